@@ -2,10 +2,72 @@
 out vec4 FragColor;
 
 in vec2 TexCoords;
+in vec3 WorldPos;
+in vec3 Normal;
+in float ViewDepth;
 
 uniform sampler2D texture_diffuse1;
+uniform sampler2DArrayShadow shadowMap;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec4 cameraPosition;
+};
+
+layout (std140) uniform Lighting
+{
+    mat4 lightSpace[4];
+    vec4 cascadeFar;
+    vec4 cascadeTexel;
+    vec4 sunDirection; // towards the sun, w = cascades
+    vec4 sunColor;
+    vec4 ambientColor;
+};
+
+const vec3 hazeColor = vec3(0.55, 0.65, 0.75);
+
+// 1 in full sun, 0 in shadow. the cascade is picked by view depth; the lookup is pushed a texel or
+// so off the surface along its normal against acne and filtered over 3x3 compared taps
+float sunVisibility(vec3 normal, float viewDepth)
+{
+    int cascades = int(sunDirection.w);
+    int cascade = 0;
+    while (cascade < cascades && viewDepth > cascadeFar[cascade])
+        cascade++;
+    if (cascade >= cascades)
+        return 1.0;
+
+    vec4 clip = lightSpace[cascade] * vec4(WorldPos + normal * cascadeTexel[cascade] * 1.5, 1.0);
+    vec3 coords = clip.xyz * 0.5 + 0.5;
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++)
+            lit += texture(shadowMap, vec4(coords.xy + vec2(x, y) * texel, float(cascade), coords.z));
+    return lit / 9.0;
+}
 
 void main()
 {    
-    FragColor = texture(texture_diffuse1, TexCoords);
-}
\ No newline at end of file
+    vec4 albedo = texture(texture_diffuse1, TexCoords);
+    vec3 toEye = cameraPosition.xyz - WorldPos;
+    float distance = length(toEye);
+
+    // meshes without normals are lit as if facing up; either side of a thin surface faces the eye
+    float normalLength = length(Normal);
+    vec3 normal = normalLength > 1e-4 ? Normal / normalLength : vec3(0.0, 1.0, 0.0);
+    if (dot(normal, toEye) < 0.0)
+        normal = -normal;
+
+    float diffuse = max(dot(normal, sunDirection.xyz), 0.0);
+    float visibility = diffuse > 0.0 ? sunVisibility(normal, ViewDepth) : 0.0;
+    // sky from above, the darker sea from below
+    vec3 ambient = ambientColor.rgb * mix(0.45, 1.0, normal.y * 0.5 + 0.5);
+    vec3 color = albedo.rgb * (ambient + sunColor.rgb * diffuse * visibility);
+
+    // the same haze the ocean fades into
+    float fog = smoothstep(3000.0, 7500.0, distance);
+    FragColor = vec4(mix(color, hazeColor, fog), albedo.a);
+}
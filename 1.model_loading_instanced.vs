@@ -0,0 +1,29 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 7) in mat4 aInstanceModel; // per instance, locations 7..10
+
+out vec2 TexCoords;
+out vec3 WorldPos;
+out vec3 Normal;
+out float ViewDepth;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec4 cameraPosition;
+};
+
+void main()
+{
+    TexCoords = aTexCoords;    
+    vec4 worldPos = aInstanceModel * vec4(aPos, 1.0);
+    WorldPos = worldPos.xyz;
+    // the game only scales models uniformly, so the model matrix itself turns the normals
+    Normal = mat3(aInstanceModel) * aNormal;
+    vec4 viewPos = view * worldPos;
+    ViewDepth = -viewPos.z;
+    gl_Position = projection * viewPos;
+}
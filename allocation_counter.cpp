@@ -0,0 +1,138 @@
+#include "allocation_counter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// plain thread_local integers: no constructor, so they are usable from the first allocation
+// of a thread to its last
+static thread_local uint64_t threadCount = 0;
+static thread_local uint64_t threadBytes = 0;
+
+AllocationCount threadAllocations()
+{
+    AllocationCount count;
+    count.allocations = threadCount;
+    count.bytes = threadBytes;
+    return count;
+}
+
+void AllocationWatch::beginFrame()
+{
+    start = threadAllocations();
+}
+
+uint64_t AllocationWatch::endFrame(bool steady)
+{
+    AllocationCount now = threadAllocations();
+    uint64_t made = now.allocations - start.allocations;
+    if (steady)
+    {
+        steadyFrames++;
+        if (made > 0)
+            allocatingFrames++;
+        allocations += made;
+        bytes += now.bytes - start.bytes;
+        maxInFrame = std::max(maxInFrame, made);
+    }
+    return made;
+}
+
+// global operator new and delete
+// ---------------------------------------------------------------------------------------------
+static void count(std::size_t size)
+{
+    threadCount++;
+    threadBytes += size;
+}
+
+static void* allocate(std::size_t size)
+{
+    count(size);
+    return std::malloc(size ? size : 1);
+}
+
+static void* allocateAligned(std::size_t size, std::size_t alignment)
+{
+    count(size);
+    size = (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment;
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    return std::aligned_alloc(alignment, size);
+#endif
+}
+
+static void freeAligned(void* pointer)
+{
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* pointer = allocate(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    if (void* pointer = allocate(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void* pointer = allocateAligned(size, static_cast<std::size_t>(alignment)))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    if (void* pointer = allocateAligned(size, static_cast<std::size_t>(alignment)))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(pointer); }
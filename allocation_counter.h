@@ -0,0 +1,38 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+// every global operator new in the process is counted per thread by the replacements in
+// allocation_counter.cpp (one thread-local increment each, always on). malloc called directly
+// (stb, Assimp, the GL driver) is not seen; standard containers and strings are.
+
+struct AllocationCount
+{
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+// since the calling thread started
+AllocationCount threadAllocations();
+
+// per-frame check of one thread: a frame marked steady must not allocate at all. frames that
+// load, upload or rebuild something are allowed to and are only counted as not steady
+class AllocationWatch
+{
+public:
+    void beginFrame();
+    // returns the allocations the calling thread made since beginFrame
+    uint64_t endFrame(bool steady);
+
+    uint64_t steadyFrames = 0;
+    uint64_t allocatingFrames = 0; // steady frames that allocated anyway
+    uint64_t allocations = 0;      // made in steady frames
+    uint64_t bytes = 0;
+    uint64_t maxInFrame = 0;
+
+private:
+    AllocationCount start;
+};
+
+#endif
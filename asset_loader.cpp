@@ -0,0 +1,115 @@
+#include "asset_loader.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+AssetLoader::~AssetLoader()
+{
+    jobs.wait(workerJobs);
+}
+
+void AssetLoader::loadCubemapAsync(const std::vector<std::string>& faces, unsigned int& texture)
+{
+    struct CubemapLoad
+    {
+        std::vector<DecodedImage> images;
+        std::atomic<int> remaining{ 0 };
+    };
+    auto load = std::make_shared<CubemapLoad>();
+    load->images.resize(faces.size());
+    load->remaining = static_cast<int>(faces.size());
+    outstanding++;
+
+    for (std::size_t i = 0; i < faces.size(); i++)
+    {
+        jobs.submit([this, load, &texture, path = faces[i], i] {
+            load->images[i] = decodeImage(path);
+            // the last face to finish hands the whole set to the render thread
+            if (--load->remaining == 0)
+                uploads.push([this, load, &texture] {
+                    texture = uploadCubemap(load->images);
+                    outstanding--;
+                });
+        }, &workerJobs);
+    }
+}
+
+void AssetLoader::loadModelAsync(const std::string& path, GpuModel& model, std::function<void(const ModelData&)> onCpuReady)
+{
+    struct ModelLoad
+    {
+        ModelData data;
+        std::vector<std::string> files;
+        std::vector<DecodedImage> images;
+        std::atomic<int> remaining{ 0 };
+    };
+    auto load = std::make_shared<ModelLoad>();
+    outstanding++;
+
+    auto finish = [this, load, &model] {
+        model.upload(load->data, &load->images);
+        outstanding--;
+    };
+
+    jobs.submit([this, load, path, onCpuReady, finish] {
+        if (!loadModelData(path, load->data))
+        {
+            outstanding--;
+            return;
+        }
+        if (onCpuReady)
+            onCpuReady(load->data);
+
+        // fan the texture decodes out; whichever finishes last queues the upload
+        load->files = modelTextureFiles(load->data);
+        load->images.resize(load->files.size());
+        load->remaining = static_cast<int>(load->files.size());
+        if (load->files.empty())
+        {
+            uploads.push(finish);
+            return;
+        }
+        for (std::size_t i = 0; i < load->files.size(); i++)
+        {
+            jobs.submit([this, load, finish, i] {
+                load->images[i] = decodeImage(load->files[i]);
+                if (--load->remaining == 0)
+                    uploads.push(finish);
+            }, &workerJobs);
+        }
+    }, &workerJobs);
+}
+
+unsigned int uploadCubemap(const std::vector<DecodedImage>& faces)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+
+    // every face needs the same number of levels; baked faces bring theirs, the rest get a CPU built chain
+    int levels = 0;
+    for (unsigned int i = 0; i < faces.size(); i++)
+    {
+        const DecodedImage& face = faces[i];
+        if (face.valid())
+        {
+            int faceLevels = uploadImageLevels(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, face, true);
+            levels = levels == 0 ? faceLevels : std::min(levels, faceLevels);
+        }
+        else
+        {
+            std::cout << "Cubemap texture failed to load at path: " << face.path << std::endl;
+        }
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, std::max(levels - 1, 0));
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    return textureID;
+}
@@ -0,0 +1,42 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include "gpu_model.h"
+#include "job_system.h"
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+// streams the startup assets in: file parsing and image decoding run on the job system, the GL
+// uploads are queued for the render loop, which keeps drawing whatever is already resident
+class AssetLoader
+{
+public:
+    explicit AssetLoader(JobSystem& jobs) : jobs(jobs) {}
+    // waits for the worker side of every load still in flight
+    ~AssetLoader();
+
+    // decodes the six faces in parallel; texture stays 0 until the cubemap is uploaded
+    void loadCubemapAsync(const std::vector<std::string>& faces, unsigned int& texture);
+    // maps/parses the model and decodes its textures in parallel; model.ready() flips after upload.
+    // onCpuReady runs on a worker with the CPU data before it is uploaded (e.g. to build a BVH)
+    void loadModelAsync(const std::string& path, GpuModel& model, std::function<void(const ModelData&)> onCpuReady = nullptr);
+
+    // main thread: runs GL uploads that became ready, within a per-frame time budget
+    void pumpUploads(double budgetMs) { uploads.drain(budgetMs); }
+    // true once every requested asset is resident on the GPU
+    bool idle() const { return outstanding.load() == 0; }
+
+private:
+    JobSystem& jobs;
+    MainThreadQueue uploads;
+    JobCounter workerJobs;
+    std::atomic<int> outstanding{ 0 };
+};
+
+// builds the cubemap texture from six decoded faces (order +X, -X, +Y, -Y, +Z, -Z)
+unsigned int uploadCubemap(const std::vector<DecodedImage>& faces);
+
+#endif
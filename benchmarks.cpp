@@ -0,0 +1,1747 @@
+#include "benchmarks.h"
+#include "bombing_evaluator.h"
+#include "collision.h"
+#include "culling.h"
+#include "flight_model.h"
+#include "instance_batcher.h"
+#include "mesh_bvh.h"
+#include "mesh_lod.h"
+#include "model_cache.h"
+#include "particles.h"
+#include "raid_ai.h"
+#include "raid_world.h"
+#include "shadow_cascades.h"
+#include "simulation.h"
+#include "spatial_hash.h"
+#include "texture_codec.h"
+#include "transform_graph.h"
+#include "world_streaming.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+static float nextRandom(uint32_t& seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+static float randomRange(uint32_t& seed, float lo, float hi)
+{
+    return lo + (hi - lo) * nextRandom(seed);
+}
+
+// results that must not be optimized away
+static volatile double benchmarkSink = 0.0;
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// ballistics
+// ---------------------------------------------------------------------------------------------
+static void fillRaid(EntityArrays& entities, std::size_t count, uint32_t seed)
+{
+    entities.clear();
+    entities.reserve(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        glm::vec3 position(randomRange(seed, -2000.0f, 2000.0f), randomRange(seed, 100.0f, 600.0f), randomRange(seed, -2000.0f, 8000.0f));
+        glm::vec3 velocity(randomRange(seed, -10.0f, 10.0f), randomRange(seed, -5.0f, 0.0f), randomRange(seed, -80.0f, -30.0f));
+        entities.spawn(position, velocity);
+    }
+}
+
+static int benchBallistics(std::size_t count, int ticks)
+{
+    const float dt = 1.0f / 60.0f;
+    const float gravity = -9.81f;
+    std::cout << "ballistics: " << count << " entities, " << ticks << " ticks" << std::endl;
+
+    // the per-entity glm::vec3 update the render loop used, as a baseline
+    {
+        std::vector<glm::vec3> positions(count), velocities(count);
+        uint32_t seed = 7u;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            positions[i] = glm::vec3(randomRange(seed, -2000.0f, 2000.0f), randomRange(seed, 100.0f, 600.0f), randomRange(seed, -2000.0f, 8000.0f));
+            velocities[i] = glm::vec3(randomRange(seed, -10.0f, 10.0f), randomRange(seed, -5.0f, 0.0f), randomRange(seed, -80.0f, -30.0f));
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < ticks; t++)
+        {
+            for (std::size_t i = 0; i < count; i++)
+            {
+                velocities[i].y += gravity * dt;
+                positions[i] += velocities[i] * dt;
+            }
+        }
+        double seconds = secondsSince(start);
+        std::cout << "  aos-glm  " << (count * (double)ticks) / seconds << " entities/sec" << std::endl;
+    }
+
+    EntityArrays reference;
+    fillRaid(reference, count, 7u);
+    for (int t = 0; t < ticks; t++)
+        integrateBallistics(reference, gravity, dt, KERNEL_SCALAR);
+
+    int result = 0;
+    for (SimdKernel kernel : { KERNEL_SCALAR, KERNEL_SSE, KERNEL_AVX2 })
+    {
+        if (!simdKernelSupported(kernel))
+        {
+            std::cout << "  " << simdKernelName(kernel) << " not supported on this CPU/build" << std::endl;
+            continue;
+        }
+
+        EntityArrays bombs;
+        fillRaid(bombs, count, 7u);
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < ticks; t++)
+            integrateBallistics(bombs, gravity, dt, kernel);
+        double seconds = secondsSince(start);
+
+        float maxError = 0.0f;
+        for (std::size_t i = 0; i < count; i++)
+            maxError = std::max(maxError, glm::length(bombs.position(i) - reference.position(i)));
+        if (maxError != 0.0f)
+            result = 1;
+
+        std::cout << "  " << simdKernelName(kernel) << "  " << (count * (double)ticks) / seconds
+                  << " entities/sec (max deviation from scalar " << maxError << ")" << std::endl;
+    }
+    return result;
+}
+
+// collision
+// ---------------------------------------------------------------------------------------------
+static bool samePairs(std::vector<CollisionPair> a, std::vector<CollisionPair> b)
+{
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return a == b;
+}
+
+// randomized check that the batched and grid paths report exactly the pairs the scalar
+// checkSphereBoxCollision finds, followed by their throughput
+static int benchCollision(std::size_t bombCount, int iterations)
+{
+    const float radius = 0.3f;
+    const std::size_t shipCount = std::max<std::size_t>(8, bombCount / 16);
+    uint32_t seed = 99u;
+
+    // carrier-sized boxes spread over the raid area, bombs clustered around them so there are hits
+    std::vector<glm::vec3> centers, halfSizes;
+    TargetBoxes boxes;
+    for (std::size_t j = 0; j < shipCount; j++)
+    {
+        centers.push_back(glm::vec3(randomRange(seed, -4000.0f, 4000.0f), -5.0f, randomRange(seed, -4000.0f, 4000.0f)));
+        halfSizes.push_back(glm::vec3(randomRange(seed, 5.0f, 15.0f), randomRange(seed, 5.0f, 10.0f), randomRange(seed, 20.0f, 100.0f)));
+        boxes.add(centers[j], halfSizes[j], static_cast<uint32_t>(j));
+    }
+    boxes.pad();
+
+    EntityArrays bombs(bombCount);
+    for (std::size_t i = 0; i < bombCount; i++)
+    {
+        const glm::vec3& target = centers[seed % shipCount];
+        const glm::vec3& half = halfSizes[seed % shipCount];
+        glm::vec3 jitter(randomRange(seed, -1.2f, 1.2f) * half.x, randomRange(seed, -1.2f, 1.2f) * half.y, randomRange(seed, -1.2f, 1.2f) * half.z);
+        std::size_t slot = bombs.spawn(target + jitter, glm::vec3(0.0f));
+        if (i % 11 == 0)
+            bombs.kill(slot);
+    }
+
+    std::vector<CollisionPair> reference;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < bombs.size(); i++)
+    {
+        if (bombs.alive[i] == 0.0f)
+            continue;
+        for (std::size_t j = 0; j < shipCount; j++)
+            if (checkSphereBoxCollision(bombs.position(i), radius, centers[j], halfSizes[j]))
+                reference.push_back({ static_cast<uint32_t>(i), static_cast<uint32_t>(j) });
+    }
+    double scalarSeconds = secondsSince(start);
+    double pairCount = double(bombCount) * double(shipCount);
+    std::cout << "collision: " << bombCount << " bombs x " << shipCount << " boxes, " << reference.size() << " hits" << std::endl;
+    std::cout << "  checkSphereBoxCollision  " << pairCount / scalarSeconds << " pairs/sec" << std::endl;
+
+    BroadphaseGrid grid;
+    grid.build(boxes, radius);
+
+    int result = 0;
+    std::vector<CollisionPair> hits;
+    for (SimdKernel kernel : { KERNEL_SCALAR, KERNEL_SSE, KERNEL_AVX2 })
+    {
+        if (!simdKernelSupported(kernel))
+        {
+            std::cout << "  " << simdKernelName(kernel) << " not supported on this CPU/build" << std::endl;
+            continue;
+        }
+
+        start = std::chrono::steady_clock::now();
+        for (int n = 0; n < iterations; n++)
+        {
+            hits.clear();
+            collideSpheresBoxes(bombs, radius, boxes, hits, kernel);
+        }
+        double batchSeconds = secondsSince(start) / iterations;
+        bool batchMatches = samePairs(hits, reference);
+
+        start = std::chrono::steady_clock::now();
+        for (int n = 0; n < iterations; n++)
+        {
+            hits.clear();
+            grid.collide(bombs, radius, hits, kernel);
+        }
+        double gridSeconds = secondsSince(start) / iterations;
+        bool gridMatches = samePairs(hits, reference);
+
+        if (!batchMatches || !gridMatches)
+            result = 1;
+        std::cout << "  " << simdKernelName(kernel) << " batched  " << pairCount / batchSeconds << " pairs/sec"
+                  << (batchMatches ? "" : " MISMATCH") << std::endl;
+        std::cout << "  " << simdKernelName(kernel) << " grid     " << pairCount / gridSeconds << " pairs/sec, "
+                  << grid.pairsTested() << " pairs tested in " << grid.cellCount() << " cells"
+                  << (gridMatches ? "" : " MISMATCH") << std::endl;
+    }
+    return result;
+}
+
+// mesh bvh
+// ---------------------------------------------------------------------------------------------
+// a long bumpy hull, roughly the proportions of the carrier in model space
+static void buildTestHull(std::size_t segments, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+{
+    const std::size_t rings = segments, around = 64;
+    for (std::size_t r = 0; r <= rings; r++)
+    {
+        float z = -3.0f + 6.0f * r / rings;
+        for (std::size_t a = 0; a < around; a++)
+        {
+            float angle = glm::two_pi<float>() * a / around;
+            float bump = 1.0f + 0.05f * std::sin(angle * 7.0f + z * 3.0f);
+            positions.push_back(glm::vec3(0.4f * bump * std::cos(angle), 0.25f * bump * std::sin(angle), z));
+        }
+    }
+    for (std::size_t r = 0; r < rings; r++)
+        for (std::size_t a = 0; a < around; a++)
+        {
+            uint32_t i0 = static_cast<uint32_t>(r * around + a);
+            uint32_t i1 = static_cast<uint32_t>(r * around + (a + 1) % around);
+            uint32_t i2 = i0 + static_cast<uint32_t>(around), i3 = i1 + static_cast<uint32_t>(around);
+            indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+        }
+}
+
+static int benchBvh(std::size_t segments, int queries)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    buildTestHull(segments, positions, indices);
+
+    MeshBvh bvh;
+    auto start = std::chrono::steady_clock::now();
+    bvh.build(positions, indices);
+    double buildSeconds = secondsSince(start);
+    std::cout << "bvh: " << bvh.triangleCount() << " triangles, " << bvh.nodeCount() << " nodes ("
+              << bvh.nodeCount() * sizeof(BvhNode) / 1024 << " KiB), built in " << buildSeconds * 1000.0 << " ms" << std::endl;
+
+    uint32_t seed = 5u;
+    std::vector<glm::vec3> centers, origins, directions;
+    for (int q = 0; q < queries; q++)
+    {
+        centers.push_back(glm::vec3(randomRange(seed, -0.6f, 0.6f), randomRange(seed, -0.4f, 0.4f), randomRange(seed, -3.2f, 3.2f)));
+        origins.push_back(glm::vec3(randomRange(seed, -0.6f, 0.6f), 2.0f, randomRange(seed, -3.2f, 3.2f)));
+        directions.push_back(glm::vec3(randomRange(seed, -0.5f, 0.5f), -4.0f, randomRange(seed, -0.5f, 0.5f)));
+    }
+    const float radius = 0.3f / 60.0f; // bombHitRadius in carrier model space
+
+    int mismatches = 0, sphereHits = 0, rayHits = 0;
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++)
+        sphereHits += bvh.intersectSphere(centers[q], radius);
+    double sphereSeconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++)
+    {
+        float t;
+        rayHits += bvh.intersectRay(origins[q], directions[q], 1.0f, t);
+    }
+    double raySeconds = secondsSince(start);
+    // the bomb's sphere over a step, as stepSimulation sweeps it
+    int sweptHits = 0;
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++)
+    {
+        float t;
+        sweptHits += bvh.intersectSweptSphere(origins[q], directions[q], radius, 1.0f, t);
+    }
+    double sweptSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++)
+    {
+        float tTree = 0.0f, tBrute = 0.0f;
+        if (bvh.intersectSphere(centers[q], radius) != bvh.intersectSphereBruteForce(centers[q], radius))
+            mismatches++;
+        bool treeHit = bvh.intersectRay(origins[q], directions[q], 1.0f, tTree);
+        bool bruteHit = bvh.intersectRayBruteForce(origins[q], directions[q], 1.0f, tBrute);
+        if (treeHit != bruteHit || (treeHit && tTree != tBrute))
+            mismatches++;
+        treeHit = bvh.intersectSweptSphere(origins[q], directions[q], radius, 1.0f, tTree);
+        bruteHit = bvh.intersectSweptSphereBruteForce(origins[q], directions[q], radius, 1.0f, tBrute);
+        if (treeHit != bruteHit || (treeHit && tTree != tBrute))
+            mismatches++;
+    }
+    double bruteSeconds = secondsSince(start);
+
+    std::cout << "  sphere  " << sphereSeconds * 1e6 / queries << " us/query (" << sphereHits << " hits)" << std::endl;
+    std::cout << "  ray     " << raySeconds * 1e6 / queries << " us/query (" << rayHits << " hits)" << std::endl;
+    std::cout << "  swept   " << sweptSeconds * 1e6 / queries << " us/query (" << sweptHits << " hits)" << std::endl;
+    std::cout << "  brute force sphere+ray+swept  " << bruteSeconds * 1e6 / queries << " us/query, "
+              << mismatches << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// model cache
+// ---------------------------------------------------------------------------------------------
+template <typename T>
+static bool sameArray(const T* a, const T* b, uint32_t count)
+{
+    return count == 0 || std::memcmp(a, b, count * sizeof(T)) == 0;
+}
+
+static bool sameModelData(const ModelData& a, const ModelData& b)
+{
+    return a.vertexCount == b.vertexCount && a.indexCount == b.indexCount && a.meshCount == b.meshCount &&
+           a.materialCount == b.materialCount && a.textureCount == b.textureCount && a.stringBytes == b.stringBytes &&
+           sameArray(a.vertices, b.vertices, a.vertexCount) && sameArray(a.indices, b.indices, a.indexCount) &&
+           sameArray(a.meshes, b.meshes, a.meshCount) && sameArray(a.materials, b.materials, a.materialCount) &&
+           sameArray(a.textures, b.textures, a.textureCount) && sameArray(a.strings, b.strings, a.stringBytes) &&
+           sameArray(a.lods, b.lods, a.meshCount * MODEL_LOD_LEVELS) &&
+           std::memcmp(a.lodError, b.lodError, sizeof(a.lodError)) == 0 && a.boundsMin == b.boundsMin && a.boundsMax == b.boundsMax && a.directory == b.directory;
+}
+
+// round trip of every game model through the binary cache, checked against what Assimp produced,
+// and the startup cost of both paths. CPU only: nothing is uploaded.
+static int benchModelCache(const std::vector<std::string>& paths, int iterations)
+{
+    int result = 0;
+    double totalAssimp = 0.0, totalCache = 0.0;
+    for (const std::string& path : paths)
+    {
+        ModelData parsed;
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < iterations; n++)
+            if (!loadModelAssimp(path, parsed))
+                return 1;
+        double assimpSeconds = secondsSince(start) / iterations;
+
+        std::string roundTripPath = modelCachePath(path) + ".roundtrip";
+        if (!writeModelCache(roundTripPath, path, parsed))
+        {
+            std::cout << "  failed to write " << roundTripPath << std::endl;
+            return 1;
+        }
+
+        ModelData cached;
+        double checksum = 0.0;
+        start = std::chrono::steady_clock::now();
+        for (int n = 0; n < iterations; n++)
+        {
+            if (!loadModelCache(roundTripPath, path, cached))
+                return 1;
+            // touch every vertex so the mapped pages are really read, as an upload would
+            for (uint32_t i = 0; i < cached.vertexCount; i++)
+                checksum += cached.vertices[i].position[0];
+        }
+        double cacheSeconds = secondsSince(start) / iterations;
+
+        benchmarkSink = checksum;
+
+        bool matches = sameModelData(parsed, cached);
+        if (!matches)
+            result = 1;
+        std::remove(roundTripPath.c_str());
+
+        totalAssimp += assimpSeconds;
+        totalCache += cacheSeconds;
+        std::cout << "  " << path << ": " << parsed.meshCount << " meshes, " << parsed.vertexCount << " vertices, assimp "
+                  << assimpSeconds * 1000.0 << " ms, cache " << cacheSeconds * 1000.0 << " ms"
+                  << (matches ? "" : " ROUND TRIP MISMATCH") << std::endl;
+    }
+    std::cout << "model-cache: assimp " << totalAssimp * 1000.0 << " ms, cache " << totalCache * 1000.0 << " ms total" << std::endl;
+    return result;
+}
+
+// instancing
+// ---------------------------------------------------------------------------------------------
+// a raid's worth of objects submitted in scene order and batched per frame the way the render loop
+// does it, against the draw calls and uploads one Draw() per object would cost. no GPU involved.
+static int benchInstancing(const std::vector<std::string>& paths, std::size_t count, int frames)
+{
+    // mesh counts of the game models (plane, carrier, bomb, explosion); 1 each when they cannot be read
+    std::vector<uint32_t> meshCounts(4, 1);
+    for (std::size_t m = 0; m < paths.size() && m < meshCounts.size(); m++)
+    {
+        ModelData data;
+        if (loadModelData(paths[m], data))
+            meshCounts[m] = std::max(data.meshCount, 1u);
+    }
+
+    // mostly bombs in the air, then planes, some explosions and a few carriers
+    uint32_t seed = 13u;
+    std::vector<uint32_t> models(count);
+    std::vector<glm::mat4> matrices(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        float pick = nextRandom(seed);
+        models[i] = pick < 0.6f ? 2u : pick < 0.85f ? 0u : pick < 0.98f ? 3u : 1u;
+        matrices[i] = glm::mat4(1.0f);
+        matrices[i][3] = glm::vec4(randomRange(seed, -2000.0f, 2000.0f), randomRange(seed, 0.0f, 600.0f), randomRange(seed, -2000.0f, 8000.0f), 1.0f);
+    }
+
+    InstanceBatcher batcher;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        batcher.clear();
+        for (std::size_t i = 0; i < count; i++)
+            batcher.add(models[i], matrices[i]);
+        batcher.build();
+    }
+    double seconds = secondsSince(start) / frames;
+
+    // every batch holds exactly its model's matrices, in submission order
+    int mismatches = 0;
+    for (const InstanceBatch& batch : batcher.batches())
+    {
+        uint32_t next = batch.firstInstance;
+        for (std::size_t i = 0; i < count; i++)
+            if (models[i] == batch.model && batcher.matrices()[next++] != matrices[i])
+                mismatches++;
+        if (next != batch.firstInstance + batch.instanceCount)
+            mismatches++;
+    }
+
+    DrawStats instanced = batcher.instancedStats(meshCounts);
+    DrawStats perObject = batcher.perObjectStats(meshCounts);
+    std::cout << "instancing: " << count << " objects in " << batcher.batches().size() << " batches, batched in "
+              << seconds * 1000.0 << " ms/frame (" << count / seconds << " objects/sec)" << std::endl;
+    std::cout << "  per object  " << perObject.drawCalls << " draw calls, " << perObject.uploads << " uploads, " << perObject.bytes << " bytes" << std::endl;
+    std::cout << "  instanced   " << instanced.drawCalls << " draw calls, " << instanced.uploads << " uploads, " << instanced.bytes << " bytes, "
+              << mismatches << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// textures
+// ---------------------------------------------------------------------------------------------
+static RgbaImage makeTestImage(int kind, int size, uint32_t seed)
+{
+    RgbaImage image;
+    image.width = image.height = size;
+    image.pixels.resize(std::size_t(size) * size * 4);
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            uint8_t* pixel = &image.pixels[(std::size_t(y) * size + x) * 4];
+            float u = x / float(size), v = y / float(size);
+            if (kind == 0)
+            {
+                // sky-like smooth gradient
+                pixel[0] = static_cast<uint8_t>(60 + 120 * v);
+                pixel[1] = static_cast<uint8_t>(110 + 100 * v + 20 * u);
+                pixel[2] = static_cast<uint8_t>(200 + 50 * u * v);
+            }
+            else if (kind == 1)
+            {
+                // painted metal: a base colour with per pixel grain
+                float grain = randomRange(seed, -24.0f, 24.0f);
+                pixel[0] = static_cast<uint8_t>(std::min(std::max(90.0f + 40.0f * u + grain, 0.0f), 255.0f));
+                pixel[1] = static_cast<uint8_t>(std::min(std::max(95.0f + 20.0f * v + grain, 0.0f), 255.0f));
+                pixel[2] = static_cast<uint8_t>(std::min(std::max(85.0f + grain, 0.0f), 255.0f));
+            }
+            else
+            {
+                // deck planks and markings: hard edges between flat colours
+                bool stripe = ((x / 6) + (y / 23)) % 2 == 0;
+                bool marking = std::abs(x - size / 2) < size / 16;
+                pixel[0] = marking ? 230 : (stripe ? 150 : 120);
+                pixel[1] = marking ? 230 : (stripe ? 110 : 85);
+                pixel[2] = marking ? 220 : (stripe ? 70 : 50);
+            }
+            pixel[3] = 255;
+        }
+    }
+    return image;
+}
+
+// peak signal to noise ratio of the RGB channels
+static double imagePsnr(const RgbaImage& a, const RgbaImage& b)
+{
+    double squared = 0.0;
+    for (std::size_t i = 0; i < a.pixels.size(); i++)
+    {
+        if (i % 4 == 3)
+            continue;
+        double d = double(a.pixels[i]) - double(b.pixels[i]);
+        squared += d * d;
+    }
+    double mse = squared / (a.pixels.size() / 4 * 3);
+    return mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+// fixed blocks with a known answer: a block whose colours all lie on a BC1 palette must come back
+// exactly, and a punch-through block must keep its transparent pixels
+static int checkReferenceBlocks()
+{
+    int failures = 0;
+    const uint8_t references[][8] = {
+        { 0x00, 0xf8, 0x1f, 0x00, 0xe4, 0x1b, 0x4e, 0xb1 }, // red -> blue, 4 colour mode
+        { 0xe0, 0x07, 0xff, 0xff, 0x1b, 0xe4, 0x00, 0xff }, // green, white, 3 colour mode with transparent pixels
+        { 0x41, 0x08, 0x41, 0x08, 0x00, 0x00, 0x00, 0x00 }, // flat dark grey
+    };
+    for (const uint8_t* reference : references)
+    {
+        uint8_t pixels[64], encoded[8], decoded[64];
+        decodeBc1Block(reference, pixels);
+        encodeBc1Block(pixels, encoded);
+        decodeBc1Block(encoded, decoded);
+        if (std::memcmp(pixels, decoded, sizeof(pixels)) != 0)
+            failures++;
+    }
+    return failures;
+}
+
+// the offline encoder and the loader's CPU decode path on synthetic images: quality of every mip
+// level against the uncompressed chain, DDS round trip, throughput and memory per texture
+static int benchTexture(int size, int iterations)
+{
+    int result = 0;
+    int referenceFailures = checkReferenceBlocks();
+    std::cout << "texture: reference blocks " << (referenceFailures == 0 ? "exact" : "MISMATCH") << std::endl;
+    if (referenceFailures)
+        result = 1;
+
+    static const char* names[] = { "gradient", "grain", "edges" };
+    static const double minimumPsnr[] = { 36.0, 32.0, 34.0 };
+    std::string ddsPath = (std::filesystem::temp_directory_path() / "bench_texture.dds").string();
+    for (int kind = 0; kind < 3; kind++)
+    {
+        RgbaImage image = makeTestImage(kind, size, 11u + kind);
+
+        CompressedTexture texture;
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < iterations; n++)
+            texture = compressTexture(image);
+        double encodeSeconds = secondsSince(start) / iterations;
+
+        std::vector<RgbaImage> decoded(texture.levelCount());
+        start = std::chrono::steady_clock::now();
+        for (int level = 0; level < texture.levelCount(); level++)
+            decoded[level] = decompressBc1(texture.levelData(level), texture.levelWidth(level), texture.levelHeight(level));
+        double decodeSeconds = secondsSince(start);
+
+        std::vector<RgbaImage> reference = buildMipChain(image);
+        double worstPsnr = 99.0;
+        std::size_t rawBytes = 0;
+        for (std::size_t level = 0; level < reference.size() && level < decoded.size(); level++)
+        {
+            rawBytes += reference[level].pixels.size();
+            // the 1x1 .. 8x8 tail is a handful of blocks, judge quality on the levels that are seen
+            if (reference[level].width >= 16)
+                worstPsnr = std::min(worstPsnr, imagePsnr(reference[level], decoded[level]));
+        }
+
+        CompressedTexture reloaded;
+        bool roundTrip = writeDds(ddsPath, "", texture) && readDds(ddsPath, "", reloaded) &&
+                         reloaded.width == texture.width && reloaded.height == texture.height &&
+                         reloaded.levelCount() == texture.levelCount() && reloaded.blocks == texture.blocks;
+        std::remove(ddsPath.c_str());
+
+        bool good = roundTrip && texture.levelCount() == static_cast<int>(reference.size()) && worstPsnr >= minimumPsnr[kind];
+        if (!good)
+            result = 1;
+        double megapixels = size * double(size) * 4.0 / 3.0 / 1e6;
+        std::cout << "  " << names[kind] << " " << size << "x" << size << ": " << texture.levelCount() << " levels, worst "
+                  << worstPsnr << " dB, encode " << megapixels / encodeSeconds << " Mpix/s, decode "
+                  << megapixels / decodeSeconds << " Mpix/s, " << rawBytes / 1024 << " KiB RGBA8 -> "
+                  << texture.blocks.size() / 1024 << " KiB BC1" << (roundTrip ? "" : " DDS ROUND TRIP MISMATCH")
+                  << (good ? "" : " FAILED") << std::endl;
+    }
+    return result;
+}
+
+// the per-object matrices the render loop used to build directly for one aircraft
+struct AircraftMatrices
+{
+    glm::mat4 planeModel, cockpit, bombModel, bombHitbox;
+};
+
+static AircraftMatrices directAircraftMatrices(const SimState& state, float yaw, float pitch, glm::vec3 cockpitOffset, float yawOffset,
+                                               float pitchOffset, float planeScale, float bombScale)
+{
+    AircraftMatrices m;
+    glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(yaw), glm::vec3(0, 1, 0));
+    rotation = glm::rotate(rotation, glm::radians(-pitch), glm::vec3(1, 0, 0));
+    rotation = glm::rotate(rotation, glm::radians(-state.plane.roll), glm::vec3(0, 0, 1));
+    glm::mat4 camera = glm::rotate(rotation, glm::radians(yawOffset), glm::vec3(0, 1, 0));
+    camera = glm::rotate(camera, glm::radians(pitchOffset), glm::vec3(1, 0, 0));
+    camera[3] = glm::vec4(state.plane.position + glm::vec3(rotation * glm::vec4(cockpitOffset, 1.0f)), 1.0f);
+    m.cockpit = camera;
+
+    glm::vec3 bombPosition = state.plane.position + glm::vec3(rotation * glm::vec4(state.bombOffsetLocal, 1.0f));
+    m.bombModel = glm::translate(glm::mat4(1.0f), bombPosition) * rotation;
+    m.bombModel = glm::rotate(m.bombModel, glm::radians(90.0f), glm::vec3(0, 1, 0));
+    m.bombModel = glm::scale(m.bombModel, glm::vec3(bombScale));
+    m.bombHitbox = glm::scale(glm::translate(glm::mat4(1.0f), bombPosition) * rotation, glm::vec3(state.bombHitRadius));
+
+    m.planeModel = glm::translate(glm::mat4(1.0f), state.plane.position);
+    m.planeModel = glm::scale(m.planeModel, glm::vec3(planeScale));
+    m.planeModel = glm::rotate(m.planeModel, glm::radians(180.0f + yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+    m.planeModel = glm::rotate(m.planeModel, glm::radians(pitch), glm::vec3(1.0f, 0.0f, 0.0f));
+    m.planeModel = glm::rotate(m.planeModel, glm::radians(state.plane.roll), glm::vec3(0.0f, 0.0f, 1.0f));
+    return m;
+}
+
+static float matrixError(const glm::mat4& a, const glm::mat4& b)
+{
+    float error = 0.0f;
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++)
+            error = std::max(error, std::fabs(a[c][r] - b[c][r]));
+    return error;
+}
+
+static int benchTransforms(std::size_t count, int frames)
+{
+    const float planeScale = 0.2f, bombScale = 5.0f;
+    const glm::vec3 cockpitOffset(0.0f, 0.9f, -0.45f);
+
+    uint32_t seed = 21u;
+    std::vector<SimState> planes(count);
+    std::vector<float> yaws(count), pitches(count), yawOffsets(count, 0.0f), pitchOffsets(count, 0.0f);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        planes[i].plane.position = glm::vec3(randomRange(seed, -2000.0f, 2000.0f), randomRange(seed, 150.0f, 600.0f), randomRange(seed, -2000.0f, 8000.0f));
+        yaws[i] = randomRange(seed, -180.0f, 180.0f);
+        pitches[i] = randomRange(seed, -10.0f, 10.0f);
+        planes[i].plane.orientation = flightOrientation(yaws[i], pitches[i]);
+    }
+
+    TransformGraph graph;
+    std::vector<AircraftRig> rigs;
+    for (const SimState& state : planes)
+        rigs.push_back(addAircraftRig(graph, state, planeScale, bombScale));
+    addShipRig(graph, SimState());
+    graph.update();
+
+    // every frame three planes in four fly and bank a little (the rest are parked); one pilot in eight moves the mouse
+    auto fly = [&](int frame) {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (i % 4 == 0)
+                continue;
+            SimState& state = planes[i];
+            yaws[i] += 0.3f;
+            state.plane.orientation = flightOrientation(yaws[i], pitches[i]);
+            state.plane.roll = 10.0f * std::sin(0.01f * frame + i);
+            state.plane.position.z -= 0.8f;
+            if ((i + frame) % 8 == 0)
+                yawOffsets[i] = std::fmod(yawOffsets[i] + 1.0f, 90.0f);
+        }
+    };
+
+    std::size_t recomputed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        fly(frame);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            updateAircraftRig(graph, rigs[i], planes[i]);
+            setCockpitView(graph, rigs[i], cockpitOffset, yawOffsets[i], pitchOffsets[i]);
+        }
+        recomputed += graph.update();
+    }
+    double graphSeconds = secondsSince(start) / frames;
+
+    double sink = 0.0;
+    start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        fly(frames + frame);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            AircraftMatrices m = directAircraftMatrices(planes[i], yaws[i], pitches[i], cockpitOffset, yawOffsets[i], pitchOffsets[i], planeScale, bombScale);
+            sink += m.planeModel[3][0] + m.cockpit[3][1] + m.bombModel[3][2] + m.bombHitbox[3][0];
+        }
+        sink += shipModelMatrix(SimState())[3][0];
+    }
+    double directSeconds = secondsSince(start) / frames;
+    benchmarkSink = sink;
+
+    // the graph has to give the same matrices as the direct chains (bombs are all on their hardpoints)
+    for (std::size_t i = 0; i < count; i++)
+    {
+        updateAircraftRig(graph, rigs[i], planes[i]);
+        setCockpitView(graph, rigs[i], cockpitOffset, yawOffsets[i], pitchOffsets[i]);
+    }
+    graph.update();
+    float worst = 0.0f;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        AircraftMatrices m = directAircraftMatrices(planes[i], yaws[i], pitches[i], cockpitOffset, yawOffsets[i], pitchOffsets[i], planeScale, bombScale);
+        float scale = 1.0f / std::max(1.0f, glm::length(planes[i].plane.position));
+        worst = std::max(worst, matrixError(graph.world(rigs[i].planeModel), m.planeModel) * scale);
+        worst = std::max(worst, matrixError(graph.world(rigs[i].cockpit), m.cockpit) * scale);
+        worst = std::max(worst, matrixError(graph.world(rigs[i].bombModel), m.bombModel) * scale);
+        worst = std::max(worst, matrixError(graph.world(rigs[i].bombHitbox), m.bombHitbox) * scale);
+    }
+    bool ok = worst < 1e-5f;
+
+    std::cout << "transforms: " << count << " aircraft, " << graph.size() << " nodes, " << recomputed / double(frames) << " world matrices recomputed per frame" << std::endl;
+    std::cout << "  direct chains  " << directSeconds * 1000.0 << " ms/frame" << std::endl;
+    std::cout << "  graph          " << graphSeconds * 1000.0 << " ms/frame (" << directSeconds / graphSeconds << "x), max relative error "
+              << worst << (ok ? "" : " MISMATCH") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// a climbing left turn with throttle, flown for seconds at frame length dt
+static FlightBody flyTurn(const FlightParams& params, float dt, float seconds)
+{
+    FlightBody body;
+    FlightControls controls;
+    controls.turn = 1.0f;
+    controls.pitch = -0.5f;
+    controls.throttle = 1.0f;
+    int frames = static_cast<int>(seconds / dt + 0.5f);
+    for (int frame = 0; frame < frames; frame++)
+        stepFlight(body, controls, params, dt);
+    return body;
+}
+
+static int benchFlight(std::size_t count, int frames)
+{
+    // the same manoeuvre at different frame rates has to end up in the same place
+    FlightParams params;
+    FlightParams reference = params;
+    reference.maxSubstep = 1.0f / 4800.0f;
+    FlightBody exact = flyTurn(reference, 1.0f / 240.0f, 30.0f);
+    float worst = 0.0f;
+    std::cout << "flight: 30 s climbing turn, distance from a 4800 Hz reference:" << std::endl;
+    for (float rate : { 20.0f, 30.0f, 60.0f, 144.0f, 240.0f })
+    {
+        FlightBody body = flyTurn(params, 1.0f / rate, 30.0f);
+        float error = glm::length(body.position - exact.position);
+        worst = std::max(worst, error);
+        std::cout << "  " << rate << " fps  " << error << " m" << std::endl;
+    }
+
+    // a formation spread over the sky, everyone weaving on their own controls
+    uint32_t seed = 5u;
+    FlightFormation formation;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        FlightBody body;
+        body.position = glm::vec3(randomRange(seed, -2000.0f, 2000.0f), randomRange(seed, 150.0f, 600.0f), randomRange(seed, -2000.0f, 8000.0f));
+        body.orientation = flightOrientation(randomRange(seed, -180.0f, 180.0f), randomRange(seed, -10.0f, 10.0f));
+        formation.add(body);
+        FlightControls controls;
+        controls.turn = randomRange(seed, -1.0f, 1.0f);
+        controls.pitch = randomRange(seed, -0.2f, 0.2f);
+        controls.throttle = nextRandom(seed) < 0.5f ? 0.0f : 1.0f;
+        formation.setControls(i, controls);
+    }
+    const float dt = 1.0f / 60.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+        formation.step(params, dt);
+    double seconds = secondsSince(start) / frames;
+    benchmarkSink = formation.body(count / 2).position.x;
+
+    // two substeps of 1/120 s per 60 Hz frame
+    std::cout << "flight: " << count << " aircraft, " << seconds * 1000.0 << " ms/frame at 60 Hz (" << count / seconds
+              << " aircraft steps/sec, " << static_cast<int>(std::ceil(dt / params.maxSubstep)) << " substeps each)" << std::endl;
+    bool ok = worst < 1.0f;
+    if (!ok)
+        std::cout << "flight: MISMATCH, frame rate changes the path by " << worst << " m" << std::endl;
+    return ok ? 0 : 1;
+}
+
+// culling
+// ---------------------------------------------------------------------------------------------
+// any corner inside the clip volume means the box is visible, so the plane test must keep it
+static bool cornerVisible(const glm::mat4& viewProjection, glm::vec3 boxMin, glm::vec3 boxMax)
+{
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec4 clip = viewProjection * glm::vec4(corner & 1 ? boxMax.x : boxMin.x, corner & 2 ? boxMax.y : boxMin.y, corner & 4 ? boxMax.z : boxMin.z, 1.0f);
+        if (std::fabs(clip.x) <= clip.w && std::fabs(clip.y) <= clip.w && std::fabs(clip.z) <= clip.w)
+            return true;
+    }
+    return false;
+}
+
+static int benchCulling(std::size_t count, int frames)
+{
+    int failures = 0;
+
+    // levels of detail of the test hull, clustered the way loadModelAssimp does it
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    buildTestHull(1000, positions, indices);
+    glm::vec3 hullMin(FLT_MAX), hullMax(-FLT_MAX);
+    for (const glm::vec3& p : positions)
+    {
+        hullMin = glm::min(hullMin, p);
+        hullMax = glm::max(hullMax, p);
+    }
+    glm::vec3 extent = hullMax - hullMin;
+    float longest = std::max(extent.x, std::max(extent.y, extent.z));
+    const float gridCells[MODEL_LOD_LEVELS] = { 0.0f, 96.0f, 32.0f, 10.0f };
+    float lodError[MODEL_LOD_LEVELS] = {};
+    std::size_t previousTriangles = indices.size() / 3;
+    std::cout << "culling: test hull levels of detail (" << previousTriangles << " triangles)" << std::endl;
+    std::vector<uint32_t> simplified;
+    for (uint32_t level = 1; level < MODEL_LOD_LEVELS; level++)
+    {
+        float cellSize = longest / gridCells[level];
+        auto start = std::chrono::steady_clock::now();
+        lodError[level] = clusterSimplify(&positions[0].x, sizeof(glm::vec3), static_cast<uint32_t>(positions.size()), indices.data(),
+                                          static_cast<uint32_t>(indices.size()), hullMin, cellSize, simplified);
+        double seconds = secondsSince(start);
+        std::size_t triangles = simplified.size() / 3;
+        std::cout << "  level " << level << "  " << triangles << " triangles, error " << lodError[level] << " (cell " << cellSize
+                  << "), " << seconds * 1000.0 << " ms" << std::endl;
+        // a vertex never moves further than the diagonal of its cell, and coarser levels must get smaller
+        if (lodError[level] > cellSize * std::sqrt(3.0f) || triangles >= previousTriangles || triangles == 0)
+            failures++;
+        previousTriangles = triangles;
+    }
+
+    // the carrier as the bomber sees it on its run in: level and projected size against distance
+    const float fov = glm::radians(45.0f), width = 800.0f, height = 600.0f;
+    glm::mat4 projection = glm::perspective(fov, width / height, 0.1f, 8000.0f);
+    ViewCuller culler;
+    std::cout << "  carrier at 60x:";
+    for (float distance : { 300.0f, 600.0f, 1200.0f, 2500.0f, 5000.0f, 7500.0f })
+    {
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 400.0f, distance), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        culler.setView(projection, view, fov, height);
+        glm::mat4 ship = glm::scale(glm::mat4(1.0f), glm::vec3(60.0f));
+        std::cout << " " << distance << " m -> " << culler.select(hullMin, hullMax, lodError, MODEL_LOD_LEVELS, ship);
+    }
+    std::cout << std::endl;
+
+    // a raid of aircraft sized objects around a camera flying through it, turning a little every frame
+    uint32_t seed = 7u;
+    std::vector<glm::mat4> matrices;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(randomRange(seed, -4000.0f, 4000.0f), randomRange(seed, 0.0f, 800.0f),
+                                                                     randomRange(seed, -4000.0f, 4000.0f)));
+        matrix = glm::rotate(matrix, randomRange(seed, 0.0f, glm::two_pi<float>()), glm::vec3(0.0f, 1.0f, 0.0f));
+        matrices.push_back(glm::scale(matrix, glm::vec3(randomRange(seed, 0.2f, 1.0f))));
+    }
+    const glm::vec3 objectMin(-8.0f, -2.0f, -6.0f), objectMax(8.0f, 2.0f, 6.0f);
+    const float objectError[MODEL_LOD_LEVELS] = { 0.0f, 0.1f, 0.3f, 1.0f };
+
+    InstanceBatcher batcher;
+    uint64_t visible = 0, missed = 0;
+    CullStats total;
+    double seconds = 0.0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        float heading = 0.01f * frame;
+        glm::vec3 eye(0.0f, 400.0f, 0.0f);
+        glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(std::sin(heading), -0.2f, -std::cos(heading)), glm::vec3(0.0f, 1.0f, 0.0f));
+        auto start = std::chrono::steady_clock::now();
+        culler.setView(projection, view, fov, height);
+        batcher.clear();
+        for (std::size_t i = 0; i < count; i++)
+        {
+            int lod = culler.select(objectMin, objectMax, objectError, MODEL_LOD_LEVELS, matrices[i]);
+            if (lod >= 0)
+                batcher.add(static_cast<uint32_t>(lod), matrices[i]);
+        }
+        batcher.build();
+        seconds += secondsSince(start);
+        visible += batcher.instanceCount();
+
+        // the plane test may keep objects it cannot see, never drop ones it can
+        glm::mat4 viewProjection = projection * view;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            glm::vec3 worldMin, worldMax;
+            transformBounds(matrices[i], objectMin, objectMax, worldMin, worldMax);
+            if (!boxInFrustum(culler.frustum, worldMin, worldMax) && cornerVisible(viewProjection * matrices[i], objectMin, objectMax))
+                missed++;
+        }
+        total.tested += culler.stats.tested;
+        total.outsideFrustum += culler.stats.outsideFrustum;
+        total.tooSmall += culler.stats.tooSmall;
+        for (uint32_t level = 0; level < MODEL_LOD_LEVELS; level++)
+            total.drawn[level] += culler.stats.drawn[level];
+    }
+    seconds /= frames;
+    std::cout << "culling: " << count << " objects, " << seconds * 1000.0 << " ms/frame (" << count / seconds / 1e6
+              << " M objects/sec), " << visible / frames << " submitted per frame" << std::endl;
+    std::cout << "  per frame: " << total.outsideFrustum / frames << " outside the frustum, " << total.tooSmall / frames
+              << " under a pixel, by level";
+    for (uint32_t level = 0; level < MODEL_LOD_LEVELS; level++)
+        std::cout << " " << total.drawn[level] / frames;
+    std::cout << std::endl;
+    if (missed > 0)
+        std::cout << "culling: MISMATCH, " << missed << " visible objects culled" << std::endl;
+    if (failures > 0)
+        std::cout << "culling: MISMATCH, " << failures << " levels of detail out of bounds" << std::endl;
+    return missed == 0 && failures == 0 ? 0 : 1;
+}
+
+// particles
+// ---------------------------------------------------------------------------------------------
+// a salvo: explosions on and around the carrier and splashes where bombs missed, until the pool is full
+static void fillSalvo(ParticlePool& particles, uint32_t seed)
+{
+    particles.clear();
+    while (particles.size() < particles.capacity())
+    {
+        glm::vec3 position(randomRange(seed, -40.0f, 40.0f), randomRange(seed, 0.0f, 15.0f), randomRange(seed, -250.0f, 250.0f));
+        if (nextRandom(seed) < 0.6f)
+            particles.emitExplosion(position, randomRange(seed, 0.5f, 1.5f));
+        else
+            particles.emitSplash(glm::vec3(position.x * 3.0f, 0.0f, position.z), randomRange(seed, 0.5f, 1.5f));
+    }
+}
+
+static int benchParticles(std::size_t count, int frames)
+{
+    const float dt = 1.0f / 60.0f;
+    std::cout << "particles: " << count << " particles, " << frames << " frames" << std::endl;
+
+    ParticlePool reference(count);
+    fillSalvo(reference, 11u);
+    for (int f = 0; f < frames; f++)
+        reference.integrate(dt, KERNEL_SCALAR);
+
+    // the update kernel alone, on a full pool
+    int result = 0;
+    for (SimdKernel kernel : { KERNEL_SCALAR, KERNEL_SSE, KERNEL_AVX2 })
+    {
+        if (!simdKernelSupported(kernel))
+        {
+            std::cout << "  " << simdKernelName(kernel) << " not supported on this CPU/build" << std::endl;
+            continue;
+        }
+
+        ParticlePool particles(count);
+        fillSalvo(particles, 11u);
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++)
+            particles.integrate(dt, kernel);
+        double seconds = secondsSince(start);
+
+        float maxError = 0.0f;
+        for (std::size_t i = 0; i < particles.size(); i++)
+            maxError = std::max(maxError, glm::length(particles.position(i) - reference.position(i)));
+        if (maxError != 0.0f)
+            result = 1;
+
+        std::cout << "  " << simdKernelName(kernel) << "  " << (particles.size() * (double)frames) / (seconds * 1000.0)
+                  << " particles/ms (max deviation from scalar " << maxError << ")" << std::endl;
+    }
+
+    // whole frames of a running salvo: new effects replace the expired ones, then update, compaction and
+    // the vertex build the renderer uploads
+    {
+        ParticlePool particles(count);
+        std::vector<ParticleVertex> vertices(particles.capacity());
+        fillSalvo(particles, 11u);
+        particles.stats = ParticleStats();
+        uint32_t seed = 13u;
+        uint64_t updated = 0, built = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++)
+        {
+            while (particles.size() + 144 <= particles.capacity())
+                particles.emitExplosion(glm::vec3(randomRange(seed, -40.0f, 40.0f), randomRange(seed, 0.0f, 15.0f), randomRange(seed, -250.0f, 250.0f)), 1.0f);
+            updated += particles.size();
+            particles.update(dt, bestSimdKernel());
+            built += particles.buildVertices(vertices.data());
+        }
+        double seconds = secondsSince(start);
+        benchmarkSink = benchmarkSink + vertices[0].size;
+        std::cout << "  frame    " << updated / (seconds * 1000.0) << " particles/ms with emission, compaction and vertices ("
+                  << built / frames << " drawn per frame, " << particles.stats.expired << " expired, " << particles.stats.dropped
+                  << " dropped)" << std::endl;
+        if (particles.stats.dropped != 0)
+            result = 1;
+    }
+    return result;
+}
+
+// world streaming
+// ---------------------------------------------------------------------------------------------
+// spacing between adjacent floats around a coordinate, the best precision a position there can have
+static double floatSpacing(float value)
+{
+    float magnitude = std::fabs(value);
+    return static_cast<double>(std::nextafter(magnitude, FLT_MAX) - magnitude);
+}
+
+// one long straight flight at a fixed speed; the error is against the same steps added up in double
+struct LongFlight
+{
+    double maxError = 0.0;
+    double finalSpacing = 0.0;
+    float maxLocal = 0.0f;
+    double absoluteX = 0.0;
+    double absoluteZ = 0.0;
+};
+
+static LongFlight flyLong(float headingDegrees, float speed, int ticks, bool rebase, WorldStreamer* world, bool& withinBounds)
+{
+    const float dt = 1.0f / 60.0f;
+    SimState state;
+    state.flight.minSpeed = state.flight.avgSpeed = state.flight.maxSpeed = speed;
+    state.plane.speed = speed;
+    state.plane.orientation = flightOrientation(headingDegrees, 0.0f);
+    if (!rebase)
+        state.rebaseDistance = FLT_MAX;
+
+    LongFlight flight;
+    double referenceX = state.plane.position.x;
+    double referenceZ = state.plane.position.z;
+    const glm::vec3 forward = flightForward(state.plane.orientation);
+    const double perTick = static_cast<double>(speed) * dt;
+    SimInput input;
+    for (int t = 0; t < ticks; t++)
+    {
+        stepSimulation(state, input, dt);
+        referenceX += forward.x * perTick;
+        referenceZ += forward.z * perTick;
+        double x = state.originTileX * static_cast<double>(WORLD_TILE_SIZE) + state.plane.position.x;
+        double z = state.originTileZ * static_cast<double>(WORLD_TILE_SIZE) + state.plane.position.z;
+        flight.maxError = std::max(flight.maxError, std::hypot(x - referenceX, z - referenceZ));
+        flight.maxLocal = std::max(flight.maxLocal, std::max(std::fabs(state.plane.position.x), std::fabs(state.plane.position.z)));
+        if (world)
+        {
+            // ticks run far faster than real time here, so each one waits for its tiles like a real
+            // 60 Hz frame would have had time to
+            world->update(tileAt(state.originTileX, state.originTileZ, state.plane.position));
+            world->waitForLoads();
+            world->collect(world->settings().maxResident);
+            if (world->stats().resident > world->settings().maxResident)
+                withinBounds = false;
+        }
+    }
+    if (rebase && flight.maxLocal > state.rebaseDistance + WORLD_TILE_SIZE)
+        withinBounds = false;
+    flight.finalSpacing = std::max(floatSpacing(state.plane.position.x), floatSpacing(state.plane.position.z));
+    flight.absoluteX = state.originTileX * static_cast<double>(WORLD_TILE_SIZE) + state.plane.position.x;
+    flight.absoluteZ = state.originTileZ * static_cast<double>(WORLD_TILE_SIZE) + state.plane.position.z;
+    return flight;
+}
+
+static int benchStreaming(std::size_t kilometres, int flights)
+{
+    const float speed = 1000.0f;
+    const int ticks = static_cast<int>(kilometres * 1000.0 / speed * 60.0);
+    std::cout << "streaming: " << flights << " flights of " << kilometres << " km at " << speed << " m/s (" << ticks << " ticks each)" << std::endl;
+
+    // generating one tile on one thread
+    {
+        const int tiles = 64;
+        auto start = std::chrono::steady_clock::now();
+        std::size_t ships = 0;
+        for (int i = 0; i < tiles; i++)
+        {
+            TileCoord coord;
+            coord.x = 1000 + i;
+            coord.z = -37 * i;
+            ships += generateTile(coord)->ships.size();
+        }
+        double seconds = secondsSince(start);
+        std::cout << "  generate " << seconds * 1000.0 / tiles << " ms per tile (" << WorldTile::meshBytes() / 1024 << " KB mesh, "
+                  << ships << " ships in " << tiles << " tiles)" << std::endl;
+    }
+
+    // a shared edge must have the same height from both sides, far out as near home
+    float seam = 0.0f;
+    for (int32_t far : { 0, 100000, 1000000 })
+    {
+        TileCoord west, east;
+        west.x = far;
+        west.z = far;
+        east.x = far + 1;
+        east.z = far;
+        for (int i = 0; i <= 16; i++)
+            seam = std::max(seam, std::fabs(oceanHeight(west, WORLD_TILE_SIZE, i * 128.0f) - oceanHeight(east, 0.0f, i * 128.0f)));
+    }
+    std::cout << "  seams    max height step " << seam << " across tile edges" << std::endl;
+
+    int result = seam > 1e-3f ? 1 : 0;
+    JobSystem jobs;
+    for (int f = 0; f < flights; f++)
+    {
+        float heading = 37.0f + 90.0f * f;
+        bool withinBounds = true;
+        StreamingStats stats;
+        auto start = std::chrono::steady_clock::now();
+        LongFlight rebased;
+        {
+            WorldStreamer world(jobs);
+            rebased = flyLong(heading, speed, ticks, true, &world, withinBounds);
+            stats = world.stats();
+        }
+        double seconds = secondsSince(start);
+        LongFlight plain = flyLong(heading, speed, ticks, false, nullptr, withinBounds);
+        if (!withinBounds)
+            result = 1;
+
+        std::cout << "  heading " << heading << ": ended " << std::hypot(rebased.absoluteX, rebased.absoluteZ) / 1000.0 << " km out, "
+                  << ticks / (seconds * 1000.0) << " ticks/ms with streaming" << std::endl;
+        std::cout << "    tiles    " << stats.loaded << " loaded, " << stats.unloaded << " unloaded, " << stats.cancelled << " cancelled, peak "
+                  << stats.peakResident << " resident of " << StreamingSettings().maxResident << " allowed (" << stats.peakResident * WorldTile::meshBytes() / 1024
+                  << " KB), load " << (stats.loaded ? stats.totalLoadMs / stats.loaded : 0.0) << " ms avg " << stats.maxLoadMs << " ms max" << std::endl;
+        std::cout << "    rebased  drift " << rebased.maxError << " m, float spacing " << rebased.finalSpacing << " m, |local| <= " << rebased.maxLocal << std::endl;
+        std::cout << "    absolute drift " << plain.maxError << " m, float spacing " << plain.finalSpacing << " m" << std::endl;
+    }
+    return result;
+}
+
+// bombing evaluator
+// ---------------------------------------------------------------------------------------------
+// the hits of one cell flown drop by drop through stepSimulation, the way the game drops a bomb
+static uint32_t referenceCellHits(const SimState& base, const BombingSweep& sweep, int cellX, int cellY)
+{
+    std::vector<BombRelease> releases;
+    cellReleases(base, sweep, cellX, cellY, releases);
+    const float hullBottom = base.shipPosition.y - base.shipBoxHalfSize.y - base.bombHitRadius;
+    uint32_t hits = 0;
+    SimInput drop;
+    drop.dropBomb = true;
+    for (const BombRelease& release : releases)
+    {
+        SimState state = base;
+        state.flight.avgSpeed = release.speed; // holds its speed without throttle
+        state.plane.position = release.planePosition;
+        state.plane.orientation = flightOrientation(0.0f, release.pitch);
+        state.plane.speed = release.speed;
+        stepSimulation(state, SimInput(), 0.0f);
+        stepSimulation(state, drop, sweep.dt);
+        for (int t = 0; t < 7200 && !state.bombHit && state.bombPosition.y >= hullBottom; t++)
+            stepSimulation(state, SimInput(), sweep.dt);
+        hits += state.bombHit ? 1 : 0;
+    }
+    return hits;
+}
+
+static bool sameCells(const BombingResult& a, const BombingResult& b)
+{
+    for (std::size_t i = 0; i < a.cells.size(); i++)
+        if (a.cells[i].hits != b.cells[i].hits || a.cells[i].drops != b.cells[i].drops)
+            return false;
+    return true;
+}
+
+static int benchBombing(std::size_t dropsPerCell, int maxThreads)
+{
+    SimState base;
+    int result = 0;
+
+    // the batched evaluator against the game's own step, on a coarse windless sweep
+    {
+        BombingSweep sweep;
+        sweep.distanceCells = 16;
+        sweep.altitudeCells = 12;
+        sweep.dropsPerCell = 16;
+        sweep.windJitter = 0.0f;
+        BombingResult batched = evaluateBombing(nullptr, base, sweep, KERNEL_SCALAR);
+        uint64_t referenceHits = 0;
+        int mismatches = 0;
+        for (int y = 0; y < sweep.altitudeCells; y++)
+            for (int x = 0; x < sweep.distanceCells; x++)
+            {
+                uint32_t hits = referenceCellHits(base, sweep, x, y);
+                referenceHits += hits;
+                if (hits != batched.cell(x, y).hits)
+                    mismatches++;
+            }
+        std::cout << "bombing: " << batched.drops << " drops checked against stepSimulation, " << batched.hits << " hits vs "
+                  << referenceHits << " (" << mismatches << " cells differ)" << std::endl;
+        if (mismatches != 0)
+            result = 1;
+    }
+
+    BombingSweep sweep;
+    sweep.dropsPerCell = static_cast<int>(dropsPerCell);
+    std::cout << "bombing: " << sweep.distanceCells << "x" << sweep.altitudeCells << " cells of " << sweep.dropsPerCell << " drops" << std::endl;
+
+    BombingResult scalar = evaluateBombing(nullptr, base, sweep, KERNEL_SCALAR);
+    BombingResult serial = evaluateBombing(nullptr, base, sweep, bestSimdKernel());
+    std::cout << "  scalar     1 thread   " << scalar.drops / scalar.seconds << " drops/s, " << scalar.bombSteps / scalar.seconds / 1e6
+              << "M bomb steps/s, " << 100.0 * scalar.hits / scalar.drops << "% hits" << std::endl;
+    std::cout << "  " << simdKernelName(bestSimdKernel()) << "       1 thread   " << serial.drops / serial.seconds << " drops/s, "
+              << serial.bombSteps / serial.seconds / 1e6 << "M bomb steps/s" << (sameCells(serial, scalar) ? "" : " MISMATCH") << std::endl;
+    if (!sameCells(serial, scalar))
+        result = 1;
+
+    // the calling thread runs cells too while it waits, so threads - 1 workers
+    for (int threads = 2; threads <= maxThreads; threads *= 2)
+    {
+        JobSystem jobs(static_cast<unsigned int>(threads - 1));
+        BombingResult parallel = evaluateBombing(&jobs, base, sweep, bestSimdKernel());
+        double speedup = serial.seconds / parallel.seconds;
+        std::cout << "  " << simdKernelName(bestSimdKernel()) << "       " << threads << " threads  " << parallel.drops / parallel.seconds
+                  << " drops/s, speedup " << speedup << " (" << 100.0 * speedup / threads << "% of linear)"
+                  << (sameCells(parallel, serial) ? "" : " MISMATCH") << std::endl;
+        if (!sameCells(parallel, serial))
+            result = 1;
+    }
+    return result;
+}
+
+// spatial queries and AI agents
+// ---------------------------------------------------------------------------------------------
+static float pointDistance2(glm::vec3 a, glm::vec3 b)
+{
+    glm::vec3 d = a - b;
+    return d.x * d.x + d.y * d.y + d.z * d.z;
+}
+
+// the hash's answers against a scan over every point: radius queries must return the same points,
+// nearest queries the same distances (ties may come back in either order)
+static int checkSpatialQueries(const SpatialHash& hash, const std::vector<glm::vec3>& points, const std::vector<uint32_t>& masks, uint32_t& seed,
+                               int queries)
+{
+    int mismatches = 0;
+    std::vector<uint32_t> found(points.size()), expected;
+    std::vector<float> expectedDistances;
+    for (int q = 0; q < queries; q++)
+    {
+        glm::vec3 center(randomRange(seed, -5500.0f, 5500.0f), randomRange(seed, 0.0f, 600.0f), randomRange(seed, -5500.0f, 5500.0f));
+        uint32_t mask = 1u + static_cast<uint32_t>(nextRandom(seed) * 7.0f);
+
+        float radius = randomRange(seed, 20.0f, 900.0f);
+        std::size_t count = hash.radius(center, radius, mask, found.data(), found.size());
+        expected.clear();
+        for (std::size_t i = 0; i < points.size(); i++)
+            if ((masks[i] & mask) && pointDistance2(points[i], center) <= radius * radius)
+                expected.push_back(static_cast<uint32_t>(i));
+        std::sort(found.begin(), found.begin() + static_cast<std::ptrdiff_t>(count));
+        if (count != expected.size() || !std::equal(expected.begin(), expected.end(), found.begin()))
+            mismatches++;
+
+        std::size_t k = 1 + static_cast<std::size_t>(q % 16);
+        float maxRadius = randomRange(seed, 100.0f, 4000.0f);
+        uint32_t skip = q % 2 ? static_cast<uint32_t>(nextRandom(seed) * points.size()) : ~0u;
+        uint32_t nearest[SPATIAL_HASH_MAX_K];
+        float distances[SPATIAL_HASH_MAX_K];
+        count = hash.nearest(center, k, maxRadius, mask, skip, nearest, distances);
+        expectedDistances.clear();
+        for (std::size_t i = 0; i < points.size(); i++)
+        {
+            float d2 = pointDistance2(points[i], center);
+            if ((masks[i] & mask) && i != skip && d2 <= maxRadius * maxRadius)
+                expectedDistances.push_back(d2);
+        }
+        std::sort(expectedDistances.begin(), expectedDistances.end());
+        bool same = count == std::min(k, expectedDistances.size());
+        for (std::size_t i = 0; same && i < count; i++)
+            same = distances[i] == expectedDistances[i] && pointDistance2(points[nearest[i]], center) == distances[i];
+        if (!same)
+            mismatches++;
+    }
+    return mismatches;
+}
+
+// half the agents are wingmen in one long V, the other half gunners on a grid of ships laid over it
+static void buildAgentRaid(RaidAi& raid, std::size_t agents, FlightBody& leader)
+{
+    leader = FlightBody();
+    leader.position = glm::vec3(0.0f, 400.0f, 0.0f);
+    std::size_t wingmen = agents / 2;
+    std::size_t shipCount = (agents - wingmen) / static_cast<std::size_t>(raid.settings().gunnersPerShip);
+    raid.reserve(wingmen, shipCount, wingmen);
+    raid.addWingmen(wingmen, leader);
+
+    // the V reaches back and out formationSpacing per rank
+    float reach = (wingmen / 2 + 1) * raid.settings().formationSpacing;
+    std::size_t columns = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(shipCount))));
+    std::vector<RaidShip> ships;
+    uint32_t seed = 11u;
+    for (std::size_t i = 0; i < shipCount; i++)
+    {
+        RaidShip ship;
+        float u = (i % columns + 0.5f) / columns, v = (i / columns + 0.5f) / columns;
+        ship.position = glm::vec3((u * 2.0f - 1.0f) * reach, -5.0f, v * (reach + 4000.0f) - 4000.0f);
+        ship.heading = randomRange(seed, 0.0f, 6.2831853f);
+        ship.halfSize = glm::vec3(15.0f, 10.0f, 100.0f);
+        ships.push_back(ship);
+    }
+    raid.setShips(ships.data(), ships.size());
+}
+
+struct AgentRun
+{
+    double decisionsPerMs = 0.0;
+    double stepMs = 0.0;
+    double maxStepMs = 0.0;
+    double decidedPerStep = 0.0;
+    uint32_t oldestDecision = 0;
+    RaidStats stats;
+};
+
+static AgentRun runAgents(JobSystem* jobs, std::size_t agents, double budgetMs, int steps)
+{
+    RaidSettings settings;
+    settings.decisionBudgetMs = budgetMs;
+    RaidAi raid(jobs, settings);
+    FlightBody leader;
+    buildAgentRaid(raid, agents, leader);
+    const float dt = 1.0f / 60.0f;
+    FlightControls straight;
+
+    AgentRun run;
+    double decisionMs = 0.0;
+    uint64_t decisions = 0;
+    for (int i = 0; i < steps; i++)
+    {
+        stepFlight(leader, straight, settings.flight, dt);
+        raid.step(leader, dt);
+        // the first second sets up the formation and the hash
+        if (i < 60)
+            continue;
+        decisionMs += raid.stats().decisionMs;
+        decisions += raid.stats().decided;
+        run.stepMs += raid.stats().stepMs;
+        run.maxStepMs = std::max(run.maxStepMs, raid.stats().stepMs);
+        run.oldestDecision = std::max(run.oldestDecision, raid.stats().oldestDecision);
+    }
+    int measured = std::max(steps - 60, 1);
+    run.decisionsPerMs = decisions / std::max(decisionMs, 1e-9);
+    run.stepMs /= measured;
+    run.decidedPerStep = static_cast<double>(decisions) / measured;
+    run.stats = raid.stats();
+    return run;
+}
+
+static int benchAgents(std::size_t agents, int maxThreads)
+{
+    int result = 0;
+
+    // the hash against brute force, then again after an incremental update
+    {
+        const std::size_t count = 20000;
+        uint32_t seed = 7u;
+        std::vector<glm::vec3> points(count);
+        std::vector<uint32_t> masks(count);
+        std::vector<float> x(count), y(count), z(count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            points[i] = glm::vec3(randomRange(seed, -5000.0f, 5000.0f), randomRange(seed, 0.0f, 600.0f), randomRange(seed, -5000.0f, 5000.0f));
+            masks[i] = nextRandom(seed) < 0.05f ? 0u : 1u << (i % 3);
+        }
+        SpatialHash hash(250.0f);
+        int mismatches = 0;
+        for (int round = 0; round < 3; round++)
+        {
+            // most points drift a little, some jump anywhere, some leave or join
+            if (round > 0)
+            {
+                for (std::size_t i = 0; i < count; i++)
+                {
+                    float roll = nextRandom(seed);
+                    if (roll < 0.1f)
+                        points[i] = glm::vec3(randomRange(seed, -5000.0f, 5000.0f), points[i].y, randomRange(seed, -5000.0f, 5000.0f));
+                    else
+                        points[i] += glm::vec3(randomRange(seed, -40.0f, 40.0f), 0.0f, randomRange(seed, -40.0f, 40.0f));
+                    if (roll > 0.95f)
+                        masks[i] = masks[i] ? 0u : 1u << (i % 3);
+                }
+            }
+            for (std::size_t i = 0; i < count; i++)
+            {
+                x[i] = points[i].x;
+                y[i] = points[i].y;
+                z[i] = points[i].z;
+            }
+            hash.update(count, x.data(), y.data(), z.data(), masks.data());
+            mismatches += checkSpatialQueries(hash, points, masks, seed, 400);
+        }
+        std::cout << "agents: spatial hash checked against brute force on 2400 radius and nearest queries over " << count << " points ("
+                  << mismatches << " differ)" << std::endl;
+        if (mismatches != 0)
+            result = 1;
+    }
+
+    // incremental update against clearing and inserting everything, points flying at 60 m/s
+    {
+        const std::size_t count = agents;
+        const int ticks = 300;
+        uint32_t seed = 5u;
+        std::vector<float> x(count), y(count), z(count), vx(count), vz(count);
+        std::vector<uint32_t> masks(count, 1u);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            x[i] = randomRange(seed, -8000.0f, 8000.0f);
+            y[i] = randomRange(seed, 100.0f, 600.0f);
+            z[i] = randomRange(seed, -8000.0f, 8000.0f);
+            float angle = randomRange(seed, 0.0f, 6.2831853f);
+            vx[i] = std::cos(angle);
+            vz[i] = std::sin(angle);
+        }
+        SpatialHash incremental(250.0f), rebuilt(250.0f);
+        incremental.reserve(count, count);
+        rebuilt.reserve(count, count);
+        double incrementalSeconds = 0.0, rebuildSeconds = 0.0;
+        std::size_t moved = 0;
+        for (int tick = 0; tick < ticks; tick++)
+        {
+            for (std::size_t i = 0; i < count; i++)
+            {
+                x[i] += vx[i];
+                z[i] += vz[i];
+            }
+            auto start = std::chrono::steady_clock::now();
+            incremental.update(count, x.data(), y.data(), z.data(), masks.data());
+            incrementalSeconds += secondsSince(start);
+            moved += incremental.stats().moved;
+
+            start = std::chrono::steady_clock::now();
+            rebuilt.clear();
+            rebuilt.update(count, x.data(), y.data(), z.data(), masks.data());
+            rebuildSeconds += secondsSince(start);
+        }
+        std::cout << "  hash update of " << count << " points moving 1 m a tick: incremental " << 1000.0 * incrementalSeconds / ticks
+                  << " ms (" << 100.0 * moved / (static_cast<double>(count) * ticks) << "% change cell), rebuild "
+                  << 1000.0 * rebuildSeconds / ticks << " ms" << std::endl;
+    }
+
+    // whole raids: every agent decides every step, on 1, 2, 4, ... threads; the outcome must not
+    // depend on the thread count
+    const int steps = 240;
+    std::cout << "  raid of " << agents / 2 << " wingmen and " << agents - agents / 2 << " gunners, " << steps << " steps" << std::endl;
+    AgentRun serial = runAgents(nullptr, agents, 0.0, steps);
+    auto report = [&](int threads, const AgentRun& run) {
+        bool same = run.stats.shots == serial.stats.shots && run.stats.bombs == serial.stats.bombs &&
+                    run.stats.shipHits == serial.stats.shipHits && run.stats.losses == serial.stats.losses;
+        std::cout << "  all decide   " << threads << (threads == 1 ? " thread   " : " threads  ") << run.decisionsPerMs << " agents/ms, step "
+                  << run.stepMs << " ms" << (same ? "" : " MISMATCH") << std::endl;
+        if (!same)
+            result = 1;
+    };
+    report(1, serial);
+    std::cout << "    " << serial.stats.shots << " shots, " << serial.stats.losses << " wingmen lost, " << serial.stats.bombs << " bombs, "
+              << serial.stats.shipHits << " ship hits, " << serial.stats.queries << " queries" << std::endl;
+    for (int threads = 2; threads <= maxThreads; threads *= 2)
+    {
+        JobSystem jobs(static_cast<unsigned int>(threads - 1));
+        report(threads, runAgents(&jobs, agents, 0.0, steps));
+    }
+
+    // time-sliced: at most about 1 ms of decisions a step, the rest wait for the next
+    {
+        JobSystem jobs(static_cast<unsigned int>(std::max(maxThreads, 1) - 1));
+        AgentRun sliced = runAgents(maxThreads > 1 ? &jobs : nullptr, agents, 1.0, steps);
+        std::cout << "  1 ms budget  " << maxThreads << (maxThreads == 1 ? " thread   " : " threads  ") << sliced.decidedPerStep
+                  << " agents decide per step, oldest decision " << sliced.oldestDecision << " steps, step " << sliced.stepMs << " ms (max "
+                  << sliced.maxStepMs << " ms)" << std::endl;
+    }
+    return result;
+}
+
+// shadows
+// ---------------------------------------------------------------------------------------------
+// a view slice point at view depth, x and y across the slice in [-1, 1]
+static glm::vec3 slicePoint(const glm::mat4& cameraWorld, float tanHalf, float aspect, float depth, float x, float y)
+{
+    return glm::vec3(cameraWorld * glm::vec4(x * depth * tanHalf * aspect, y * depth * tanHalf, -depth, 1.0f));
+}
+
+static int benchShadows(std::size_t count, int frames)
+{
+    int result = 0;
+    const float fov = glm::radians(45.0f), aspect = 800.0f / 600.0f, nearPlane = 0.1f, farPlane = 8000.0f;
+    const float lambda = 0.9f, reach = 2000.0f;
+    const float tanHalf = std::tan(fov * 0.5f);
+
+    // where each quality splits the view and how large its texels get
+    for (int q = SHADOWS_LOW; q <= SHADOWS_HIGH; q++)
+    {
+        ShadowLevel level = shadowLevel(static_cast<ShadowQuality>(q));
+        float splits[SHADOW_MAX_CASCADES];
+        ShadowCascade cascades[SHADOW_MAX_CASCADES];
+        cascadeSplits(nearPlane, farPlane, level.cascades, lambda, splits);
+        fitCascades(glm::mat4(1.0f), fov, aspect, nearPlane, splits, level.cascades, SUN_DIRECTION, level.resolution, reach, cascades);
+        std::cout << "shadows: " << shadowQualityName(static_cast<ShadowQuality>(q)) << ", " << level.cascades << " x " << level.resolution << ":";
+        for (int c = 0; c < level.cascades; c++)
+            std::cout << "  to " << splits[c] << " m (" << cascades[c].texelSize * 100.0f << " cm/texel)";
+        std::cout << std::endl;
+    }
+
+    // every point of every slice must land inside its cascade, also when lifted towards the sun by
+    // up to the caster reach, from any camera
+    {
+        uint32_t seed = 7u;
+        ShadowLevel level = shadowLevel(SHADOWS_HIGH);
+        float splits[SHADOW_MAX_CASCADES];
+        ShadowCascade cascades[SHADOW_MAX_CASCADES];
+        cascadeSplits(nearPlane, farPlane, level.cascades, lambda, splits);
+        uint64_t samples = 0, outside = 0;
+        for (int view = 0; view < 500; view++)
+        {
+            glm::vec3 eye(randomRange(seed, -5000.0f, 5000.0f), randomRange(seed, 1.0f, 1500.0f), randomRange(seed, -5000.0f, 5000.0f));
+            glm::vec3 forward = glm::normalize(glm::vec3(randomRange(seed, -1.0f, 1.0f), randomRange(seed, -1.0f, 1.0f), randomRange(seed, -1.0f, 1.0f)));
+            glm::mat4 viewMatrix = glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+            glm::mat4 cameraWorld = glm::inverse(viewMatrix);
+            fitCascades(viewMatrix, fov, aspect, nearPlane, splits, level.cascades, SUN_DIRECTION, level.resolution, reach, cascades);
+            for (int c = 0; c < level.cascades; c++)
+            {
+                for (int i = 0; i < 64; i++)
+                {
+                    // the corners first, then anywhere in the slice
+                    float depth = i < 8 ? (i & 1 ? cascades[c].splitFar : cascades[c].splitNear) : randomRange(seed, cascades[c].splitNear, cascades[c].splitFar);
+                    float x = i < 8 ? (i & 2 ? 1.0f : -1.0f) : randomRange(seed, -1.0f, 1.0f);
+                    float y = i < 8 ? (i & 4 ? 1.0f : -1.0f) : randomRange(seed, -1.0f, 1.0f);
+                    glm::vec3 point = slicePoint(cameraWorld, tanHalf, aspect, depth, x, y);
+                    for (float lift : { 0.0f, reach * 0.99f })
+                    {
+                        glm::vec4 clip = cascades[c].viewProjection * glm::vec4(point + SUN_DIRECTION * lift, 1.0f);
+                        samples++;
+                        if (std::fabs(clip.x) > 1.0001f || std::fabs(clip.y) > 1.0001f || std::fabs(clip.z) > 1.0001f)
+                            outside++;
+                    }
+                }
+            }
+        }
+        std::cout << "  " << samples << " slice points from 500 random views, " << outside << " outside their cascade" << std::endl;
+        if (outside > 0)
+        {
+            std::cout << "shadows: MISMATCH, cascades do not cover their slices" << std::endl;
+            result = 1;
+        }
+    }
+
+    // a camera sliding and turning over the sea: a fixed point must keep its place inside its
+    // shadow texel, or the shadow edges crawl
+    {
+        ShadowLevel level = shadowLevel(SHADOWS_HIGH);
+        float splits[SHADOW_MAX_CASCADES];
+        ShadowCascade cascades[SHADOW_MAX_CASCADES];
+        cascadeSplits(nearPlane, farPlane, level.cascades, lambda, splits);
+        const glm::vec3 target(37.3f, 5.1f, -415.7f);
+        float first[SHADOW_MAX_CASCADES] = {};
+        float worst = 0.0f;
+        for (int frame = 0; frame < 600; frame++)
+        {
+            float t = frame / 60.0f;
+            glm::vec3 eye(13.0f * t, 300.0f + 2.0f * std::sin(t), 40.0f - 21.0f * t);
+            glm::vec3 forward(0.3f * std::sin(0.5f * t), -0.35f, -1.0f);
+            fitCascades(glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f)), fov, aspect, nearPlane, splits, level.cascades, SUN_DIRECTION,
+                        level.resolution, reach, cascades);
+            for (int c = 0; c < level.cascades; c++)
+            {
+                glm::vec4 clip = cascades[c].viewProjection * glm::vec4(target, 1.0f);
+                float texel = (clip.x * 0.5f + 0.5f) * level.resolution;
+                float phase = texel - std::floor(texel);
+                if (frame == 0)
+                    first[c] = phase;
+                float drift = std::fabs(phase - first[c]);
+                worst = std::max(worst, std::min(drift, 1.0f - drift));
+            }
+        }
+        std::cout << "  600 frames of a moving camera: a fixed point drifts at most " << worst << " texels inside its texel" << std::endl;
+        if (worst > 0.05f)
+        {
+            std::cout << "shadows: MISMATCH, cascades are not snapped to texels" << std::endl;
+            result = 1;
+        }
+    }
+
+    // caster culling over a field of planes and ships, against testing every corner in every cascade
+    {
+        uint32_t seed = 11u;
+        std::vector<glm::mat4> matrices(count);
+        std::vector<uint8_t> ship(count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            ship[i] = nextRandom(seed) < 0.2f;
+            glm::vec3 position(randomRange(seed, -4000.0f, 4000.0f), ship[i] ? 0.0f : randomRange(seed, 50.0f, 800.0f), randomRange(seed, -4000.0f, 4000.0f));
+            glm::mat4 matrix = glm::rotate(glm::translate(glm::mat4(1.0f), position), randomRange(seed, 0.0f, glm::two_pi<float>()), glm::vec3(0.0f, 1.0f, 0.0f));
+            matrices[i] = glm::scale(matrix, glm::vec3(ship[i] ? 60.0f : 0.2f));
+        }
+        // a carrier hull in model units and a plane
+        const glm::vec3 shipMin(-2.5f, -0.3f, -0.6f), shipMax(2.5f, 0.5f, 0.6f);
+        const glm::vec3 planeMin(-40.0f, -8.0f, -40.0f), planeMax(40.0f, 8.0f, 40.0f);
+        const float shipError[MODEL_LOD_LEVELS] = { 0.0f, 0.005f, 0.02f, 0.06f };
+        const float planeError[MODEL_LOD_LEVELS] = { 0.0f, 0.5f, 2.0f, 6.0f };
+
+        ShadowLevel level = shadowLevel(SHADOWS_HIGH);
+        float splits[SHADOW_MAX_CASCADES];
+        ShadowCascade cascades[SHADOW_MAX_CASCADES];
+        cascadeSplits(nearPlane, farPlane, level.cascades, lambda, splits);
+        ShadowCasterCuller culler;
+        ShadowCullStats total;
+        uint64_t missed = 0, lodDrawn[MODEL_LOD_LEVELS] = {};
+        double seconds = 0.0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            float heading = 0.01f * frame;
+            glm::vec3 eye(0.0f, 400.0f, 0.0f);
+            glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(std::sin(heading), -0.2f, -std::cos(heading)), glm::vec3(0.0f, 1.0f, 0.0f));
+            auto start = std::chrono::steady_clock::now();
+            fitCascades(view, fov, aspect, nearPlane, splits, level.cascades, SUN_DIRECTION, level.resolution, reach, cascades);
+            culler.setCascades(cascades, level.cascades);
+            int levels[SHADOW_MAX_CASCADES];
+            for (std::size_t i = 0; i < count; i++)
+            {
+                if (culler.select(ship[i] ? shipMin : planeMin, ship[i] ? shipMax : planeMax, ship[i] ? shipError : planeError, MODEL_LOD_LEVELS,
+                                  matrices[i], levels) > 0)
+                    for (int c = 0; c < level.cascades; c++)
+                        if (levels[c] >= 0)
+                            lodDrawn[levels[c]]++;
+            }
+            seconds += secondsSince(start);
+            total.outsideCascade += culler.stats.outsideCascade;
+            total.tooSmall += culler.stats.tooSmall;
+            for (int c = 0; c < level.cascades; c++)
+                total.drawn[c] += culler.stats.drawn[c];
+
+            // a caster with a corner inside a cascade, big enough to show, must be drawn into it
+            for (std::size_t i = 0; i < count; i++)
+            {
+                glm::vec3 boundsMin = ship[i] ? shipMin : planeMin, boundsMax = ship[i] ? shipMax : planeMax;
+                glm::vec3 worldMin, worldMax;
+                transformBounds(matrices[i], boundsMin, boundsMax, worldMin, worldMax);
+                float radius = 0.5f * glm::length(worldMax - worldMin);
+                culler.select(boundsMin, boundsMax, ship[i] ? shipError : planeError, MODEL_LOD_LEVELS, matrices[i], levels);
+                for (int c = 0; c < level.cascades; c++)
+                    if (levels[c] < 0 && radius >= culler.minRadiusTexels * cascades[c].texelSize &&
+                        cornerVisible(cascades[c].viewProjection * matrices[i], boundsMin, boundsMax))
+                        missed++;
+            }
+        }
+        seconds /= frames;
+        uint64_t drawn = 0;
+        for (int c = 0; c < level.cascades; c++)
+            drawn += total.drawn[c];
+        std::cout << "  caster culling: " << count << " objects into " << level.cascades << " cascades, " << seconds * 1000.0 << " ms/frame ("
+                  << count / seconds / 1e6 << " M objects/sec), " << drawn / frames << " draws per frame instead of "
+                  << count * level.cascades << std::endl;
+        std::cout << "  per frame: " << total.outsideCascade / frames << " outside a cascade, " << total.tooSmall / frames << " under a texel, by cascade";
+        for (int c = 0; c < level.cascades; c++)
+            std::cout << " " << total.drawn[c] / frames;
+        std::cout << ", by level";
+        for (uint32_t l = 0; l < MODEL_LOD_LEVELS; l++)
+            std::cout << " " << lodDrawn[l] / frames;
+        std::cout << std::endl;
+        if (missed > 0)
+        {
+            std::cout << "shadows: MISMATCH, " << missed << " casters culled from a cascade they reach" << std::endl;
+            result = 1;
+        }
+    }
+
+    // the budget against a pass whose cost grows with the shadow texels: 0.25 ms per 1024x1024
+    // layer, +-10% noise, and a scene that gets 2.5 times heavier half way
+    {
+        uint32_t seed = 3u;
+        const double budgetMs = 2.0;
+        ShadowBudget budget(budgetMs, SHADOWS_HIGH);
+        ShadowQuality settled[2] = {};
+        int changes[2] = {};
+        for (int half = 0; half < 2; half++)
+        {
+            double load = half == 0 ? 1.0 : 2.5;
+            int before = budget.changes();
+            for (int frame = 0; frame < 3000; frame++)
+            {
+                ShadowLevel level = shadowLevel(budget.quality());
+                double cost = 0.25 * load * level.cascades * (level.resolution / 1024.0) * (level.resolution / 1024.0);
+                budget.update(cost * randomRange(seed, 0.9f, 1.1f));
+            }
+            settled[half] = budget.quality();
+            changes[half] = budget.changes() - before;
+        }
+        std::cout << "  budget " << budgetMs << " ms from high: settles at " << shadowQualityName(settled[0]) << " after " << changes[0]
+                  << " changes, " << shadowQualityName(settled[1]) << " after " << changes[1] << " more once the scene is 2.5x heavier"
+                  << std::endl;
+        if (settled[0] != SHADOWS_MEDIUM || settled[1] != SHADOWS_LOW || changes[0] + changes[1] > 12)
+        {
+            std::cout << "shadows: MISMATCH, the budget did not settle" << std::endl;
+            result = 1;
+        }
+    }
+    return result;
+}
+
+int runBenchmark(const std::string& name, const BenchmarkOptions& options)
+{
+    long long count = options.count;
+    int iterations = options.iterations;
+
+    if (name == "ballistics")
+        return benchBallistics(count > 0 ? count : 100000, iterations > 0 ? iterations : 200);
+
+    if (name == "collision")
+        return benchCollision(count > 0 ? count : 20000, iterations > 0 ? iterations : 10);
+
+    if (name == "bvh")
+        return benchBvh(count > 0 ? count : 1000, iterations > 0 ? iterations : 2000);
+
+    if (name == "model-cache")
+        return benchModelCache(options.modelPaths, iterations > 0 ? iterations : 3);
+
+    if (name == "instancing")
+        return benchInstancing(options.modelPaths, count > 0 ? count : 10000, iterations > 0 ? iterations : 200);
+
+    if (name == "texture")
+        return benchTexture(count > 0 ? static_cast<int>(count) : 1024, iterations > 0 ? iterations : 3);
+
+    if (name == "transforms")
+        return benchTransforms(count > 0 ? count : 10000, iterations > 0 ? iterations : 200);
+
+    if (name == "flight")
+        return benchFlight(count > 0 ? count : 10000, iterations > 0 ? iterations : 200);
+
+    if (name == "culling")
+        return benchCulling(count > 0 ? count : 100000, iterations > 0 ? iterations : 100);
+
+    if (name == "particles")
+        return benchParticles(count > 0 ? count : 100000, iterations > 0 ? iterations : 300);
+
+    if (name == "streaming")
+        return benchStreaming(count > 0 ? count : 500, iterations > 0 ? iterations : 2);
+
+    if (name == "bombing")
+        return benchBombing(count > 0 ? count : 64, iterations > 0 ? iterations : static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+
+    if (name == "agents")
+        return benchAgents(count > 0 ? count : 4000, iterations > 0 ? iterations : static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+
+    if (name == "shadows")
+        return benchShadows(count > 0 ? count : 20000, iterations > 0 ? iterations : 100);
+
+    std::cout << "Unknown benchmark: " << name << " (available: ballistics, collision, bvh, model-cache, texture, instancing, transforms, flight, culling, particles, streaming, bombing, agents, shadows)" << std::endl;
+    return -1;
+}
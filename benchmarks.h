@@ -0,0 +1,18 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <string>
+#include <vector>
+
+struct BenchmarkOptions
+{
+    long long count = 0;  // workload size (entities, pairs, ...), 0 picks the benchmark's default
+    int iterations = 0;   // how many times the kernel is repeated, 0 picks the default
+    std::vector<std::string> modelPaths; // the game's model sources, for the loading benchmarks
+};
+
+// CPU-only microbenchmarks selected with --bench <name>.
+// returns the process exit code, non-zero when a kernel disagrees with its reference.
+int runBenchmark(const std::string& name, const BenchmarkOptions& options);
+
+#endif
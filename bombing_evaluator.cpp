@@ -0,0 +1,236 @@
+#include "bombing_evaluator.h"
+#include "flight_model.h"
+#include "raid_world.h"
+#include "texture_codec.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// every cell has its own stream, seeded from the sweep seed and the cell index
+static uint32_t cellSeed(uint32_t seed, std::size_t cell)
+{
+    uint32_t h = seed * 0x9E3779B1u ^ static_cast<uint32_t>(cell) * 0x85EBCA77u;
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    return h;
+}
+
+static float nextRandom(uint32_t& seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+static float randomRange(uint32_t& seed, float lo, float hi)
+{
+    return lo + (hi - lo) * nextRandom(seed);
+}
+
+void cellReleases(const SimState& base, const BombingSweep& sweep, int cellX, int cellY, std::vector<BombRelease>& releases)
+{
+    uint32_t seed = cellSeed(sweep.seed, static_cast<std::size_t>(cellY) * sweep.distanceCells + cellX);
+    const float cellWidth = (sweep.maxDistance - sweep.minDistance) / sweep.distanceCells;
+    const float cellHeight = (sweep.maxAltitude - sweep.minAltitude) / sweep.altitudeCells;
+    releases.resize(static_cast<std::size_t>(sweep.dropsPerCell));
+    for (BombRelease& release : releases)
+    {
+        float distance = sweep.minDistance + (cellX + nextRandom(seed)) * cellWidth;
+        float altitude = sweep.minAltitude + (cellY + nextRandom(seed)) * cellHeight;
+        float lateral = randomRange(seed, -sweep.lateralJitter, sweep.lateralJitter);
+        release.planePosition = glm::vec3(base.shipPosition.x + lateral, altitude, base.shipPosition.z + distance);
+        release.pitch = randomRange(seed, sweep.minPitch, sweep.maxPitch);
+        release.speed = randomRange(seed, base.flight.minSpeed, base.flight.maxSpeed);
+        float windAngle = randomRange(seed, 0.0f, 6.2831853f);
+        float wind = sweep.windJitter * std::sqrt(nextRandom(seed));
+        release.wind = glm::vec3(std::cos(windAngle), 0.0f, std::sin(windAngle)) * wind;
+    }
+}
+
+// drops one cell's bombs together: the batch falls with the SoA ballistics kernel and every live
+// bomb is swept against the ship over the step it just took, exactly like stepSimulation does for one
+static void evaluateCell(const SimState& base, const BombingSweep& sweep, int cellX, int cellY, SimdKernel kernel, EntityArrays& bombs,
+                         std::vector<BombRelease>& releases, std::vector<float>& previous, BombingCell& out, uint64_t& steps)
+{
+    // the bomb leaves the hardpoint with the plane's velocity plus the wind
+    cellReleases(base, sweep, cellX, cellY, releases);
+    SimState plane = base;
+    bombs.clear();
+    for (const BombRelease& release : releases)
+    {
+        plane.plane.position = release.planePosition;
+        plane.plane.orientation = flightOrientation(0.0f, release.pitch);
+        plane.plane.roll = 0.0f;
+        glm::vec3 hardpoint = glm::vec3(planeRotationMatrix(plane) * glm::vec4(base.bombOffsetLocal, 1.0f));
+        bombs.spawn(release.planePosition + hardpoint, flightForward(plane.plane.orientation) * release.speed + release.wind);
+    }
+
+    // a bomb below the hull cannot come back up
+    const float hullBottom = base.shipPosition.y - base.shipBoxHalfSize.y - base.bombHitRadius;
+    const int maxSteps = static_cast<int>(120.0f / sweep.dt);
+    previous.resize(bombs.capacity() * 3);
+    out.drops = static_cast<uint32_t>(bombs.size());
+    for (int step = 0; step < maxSteps && bombs.size() > 0; step++)
+    {
+        std::size_t count = bombs.size();
+        std::memcpy(previous.data(), bombs.posX, count * sizeof(float));
+        std::memcpy(previous.data() + count, bombs.posY, count * sizeof(float));
+        std::memcpy(previous.data() + 2 * count, bombs.posZ, count * sizeof(float));
+        integrateBallistics(bombs, base.gravity, sweep.dt, kernel);
+        steps += count;
+
+        bool anyDead = false;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            glm::vec3 start(previous[i], previous[count + i], previous[2 * count + i]);
+            glm::vec3 end = bombs.position(i);
+            float timeOfImpact = 0.0f;
+            if (sweepSphereBox(start, end, base.bombHitRadius, base.shipPosition, base.shipBoxHalfSize, timeOfImpact))
+            {
+                out.hits++;
+                bombs.kill(i);
+                anyDead = true;
+            }
+            else if (end.y < hullBottom)
+            {
+                bombs.kill(i);
+                anyDead = true;
+            }
+        }
+        if (anyDead)
+            bombs.removeDead();
+    }
+}
+
+BombingResult evaluateBombing(JobSystem* jobs, const SimState& base, const BombingSweep& sweep, SimdKernel kernel)
+{
+    BombingResult result;
+    result.width = sweep.distanceCells;
+    result.height = sweep.altitudeCells;
+    result.cells.assign(static_cast<std::size_t>(result.width) * result.height, BombingCell());
+    std::vector<uint64_t> cellSteps(result.cells.size(), 0);
+
+    auto start = std::chrono::steady_clock::now();
+    auto evaluateCells = [&](std::size_t begin, std::size_t end) {
+        EntityArrays bombs(static_cast<std::size_t>(sweep.dropsPerCell));
+        std::vector<BombRelease> releases;
+        std::vector<float> previous;
+        for (std::size_t cell = begin; cell < end; cell++)
+        {
+            int x = static_cast<int>(cell % result.width);
+            int y = static_cast<int>(cell / result.width);
+            evaluateCell(base, sweep, x, y, kernel, bombs, releases, previous, result.cells[cell], cellSteps[cell]);
+        }
+    };
+    if (jobs)
+        jobs->parallelFor(result.cells.size(), 1, evaluateCells);
+    else
+        evaluateCells(0, result.cells.size());
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (std::size_t cell = 0; cell < result.cells.size(); cell++)
+    {
+        result.drops += result.cells[cell].drops;
+        result.hits += result.cells[cell].hits;
+        result.bombSteps += cellSteps[cell];
+    }
+    return result;
+}
+
+bool writeBombingCsv(const std::string& path, const BombingSweep& sweep, const BombingResult& result)
+{
+    std::ofstream out(path, std::ios::trunc);
+    const float cellWidth = (sweep.maxDistance - sweep.minDistance) / sweep.distanceCells;
+    const float cellHeight = (sweep.maxAltitude - sweep.minAltitude) / sweep.altitudeCells;
+    out << "distance,altitude,drops,hits,probability\n";
+    for (int y = 0; y < result.height; y++)
+    {
+        for (int x = 0; x < result.width; x++)
+        {
+            const BombingCell& cell = result.cell(x, y);
+            out << sweep.minDistance + (x + 0.5f) * cellWidth << ',' << sweep.minAltitude + (y + 0.5f) * cellHeight << ','
+                << cell.drops << ',' << cell.hits << ',' << (cell.drops ? static_cast<double>(cell.hits) / cell.drops : 0.0) << '\n';
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+// black through red and yellow to white as the probability goes from 0 to 1
+static void heatColor(float probability, uint8_t* rgba)
+{
+    float t = std::min(std::max(probability, 0.0f), 1.0f) * 3.0f;
+    rgba[0] = static_cast<uint8_t>(255.0f * std::min(t, 1.0f));
+    rgba[1] = static_cast<uint8_t>(255.0f * std::min(std::max(t - 1.0f, 0.0f), 1.0f));
+    rgba[2] = static_cast<uint8_t>(255.0f * std::min(std::max(t - 2.0f, 0.0f), 1.0f));
+    rgba[3] = 255;
+}
+
+bool writeBombingPng(const std::string& path, const BombingResult& result, int pixelsPerCell)
+{
+    RgbaImage image;
+    image.width = result.width * pixelsPerCell;
+    image.height = result.height * pixelsPerCell;
+    image.pixels.resize(static_cast<std::size_t>(image.width) * image.height * 4);
+    for (int py = 0; py < image.height; py++)
+    {
+        int y = result.height - 1 - py / pixelsPerCell;
+        for (int px = 0; px < image.width; px++)
+        {
+            const BombingCell& cell = result.cell(px / pixelsPerCell, y);
+            heatColor(cell.drops ? static_cast<float>(cell.hits) / cell.drops : 0.0f, &image.pixels[(static_cast<std::size_t>(py) * image.width + px) * 4]);
+        }
+    }
+    return writePng(path, image);
+}
+
+int runBombingEvaluation(const std::string& dir, long long dropsPerCell, float dt)
+{
+    BombingSweep sweep;
+    if (dropsPerCell > 0)
+        sweep.dropsPerCell = static_cast<int>(dropsPerCell);
+    sweep.dt = dt;
+    SimState base;
+    JobSystem jobs;
+    std::cout << "Bombing evaluation: " << sweep.distanceCells << "x" << sweep.altitudeCells << " cells of " << sweep.dropsPerCell
+              << " drops on " << jobs.workerCount() + 1 << " threads" << std::endl;
+
+    BombingResult result = evaluateBombing(&jobs, base, sweep, bestSimdKernel());
+
+    const BombingCell* best = &result.cells[0];
+    int bestX = 0, bestY = 0;
+    for (int y = 0; y < result.height; y++)
+        for (int x = 0; x < result.width; x++)
+            if (static_cast<uint64_t>(result.cell(x, y).hits) * best->drops > static_cast<uint64_t>(best->hits) * result.cell(x, y).drops)
+            {
+                best = &result.cell(x, y);
+                bestX = x;
+                bestY = y;
+            }
+    std::cout << "  " << result.drops << " drops, " << result.hits << " hits (" << 100.0 * result.hits / std::max<uint64_t>(result.drops, 1)
+              << "%) in " << result.seconds << " s: " << result.drops / result.seconds << " drops/s, " << result.bombSteps / result.seconds / 1e6
+              << "M bomb steps/s" << std::endl;
+    std::cout << "  best release: " << sweep.minDistance + (bestX + 0.5f) * (sweep.maxDistance - sweep.minDistance) / sweep.distanceCells
+              << " m out at " << sweep.minAltitude + (bestY + 0.5f) * (sweep.maxAltitude - sweep.minAltitude) / sweep.altitudeCells
+              << " m, " << 100.0 * best->hits / std::max<uint32_t>(best->drops, 1) << "% hits" << std::endl;
+
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    std::string csvPath = dir + "/bombing.csv";
+    std::string pngPath = dir + "/bombing.png";
+    bool written = writeBombingCsv(csvPath, sweep, result);
+    written = writeBombingPng(pngPath, result, 8) && written;
+    if (!written)
+    {
+        std::cout << "Failed to write " << csvPath << " or " << pngPath << std::endl;
+        return -1;
+    }
+    std::cout << "  wrote " << csvPath << " and " << pngPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef BOMBING_EVALUATOR_H
+#define BOMBING_EVALUATOR_H
+
+#include "job_system.h"
+#include "simd.h"
+#include "simulation.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Monte Carlo release evaluator: how likely is a bomb released here to hit the carrier? the map is
+// release distance (along the run, ahead of the ship's centre) against release altitude; every
+// cell drops many bombs with the rest of the release jittered (where in the cell, off-track offset,
+// dive angle, airspeed between the plane type's minSpeed and maxSpeed, and a wind the bomb drifts
+// with). bombs fall with the game's Euler step and hit by the game's swept sphere-vs-box test
+// (sweepSphereBox, the broadphase of stepSimulation; the carrier mesh is not used).
+struct BombingSweep
+{
+    int distanceCells = 64;
+    float minDistance = 0.0f;
+    float maxDistance = 1600.0f;
+    int altitudeCells = 48;
+    float minAltitude = 50.0f;
+    float maxAltitude = 1000.0f;
+    int dropsPerCell = 512;
+
+    float lateralJitter = 10.0f; // metres either side of the ship's centre line
+    float minPitch = 0.0f;       // dive angle at release in degrees, 0 is level
+    float maxPitch = 20.0f;
+    float windJitter = 5.0f;     // horizontal wind speed up to this, any direction, in m/s
+
+    float dt = 1.0f / 60.0f;
+    uint32_t seed = 1u;
+};
+
+// one drop: the plane (flying towards -z, level wings) at the moment the bomb leaves it
+struct BombRelease
+{
+    glm::vec3 planePosition;
+    float pitch; // dive angle in degrees
+    float speed;
+    glm::vec3 wind;
+};
+
+struct BombingCell
+{
+    uint32_t drops = 0;
+    uint32_t hits = 0;
+};
+
+struct BombingResult
+{
+    int width = 0;
+    int height = 0;
+    std::vector<BombingCell> cells; // row 0 is the lowest altitude
+    uint64_t drops = 0;
+    uint64_t hits = 0;
+    uint64_t bombSteps = 0; // integration + collision steps over every bomb
+    double seconds = 0.0;
+
+    const BombingCell& cell(int x, int y) const { return cells[static_cast<std::size_t>(y) * width + x]; }
+};
+
+// the drops of one cell, in the order evaluateBombing makes them; each cell has its own random stream
+void cellReleases(const SimState& base, const BombingSweep& sweep, int cellX, int cellY, std::vector<BombRelease>& releases);
+
+// the carrier, gravity, hit radius and plane type come from base. cells run in parallel on jobs
+// (one cell per task, or all on the calling thread when jobs is null); the result is the same for
+// any number of workers
+BombingResult evaluateBombing(JobSystem* jobs, const SimState& base, const BombingSweep& sweep, SimdKernel kernel);
+
+// one row per cell: release distance and altitude at the cell centre, drops, hits, probability
+bool writeBombingCsv(const std::string& path, const BombingSweep& sweep, const BombingResult& result);
+// the map as an image, pixelsPerCell wide per cell, highest altitude at the top
+bool writeBombingPng(const std::string& path, const BombingResult& result, int pixelsPerCell);
+
+// --evaluate-bombing: sweeps the default start with every core and writes dir/bombing.csv and
+// dir/bombing.png; dropsPerCell 0 keeps the default. returns the process exit code
+int runBombingEvaluation(const std::string& dir, long long dropsPerCell, float dt);
+
+#endif
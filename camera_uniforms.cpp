@@ -0,0 +1,25 @@
+#include "camera_uniforms.h"
+
+#include <glad/glad.h>
+
+void CameraUniformBuffer::update(const CameraUniforms& camera)
+{
+    if (!buffer)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraUniforms), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BINDING, buffer);
+    }
+    // one small write per frame; the binding point stays attached for every program
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraUniforms), &camera);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void CameraUniformBuffer::release()
+{
+    if (buffer)
+        glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
@@ -0,0 +1,34 @@
+#ifndef CAMERA_UNIFORMS_H
+#define CAMERA_UNIFORMS_H
+
+#include <glm/glm.hpp>
+
+// per-frame camera data every shader reads from one uniform buffer, the std140 block
+//
+//     layout (std140) uniform Camera { mat4 projection; mat4 view; vec4 cameraPosition; };
+//
+// bound to CAMERA_UNIFORM_BINDING. mat4 and vec4 members need no std140 padding, so the C++ struct
+// matches the block byte for byte.
+
+const unsigned int CAMERA_UNIFORM_BINDING = 0;
+
+struct CameraUniforms
+{
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec4 position; // w = 1
+};
+static_assert(sizeof(CameraUniforms) == 144, "CameraUniforms must match the std140 Camera block");
+
+class CameraUniformBuffer
+{
+public:
+    // like GpuModel the buffer lives until the context goes away; release() frees it earlier
+    void update(const CameraUniforms& camera);
+    void release();
+
+private:
+    unsigned int buffer = 0;
+};
+
+#endif
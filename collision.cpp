@@ -0,0 +1,212 @@
+#include "collision.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+void TargetBoxes::add(glm::vec3 center, glm::vec3 halfSize, uint32_t id)
+{
+    minX.push_back(center.x - halfSize.x);
+    minY.push_back(center.y - halfSize.y);
+    minZ.push_back(center.z - halfSize.z);
+    maxX.push_back(center.x + halfSize.x);
+    maxY.push_back(center.y + halfSize.y);
+    maxZ.push_back(center.z + halfSize.z);
+    ids.push_back(id);
+}
+
+void TargetBoxes::addBounds(const TargetBoxes& from, std::size_t index)
+{
+    minX.push_back(from.minX[index]);
+    minY.push_back(from.minY[index]);
+    minZ.push_back(from.minZ[index]);
+    maxX.push_back(from.maxX[index]);
+    maxY.push_back(from.maxY[index]);
+    maxZ.push_back(from.maxZ[index]);
+    ids.push_back(from.ids[index]);
+}
+
+void TargetBoxes::pad()
+{
+    while (ids.size() % 8 != 0)
+        add(glm::vec3(FLT_MAX), glm::vec3(0.0f), UINT32_MAX);
+}
+
+void TargetBoxes::clear()
+{
+    minX.clear(); minY.clear(); minZ.clear();
+    maxX.clear(); maxY.clear(); maxZ.clear();
+    ids.clear();
+}
+
+// narrow phase: one sphere against the padded box range [begin, end)
+// ---------------------------------------------------------------------------------------------
+static void sphereVsBoxesScalar(glm::vec3 c, float r2, uint32_t sphere, const TargetBoxes& b,
+                                std::size_t begin, std::size_t end, std::vector<CollisionPair>& hits)
+{
+    for (std::size_t j = begin; j < end; j++)
+    {
+        float x = std::max(b.minX[j], std::min(c.x, b.maxX[j]));
+        float y = std::max(b.minY[j], std::min(c.y, b.maxY[j]));
+        float z = std::max(b.minZ[j], std::min(c.z, b.maxZ[j]));
+        float dx = c.x - x, dy = c.y - y, dz = c.z - z;
+        if (dx * dx + dy * dy + dz * dz < r2)
+            hits.push_back({ sphere, b.ids[j] });
+    }
+}
+
+#ifdef SIMD_SSE2
+static void sphereVsBoxesSse(glm::vec3 c, float r2, uint32_t sphere, const TargetBoxes& b,
+                             std::size_t begin, std::size_t end, std::vector<CollisionPair>& hits)
+{
+    const __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+    const __m128 vr2 = _mm_set1_ps(r2);
+    for (std::size_t j = begin; j < end; j += 4)
+    {
+        __m128 dx = _mm_sub_ps(cx, _mm_max_ps(_mm_loadu_ps(&b.minX[j]), _mm_min_ps(cx, _mm_loadu_ps(&b.maxX[j]))));
+        __m128 dy = _mm_sub_ps(cy, _mm_max_ps(_mm_loadu_ps(&b.minY[j]), _mm_min_ps(cy, _mm_loadu_ps(&b.maxY[j]))));
+        __m128 dz = _mm_sub_ps(cz, _mm_max_ps(_mm_loadu_ps(&b.minZ[j]), _mm_min_ps(cz, _mm_loadu_ps(&b.maxZ[j]))));
+        __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        int mask = _mm_movemask_ps(_mm_cmplt_ps(d2, vr2));
+        while (mask)
+        {
+            int lane = 0;
+            while (!(mask & (1 << lane))) lane++;
+            mask &= ~(1 << lane);
+            hits.push_back({ sphere, b.ids[j + lane] });
+        }
+    }
+}
+
+SIMD_TARGET_AVX2 static void sphereVsBoxesAvx2(glm::vec3 c, float r2, uint32_t sphere, const TargetBoxes& b,
+                                               std::size_t begin, std::size_t end, std::vector<CollisionPair>& hits)
+{
+    const __m256 cx = _mm256_set1_ps(c.x), cy = _mm256_set1_ps(c.y), cz = _mm256_set1_ps(c.z);
+    const __m256 vr2 = _mm256_set1_ps(r2);
+    for (std::size_t j = begin; j < end; j += 8)
+    {
+        __m256 dx = _mm256_sub_ps(cx, _mm256_max_ps(_mm256_loadu_ps(&b.minX[j]), _mm256_min_ps(cx, _mm256_loadu_ps(&b.maxX[j]))));
+        __m256 dy = _mm256_sub_ps(cy, _mm256_max_ps(_mm256_loadu_ps(&b.minY[j]), _mm256_min_ps(cy, _mm256_loadu_ps(&b.maxY[j]))));
+        __m256 dz = _mm256_sub_ps(cz, _mm256_max_ps(_mm256_loadu_ps(&b.minZ[j]), _mm256_min_ps(cz, _mm256_loadu_ps(&b.maxZ[j]))));
+        __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(d2, vr2, _CMP_LT_OQ));
+        while (mask)
+        {
+            int lane = 0;
+            while (!(mask & (1 << lane))) lane++;
+            mask &= ~(1 << lane);
+            hits.push_back({ sphere, b.ids[j + lane] });
+        }
+    }
+}
+#endif
+
+typedef void (*SphereVsBoxesFn)(glm::vec3, float, uint32_t, const TargetBoxes&, std::size_t, std::size_t, std::vector<CollisionPair>&);
+
+static SphereVsBoxesFn selectKernel(SimdKernel kernel)
+{
+#ifdef SIMD_SSE2
+    if (kernel == KERNEL_AVX2 && cpuHasAvx2())
+        return sphereVsBoxesAvx2;
+    if (kernel != KERNEL_SCALAR)
+        return sphereVsBoxesSse;
+#endif
+    (void)kernel;
+    return sphereVsBoxesScalar;
+}
+
+void collideSpheresBoxes(const EntityArrays& spheres, float radius, const TargetBoxes& boxes,
+                         std::vector<CollisionPair>& hits, SimdKernel kernel)
+{
+    SphereVsBoxesFn narrow = selectKernel(kernel);
+    float r2 = radius * radius;
+    for (std::size_t i = 0; i < spheres.size(); i++)
+    {
+        if (spheres.alive[i] == 0.0f)
+            continue;
+        narrow(spheres.position(i), r2, static_cast<uint32_t>(i), boxes, 0, boxes.size(), hits);
+    }
+}
+
+// broadphase grid
+// ---------------------------------------------------------------------------------------------
+int BroadphaseGrid::cellCoord(float v) const
+{
+    return static_cast<int>(std::floor(v / cellSize));
+}
+
+uint64_t BroadphaseGrid::cellKey(int x, int y, int z) const
+{
+    const uint64_t bias = 1u << 20;
+    const uint64_t mask = (1u << 21) - 1;
+    return ((uint64_t(x) + bias) & mask) | (((uint64_t(y) + bias) & mask) << 21) | (((uint64_t(z) + bias) & mask) << 42);
+}
+
+void BroadphaseGrid::build(const TargetBoxes& boxes, float maxRadius)
+{
+    builtRadius = maxRadius;
+    cellLookup.clear();
+    cellBegin.clear();
+    cellEnd.clear();
+    packed.clear();
+
+    // bucket box indices by cell, then lay every bucket out as its own padded SoA block
+    std::vector<std::vector<uint32_t>> buckets;
+    for (std::size_t j = 0; j < boxes.size(); j++)
+    {
+        if (boxes.ids[j] == UINT32_MAX)
+            continue;
+        int x0 = cellCoord(boxes.minX[j] - maxRadius), x1 = cellCoord(boxes.maxX[j] + maxRadius);
+        int y0 = cellCoord(boxes.minY[j] - maxRadius), y1 = cellCoord(boxes.maxY[j] + maxRadius);
+        int z0 = cellCoord(boxes.minZ[j] - maxRadius), z1 = cellCoord(boxes.maxZ[j] + maxRadius);
+        for (int z = z0; z <= z1; z++)
+            for (int y = y0; y <= y1; y++)
+                for (int x = x0; x <= x1; x++)
+                {
+                    auto inserted = cellLookup.emplace(cellKey(x, y, z), static_cast<uint32_t>(buckets.size()));
+                    if (inserted.second)
+                        buckets.emplace_back();
+                    buckets[inserted.first->second].push_back(static_cast<uint32_t>(j));
+                }
+    }
+
+    for (const std::vector<uint32_t>& bucket : buckets)
+    {
+        cellBegin.push_back(static_cast<uint32_t>(packed.size()));
+        for (uint32_t j : bucket)
+            packed.addBounds(boxes, j);
+        packed.pad();
+        cellEnd.push_back(static_cast<uint32_t>(packed.size()));
+    }
+}
+
+void BroadphaseGrid::collide(const EntityArrays& spheres, float radius, std::vector<CollisionPair>& hits, SimdKernel kernel) const
+{
+    SphereVsBoxesFn narrow = selectKernel(kernel);
+    float r2 = radius * radius;
+    tested = 0;
+    // a sphere larger than the build radius could touch boxes outside its own cell
+    if (radius > builtRadius)
+    {
+        // boxes sit in several cells of packed, so drop the duplicate pairs this produces
+        std::size_t first = hits.size();
+        collideSpheresBoxes(spheres, radius, packed, hits, kernel);
+        std::sort(hits.begin() + first, hits.end());
+        hits.erase(std::unique(hits.begin() + first, hits.end()), hits.end());
+        tested = spheres.size() * packed.size();
+        return;
+    }
+
+    for (std::size_t i = 0; i < spheres.size(); i++)
+    {
+        if (spheres.alive[i] == 0.0f)
+            continue;
+        glm::vec3 center = spheres.position(i);
+        auto cell = cellLookup.find(cellKey(cellCoord(center.x), cellCoord(center.y), cellCoord(center.z)));
+        if (cell == cellLookup.end())
+            continue;
+        std::size_t begin = cellBegin[cell->second], end = cellEnd[cell->second];
+        tested += end - begin;
+        narrow(center, r2, static_cast<uint32_t>(i), packed, begin, end, hits);
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include "raid_world.h"
+#include "simd.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// a bomb (sphere) index that overlaps a target box index
+struct CollisionPair
+{
+    uint32_t sphere;
+    uint32_t box;
+
+    bool operator<(const CollisionPair& other) const
+    {
+        return sphere != other.sphere ? sphere < other.sphere : box < other.box;
+    }
+    bool operator==(const CollisionPair& other) const { return sphere == other.sphere && box == other.box; }
+};
+
+// axis aligned target boxes stored as SoA min/max arrays. the end is padded to a whole
+// AVX block with boxes at FLT_MAX that nothing can touch, so the kernels need no tail loop.
+class TargetBoxes
+{
+public:
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+    std::vector<uint32_t> ids;
+
+    // same corner math as checkSphereBoxCollision so both paths see bit-identical bounds
+    void add(glm::vec3 center, glm::vec3 halfSize, uint32_t id);
+    void addBounds(const TargetBoxes& from, std::size_t index);
+    void pad();
+    void clear();
+    std::size_t size() const { return ids.size(); }
+};
+
+// every live sphere in spheres against every box, appending overlaps to hits
+void collideSpheresBoxes(const EntityArrays& spheres, float radius, const TargetBoxes& boxes,
+                         std::vector<CollisionPair>& hits, SimdKernel kernel);
+
+// uniform grid broadphase. each box is inserted, grown by the query radius, into every cell it
+// touches and stored in a per-cell SoA block, so a sphere only runs the SIMD narrow phase
+// against the boxes sharing the cell of its center.
+class BroadphaseGrid
+{
+public:
+    explicit BroadphaseGrid(float cellSize = 256.0f) : cellSize(cellSize) {}
+
+    void build(const TargetBoxes& boxes, float maxRadius);
+    void collide(const EntityArrays& spheres, float radius, std::vector<CollisionPair>& hits, SimdKernel kernel) const;
+
+    std::size_t cellCount() const { return cellBegin.size(); }
+    // sphere-box tests the last collide() ran, to compare against the N*M brute force
+    std::size_t pairsTested() const { return tested; }
+
+private:
+    float cellSize;
+    float builtRadius = 0.0f;
+    std::unordered_map<uint64_t, uint32_t> cellLookup;
+    std::vector<uint32_t> cellBegin, cellEnd;
+    TargetBoxes packed;
+    mutable std::size_t tested = 0;
+
+    uint64_t cellKey(int x, int y, int z) const;
+    int cellCoord(float v) const;
+};
+
+#endif
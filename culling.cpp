@@ -0,0 +1,103 @@
+#include "culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+// planes straight from the rows of the clip matrix (Gribb & Hartmann)
+Frustum extractFrustum(const glm::mat4& m)
+{
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+    for (glm::vec4& plane : frustum.planes)
+        plane = plane / glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+bool sphereInFrustum(const Frustum& frustum, glm::vec3 center, float radius)
+{
+    for (const glm::vec4& plane : frustum.planes)
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    return true;
+}
+
+bool boxInFrustum(const Frustum& frustum, glm::vec3 boxMin, glm::vec3 boxMax)
+{
+    // only the corner furthest along each plane's normal needs checking
+    for (const glm::vec4& plane : frustum.planes)
+    {
+        glm::vec3 corner(plane.x >= 0.0f ? boxMax.x : boxMin.x, plane.y >= 0.0f ? boxMax.y : boxMin.y, plane.z >= 0.0f ? boxMax.z : boxMin.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+// Arvo: each output axis is the translation plus the smaller/larger of every matrix entry times min/max
+void transformBounds(const glm::mat4& matrix, glm::vec3 boxMin, glm::vec3 boxMax, glm::vec3& outMin, glm::vec3& outMax)
+{
+    outMin = outMax = glm::vec3(matrix[3]);
+    for (int column = 0; column < 3; column++)
+        for (int row = 0; row < 3; row++)
+        {
+            float a = matrix[column][row] * boxMin[column];
+            float b = matrix[column][row] * boxMax[column];
+            outMin[row] += std::min(a, b);
+            outMax[row] += std::max(a, b);
+        }
+}
+
+void ViewCuller::setView(const glm::mat4& projection, const glm::mat4& view, float fovY, float viewportHeight)
+{
+    frustum = extractFrustum(projection * view);
+    eye = glm::vec3(glm::inverse(view)[3]);
+    pixelsPerUnit = viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+    stats = CullStats();
+}
+
+int ViewCuller::select(glm::vec3 boundsMin, glm::vec3 boundsMax, const float* lodError, uint32_t levels, const glm::mat4& matrix)
+{
+    stats.tested++;
+    glm::vec3 worldMin, worldMax;
+    transformBounds(matrix, boundsMin, boundsMax, worldMin, worldMax);
+    if (!boxInFrustum(frustum, worldMin, worldMax))
+    {
+        stats.outsideFrustum++;
+        return -1;
+    }
+
+    // errors are in model units; the largest axis scale turns them into world units
+    float scale = std::max(glm::length(glm::vec3(matrix[0])), std::max(glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))));
+    glm::vec3 center = 0.5f * (worldMin + worldMax);
+    float radius = 0.5f * glm::length(worldMax - worldMin);
+    float distance = glm::length(center - eye);
+    if (distance <= radius)
+    {
+        stats.drawn[0]++;
+        return 0;
+    }
+    if (radius / distance * pixelsPerUnit < minRadiusPixels)
+    {
+        stats.tooSmall++;
+        return -1;
+    }
+
+    // the nearest point of the bounding sphere is where an error shows the most
+    float pixelsPerModelUnit = scale / (distance - radius) * pixelsPerUnit;
+    int level = 0;
+    for (uint32_t l = 1; l < levels && l < CULL_MAX_LODS; l++)
+        if (lodError[l] * pixelsPerModelUnit <= maxErrorPixels)
+            level = static_cast<int>(l);
+    stats.drawn[level]++;
+    return level;
+}
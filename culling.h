@@ -0,0 +1,53 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// CPU visibility: objects are tested against the view frustum and dropped when they cover less than
+// a pixel, the rest get the coarsest level of detail whose geometric error (ModelData::lodError)
+// still projects to under a pixel or so. nothing in here needs GL.
+
+const uint32_t CULL_MAX_LODS = 8;
+
+// the six planes of projection * view (left, right, bottom, top, near, far), normalised, inside positive
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+Frustum extractFrustum(const glm::mat4& viewProjection);
+bool sphereInFrustum(const Frustum& frustum, glm::vec3 center, float radius);
+bool boxInFrustum(const Frustum& frustum, glm::vec3 boxMin, glm::vec3 boxMax);
+// bounds of the box after the transform, without transforming its eight corners
+void transformBounds(const glm::mat4& matrix, glm::vec3 boxMin, glm::vec3 boxMax, glm::vec3& outMin, glm::vec3& outMax);
+
+struct CullStats
+{
+    uint64_t tested = 0;
+    uint64_t outsideFrustum = 0;
+    uint64_t tooSmall = 0;
+    uint64_t drawn[CULL_MAX_LODS] = {};
+};
+
+class ViewCuller
+{
+public:
+    // projected error a level may have, and the projected radius below which an object is not drawn
+    float maxErrorPixels = 1.0f;
+    float minRadiusPixels = 0.5f;
+
+    Frustum frustum;
+    glm::vec3 eye = glm::vec3(0.0f);
+    float pixelsPerUnit = 1.0f; // screen pixels covered by one unit at distance one
+    CullStats stats;
+
+    // once per frame; fovY in radians, viewportHeight in pixels. clears the stats
+    void setView(const glm::mat4& projection, const glm::mat4& view, float fovY, float viewportHeight);
+    // level to draw an object with these model-space bounds and per-level errors under matrix,
+    // -1 when it is outside the frustum or too small to see
+    int select(glm::vec3 boundsMin, glm::vec3 boundsMax, const float* lodError, uint32_t levels, const glm::mat4& matrix);
+};
+
+#endif
@@ -0,0 +1,284 @@
+#include "debug_draw.h"
+#include "shader_manager.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// GL 4.4 / ARB_buffer_storage, loaded by hand because glad is generated for 3.3
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP BufferStorageProc)(GLenum, GLsizeiptr, const void*, GLbitfield);
+
+static bool hasBufferStorage()
+{
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 4 || (major == 4 && minor >= 4))
+        return true;
+    GLint extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+    for (GLint i = 0; i < extensions; i++)
+    {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (name && std::strcmp(name, "GL_ARB_buffer_storage") == 0)
+            return true;
+    }
+    return false;
+}
+
+void DebugDraw::create(void* (*procAddress)(const char*), std::size_t verticesPerFrame)
+{
+    regionVertices = verticesPerFrame;
+    lines.reserve(regionVertices);
+    triangles.reserve(regionVertices);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    BufferStorageProc bufferStorage = hasBufferStorage() ? reinterpret_cast<BufferStorageProc>(procAddress("glBufferStorage")) : nullptr;
+    if (bufferStorage)
+    {
+        // mapped once for the buffer's whole life; coherent, so writes need no explicit flush
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLsizeiptr bytes = static_cast<GLsizeiptr>(REGIONS * regionVertices * sizeof(DebugVertex));
+        bufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+        mapped = static_cast<DebugVertex*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags));
+        if (!mapped)
+        {
+            // immutable storage cannot be respecified by glBufferData: start over with a new buffer
+            glDeleteBuffers(1, &vbo);
+            glGenBuffers(1, &vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        }
+    }
+    if (!mapped)
+        glBufferData(GL_ARRAY_BUFFER, regionVertices * sizeof(DebugVertex), nullptr, GL_STREAM_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void*)offsetof(DebugVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DebugVertex), (void*)offsetof(DebugVertex, color));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DebugDraw::release()
+{
+    for (void*& fence : fences)
+    {
+        if (fence)
+            glDeleteSync(static_cast<GLsync>(fence));
+        fence = nullptr;
+    }
+    if (vao)
+    {
+        if (mapped)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vbo);
+    }
+    vao = vbo = 0;
+    mapped = nullptr;
+}
+
+// shapes
+// ---------------------------------------------------------------------------------------------
+static void packColor(glm::vec4 color, uint8_t* out)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = static_cast<uint8_t>(std::min(std::max(color[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+bool DebugDraw::room(std::size_t vertices)
+{
+    if (lines.size() + triangles.size() + vertices <= regionVertices)
+        return true;
+    dropped += vertices;
+    return false;
+}
+
+void DebugDraw::push(std::vector<DebugVertex>& to, glm::vec3 position, const uint8_t* color)
+{
+    DebugVertex vertex;
+    vertex.position = position;
+    std::memcpy(vertex.color, color, 4);
+    to.push_back(vertex);
+}
+
+void DebugDraw::line(glm::vec3 a, glm::vec3 b, glm::vec4 color)
+{
+    if (!room(2))
+        return;
+    uint8_t rgba[4];
+    packColor(color, rgba);
+    push(lines, a, rgba);
+    push(lines, b, rgba);
+}
+
+void DebugDraw::box(const glm::mat4& transform, glm::vec4 color)
+{
+    if (!room(24))
+        return;
+    uint8_t rgba[4];
+    packColor(color, rgba);
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; i++)
+        corners[i] = glm::vec3(transform * glm::vec4(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f, 1.0f));
+    // corner pairs that differ in exactly one axis
+    static const int edges[24] = { 0, 1, 2, 3, 4, 5, 6, 7, 0, 2, 1, 3, 4, 6, 5, 7, 0, 4, 1, 5, 2, 6, 3, 7 };
+    for (int corner : edges)
+        push(lines, corners[corner], rgba);
+}
+
+void DebugDraw::box(glm::vec3 center, glm::vec3 halfSize, glm::vec4 color)
+{
+    glm::mat4 transform(1.0f);
+    transform[0][0] = halfSize.x * 2.0f;
+    transform[1][1] = halfSize.y * 2.0f;
+    transform[2][2] = halfSize.z * 2.0f;
+    transform[3] = glm::vec4(center, 1.0f);
+    box(transform, color);
+}
+
+void DebugDraw::sphere(glm::vec3 center, float radius, glm::vec4 color, int segments)
+{
+    if (segments < 3 || !room(static_cast<std::size_t>(segments) * 6))
+        return;
+    uint8_t rgba[4];
+    packColor(color, rgba);
+    for (int i = 0; i < segments; i++)
+    {
+        float a0 = 6.2831853f * i / segments;
+        float a1 = 6.2831853f * (i + 1) / segments;
+        float c0 = std::cos(a0) * radius, s0 = std::sin(a0) * radius;
+        float c1 = std::cos(a1) * radius, s1 = std::sin(a1) * radius;
+        push(lines, center + glm::vec3(c0, s0, 0.0f), rgba);
+        push(lines, center + glm::vec3(c1, s1, 0.0f), rgba);
+        push(lines, center + glm::vec3(c0, 0.0f, s0), rgba);
+        push(lines, center + glm::vec3(c1, 0.0f, s1), rgba);
+        push(lines, center + glm::vec3(0.0f, c0, s0), rgba);
+        push(lines, center + glm::vec3(0.0f, c1, s1), rgba);
+    }
+}
+
+void DebugDraw::path(const glm::vec3* points, std::size_t count, glm::vec4 color)
+{
+    if (count < 2 || !room((count - 1) * 2))
+        return;
+    uint8_t rgba[4];
+    packColor(color, rgba);
+    for (std::size_t i = 1; i < count; i++)
+    {
+        push(lines, points[i - 1], rgba);
+        push(lines, points[i], rgba);
+    }
+}
+
+void DebugDraw::disc(glm::vec3 center, float radius, glm::vec4 color, int segments)
+{
+    if (segments < 3 || !room(static_cast<std::size_t>(segments) * 5))
+        return;
+    uint8_t fill[4], outline[4];
+    packColor(glm::vec4(glm::vec3(color), color.w * 0.35f), fill);
+    packColor(color, outline);
+    for (int i = 0; i < segments; i++)
+    {
+        float a0 = 6.2831853f * i / segments;
+        float a1 = 6.2831853f * (i + 1) / segments;
+        glm::vec3 p0 = center + glm::vec3(std::cos(a0), 0.0f, std::sin(a0)) * radius;
+        glm::vec3 p1 = center + glm::vec3(std::cos(a1), 0.0f, std::sin(a1)) * radius;
+        push(triangles, center, fill);
+        push(triangles, p1, fill);
+        push(triangles, p0, fill);
+        push(lines, p0, outline);
+        push(lines, p1, outline);
+    }
+}
+
+// flush
+// ---------------------------------------------------------------------------------------------
+void DebugDraw::flush(ShaderProgram& shader)
+{
+    lastFrame = DebugDrawStats();
+    lastFrame.lineVertices = lines.size();
+    lastFrame.triangleVertices = triangles.size();
+    lastFrame.dropped = dropped;
+
+    std::size_t total = lines.size() + triangles.size();
+    if (vao && total > 0)
+    {
+        GLint first = 0;
+        if (mapped)
+        {
+            // the region was last drawn REGIONS frames ago; only wait when the GPU is that far behind
+            if (fences[region])
+            {
+                GLsync fence = static_cast<GLsync>(fences[region]);
+                if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                {
+                    fenceWaits++;
+                    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+                }
+                glDeleteSync(fence);
+                fences[region] = nullptr;
+            }
+            DebugVertex* out = mapped + region * regionVertices;
+            std::memcpy(out, lines.data(), lines.size() * sizeof(DebugVertex));
+            std::memcpy(out + lines.size(), triangles.data(), triangles.size() * sizeof(DebugVertex));
+            first = static_cast<GLint>(region * regionVertices);
+        }
+        else
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferData(GL_ARRAY_BUFFER, regionVertices * sizeof(DebugVertex), nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, lines.size() * sizeof(DebugVertex), lines.data());
+            glBufferSubData(GL_ARRAY_BUFFER, lines.size() * sizeof(DebugVertex), triangles.size() * sizeof(DebugVertex), triangles.data());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        shader.use();
+        glBindVertexArray(vao);
+        if (!lines.empty())
+        {
+            glDrawArrays(GL_LINES, first, static_cast<GLsizei>(lines.size()));
+            lastFrame.draws++;
+        }
+        if (!triangles.empty())
+        {
+            // see-through, and without writing depth
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            glDrawArrays(GL_TRIANGLES, first + static_cast<GLint>(lines.size()), static_cast<GLsizei>(triangles.size()));
+            glDepthMask(GL_TRUE);
+            glDisable(GL_BLEND);
+            lastFrame.draws++;
+        }
+        glBindVertexArray(0);
+
+        if (mapped)
+        {
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            region = (region + 1) % REGIONS;
+        }
+    }
+    lastFrame.fenceWaits = fenceWaits;
+    lines.clear();
+    triangles.clear();
+    dropped = 0;
+}
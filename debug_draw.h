@@ -0,0 +1,76 @@
+#ifndef DEBUG_DRAW_H
+#define DEBUG_DRAW_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ShaderProgram;
+
+// one vertex of a debug line or triangle: world position and an RGBA colour
+struct DebugVertex
+{
+    glm::vec3 position;
+    uint8_t color[4];
+};
+static_assert(sizeof(DebugVertex) == 16, "DebugVertex is copied into the ring as is");
+
+struct DebugDrawStats
+{
+    std::size_t lineVertices = 0;
+    std::size_t triangleVertices = 0;
+    std::size_t dropped = 0; // over the per-frame capacity
+    std::size_t draws = 0;
+    uint64_t fenceWaits = 0; // flushes that found the GPU still reading their part of the ring
+};
+
+// immediate-mode debug geometry: shapes are added at any point of the frame and flush() draws
+// all of them, one draw for the lines and one for the filled triangles. the vertices go into a
+// ring of three frame-sized regions in one persistently mapped buffer (ARB_buffer_storage); a
+// fence after each frame's draws guards its region until the GPU is done with it. without buffer
+// storage the buffer is orphaned and refilled every frame like the particle stream.
+class DebugDraw
+{
+public:
+    // procAddress is the context's GL loader (glad is generated for 3.3 and has no glBufferStorage)
+    void create(void* (*procAddress)(const char*), std::size_t verticesPerFrame = 65536);
+    void release();
+
+    void line(glm::vec3 a, glm::vec3 b, glm::vec4 color);
+    // the twelve edges of the unit cube (-0.5..0.5) under transform
+    void box(const glm::mat4& transform, glm::vec4 color);
+    void box(glm::vec3 center, glm::vec3 halfSize, glm::vec4 color);
+    // three great circles
+    void sphere(glm::vec3 center, float radius, glm::vec4 color, int segments = 24);
+    // a polyline through count points
+    void path(const glm::vec3* points, std::size_t count, glm::vec4 color);
+    // a filled disc lying flat (normal +y) with its outline, e.g. an impact point
+    void disc(glm::vec3 center, float radius, glm::vec4 color, int segments = 24);
+
+    // uploads and draws everything added since the last flush, then starts the next frame
+    void flush(ShaderProgram& shader);
+
+    bool persistent() const { return mapped != nullptr; }
+    DebugDrawStats lastFrame;
+
+private:
+    static const int REGIONS = 3;
+
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+    std::size_t regionVertices = 0;
+    DebugVertex* mapped = nullptr;
+    void* fences[REGIONS] = {};
+    int region = 0;
+    std::vector<DebugVertex> lines;
+    std::vector<DebugVertex> triangles;
+    std::size_t dropped = 0;
+    uint64_t fenceWaits = 0;
+
+    bool room(std::size_t vertices);
+    void push(std::vector<DebugVertex>& to, glm::vec3 position, const uint8_t* color);
+};
+
+#endif
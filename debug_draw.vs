@@ -0,0 +1,18 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aColor;
+
+out vec4 Color;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec4 cameraPosition;
+};
+
+void main()
+{
+    Color = aColor;
+    gl_Position = projection * view * vec4(aPos, 1.0);
+}
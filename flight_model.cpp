@@ -0,0 +1,179 @@
+#include "flight_model.h"
+
+#include <algorithm>
+#include <cmath>
+
+static int substepCount(const FlightParams& params, float dt)
+{
+    if (!(dt > 0.0f) || !(params.maxSubstep > 0.0f))
+        return 1;
+    return std::max(1, static_cast<int>(std::ceil(dt / params.maxSubstep)));
+}
+
+// one aircraft over a frame of substeps. the controls hold for the whole frame, so every substep
+// turns by the same two small rotations: their half-angle sin/cos are taken once, and applying them
+// is a specialised quaternion product (a pure y rotation in front, a pure x rotation behind)
+static inline void integrate(float& px, float& py, float& pz, float& qw, float& qx, float& qy, float& qz, float& roll, float& speed,
+                             float pitch, float turn, float throttle, const FlightParams& params, int substeps, float h)
+{
+    float yawHalf = glm::radians(params.yawRate * turn * h) * 0.5f;
+    float pitchHalf = glm::radians(-params.pitchRate * pitch * h) * 0.5f; // the frame carries pitch inverted
+    float cy = std::cos(yawHalf), sy = std::sin(yawHalf);
+    float cp = std::cos(pitchHalf), sp = std::sin(pitchHalf);
+
+    for (int step = 0; step < substeps; step++)
+    {
+        // rudder about the world up axis, stick about the wing
+        float w = cy * qw - sy * qy;
+        float x = cy * qx + sy * qz;
+        float y = cy * qy + sy * qw;
+        float z = cy * qz - sy * qx;
+        qw = w * cp - x * sp;
+        qx = w * sp + x * cp;
+        qy = y * cp + z * sp;
+        qz = z * cp - y * sp;
+
+        // bank follows the turn and levels out when the rudder is released
+        if (turn != 0.0f)
+            roll = glm::clamp(roll - params.rollRate * turn * h, -params.maxRoll, params.maxRoll);
+        else if (roll > 0.0f)
+            roll = std::max(roll - params.rollRate * h * 0.8f, 0.0f);
+        else if (roll < 0.0f)
+            roll = std::min(roll + params.rollRate * h * 0.8f, 0.0f);
+
+        // throttle, or settle back to cruise at half the rate
+        if (throttle != 0.0f)
+            speed = glm::clamp(speed + params.accelerate * throttle * h, params.minSpeed, params.maxSpeed);
+        else if (speed > params.avgSpeed)
+            speed = std::max(speed - params.accelerate * h * 0.5f, params.avgSpeed);
+        else if (speed < params.avgSpeed)
+            speed = std::min(speed + params.accelerate * h * 0.5f, params.avgSpeed);
+
+        // along the nose: minus the rotated z axis
+        float distance = speed * h;
+        px -= 2.0f * (qx * qz + qw * qy) * distance;
+        py -= 2.0f * (qy * qz - qw * qx) * distance;
+        pz -= (1.0f - 2.0f * (qx * qx + qy * qy)) * distance;
+    }
+
+    // renormalise once per frame against rounding drift
+    float length = std::sqrt(qw * qw + qx * qx + qy * qy + qz * qz);
+    qw /= length;
+    qx /= length;
+    qy /= length;
+    qz /= length;
+}
+
+void stepFlight(FlightBody& body, const FlightControls& controls, const FlightParams& params, float dt)
+{
+    int substeps = substepCount(params, dt);
+    integrate(body.position.x, body.position.y, body.position.z, body.orientation.w, body.orientation.x, body.orientation.y,
+              body.orientation.z, body.roll, body.speed, controls.pitch, controls.turn, controls.throttle, params, substeps, dt / substeps);
+}
+
+glm::quat flightOrientation(float headingDegrees, float pitchDegrees)
+{
+    return glm::angleAxis(glm::radians(headingDegrees), glm::vec3(0.0f, 1.0f, 0.0f)) *
+           glm::angleAxis(glm::radians(-pitchDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
+}
+
+glm::vec3 flightForward(const glm::quat& q)
+{
+    return -glm::vec3(2.0f * (q.x * q.z + q.w * q.y), 2.0f * (q.y * q.z - q.w * q.x), 1.0f - 2.0f * (q.x * q.x + q.y * q.y));
+}
+
+float flightHeading(const glm::quat& orientation)
+{
+    glm::vec3 forward = flightForward(orientation);
+    return glm::degrees(std::atan2(-forward.x, -forward.z));
+}
+
+float flightPitch(const glm::quat& orientation)
+{
+    return glm::degrees(std::asin(glm::clamp(-flightForward(orientation).y, -1.0f, 1.0f)));
+}
+
+glm::mat4 flightRotationMatrix(const glm::quat& orientation, float roll)
+{
+    // mat4_cast(orientation) * Rz(-roll): the bank only mixes the first two columns
+    glm::mat4 rotation = glm::mat4_cast(orientation);
+    float c = std::cos(glm::radians(roll)), s = std::sin(glm::radians(roll));
+    glm::vec4 right = rotation[0], up = rotation[1];
+    rotation[0] = right * c - up * s;
+    rotation[1] = up * c + right * s;
+    return rotation;
+}
+
+std::size_t FlightFormation::add(const FlightBody& body)
+{
+    posX.push_back(body.position.x);
+    posY.push_back(body.position.y);
+    posZ.push_back(body.position.z);
+    rotW.push_back(body.orientation.w);
+    rotX.push_back(body.orientation.x);
+    rotY.push_back(body.orientation.y);
+    rotZ.push_back(body.orientation.z);
+    roll.push_back(body.roll);
+    speed.push_back(body.speed);
+    pitchInput.push_back(0.0f);
+    turnInput.push_back(0.0f);
+    throttleInput.push_back(0.0f);
+    return speed.size() - 1;
+}
+
+void FlightFormation::clear()
+{
+    std::vector<float>* arrays[] = { &posX, &posY, &posZ, &rotW, &rotX, &rotY, &rotZ, &roll, &speed, &pitchInput, &turnInput, &throttleInput };
+    for (std::vector<float>* array : arrays)
+        array->clear();
+}
+
+FlightBody FlightFormation::body(std::size_t index) const
+{
+    FlightBody body;
+    body.position = glm::vec3(posX[index], posY[index], posZ[index]);
+    body.orientation = glm::quat(rotW[index], rotX[index], rotY[index], rotZ[index]);
+    body.roll = roll[index];
+    body.speed = speed[index];
+    return body;
+}
+
+void FlightFormation::setBody(std::size_t index, const FlightBody& body)
+{
+    posX[index] = body.position.x;
+    posY[index] = body.position.y;
+    posZ[index] = body.position.z;
+    rotW[index] = body.orientation.w;
+    rotX[index] = body.orientation.x;
+    rotY[index] = body.orientation.y;
+    rotZ[index] = body.orientation.z;
+    roll[index] = body.roll;
+    speed[index] = body.speed;
+}
+
+void FlightFormation::translate(glm::vec3 offset)
+{
+    for (std::size_t i = 0; i < size(); i++)
+    {
+        posX[i] += offset.x;
+        posY[i] += offset.y;
+        posZ[i] += offset.z;
+    }
+}
+
+void FlightFormation::setControls(std::size_t index, const FlightControls& controls)
+{
+    pitchInput[index] = controls.pitch;
+    turnInput[index] = controls.turn;
+    throttleInput[index] = controls.throttle;
+}
+
+void FlightFormation::step(const FlightParams& params, float dt)
+{
+    int substeps = substepCount(params, dt);
+    float h = dt / substeps;
+    std::size_t count = size();
+    for (std::size_t i = 0; i < count; i++)
+        integrate(posX[i], posY[i], posZ[i], rotW[i], rotX[i], rotY[i], rotZ[i], roll[i], speed[i], pitchInput[i], turnInput[i],
+                  throttleInput[i], params, substeps, h);
+}
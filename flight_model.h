@@ -0,0 +1,80 @@
+#ifndef FLIGHT_MODEL_H
+#define FLIGHT_MODEL_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// arcade flight model: the flight frame (heading and climb) is a quaternion turned about the world
+// up axis by the rudder and about the wing axis by the stick, bank is a cosmetic angle that follows
+// the turn, and the aircraft flies along its nose. a frame is integrated in equal substeps no longer
+// than maxSubstep (semi-implicit: rotate and change speed, then move), so the path flown does not
+// depend on the frame rate.
+
+// tunables of an aircraft type: speeds in m/s, rates in degrees/s
+struct FlightParams
+{
+    float accelerate = 10.0f;
+    float maxSpeed = 80.0f;
+    float avgSpeed = 50.0f; // the speed the plane settles back to without throttle input
+    float minSpeed = 30.0f;
+    float yawRate = 20.0f;
+    float pitchRate = 20.0f;
+    float rollRate = 20.0f;
+    float maxRoll = 45.0f;
+    float maxSubstep = 1.0f / 120.0f;
+};
+
+// stick, rudder and throttle in -1..1. pitch > 0 lowers the nose (S), turn > 0 turns left (A),
+// throttle > 0 speeds up (F)
+struct FlightControls
+{
+    float pitch = 0.0f;
+    float turn = 0.0f;
+    float throttle = 0.0f;
+};
+
+struct FlightBody
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::quat orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f); // w, x, y, z
+    float roll = 0.0f;  // bank in degrees, positive banks right
+    float speed = 50.0f;
+};
+
+void stepFlight(FlightBody& body, const FlightControls& controls, const FlightParams& params, float dt);
+
+// the flight frame for a heading (0 flies towards -z, positive turns left) and a pitch (positive dives)
+glm::quat flightOrientation(float headingDegrees, float pitchDegrees);
+glm::vec3 flightForward(const glm::quat& orientation);
+float flightHeading(const glm::quat& orientation);
+float flightPitch(const glm::quat& orientation);
+// orientation with the bank applied, as a model rotation
+glm::mat4 flightRotationMatrix(const glm::quat& orientation, float roll);
+
+// many aircraft of one type, structure of arrays, stepped together with the same substeps
+class FlightFormation
+{
+public:
+    std::size_t add(const FlightBody& body);
+    std::size_t size() const { return speed.size(); }
+    void clear();
+
+    FlightBody body(std::size_t index) const;
+    void setBody(std::size_t index, const FlightBody& body);
+    void setControls(std::size_t index, const FlightControls& controls);
+    // moves every aircraft, e.g. when the world origin is rebased
+    void translate(glm::vec3 offset);
+
+    void step(const FlightParams& params, float dt);
+
+private:
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> rotW, rotX, rotY, rotZ;
+    std::vector<float> roll, speed;
+    std::vector<float> pitchInput, turnInput, throttleInput;
+};
+
+#endif
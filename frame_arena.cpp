@@ -0,0 +1,27 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+
+FrameArena::FrameArena(std::size_t capacity)
+    : block(new unsigned char[capacity]), size(capacity)
+{
+}
+
+void* FrameArena::allocate(std::size_t bytes, std::size_t alignment)
+{
+    // the block itself comes from new[], aligned for any fundamental type
+    std::size_t start = (offset + alignment - 1) & ~(alignment - 1);
+    if (start > size || bytes > size - start)
+    {
+        failures++;
+        return nullptr;
+    }
+    offset = start + bytes;
+    return block.get() + start;
+}
+
+void FrameArena::reset()
+{
+    peak = std::max(peak, offset);
+    offset = 0;
+}
@@ -0,0 +1,46 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+// scratch memory for one frame: a linear allocator over a block reserved up front. an allocation
+// is a pointer bump, nothing is freed on its own and reset() at the end of the frame hands the
+// whole block back. the block never grows; a request that does not fit returns nullptr and is
+// counted, so callers skip their optional work (an overlay, a debug list) rather than allocate.
+class FrameArena
+{
+public:
+    explicit FrameArena(std::size_t capacity = 4 << 20);
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+
+    // uninitialised room for count objects; only for types that need no destructor, since the
+    // arena never runs one
+    template <typename T>
+    T* allocate(std::size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void reset();
+
+    std::size_t used() const { return offset; }
+    std::size_t capacity() const { return size; }
+    std::size_t highWater() const { return peak; }
+    uint64_t failed() const { return failures; } // requests that did not fit, over the arena's life
+
+private:
+    std::unique_ptr<unsigned char[]> block;
+    std::size_t size;
+    std::size_t offset = 0;
+    std::size_t peak = 0;
+    uint64_t failures = 0;
+};
+
+#endif
@@ -0,0 +1,378 @@
+#include "gpu_model.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+
+DecodedImage decodeImage(const std::string& path)
+{
+    DecodedImage image;
+    image.path = path;
+    if (readDds(textureCachePath(path), path, image.compressed))
+    {
+        image.width = image.compressed.width;
+        image.height = image.compressed.height;
+        image.channels = image.compressed.hasAlpha ? 4 : 3;
+        return image;
+    }
+    image.pixels = std::unique_ptr<unsigned char, void (*)(void*)>(
+        stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0), stbi_image_free);
+    return image;
+}
+
+// S3TC is an extension on core profiles, so ask the driver for its compressed formats once
+static bool bc1Supported()
+{
+    static int supported = -1;
+    if (supported < 0)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+        std::vector<GLint> formats(std::max(count, 0));
+        if (count > 0)
+            glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+        supported = std::find(formats.begin(), formats.end(), GL_COMPRESSED_RGB_S3TC_DXT1_EXT) != formats.end()
+            && std::find(formats.begin(), formats.end(), GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) != formats.end();
+    }
+    return supported == 1;
+}
+
+static GLenum pixelFormat(int channels)
+{
+    if (channels == 1)
+        return GL_RED;
+    if (channels == 4)
+        return GL_RGBA;
+    return GL_RGB;
+}
+
+int uploadImageLevels(unsigned int target, const DecodedImage& image, bool buildMips)
+{
+    if (image.isCompressed())
+    {
+        const CompressedTexture& texture = image.compressed;
+        GLenum internalFormat = texture.hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        for (int level = 0; level < texture.levelCount(); level++)
+        {
+            int width = texture.levelWidth(level), height = texture.levelHeight(level);
+            if (bc1Supported())
+            {
+                glCompressedTexImage2D(target, level, internalFormat, width, height, 0,
+                                       static_cast<GLsizei>(texture.levelSize(level)), texture.levelData(level));
+            }
+            else
+            {
+                RgbaImage pixels = decompressBc1(texture.levelData(level), width, height);
+                glTexImage2D(target, level, texture.hasAlpha ? GL_RGBA : GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.pixels.data());
+            }
+        }
+        return texture.levelCount();
+    }
+
+    if (!image.pixels)
+        return 0;
+    GLenum format = pixelFormat(image.channels);
+    if (!buildMips)
+    {
+        glTexImage2D(target, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.get());
+        return 1;
+    }
+    // widened to RGBA so rows stay 4 byte aligned whatever the channel count
+    std::vector<RgbaImage> levels = buildMipChain(expandToRgba(image.pixels.get(), image.width, image.height, image.channels));
+    for (std::size_t level = 0; level < levels.size(); level++)
+        glTexImage2D(target, static_cast<GLint>(level), format, levels[level].width, levels[level].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[level].pixels.data());
+    return static_cast<int>(levels.size());
+}
+
+std::vector<std::string> modelTextureFiles(const ModelData& data)
+{
+    std::vector<std::string> files;
+    for (uint32_t t = 0; t < data.textureCount; t++)
+    {
+        std::string file = data.directory + '/' + data.texturePath(data.textures[t]);
+        bool seen = false;
+        for (const std::string& existing : files)
+            seen = seen || existing == file;
+        if (!seen)
+            files.push_back(file);
+    }
+    return files;
+}
+
+void GpuModel::upload(const ModelData& data, const std::vector<DecodedImage>* images)
+{
+    release();
+    boundsMin = data.boundsMin;
+    boundsMax = data.boundsMax;
+    for (uint32_t level = 0; level < MODEL_LOD_LEVELS; level++)
+        lodError[level] = data.lodError[level];
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, data.vertexCount * sizeof(ModelVertex), data.vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.indexCount * sizeof(uint32_t), data.indices, GL_STATIC_DRAW);
+
+    // vertex positions
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, position));
+    // vertex normals
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, normal));
+    // vertex texture coords
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, texCoords));
+    // vertex tangent
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, tangent));
+    // vertex bitangent
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, bitangent));
+    glBindVertexArray(0);
+
+    for (uint32_t m = 0; m < data.meshCount; m++)
+    {
+        const ModelMesh& mesh = data.meshes[m];
+        DrawRange range;
+        range.firstVertex = mesh.firstVertex;
+        range.firstIndex = mesh.firstIndex;
+        range.indexCount = mesh.indexCount;
+        for (uint32_t level = 0; level < MODEL_LOD_LEVELS; level++)
+            range.lods[level] = data.lod(m, level);
+        range.boundsMin = glm::vec3(mesh.boundsMin[0], mesh.boundsMin[1], mesh.boundsMin[2]);
+        range.boundsMax = glm::vec3(mesh.boundsMax[0], mesh.boundsMax[1], mesh.boundsMax[2]);
+        if (mesh.material < data.materialCount)
+        {
+            const ModelMaterial& material = data.materials[mesh.material];
+            for (uint32_t t = 0; t < material.textureCount; t++)
+            {
+                const ModelTextureRef& texture = data.textures[material.firstTexture + t];
+                range.textures.push_back({ loadTexture(data.directory + '/' + data.texturePath(texture), images), texture.type });
+            }
+        }
+        meshes.push_back(range);
+    }
+}
+
+void GpuModel::release()
+{
+    if (VAO)
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+    for (auto& loaded : loadedTextures)
+        glDeleteTextures(1, &loaded.second);
+    VAO = VBO = EBO = 0;
+    meshes.clear();
+    loadedTextures.clear();
+}
+
+// same sampling setup as learnopengl's TextureFromFile, shared between meshes of the model. a baked
+// .dds brings its own mips, a plain image gets them from glGenerateMipmap
+unsigned int GpuModel::loadTexture(const std::string& file, const std::vector<DecodedImage>* images)
+{
+    for (const auto& loaded : loadedTextures)
+        if (loaded.first == file)
+            return loaded.second;
+
+    const DecodedImage* image = nullptr;
+    DecodedImage decodedHere;
+    if (images)
+        for (const DecodedImage& candidate : *images)
+            if (candidate.path == file)
+                image = &candidate;
+    if (!image)
+    {
+        decodedHere = decodeImage(file);
+        image = &decodedHere;
+    }
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    if (image->valid())
+    {
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        if (image->isCompressed())
+        {
+            // baked mip chain, uploaded as is
+            int levels = uploadImageLevels(GL_TEXTURE_2D, *image, false);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        }
+        else
+        {
+            uploadImageLevels(GL_TEXTURE_2D, *image, false);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    else
+    {
+        std::cout << "Texture failed to load at path: " << file << std::endl;
+    }
+
+    loadedTextures.push_back({ file, textureID });
+    return textureID;
+}
+
+void GpuModel::bindTextures(ShaderProgram& shader, const DrawRange& mesh) const
+{
+    // texture_diffuseN ... as learnopengl's Mesh::Draw builds them, spelled out so the names are
+    // the same pointers every call and resolve through the program's uniform cache
+    static const unsigned int SAMPLERS_PER_TYPE = 4;
+    static const char* samplerNames[4][SAMPLERS_PER_TYPE] = {
+        { "texture_diffuse1", "texture_diffuse2", "texture_diffuse3", "texture_diffuse4" },
+        { "texture_specular1", "texture_specular2", "texture_specular3", "texture_specular4" },
+        { "texture_normal1", "texture_normal2", "texture_normal3", "texture_normal4" },
+        { "texture_height1", "texture_height2", "texture_height3", "texture_height4" },
+    };
+
+    unsigned int counters[4] = { 0, 0, 0, 0 };
+    for (unsigned int i = 0; i < mesh.textures.size(); i++)
+    {
+        uint32_t type = mesh.textures[i].type < 4 ? mesh.textures[i].type : 0;
+        if (counters[type] == SAMPLERS_PER_TYPE)
+            continue;
+        glActiveTexture(GL_TEXTURE0 + i);
+        shader.setInt(shader.uniformId(samplerNames[type][counters[type]++]), static_cast<int>(i));
+        glBindTexture(GL_TEXTURE_2D, mesh.textures[i].id);
+    }
+}
+
+void GpuModel::Draw(ShaderProgram& shader) const
+{
+    if (!VAO)
+        return; // still streaming in
+
+    glBindVertexArray(VAO);
+    for (const DrawRange& mesh : meshes)
+    {
+        bindTextures(shader, mesh);
+        glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount), GL_UNSIGNED_INT,
+                                 (void*)(mesh.firstIndex * sizeof(uint32_t)), static_cast<GLint>(mesh.firstVertex));
+    }
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void GpuModel::DrawInstanced(ShaderProgram& shader, unsigned int instanceBuffer, uint32_t firstInstance, uint32_t count, uint32_t lod,
+                             const uint8_t* meshVisible) const
+{
+    if (!VAO || count == 0)
+        return;
+
+    glBindVertexArray(VAO);
+    // GL 3.3 has no base instance, so the matrix attributes are pointed at this batch's slice
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    std::size_t offset = std::size_t(firstInstance) * sizeof(glm::mat4);
+    for (unsigned int column = 0; column < 4; column++)
+    {
+        unsigned int location = INSTANCE_MATRIX_LOCATION + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+    }
+
+    for (std::size_t m = 0; m < meshes.size(); m++)
+    {
+        const DrawRange& mesh = meshes[m];
+        const ModelLodRange& range = mesh.lods[lod < MODEL_LOD_LEVELS ? lod : 0];
+        if (range.indexCount == 0 || (meshVisible && !meshVisible[m]))
+            continue;
+        bindTextures(shader, mesh);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), GL_UNSIGNED_INT,
+                                          (void*)(range.firstIndex * sizeof(uint32_t)), static_cast<GLsizei>(count),
+                                          static_cast<GLint>(mesh.firstVertex));
+    }
+
+    // Draw() on the same VAO must not pick up the instance arrays
+    for (unsigned int column = 0; column < 4; column++)
+        glDisableVertexAttribArray(INSTANCE_MATRIX_LOCATION + column);
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// instance renderer
+// ---------------------------------------------------------------------------------------------
+uint32_t InstanceRenderer::addModel(const GpuModel& model, const char* name)
+{
+    uint32_t id = static_cast<uint32_t>(models.size());
+    models.insert(models.end(), MODEL_LOD_LEVELS, &model);
+    names.insert(names.end(), MODEL_LOD_LEVELS, name);
+    return id;
+}
+
+void InstanceRenderer::draw(ShaderProgram& shader, const InstanceBatcher& batcher)
+{
+    lastFrame = DrawStats();
+    const std::vector<glm::mat4>& matrices = batcher.matrices();
+    if (matrices.empty())
+        return;
+
+    if (!instanceVBO)
+        glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    std::size_t bytes = matrices.size() * sizeof(glm::mat4);
+    if (bytes > capacity)
+        capacity = std::max(bytes, capacity * 2);
+    // orphan last frame's storage so the driver never waits for draws still reading it
+    glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, matrices.data());
+    lastFrame.uploads = 1;
+    lastFrame.bytes = bytes;
+
+    for (const InstanceBatch& batch : batcher.batches())
+    {
+        if (batch.model >= models.size() || !models[batch.model]->ready())
+            continue;
+        const GpuModel& model = *models[batch.model];
+        uint32_t lod = batch.model % MODEL_LOD_LEVELS;
+        PROFILE_SCOPE(names[batch.model]);
+        GpuScope gpuScope(gpuTimers, names[batch.model]);
+
+        // one big object: its meshes are worth culling one by one
+        const uint8_t* visible = nullptr;
+        if (meshFrustum && batch.instanceCount == 1)
+        {
+            const glm::mat4& matrix = matrices[batch.firstInstance];
+            meshVisible.resize(model.meshes.size());
+            for (std::size_t m = 0; m < model.meshes.size(); m++)
+            {
+                glm::vec3 worldMin, worldMax;
+                transformBounds(matrix, model.meshes[m].boundsMin, model.meshes[m].boundsMax, worldMin, worldMax);
+                meshVisible[m] = boxInFrustum(*meshFrustum, worldMin, worldMax) ? 1 : 0;
+            }
+            visible = meshVisible.data();
+        }
+
+        model.DrawInstanced(shader, instanceVBO, batch.firstInstance, batch.instanceCount, lod, visible);
+        for (std::size_t m = 0; m < model.meshes.size(); m++)
+        {
+            const ModelLodRange& range = model.meshes[m].lods[lod];
+            if (range.indexCount == 0 || (visible && !visible[m]))
+                continue;
+            lastFrame.drawCalls++;
+            lastFrame.triangles += uint64_t(range.indexCount / 3) * batch.instanceCount;
+        }
+        lastFrame.instances += batch.instanceCount;
+    }
+}
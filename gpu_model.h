@@ -0,0 +1,122 @@
+#ifndef GPU_MODEL_H
+#define GPU_MODEL_H
+
+#include "model_cache.h"
+#include "texture_codec.h"
+#include "instance_batcher.h"
+#include "gpu_timers.h"
+#include "culling.h"
+
+#include "shader_manager.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// an image file decoded on the CPU (any thread), waiting to be uploaded. when a baked .dds is
+// next to the file the compressed mip chain is loaded instead of decoding the source.
+struct DecodedImage
+{
+    std::string path;
+    std::unique_ptr<unsigned char, void (*)(void*)> pixels{ nullptr, nullptr };
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    CompressedTexture compressed;
+
+    bool isCompressed() const { return !compressed.blocks.empty(); }
+    bool valid() const { return pixels || isCompressed(); }
+};
+
+DecodedImage decodeImage(const std::string& path);
+
+// uploads every level of the image to target (GL_TEXTURE_2D or a cubemap face) and returns how many
+// there are. compressed images are uploaded as BC1 when the driver lists it and decompressed on the
+// CPU otherwise; uncompressed ones get a CPU built mip chain when buildMips is set, a single level if not.
+int uploadImageLevels(unsigned int target, const DecodedImage& image, bool buildMips);
+
+// every texture file the model's materials reference, resolved against its directory
+std::vector<std::string> modelTextureFiles(const ModelData& data);
+
+// first of the four attribute locations the per-instance model matrix occupies (1.model_loading_instanced.vs)
+const unsigned int INSTANCE_MATRIX_LOCATION = 7;
+
+// GL side of a ModelData: one VAO over a shared vertex/index buffer, drawn mesh by mesh with the
+// same texture_diffuseN / texture_specularN ... sampler naming as learnopengl's Mesh::Draw
+class GpuModel
+{
+public:
+    struct Texture
+    {
+        unsigned int id;
+        uint32_t type;
+    };
+    struct DrawRange
+    {
+        uint32_t firstVertex;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        ModelLodRange lods[MODEL_LOD_LEVELS]; // lods[0] is firstIndex/indexCount
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        std::vector<Texture> textures;
+    };
+
+    unsigned int VAO = 0;
+    std::vector<DrawRange> meshes;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    float lodError[MODEL_LOD_LEVELS] = {};
+
+    // like learnopengl's Model the GL objects live until the context goes away; call release() to free them earlier
+    GpuModel() {}
+    GpuModel(const GpuModel&) = delete;
+    GpuModel& operator=(const GpuModel&) = delete;
+
+    // uploads straight from data's arrays (the cache mapping when it came from disk). textures found
+    // in images were decoded ahead of time, anything else is decoded here.
+    void upload(const ModelData& data, const std::vector<DecodedImage>* images = nullptr);
+    void release();
+    bool ready() const { return VAO != 0; }
+
+    void Draw(ShaderProgram& shader) const;
+    // every mesh once with count instances; their matrices are instanceBuffer[firstInstance, firstInstance + count).
+    // lod picks the index list, meshVisible (one flag per mesh) skips meshes when given
+    void DrawInstanced(ShaderProgram& shader, unsigned int instanceBuffer, uint32_t firstInstance, uint32_t count, uint32_t lod = 0,
+                       const uint8_t* meshVisible = nullptr) const;
+
+private:
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    std::vector<std::pair<std::string, unsigned int>> loadedTextures;
+
+    unsigned int loadTexture(const std::string& file, const std::vector<DecodedImage>* images);
+    void bindTextures(ShaderProgram& shader, const DrawRange& mesh) const;
+};
+
+// draws an InstanceBatcher's batches: all matrices go into one streamed buffer per frame, then each
+// model is drawn once per mesh for all of its instances
+class InstanceRenderer
+{
+public:
+    // the id to submit this model's instances under at full detail; id + level draws them at that level
+    // of detail, so MODEL_LOD_LEVELS ids are taken per model. name labels its draws in the profiler
+    uint32_t addModel(const GpuModel& model, const char* name = "model");
+    void draw(ShaderProgram& shader, const InstanceBatcher& batcher);
+
+    // what the last draw() submitted
+    DrawStats lastFrame;
+    // when set, every model's draws are also timed on the GPU
+    GpuTimers* gpuTimers = nullptr;
+    // when set, a model drawn only once (the carrier) skips the meshes outside it
+    const Frustum* meshFrustum = nullptr;
+
+private:
+    std::vector<const GpuModel*> models;
+    std::vector<const char*> names;
+    std::vector<uint8_t> meshVisible;
+    unsigned int instanceVBO = 0;
+    std::size_t capacity = 0;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include "gpu_timers.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+
+void GpuTimers::begin(const char* name)
+{
+    Frame& frame = frames[current];
+    timing = frame.used < GPU_TIMER_SCOPES;
+    if (!timing)
+        return;
+    if (frame.used == frame.created)
+    {
+        glGenQueries(1, &frame.queries[frame.created].begin);
+        glGenQueries(1, &frame.queries[frame.created].end);
+        frame.created++;
+    }
+    Query& query = frame.queries[frame.used];
+    query.name = name;
+    query.cpuStartNs = profiler().nowNs();
+    glQueryCounter(query.begin, GL_TIMESTAMP);
+}
+
+void GpuTimers::end()
+{
+    if (!timing)
+        return;
+    Frame& frame = frames[current];
+    glQueryCounter(frame.queries[frame.used].end, GL_TIMESTAMP);
+    frame.used++;
+}
+
+void GpuTimers::endFrame()
+{
+    frames[current].frame = profiler().frame();
+    current = (current + 1) % GPU_TIMER_FRAMES;
+    // the slot about to be reused was filled GPU_TIMER_FRAMES frames ago
+    collect(frames[current]);
+}
+
+void GpuTimers::collect(Frame& frame)
+{
+    for (std::size_t i = 0; i < frame.used; i++)
+    {
+        Query& query = frame.queries[i];
+        GLint available = 0;
+        glGetQueryObjectiv(query.end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue; // the GPU is more than GPU_TIMER_FRAMES behind; drop the sample rather than stall
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(query.begin, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &end);
+        // placed at the CPU time the work was issued; the GPU clock has its own epoch
+        profiler().record(query.name, query.cpuStartNs, end - begin, PROFILE_GPU_TRACK, frame.frame);
+    }
+    frame.used = 0;
+}
+
+void GpuTimers::release()
+{
+    for (Frame& frame : frames)
+    {
+        for (std::size_t i = 0; i < frame.created; i++)
+        {
+            glDeleteQueries(1, &frame.queries[i].begin);
+            glDeleteQueries(1, &frame.queries[i].end);
+        }
+        frame.created = 0;
+        frame.used = 0;
+    }
+}
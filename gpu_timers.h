@@ -0,0 +1,67 @@
+#ifndef GPU_TIMERS_H
+#define GPU_TIMERS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// GL_TIMESTAMP query pairs around GPU work. results are read back GPU_TIMER_FRAMES frames later,
+// when they are long finished, and handed to profiler() on its GPU track. needs a current context.
+class GpuTimers
+{
+public:
+    static const int GPU_TIMER_FRAMES = 4;
+    // query pairs per frame; scopes beyond these go untimed
+    static const int GPU_TIMER_SCOPES = 32;
+
+    // not nested: one begin/end pair at a time
+    void begin(const char* name);
+    void end();
+    // call once per frame after the last end(), before the profiler's endFrame()
+    void endFrame();
+    void release();
+
+private:
+    struct Query
+    {
+        const char* name;
+        unsigned int begin;
+        unsigned int end;
+        uint64_t cpuStartNs;
+    };
+    struct Frame
+    {
+        Query queries[GPU_TIMER_SCOPES];
+        std::size_t created = 0; // queries with GL objects
+        std::size_t used = 0;
+        uint32_t frame = 0;
+    };
+
+    Frame frames[GPU_TIMER_FRAMES];
+    int current = 0;
+    bool timing = false; // the open begin() got a query
+
+    void collect(Frame& frame);
+};
+
+// times the GPU work issued in its lifetime; a null timers pointer makes it a no-op
+class GpuScope
+{
+public:
+    GpuScope(GpuTimers* timers, const char* name) : timers(timers)
+    {
+        if (timers)
+            timers->begin(name);
+    }
+    ~GpuScope()
+    {
+        if (timers)
+            timers->end();
+    }
+    GpuScope(const GpuScope&) = delete;
+    GpuScope& operator=(const GpuScope&) = delete;
+
+private:
+    GpuTimers* timers;
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "headless.h"
+#include "simulation.h"
+#include "input_recording.h"
+#include "mesh_bvh.h"
+#include "model_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+
+// small deterministic generator so every headless run flies the same sequence of passes
+static float nextRandom(uint32_t& seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+// puts the plane on a straight pass towards the ship with the release point jittered around
+// the ballistic solution, so roughly half of the drops land on the deck
+static void setupBombingRun(SimState& state, uint32_t& seed)
+{
+    state = SimState();
+    float altitude = 150.0f + 450.0f * nextRandom(seed);
+    state.plane.speed = state.flight.minSpeed + (state.flight.maxSpeed - state.flight.minSpeed) * nextRandom(seed);
+    state.flight.avgSpeed = state.plane.speed;
+
+    float deckHeight = state.shipPosition.y + state.shipBoxHalfSize.y;
+    float fallTime = std::sqrt(2.0f * (altitude - deckHeight) / -state.gravity);
+    float releaseDistance = state.plane.speed * fallTime + (nextRandom(seed) - 0.5f) * 300.0f;
+    state.plane.position = glm::vec3(state.shipPosition.x + (nextRandom(seed) - 0.5f) * 40.0f, altitude,
+                                    state.shipPosition.z + releaseDistance);
+
+    // zero-length step so the attached bomb is carried to the hardpoint before release
+    stepSimulation(state, SimInput(), 0.0f);
+}
+
+int runHeadless(long long ticks, float dt)
+{
+    SimState state;
+    SimInput input;
+    uint32_t seed = 12345u;
+    float shipBottom = 0.0f;
+    float runTime = 0.0f;
+    long long runs = 0;
+    long long hits = 0;
+    bool newRun = true;
+
+    auto start = std::chrono::steady_clock::now();
+    for (long long tick = 0; tick < ticks; ++tick)
+    {
+        if (newRun) {
+            setupBombingRun(state, seed);
+            shipBottom = state.shipPosition.y - state.shipBoxHalfSize.y;
+            runTime = 0.0f;
+            newRun = false;
+        }
+
+        // release on the first tick of the pass, then just hold course
+        input.dropBomb = state.bombAttached;
+        if (stepSimulation(state, input, dt))
+            hits++;
+        runTime += dt;
+
+        if (state.bombHit || state.bombPosition.y < shipBottom || runTime > 60.0f) {
+            runs++;
+            newRun = true;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << "headless: " << ticks << " ticks at dt " << dt << "s in " << seconds << "s" << std::endl;
+    std::cout << "headless: " << (seconds > 0.0 ? ticks / seconds : 0.0) << " ticks/sec, "
+              << (seconds > 0.0 ? runs / seconds : 0.0) << " bombing runs/sec" << std::endl;
+    std::cout << "headless: " << runs << " runs completed, " << hits << " hits" << std::endl;
+    return 0;
+}
+
+// autopilot for recordings: fly out to a point 1.5 km behind the carrier, turn in, hold 400 m and
+// release at the ballistic distance (jittered), reload once the bomb is done, repeat
+struct Autopilot
+{
+    uint32_t seed = 2024u;
+    float releaseJitter = 0.0f;
+    bool inbound = true;
+};
+
+static SimInput autopilot(const SimState& state, Autopilot& pilot)
+{
+    SimInput input;
+    glm::vec3 outbound = state.shipPosition + glm::vec3(0.0f, 0.0f, 1500.0f);
+    if (!pilot.inbound && glm::length(glm::vec2(outbound.x - state.plane.position.x, outbound.z - state.plane.position.z)) < 150.0f)
+        pilot.inbound = true;
+    glm::vec3 toTarget = (pilot.inbound ? state.shipPosition : outbound) - state.plane.position;
+    float distance = std::sqrt(toTarget.x * toTarget.x + toTarget.z * toTarget.z);
+
+    // heading: yaw 0 flies towards -z, turning left increases yaw
+    float desiredYaw = glm::degrees(std::atan2(-toTarget.x, -toTarget.z));
+    float error = std::remainder(desiredYaw - flightHeading(state.plane.orientation), 360.0f);
+    input.turnLeft = error > 0.5f;
+    input.turnRight = error < -0.5f;
+
+    // altitude: positive pitch dives
+    float desiredPitch = glm::clamp((state.plane.position.y - 400.0f) * 0.1f, -10.0f, 10.0f);
+    float pitch = flightPitch(state.plane.orientation);
+    input.pitchUp = pitch < desiredPitch - 1.0f;
+    input.pitchDown = pitch > desiredPitch + 1.0f;
+
+    float deckHeight = state.shipPosition.y + state.shipBoxHalfSize.y;
+    float fallTime = std::sqrt(2.0f * std::max(state.plane.position.y - deckHeight, 0.0f) / -state.gravity);
+    input.dropBomb = pilot.inbound && state.bombAttached && std::fabs(error) < 1.0f &&
+                     distance < state.plane.speed * fallTime + pilot.releaseJitter;
+
+    float shipBottom = state.shipPosition.y - state.shipBoxHalfSize.y;
+    if (state.bombReleased && (state.bombHit || state.bombPosition.y < shipBottom))
+    {
+        input.reloadBomb = true;
+        pilot.inbound = false;
+        pilot.releaseJitter = (nextRandom(pilot.seed) - 0.5f) * 200.0f;
+    }
+    return input;
+}
+
+int recordAutopilot(const std::string& path, long long ticks, float dt)
+{
+    SimState state;
+    InputRecording recording;
+    recording.dt = dt;
+    Autopilot pilot;
+    for (long long tick = 0; tick < ticks; ++tick)
+    {
+        SimInput input = autopilot(state, pilot);
+        InputTick recorded;
+        recorded.keys = packSimInput(input);
+        recording.ticks.push_back(recorded);
+        stepSimulation(state, input, dt);
+    }
+    if (!recording.save(path))
+    {
+        std::cout << "Failed to write recording: " << path << std::endl;
+        return -1;
+    }
+    std::cout << "record: " << ticks << " ticks at dt " << dt << "s, " << state.hitCount << " hits -> " << path << std::endl;
+    return 0;
+}
+
+int runReplay(const std::string& path, const std::string& shipModelPath, const std::string& expectedHash)
+{
+    InputRecording recording;
+    if (!recording.load(path))
+    {
+        std::cout << "Failed to read recording: " << path << std::endl;
+        return -1;
+    }
+
+    SimState state;
+    MeshBvh shipBvh;
+    MeshCollider shipCollider;
+    if (recording.shipMesh)
+    {
+        ModelData data;
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+        if (loadModelData(shipModelPath, data))
+            data.collectTriangles(positions, indices);
+        shipBvh.build(positions, indices);
+        if (shipBvh.empty())
+        {
+            std::cout << "replay: the recording tested hits against the carrier mesh but " << shipModelPath << " did not load" << std::endl;
+            return -1;
+        }
+        shipCollider.place(shipBvh, shipColliderMatrix(state), state.shipScale);
+        state.shipMesh = &shipCollider;
+    }
+
+    float yawOffset = 0.0f, pitchOffset = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (const InputTick& tick : recording.ticks)
+    {
+        applyMouseLook(yawOffset, pitchOffset, tick.mouseX, tick.mouseY);
+        stepSimulation(state, unpackSimInput(tick.keys), recording.dt);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    char hash[32];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(hashSimState(state, yawOffset, pitchOffset)));
+    std::cout << "replay: " << recording.ticks.size() << " ticks at dt " << recording.dt << "s in " << seconds << "s ("
+              << (seconds > 0.0 ? recording.ticks.size() / seconds : 0.0) << " ticks/sec), " << state.hitCount << " hits" << std::endl;
+    std::cout << "replay: final state " << hash << std::endl;
+    if (!expectedHash.empty() && expectedHash != hash)
+    {
+        std::cout << "replay: MISMATCH, expected " << expectedHash << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <string>
+
+// runs scripted bombing runs through stepSimulation at a fixed timestep without a GL context
+// and prints the achieved sim throughput. returns the process exit code.
+int runHeadless(long long ticks, float dt);
+
+// flies the default start with a simple autopilot (repeated passes over the carrier, drops and
+// reloads) for ticks fixed steps and saves the input as a recording: the standard replay workload
+int recordAutopilot(const std::string& path, long long ticks, float dt);
+
+// replays a recording without a window and prints the final state hash and ticks/sec. the carrier
+// collider is built from shipModelPath when the recording was made with one. with expectedHash
+// set, a different final state is an error (exit code 1).
+int runReplay(const std::string& path, const std::string& shipModelPath, const std::string& expectedHash);
+
+#endif
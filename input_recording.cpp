@@ -0,0 +1,178 @@
+#include "input_recording.h"
+
+#include <cstring>
+#include <fstream>
+
+static const char INPUT_RECORDING_MAGIC[4] = { 'D', 'B', 'I', 'R' };
+static const uint32_t INPUT_RECORDING_VERSION = 1;
+static const uint32_t RECORDING_SHIP_MESH = 1;
+// set in a tick's stored key word when mouse/scroll deltas follow it
+static const uint16_t TICK_HAS_DELTAS = 0x8000;
+
+uint16_t packSimInput(const SimInput& input)
+{
+    uint16_t keys = 0;
+    if (input.pitchDown) keys |= INPUT_PITCH_DOWN;
+    if (input.pitchUp) keys |= INPUT_PITCH_UP;
+    if (input.turnLeft) keys |= INPUT_TURN_LEFT;
+    if (input.turnRight) keys |= INPUT_TURN_RIGHT;
+    if (input.speedUp) keys |= INPUT_SPEED_UP;
+    if (input.slowDown) keys |= INPUT_SLOW_DOWN;
+    if (input.dropBomb) keys |= INPUT_DROP_BOMB;
+    if (input.reloadBomb) keys |= INPUT_RELOAD_BOMB;
+    return keys;
+}
+
+SimInput unpackSimInput(uint16_t keys)
+{
+    SimInput input;
+    input.pitchDown = (keys & INPUT_PITCH_DOWN) != 0;
+    input.pitchUp = (keys & INPUT_PITCH_UP) != 0;
+    input.turnLeft = (keys & INPUT_TURN_LEFT) != 0;
+    input.turnRight = (keys & INPUT_TURN_RIGHT) != 0;
+    input.speedUp = (keys & INPUT_SPEED_UP) != 0;
+    input.slowDown = (keys & INPUT_SLOW_DOWN) != 0;
+    input.dropBomb = (keys & INPUT_DROP_BOMB) != 0;
+    input.reloadBomb = (keys & INPUT_RELOAD_BOMB) != 0;
+    return input;
+}
+
+// file: magic, version, dt, flags, tick count, then per tick a 16 bit key word, followed by three
+// floats only when the mouse or wheel moved. a held key costs two bytes per tick.
+bool InputRecording::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    uint32_t flags = shipMesh ? RECORDING_SHIP_MESH : 0;
+    uint64_t count = ticks.size();
+    out.write(INPUT_RECORDING_MAGIC, 4);
+    out.write(reinterpret_cast<const char*>(&INPUT_RECORDING_VERSION), sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(&dt), sizeof(float));
+    out.write(reinterpret_cast<const char*>(&flags), sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(uint64_t));
+    for (const InputTick& tick : ticks)
+    {
+        bool deltas = tick.mouseX != 0.0f || tick.mouseY != 0.0f || tick.scroll != 0.0f;
+        uint16_t keys = static_cast<uint16_t>(tick.keys | (deltas ? TICK_HAS_DELTAS : 0));
+        out.write(reinterpret_cast<const char*>(&keys), sizeof(keys));
+        if (deltas)
+        {
+            float values[3] = { tick.mouseX, tick.mouseY, tick.scroll };
+            out.write(reinterpret_cast<const char*>(values), sizeof(values));
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+bool InputRecording::load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    char magic[4];
+    uint32_t version = 0, flags = 0;
+    uint64_t count = 0;
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(&version), sizeof(uint32_t));
+    in.read(reinterpret_cast<char*>(&dt), sizeof(float));
+    in.read(reinterpret_cast<char*>(&flags), sizeof(uint32_t));
+    in.read(reinterpret_cast<char*>(&count), sizeof(uint64_t));
+    if (!in || std::memcmp(magic, INPUT_RECORDING_MAGIC, 4) != 0 || version != INPUT_RECORDING_VERSION || !(dt > 0.0f))
+        return false;
+    shipMesh = (flags & RECORDING_SHIP_MESH) != 0;
+
+    ticks.clear();
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint16_t keys = 0;
+        in.read(reinterpret_cast<char*>(&keys), sizeof(keys));
+        InputTick tick;
+        tick.keys = static_cast<uint16_t>(keys & ~TICK_HAS_DELTAS);
+        if (keys & TICK_HAS_DELTAS)
+        {
+            float values[3];
+            in.read(reinterpret_cast<char*>(values), sizeof(values));
+            tick.mouseX = values[0];
+            tick.mouseY = values[1];
+            tick.scroll = values[2];
+        }
+        if (!in)
+            return false;
+        ticks.push_back(tick);
+    }
+    return true;
+}
+
+void applyMouseLook(float& yawOffset, float& pitchOffset, float mouseX, float mouseY)
+{
+    float sensitivity = 0.05f;
+    yawOffset += mouseX * sensitivity;
+    pitchOffset += mouseY * sensitivity;
+
+    if (pitchOffset > 89.0f)
+        pitchOffset = 89.0f;
+    if (pitchOffset < -89.0f)
+        pitchOffset = -89.0f;
+}
+
+struct StateHash
+{
+    uint64_t value = 1469598103934665603ull;
+
+    void bytes(const void* data, std::size_t size)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; i++)
+        {
+            value ^= p[i];
+            value *= 1099511628211ull;
+        }
+    }
+    void add(float v) { bytes(&v, sizeof(v)); }
+    void add(int v) { bytes(&v, sizeof(v)); }
+    void add(bool v) { unsigned char b = v ? 1 : 0; bytes(&b, 1); }
+    void add(glm::vec3 v) { add(v.x); add(v.y); add(v.z); }
+};
+
+uint64_t hashSimState(const SimState& state, float cameraYawOffset, float cameraPitchOffset)
+{
+    StateHash hash;
+    hash.add(state.plane.position);
+    hash.add(state.plane.orientation.w);
+    hash.add(state.plane.orientation.x);
+    hash.add(state.plane.orientation.y);
+    hash.add(state.plane.orientation.z);
+    hash.add(state.plane.roll);
+    hash.add(state.plane.speed);
+    hash.add(state.flight.accelerate);
+    hash.add(state.flight.maxSpeed);
+    hash.add(state.flight.avgSpeed);
+    hash.add(state.flight.minSpeed);
+    hash.add(state.flight.yawRate);
+    hash.add(state.flight.pitchRate);
+    hash.add(state.flight.rollRate);
+    hash.add(state.flight.maxRoll);
+    hash.add(state.flight.maxSubstep);
+    hash.add(state.bombOffsetLocal);
+    hash.add(state.bombPosition);
+    hash.add(state.bombVelocity);
+    hash.add(state.bombAttached);
+    hash.add(state.bombReleased);
+    hash.add(state.gravity);
+    hash.add(state.hitCount);
+    hash.add(state.bombHit);
+    hash.add(state.bombHitRadius);
+    hash.add(state.showExplosion);
+    hash.add(state.explosionPosition);
+    hash.add(state.explosionTimer);
+    hash.add(state.originTileX);
+    hash.add(state.originTileZ);
+    hash.add(state.rebaseDistance);
+    hash.add(state.shipBoxHalfSize);
+    hash.add(state.shipPosition);
+    hash.add(state.shipScale);
+    hash.add(cameraYawOffset);
+    hash.add(cameraPitchOffset);
+    return hash.value;
+}
@@ -0,0 +1,55 @@
+#ifndef INPUT_RECORDING_H
+#define INPUT_RECORDING_H
+
+#include "simulation.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// per-tick input at a fixed timestep, saved to a small binary file and fed back through the same
+// stepSimulation so a replay reproduces the run bit for bit (same build, same dt)
+
+enum InputBits
+{
+    INPUT_PITCH_DOWN = 1 << 0,
+    INPUT_PITCH_UP = 1 << 1,
+    INPUT_TURN_LEFT = 1 << 2,
+    INPUT_TURN_RIGHT = 1 << 3,
+    INPUT_SPEED_UP = 1 << 4,
+    INPUT_SLOW_DOWN = 1 << 5,
+    INPUT_DROP_BOMB = 1 << 6,
+    INPUT_RELOAD_BOMB = 1 << 7,
+    INPUT_THIRD_PERSON = 1 << 8 // camera choice, not a key: 1 and 2 switch it
+};
+
+struct InputTick
+{
+    uint16_t keys = 0;
+    // raw cursor and wheel movement since the previous tick, before sensitivity is applied
+    float mouseX = 0.0f;
+    float mouseY = 0.0f;
+    float scroll = 0.0f;
+};
+
+uint16_t packSimInput(const SimInput& input);
+SimInput unpackSimInput(uint16_t keys);
+
+struct InputRecording
+{
+    float dt = 1.0f / 60.0f;
+    // whether hits were tested against the carrier mesh; a replay needs the same collider to match
+    bool shipMesh = false;
+    std::vector<InputTick> ticks;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
+
+// mouse look as mouse_callback applies it: sensitivity, then pitch clamped to +-89 degrees
+void applyMouseLook(float& yawOffset, float& pitchOffset, float mouseX, float mouseY);
+
+// FNV-1a over every simulated value (not the collider pointer) and the camera look angles
+uint64_t hashSimState(const SimState& state, float cameraYawOffset, float cameraPitchOffset);
+
+#endif
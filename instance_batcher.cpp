@@ -0,0 +1,72 @@
+#include "instance_batcher.h"
+
+void InstanceBatcher::reserve(std::size_t instances, uint32_t modelIds)
+{
+    models.reserve(instances);
+    submitted.reserve(instances);
+    sorted.reserve(instances);
+    counts.reserve(modelIds);
+    batchList.reserve(modelIds);
+}
+
+void InstanceBatcher::clear()
+{
+    models.clear();
+    submitted.clear();
+}
+
+void InstanceBatcher::add(uint32_t model, const glm::mat4& matrix)
+{
+    models.push_back(model);
+    submitted.push_back(matrix);
+}
+
+void InstanceBatcher::build()
+{
+    // a handful of models and possibly thousands of instances: count, prefix sum, scatter
+    counts.assign(counts.size(), 0);
+    for (uint32_t model : models)
+    {
+        if (model >= counts.size())
+            counts.resize(model + 1, 0);
+        counts[model]++;
+    }
+
+    batchList.clear();
+    uint32_t first = 0;
+    for (uint32_t model = 0; model < counts.size(); model++)
+    {
+        if (counts[model] == 0)
+            continue;
+        batchList.push_back({ model, first, counts[model] });
+        uint32_t count = counts[model];
+        counts[model] = first; // becomes the write cursor
+        first += count;
+    }
+
+    sorted.resize(submitted.size());
+    for (std::size_t i = 0; i < submitted.size(); i++)
+        sorted[counts[models[i]]++] = submitted[i];
+}
+
+DrawStats InstanceBatcher::instancedStats(const std::vector<uint32_t>& meshCounts) const
+{
+    DrawStats stats;
+    for (const InstanceBatch& batch : batchList)
+        stats.drawCalls += batch.model < meshCounts.size() ? meshCounts[batch.model] : 0;
+    stats.instances = models.size();
+    stats.uploads = models.empty() ? 0 : 1;
+    stats.bytes = models.size() * sizeof(glm::mat4);
+    return stats;
+}
+
+DrawStats InstanceBatcher::perObjectStats(const std::vector<uint32_t>& meshCounts) const
+{
+    DrawStats stats;
+    for (uint32_t model : models)
+        stats.drawCalls += model < meshCounts.size() ? meshCounts[model] : 0;
+    stats.instances = models.size();
+    stats.uploads = models.size();
+    stats.bytes = models.size() * sizeof(glm::mat4);
+    return stats;
+}
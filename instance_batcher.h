@@ -0,0 +1,59 @@
+#ifndef INSTANCE_BATCHER_H
+#define INSTANCE_BATCHER_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU side of instanced drawing: objects are submitted one by one with the model they use, build()
+// groups them so every model's matrices are contiguous and each model becomes one instanced draw
+// per mesh. nothing in here needs GL, so batching cost and draw counts can be measured headless.
+
+struct InstanceBatch
+{
+    uint32_t model;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
+// what a frame submits to the driver
+struct DrawStats
+{
+    uint64_t drawCalls = 0;
+    uint64_t instances = 0;
+    uint64_t triangles = 0;
+    uint64_t uploads = 0; // separate transfers of per-object data (uniform sets or buffer writes)
+    uint64_t bytes = 0;
+};
+
+class InstanceBatcher
+{
+public:
+    // room for this many objects over modelIds ids, so frames up to that size never allocate
+    void reserve(std::size_t instances, uint32_t modelIds);
+    void clear();
+    void add(uint32_t model, const glm::mat4& matrix);
+    // counting sort by model id, keeping submission order inside a model
+    void build();
+
+    // valid after build()
+    const std::vector<glm::mat4>& matrices() const { return sorted; }
+    const std::vector<InstanceBatch>& batches() const { return batchList; }
+    std::size_t instanceCount() const { return models.size(); }
+
+    // one draw per mesh per batch and all matrices in one buffer write; meshCounts is indexed by model id
+    DrawStats instancedStats(const std::vector<uint32_t>& meshCounts) const;
+    // the same objects drawn the old way: a draw per mesh per object and a model uniform per object
+    DrawStats perObjectStats(const std::vector<uint32_t>& meshCounts) const;
+
+private:
+    std::vector<uint32_t> models;
+    std::vector<glm::mat4> submitted;
+    std::vector<glm::mat4> sorted;
+    std::vector<uint32_t> counts;
+    std::vector<InstanceBatch> batchList;
+};
+
+#endif
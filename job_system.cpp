@@ -0,0 +1,185 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <chrono>
+
+// index of the worker running on this thread, -1 on threads outside the pool
+static thread_local int currentWorker = -1;
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+    if (workerCount == 0)
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        workerCount = cores > 1 ? cores - 1 : 1;
+    }
+    for (unsigned int i = 0; i < workerCount; i++)
+        queues.push_back(std::unique_ptr<Worker>(new Worker()));
+    for (unsigned int i = 0; i < workerCount; i++)
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void JobSystem::JobRing::pushBack(Job&& job)
+{
+    if (count == slots.size())
+    {
+        std::vector<Job> grown(std::max<std::size_t>(16, slots.size() * 2));
+        for (std::size_t i = 0; i < count; i++)
+            grown[i] = std::move(slots[(head + i) % slots.size()]);
+        slots.swap(grown);
+        head = 0;
+    }
+    slots[(head + count) % slots.size()] = std::move(job);
+    count++;
+}
+
+JobSystem::Job JobSystem::JobRing::popBack()
+{
+    count--;
+    return std::move(slots[(head + count) % slots.size()]);
+}
+
+JobSystem::Job JobSystem::JobRing::popFront()
+{
+    Job job = std::move(slots[head]);
+    head = (head + 1) % slots.size();
+    count--;
+    return job;
+}
+
+void JobSystem::submit(std::function<void()> job, JobCounter* counter)
+{
+    if (counter)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    // a worker keeps the jobs it spawns local, everything else is spread round-robin
+    unsigned int target = currentWorker >= 0 ? static_cast<unsigned int>(currentWorker)
+                                             : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> guard(queues[target]->lock);
+        queues[target]->jobs.pushBack({ std::move(job), counter });
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        queued.fetch_add(1, std::memory_order_release);
+    }
+    wake.notify_one();
+}
+
+bool JobSystem::tryRun(unsigned int preferred)
+{
+    Job job;
+    bool found = false;
+    std::size_t count = queues.size();
+    for (std::size_t n = 0; n < count && !found; n++)
+    {
+        Worker& queue = *queues[(preferred + n) % count];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.jobs.empty())
+            continue;
+        // own queue LIFO for cache warmth, steal FIFO so the victim keeps its freshest work
+        if (n == 0)
+        {
+            job = queue.jobs.popBack();
+        }
+        else
+        {
+            job = queue.jobs.popFront();
+        }
+        found = true;
+    }
+    if (!found)
+        return false;
+
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    job.run();
+    if (job.counter)
+        job.counter->pending.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+    currentWorker = static_cast<int>(index);
+    while (true)
+    {
+        if (tryRun(index))
+            continue;
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wake.wait(guard, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping && queued.load() == 0)
+            return;
+    }
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    unsigned int preferred = currentWorker >= 0 ? static_cast<unsigned int>(currentWorker) : 0;
+    while (!counter.done())
+    {
+        if (!tryRun(preferred))
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::parallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body)
+{
+    // each job captures a reference and its first index: small enough for std::function to keep
+    // in place, so splitting the range does not allocate
+    struct Range
+    {
+        const std::function<void(std::size_t, std::size_t)>& body;
+        std::size_t count;
+        std::size_t grain;
+    };
+    const Range range = { body, count, std::max<std::size_t>(grain, 1) };
+    JobCounter counter;
+    for (std::size_t begin = 0; begin < count; begin += range.grain)
+        submit([&range, begin] { range.body(begin, std::min(range.count, begin + range.grain)); }, &counter);
+    wait(counter);
+}
+
+void MainThreadQueue::push(std::function<void()> task)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    tasks.push_back(std::move(task));
+}
+
+int MainThreadQueue::drain(double budgetMs)
+{
+    auto start = std::chrono::steady_clock::now();
+    int ran = 0;
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (tasks.empty())
+                break;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+        ran++;
+        if (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs)
+            break;
+    }
+    return ran;
+}
+
+bool MainThreadQueue::empty()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return tasks.empty();
+}
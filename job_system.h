@@ -0,0 +1,95 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// counts outstanding jobs so a caller can wait for a group of them
+struct JobCounter
+{
+    std::atomic<int> pending{ 0 };
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// small work-stealing thread pool. every worker owns a deque: it pops its own newest job and,
+// when empty, steals the oldest job from another worker. jobs submitted from outside the pool
+// are spread round-robin.
+class JobSystem
+{
+public:
+    // 0 workers picks hardware_concurrency - 1 (at least one)
+    explicit JobSystem(unsigned int workerCount = 0);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void submit(std::function<void()> job, JobCounter* counter = nullptr);
+    // runs queued jobs on the calling thread until counter reaches zero
+    void wait(JobCounter& counter);
+    // splits [0, count) into chunks of at most grain items and runs body(begin, end) on each, blocking until all finish
+    void parallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body);
+
+    unsigned int workerCount() const { return static_cast<unsigned int>(workers.size()); }
+
+private:
+    struct Job
+    {
+        std::function<void()> run;
+        JobCounter* counter;
+    };
+    // double-ended ring of jobs. unlike a deque, which allocates and frees a block every few jobs
+    // passing through, it only allocates when it has to grow
+    class JobRing
+    {
+    public:
+        bool empty() const { return count == 0; }
+        void pushBack(Job&& job);
+        Job popBack();
+        Job popFront();
+
+    private:
+        std::vector<Job> slots;
+        std::size_t head = 0;
+        std::size_t count = 0;
+    };
+    struct Worker
+    {
+        std::mutex lock;
+        JobRing jobs;
+    };
+
+    std::vector<std::unique_ptr<Worker>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::atomic<int> queued{ 0 };
+    std::atomic<unsigned int> nextQueue{ 0 };
+    std::atomic<bool> stopping{ false };
+
+    bool tryRun(unsigned int preferred);
+    void workerLoop(unsigned int index);
+};
+
+// work that has to run on the thread owning the GL context (buffer and texture uploads).
+// workers push, the render loop drains it once per frame within a time budget.
+class MainThreadQueue
+{
+public:
+    void push(std::function<void()> task);
+    // runs queued tasks until the queue is empty or budgetMs has passed; returns how many ran
+    int drain(double budgetMs);
+    bool empty();
+
+private:
+    std::mutex lock;
+    std::deque<std::function<void()>> tasks;
+};
+
+#endif
@@ -0,0 +1,550 @@
+#include "mesh_bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+// build
+// ---------------------------------------------------------------------------------------------
+static const int SAH_BINS = 16;
+static const uint32_t MAX_LEAF_TRIANGLES = 4;
+// a node this deep stays a leaf whatever it holds. a traversal keeps at most one pending sibling per
+// level plus the two children just pushed, so the queries' fixed stacks can never overflow
+static const uint32_t MAX_DEPTH = 60;
+static const int STACK_SIZE = 64;
+static_assert(MAX_DEPTH + 2 <= STACK_SIZE, "the query stacks must hold the deepest traversal");
+
+struct SahBin
+{
+    glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+    glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+    uint32_t count = 0;
+};
+
+static float surfaceArea(glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    glm::vec3 e = boundsMax - boundsMin;
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+void MeshBvh::build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+{
+    nodes.clear();
+    triangles.clear();
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+        triangles.push_back({ positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]] });
+    if (triangles.empty())
+        return;
+
+    std::vector<glm::vec3> centroids(triangles.size());
+    for (std::size_t i = 0; i < triangles.size(); i++)
+        centroids[i] = (triangles[i].v0 + triangles[i].v1 + triangles[i].v2) * (1.0f / 3.0f);
+
+    nodes.reserve(triangles.size() * 2);
+    BvhNode root;
+    root.leftFirst = 0;
+    root.triangleCount = static_cast<uint32_t>(triangles.size());
+    nodes.push_back(root);
+    updateBounds(nodes[0]);
+    subdivide(0, centroids);
+    nodes.shrink_to_fit();
+}
+
+void MeshBvh::updateBounds(BvhNode& node) const
+{
+    node.boundsMin = glm::vec3(FLT_MAX);
+    node.boundsMax = glm::vec3(-FLT_MAX);
+    for (uint32_t i = 0; i < node.triangleCount; i++)
+    {
+        const BvhTriangle& t = triangles[node.leftFirst + i];
+        node.boundsMin = glm::min(node.boundsMin, glm::min(t.v0, glm::min(t.v1, t.v2)));
+        node.boundsMax = glm::max(node.boundsMax, glm::max(t.v0, glm::max(t.v1, t.v2)));
+    }
+}
+
+void MeshBvh::subdivide(uint32_t rootIndex, std::vector<glm::vec3>& centroids)
+{
+    // node index and depth
+    std::vector<std::pair<uint32_t, uint32_t>> pending(1, std::make_pair(rootIndex, 0u));
+    while (!pending.empty())
+    {
+        uint32_t nodeIndex = pending.back().first;
+        uint32_t depth = pending.back().second;
+        pending.pop_back();
+        BvhNode node = nodes[nodeIndex];
+        if (node.triangleCount <= MAX_LEAF_TRIANGLES || depth >= MAX_DEPTH)
+            continue;
+
+        // centroid bounds decide the binning range
+        glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+        for (uint32_t i = 0; i < node.triangleCount; i++)
+        {
+            centroidMin = glm::min(centroidMin, centroids[node.leftFirst + i]);
+            centroidMax = glm::max(centroidMax, centroids[node.leftFirst + i]);
+        }
+
+        // binned SAH: cost = area(left) * count(left) + area(right) * count(right)
+        int bestAxis = -1;
+        int bestSplit = 0;
+        float bestCost = surfaceArea(node.boundsMin, node.boundsMax) * node.triangleCount;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float extent = centroidMax[axis] - centroidMin[axis];
+            if (extent <= 0.0f)
+                continue;
+            SahBin bins[SAH_BINS];
+            float binScale = SAH_BINS / extent;
+            for (uint32_t i = 0; i < node.triangleCount; i++)
+            {
+                const BvhTriangle& t = triangles[node.leftFirst + i];
+                int b = std::min(SAH_BINS - 1, static_cast<int>((centroids[node.leftFirst + i][axis] - centroidMin[axis]) * binScale));
+                bins[b].count++;
+                bins[b].boundsMin = glm::min(bins[b].boundsMin, glm::min(t.v0, glm::min(t.v1, t.v2)));
+                bins[b].boundsMax = glm::max(bins[b].boundsMax, glm::max(t.v0, glm::max(t.v1, t.v2)));
+            }
+
+            // sweep from both sides so every split plane is costed in O(bins)
+            float leftArea[SAH_BINS - 1], rightArea[SAH_BINS - 1];
+            uint32_t leftCount[SAH_BINS - 1], rightCount[SAH_BINS - 1];
+            glm::vec3 lMin(FLT_MAX), lMax(-FLT_MAX), rMin(FLT_MAX), rMax(-FLT_MAX);
+            uint32_t lSum = 0, rSum = 0;
+            for (int i = 0; i < SAH_BINS - 1; i++)
+            {
+                lSum += bins[i].count;
+                leftCount[i] = lSum;
+                lMin = glm::min(lMin, bins[i].boundsMin);
+                lMax = glm::max(lMax, bins[i].boundsMax);
+                leftArea[i] = lSum ? surfaceArea(lMin, lMax) : 0.0f;
+
+                int j = SAH_BINS - 1 - i;
+                rSum += bins[j].count;
+                rightCount[j - 1] = rSum;
+                rMin = glm::min(rMin, bins[j].boundsMin);
+                rMax = glm::max(rMax, bins[j].boundsMax);
+                rightArea[j - 1] = rSum ? surfaceArea(rMin, rMax) : 0.0f;
+            }
+            for (int i = 0; i < SAH_BINS - 1; i++)
+            {
+                float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+                if (leftCount[i] && rightCount[i] && cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+        if (bestAxis < 0)
+            continue; // no split beats the leaf
+
+        // partition the node's triangles (and their centroids) by the same bin mapping used for costing
+        float extent = centroidMax[bestAxis] - centroidMin[bestAxis];
+        uint32_t i = node.leftFirst;
+        uint32_t j = node.leftFirst + node.triangleCount - 1;
+        while (i <= j)
+        {
+            int b = std::min(SAH_BINS - 1, static_cast<int>((centroids[i][bestAxis] - centroidMin[bestAxis]) * (SAH_BINS / extent)));
+            if (b <= bestSplit)
+                i++;
+            else
+            {
+                std::swap(triangles[i], triangles[j]);
+                std::swap(centroids[i], centroids[j]);
+                if (j == 0)
+                    break;
+                j--;
+            }
+        }
+        uint32_t leftCountTotal = i - node.leftFirst;
+        if (leftCountTotal == 0 || leftCountTotal == node.triangleCount)
+            continue;
+
+        uint32_t leftIndex = static_cast<uint32_t>(nodes.size());
+        BvhNode left, right;
+        left.leftFirst = node.leftFirst;
+        left.triangleCount = leftCountTotal;
+        right.leftFirst = i;
+        right.triangleCount = node.triangleCount - leftCountTotal;
+        updateBounds(left);
+        updateBounds(right);
+        nodes.push_back(left);
+        nodes.push_back(right);
+
+        nodes[nodeIndex].leftFirst = leftIndex;
+        nodes[nodeIndex].triangleCount = 0;
+        pending.push_back(std::make_pair(leftIndex, depth + 1));
+        pending.push_back(std::make_pair(leftIndex + 1, depth + 1));
+    }
+}
+
+// primitive tests
+// ---------------------------------------------------------------------------------------------
+static glm::vec3 closestPointOnTriangle(glm::vec3 p, const BvhTriangle& t)
+{
+    // Ericson, Real-Time Collision Detection 5.1.5
+    glm::vec3 ab = t.v1 - t.v0, ac = t.v2 - t.v0, ap = p - t.v0;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return t.v0;
+
+    glm::vec3 bp = p - t.v1;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) return t.v1;
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return t.v0 + ab * (d1 / (d1 - d3));
+
+    glm::vec3 cp = p - t.v2;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) return t.v2;
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return t.v0 + ac * (d2 / (d2 - d6));
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        return t.v1 + (t.v2 - t.v1) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    float denom = 1.0f / (va + vb + vc);
+    return t.v0 + ab * (vb * denom) + ac * (vc * denom);
+}
+
+static bool sphereTriangle(glm::vec3 center, float r2, const BvhTriangle& t)
+{
+    glm::vec3 d = center - closestPointOnTriangle(center, t);
+    return glm::dot(d, d) < r2;
+}
+
+// Moller-Trumbore, two sided
+static bool rayTriangle(glm::vec3 origin, glm::vec3 direction, const BvhTriangle& t, float& tHit)
+{
+    glm::vec3 e1 = t.v1 - t.v0, e2 = t.v2 - t.v0;
+    glm::vec3 h = glm::cross(direction, e2);
+    float a = glm::dot(e1, h);
+    if (std::fabs(a) < 1e-12f)
+        return false;
+    float f = 1.0f / a;
+    glm::vec3 s = origin - t.v0;
+    float u = f * glm::dot(s, h);
+    if (u < 0.0f || u > 1.0f)
+        return false;
+    glm::vec3 q = glm::cross(s, e1);
+    float v = f * glm::dot(direction, q);
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+    tHit = f * glm::dot(e2, q);
+    return tHit >= 0.0f;
+}
+
+// smallest root of a t^2 + b t + c = 0 in [0, maxT]; a sphere starting outside has c > 0, so the
+// smaller root is where it first touches
+static bool firstRoot(float a, float b, float c, float maxT, float& t)
+{
+    if (a <= 0.0f)
+        return false;
+    float discriminant = b * b - 4.0f * a * c;
+    if (discriminant < 0.0f)
+        return false;
+    t = (-b - std::sqrt(discriminant)) / (2.0f * a);
+    return t >= 0.0f && t <= maxT;
+}
+
+// earliest t in [0, maxT] where a sphere of radius r at origin + direction * t touches the triangle:
+// first against the face, then the edges as cylinders and the corners as spheres
+static bool sweptSphereTriangle(glm::vec3 origin, glm::vec3 direction, float r, const BvhTriangle& t, float maxT, float& tHit)
+{
+    if (sphereTriangle(origin, r * r, t))
+    {
+        tHit = 0.0f;
+        return true;
+    }
+    float closest = maxT;
+    bool hit = false;
+
+    // face: the sphere reaches the plane with its centre over the triangle. a sphere already
+    // within r of the plane can only reach the face across an edge, which the edges catch
+    glm::vec3 normal = glm::cross(t.v1 - t.v0, t.v2 - t.v0);
+    float normalLength = glm::length(normal);
+    if (normalLength > 0.0f)
+    {
+        normal /= normalLength;
+        float distance = glm::dot(normal, origin - t.v0);
+        float speed = glm::dot(normal, direction);
+        // towards the side the sphere comes from
+        float side = distance < 0.0f ? -1.0f : 1.0f;
+        if (distance * side > r && speed * side < 0.0f)
+        {
+            float tPlane = (r - distance * side) / (speed * side);
+            glm::vec3 contact = origin + direction * tPlane - normal * (r * side);
+            bool inside = glm::dot(glm::cross(t.v1 - t.v0, contact - t.v0), normal) >= 0.0f &&
+                          glm::dot(glm::cross(t.v2 - t.v1, contact - t.v1), normal) >= 0.0f &&
+                          glm::dot(glm::cross(t.v0 - t.v2, contact - t.v2), normal) >= 0.0f;
+            // a face contact comes before any edge or corner contact of the same triangle
+            if (inside)
+            {
+                if (tPlane > closest)
+                    return false;
+                tHit = tPlane;
+                return true;
+            }
+        }
+    }
+
+    const glm::vec3 corners[3] = { t.v0, t.v1, t.v2 };
+    for (int i = 0; i < 3; i++)
+    {
+        float tt;
+        // corner
+        glm::vec3 m = origin - corners[i];
+        if (firstRoot(glm::dot(direction, direction), 2.0f * glm::dot(direction, m), glm::dot(m, m) - r * r, closest, tt))
+        {
+            closest = tt;
+            hit = true;
+        }
+        // edge to the next corner, a cylinder cut off at the two corners
+        glm::vec3 edge = corners[(i + 1) % 3] - corners[i];
+        float ee = glm::dot(edge, edge), ed = glm::dot(edge, direction), em = glm::dot(edge, m);
+        float a = ee * glm::dot(direction, direction) - ed * ed;
+        float b = 2.0f * (ee * glm::dot(direction, m) - ed * em);
+        float c = ee * (glm::dot(m, m) - r * r) - em * em;
+        if (firstRoot(a, b, c, closest, tt))
+        {
+            float along = ed * tt + em;
+            if (along >= 0.0f && along <= ee)
+            {
+                closest = tt;
+                hit = true;
+            }
+        }
+    }
+    if (hit)
+        tHit = closest;
+    return hit;
+}
+
+static bool sphereOverlapsBox(glm::vec3 center, float r2, const BvhNode& node)
+{
+    glm::vec3 d = center - glm::clamp(center, node.boundsMin, node.boundsMax);
+    return glm::dot(d, d) < r2;
+}
+
+// entry distance of the ray into the node bounds grown by grow (a swept sphere's radius, 0 for a
+// ray), FLT_MAX on a miss. the grown box has square corners, so for a sphere it only over-accepts
+static float rayBoxEntry(glm::vec3 origin, glm::vec3 invDirection, float maxT, const BvhNode& node, float grow)
+{
+    glm::vec3 t0 = (node.boundsMin - glm::vec3(grow) - origin) * invDirection;
+    glm::vec3 t1 = (node.boundsMax + glm::vec3(grow) - origin) * invDirection;
+    glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxT));
+    return enter <= exit ? enter : FLT_MAX;
+}
+
+// queries. build() caps the depth at MAX_DEPTH, so STACK_SIZE entries always hold the traversal
+// ---------------------------------------------------------------------------------------------
+bool MeshBvh::intersectSphere(glm::vec3 center, float radius) const
+{
+    if (nodes.empty())
+        return false;
+    float r2 = radius * radius;
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const BvhNode& node = nodes[stack[--top]];
+        if (!sphereOverlapsBox(center, r2, node))
+            continue;
+        if (node.triangleCount > 0)
+        {
+            for (uint32_t i = 0; i < node.triangleCount; i++)
+                if (sphereTriangle(center, r2, triangles[node.leftFirst + i]))
+                    return true;
+        }
+        else
+        {
+            stack[top++] = node.leftFirst;
+            stack[top++] = node.leftFirst + 1;
+        }
+    }
+    return false;
+}
+
+bool MeshBvh::intersectRay(glm::vec3 origin, glm::vec3 direction, float maxT, float& tHit) const
+{
+    if (nodes.empty())
+        return false;
+    glm::vec3 invDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    float closest = maxT;
+    bool hit = false;
+
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    if (rayBoxEntry(origin, invDirection, closest, nodes[0], 0.0f) == FLT_MAX)
+        return false;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const BvhNode& node = nodes[stack[--top]];
+        if (node.triangleCount > 0)
+        {
+            for (uint32_t i = 0; i < node.triangleCount; i++)
+            {
+                float t;
+                if (rayTriangle(origin, direction, triangles[node.leftFirst + i], t) && t <= closest)
+                {
+                    closest = t;
+                    hit = true;
+                }
+            }
+            continue;
+        }
+
+        // visit the nearer child first so the far one is usually culled by the shrinking closest hit
+        uint32_t nearChild = node.leftFirst, farChild = node.leftFirst + 1;
+        float nearT = rayBoxEntry(origin, invDirection, closest, nodes[nearChild], 0.0f);
+        float farT = rayBoxEntry(origin, invDirection, closest, nodes[farChild], 0.0f);
+        if (farT < nearT)
+        {
+            std::swap(nearChild, farChild);
+            std::swap(nearT, farT);
+        }
+        if (farT != FLT_MAX)
+            stack[top++] = farChild;
+        if (nearT != FLT_MAX)
+            stack[top++] = nearChild;
+    }
+    if (hit)
+        tHit = closest;
+    return hit;
+}
+
+bool MeshBvh::intersectSweptSphere(glm::vec3 origin, glm::vec3 direction, float radius, float maxT, float& tHit) const
+{
+    if (nodes.empty())
+        return false;
+    glm::vec3 invDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    float closest = maxT;
+    bool hit = false;
+
+    // the ray traversal with every box grown by the radius
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    if (rayBoxEntry(origin, invDirection, closest, nodes[0], radius) == FLT_MAX)
+        return false;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const BvhNode& node = nodes[stack[--top]];
+        if (node.triangleCount > 0)
+        {
+            for (uint32_t i = 0; i < node.triangleCount; i++)
+            {
+                float t;
+                if (sweptSphereTriangle(origin, direction, radius, triangles[node.leftFirst + i], closest, t))
+                {
+                    closest = t;
+                    hit = true;
+                }
+            }
+            continue;
+        }
+
+        uint32_t nearChild = node.leftFirst, farChild = node.leftFirst + 1;
+        float nearT = rayBoxEntry(origin, invDirection, closest, nodes[nearChild], radius);
+        float farT = rayBoxEntry(origin, invDirection, closest, nodes[farChild], radius);
+        if (farT < nearT)
+        {
+            std::swap(nearChild, farChild);
+            std::swap(nearT, farT);
+        }
+        if (farT != FLT_MAX)
+            stack[top++] = farChild;
+        if (nearT != FLT_MAX)
+            stack[top++] = nearChild;
+    }
+    if (hit)
+        tHit = closest;
+    return hit;
+}
+
+bool MeshBvh::intersectSphereBruteForce(glm::vec3 center, float radius) const
+{
+    for (const BvhTriangle& t : triangles)
+        if (sphereTriangle(center, radius * radius, t))
+            return true;
+    return false;
+}
+
+bool MeshBvh::intersectRayBruteForce(glm::vec3 origin, glm::vec3 direction, float maxT, float& tHit) const
+{
+    bool hit = false;
+    float closest = maxT;
+    for (const BvhTriangle& t : triangles)
+    {
+        float tt;
+        if (rayTriangle(origin, direction, t, tt) && tt <= closest)
+        {
+            closest = tt;
+            hit = true;
+        }
+    }
+    if (hit)
+        tHit = closest;
+    return hit;
+}
+
+bool MeshBvh::intersectSweptSphereBruteForce(glm::vec3 origin, glm::vec3 direction, float radius, float maxT, float& tHit) const
+{
+    bool hit = false;
+    float closest = maxT;
+    for (const BvhTriangle& t : triangles)
+    {
+        float tt;
+        if (sweptSphereTriangle(origin, direction, radius, t, closest, tt))
+        {
+            closest = tt;
+            hit = true;
+        }
+    }
+    if (hit)
+        tHit = closest;
+    return hit;
+}
+
+// world placement
+// ---------------------------------------------------------------------------------------------
+void MeshCollider::place(const MeshBvh& mesh, const glm::mat4& modelMatrix, float uniformScale)
+{
+    bvh = &mesh;
+    localToWorld = modelMatrix;
+    worldToLocal = glm::inverse(modelMatrix);
+    scale = uniformScale;
+}
+
+bool MeshCollider::sphereHits(glm::vec3 center, float radius) const
+{
+    glm::vec3 local = glm::vec3(worldToLocal * glm::vec4(center, 1.0f));
+    return bvh && bvh->intersectSphere(local, radius / scale);
+}
+
+bool MeshCollider::segmentHits(glm::vec3 start, glm::vec3 end, float& timeOfImpact) const
+{
+    if (!bvh)
+        return false;
+    // the direction is left unnormalized so t comes back as a fraction of the segment
+    glm::vec3 localStart = glm::vec3(worldToLocal * glm::vec4(start, 1.0f));
+    glm::vec3 localEnd = glm::vec3(worldToLocal * glm::vec4(end, 1.0f));
+    return bvh->intersectRay(localStart, localEnd - localStart, 1.0f, timeOfImpact);
+}
+
+bool MeshCollider::sweptSphereHits(glm::vec3 start, glm::vec3 end, float radius, float& timeOfImpact) const
+{
+    if (!bvh)
+        return false;
+    glm::vec3 localStart = glm::vec3(worldToLocal * glm::vec4(start, 1.0f));
+    glm::vec3 localEnd = glm::vec3(worldToLocal * glm::vec4(end, 1.0f));
+    return bvh->intersectSweptSphere(localStart, localEnd - localStart, radius / scale, 1.0f, timeOfImpact);
+}
@@ -0,0 +1,74 @@
+#ifndef MESH_BVH_H
+#define MESH_BVH_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// 32 byte node so two siblings share a cache line. an interior node has triangleCount == 0 and its
+// children at leftFirst and leftFirst + 1; a leaf owns triangles [leftFirst, leftFirst + triangleCount).
+struct BvhNode
+{
+    glm::vec3 boundsMin;
+    uint32_t leftFirst;
+    glm::vec3 boundsMax;
+    uint32_t triangleCount;
+};
+
+struct BvhTriangle
+{
+    glm::vec3 v0, v1, v2;
+};
+
+// bounding volume hierarchy over the triangles of a mesh, built with binned SAH splits into a
+// flat node array. queries are in the mesh's own (model) space.
+class MeshBvh
+{
+public:
+    // positions/indices as they come out of the loaded Mesh objects (triangle list)
+    void build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+
+    bool intersectSphere(glm::vec3 center, float radius) const;
+    // closest hit along origin + direction * t for t in [0, maxT]
+    bool intersectRay(glm::vec3 origin, glm::vec3 direction, float maxT, float& tHit) const;
+    // first t in [0, maxT] where a sphere moving along origin + direction * t touches a triangle
+    bool intersectSweptSphere(glm::vec3 origin, glm::vec3 direction, float radius, float maxT, float& tHit) const;
+
+    // brute force versions of the queries, used to check the tree
+    bool intersectSphereBruteForce(glm::vec3 center, float radius) const;
+    bool intersectRayBruteForce(glm::vec3 origin, glm::vec3 direction, float maxT, float& tHit) const;
+    bool intersectSweptSphereBruteForce(glm::vec3 origin, glm::vec3 direction, float radius, float maxT, float& tHit) const;
+
+    bool empty() const { return nodes.empty(); }
+    std::size_t nodeCount() const { return nodes.size(); }
+    std::size_t triangleCount() const { return triangles.size(); }
+    glm::vec3 boundsMin() const { return nodes.empty() ? glm::vec3(0.0f) : nodes[0].boundsMin; }
+    glm::vec3 boundsMax() const { return nodes.empty() ? glm::vec3(0.0f) : nodes[0].boundsMax; }
+
+private:
+    std::vector<BvhNode> nodes;
+    std::vector<BvhTriangle> triangles;
+
+    void subdivide(uint32_t nodeIndex, std::vector<glm::vec3>& centroids);
+    void updateBounds(BvhNode& node) const;
+};
+
+// a MeshBvh placed in the world with a model matrix (rotation, uniform scale, translation)
+struct MeshCollider
+{
+    const MeshBvh* bvh = nullptr;
+    glm::mat4 localToWorld = glm::mat4(1.0f);
+    glm::mat4 worldToLocal = glm::mat4(1.0f);
+    float scale = 1.0f;
+
+    void place(const MeshBvh& mesh, const glm::mat4& modelMatrix, float uniformScale);
+
+    bool sphereHits(glm::vec3 center, float radius) const;
+    // first hit of the segment start -> end, returned as a fraction of the segment
+    bool segmentHits(glm::vec3 start, glm::vec3 end, float& timeOfImpact) const;
+    // first touch of a sphere moving from start to end, as a fraction of the segment
+    bool sweptSphereHits(glm::vec3 start, glm::vec3 end, float radius, float& timeOfImpact) const;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "mesh_lod.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+static glm::vec3 positionAt(const float* positions, std::size_t strideBytes, uint32_t index)
+{
+    const float* p = reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(positions) + std::size_t(index) * strideBytes);
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+// 21 bits per axis, centred so negative cells pack too
+static uint64_t cellKey(glm::vec3 position, glm::vec3 origin, float cellSize)
+{
+    glm::vec3 cell = (position - origin) / cellSize;
+    uint64_t x = static_cast<uint64_t>(static_cast<int64_t>(std::floor(cell.x)) + (1 << 20)) & 0x1fffff;
+    uint64_t y = static_cast<uint64_t>(static_cast<int64_t>(std::floor(cell.y)) + (1 << 20)) & 0x1fffff;
+    uint64_t z = static_cast<uint64_t>(static_cast<int64_t>(std::floor(cell.z)) + (1 << 20)) & 0x1fffff;
+    return x | (y << 21) | (z << 42);
+}
+
+float clusterSimplify(const float* positions, std::size_t strideBytes, uint32_t vertexCount, const uint32_t* indices,
+                      uint32_t indexCount, glm::vec3 gridOrigin, float cellSize, std::vector<uint32_t>& simplified)
+{
+    simplified.clear();
+    if (vertexCount == 0 || !(cellSize > 0.0f))
+        return 0.0f;
+
+    // which cell every vertex falls in, and the average position of each cell
+    std::unordered_map<uint64_t, uint32_t> cells;
+    cells.reserve(vertexCount);
+    std::vector<uint32_t> cellOf(vertexCount);
+    std::vector<glm::vec3> averages;
+    std::vector<uint32_t> counts;
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        glm::vec3 position = positionAt(positions, strideBytes, v);
+        auto inserted = cells.emplace(cellKey(position, gridOrigin, cellSize), static_cast<uint32_t>(averages.size()));
+        if (inserted.second)
+        {
+            averages.push_back(glm::vec3(0.0f));
+            counts.push_back(0);
+        }
+        uint32_t cell = inserted.first->second;
+        cellOf[v] = cell;
+        averages[cell] += position;
+        counts[cell]++;
+    }
+    for (std::size_t cell = 0; cell < averages.size(); cell++)
+        averages[cell] /= static_cast<float>(counts[cell]);
+
+    // representative: the cell's vertex nearest its average
+    std::vector<uint32_t> representative(averages.size(), 0);
+    std::vector<float> nearest(averages.size(), FLT_MAX);
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        glm::vec3 offset = positionAt(positions, strideBytes, v) - averages[cellOf[v]];
+        float distance = glm::dot(offset, offset);
+        if (distance < nearest[cellOf[v]])
+        {
+            nearest[cellOf[v]] = distance;
+            representative[cellOf[v]] = v;
+        }
+    }
+
+    float error = 0.0f;
+    for (uint32_t v = 0; v < vertexCount; v++)
+        error = std::max(error, glm::length(positionAt(positions, strideBytes, v) - positionAt(positions, strideBytes, representative[cellOf[v]])));
+
+    for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+            continue;
+        uint32_t a = representative[cellOf[indices[i]]];
+        uint32_t b = representative[cellOf[indices[i + 1]]];
+        uint32_t c = representative[cellOf[indices[i + 2]]];
+        if (a == b || b == c || a == c)
+            continue;
+        simplified.insert(simplified.end(), { a, b, c });
+    }
+    return error;
+}
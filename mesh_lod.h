@@ -0,0 +1,21 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// offline level-of-detail by vertex clustering: every vertex is snapped to a grid cell, each cell
+// keeps the one vertex nearest the cell's average position, and only the triangles that still have
+// three distinct corners are kept. the kept vertices are original ones, so a LOD is just another
+// index list over the same vertex buffer (normals and texture coordinates stay valid).
+
+// positions are read as three floats every strideBytes; indices are relative to positions, like a
+// ModelMesh's. simplified receives the new triangle list. returns the farthest any vertex moved, the
+// geometric error of the level in model units.
+float clusterSimplify(const float* positions, std::size_t strideBytes, uint32_t vertexCount, const uint32_t* indices,
+                      uint32_t indexCount, glm::vec3 gridOrigin, float cellSize, std::vector<uint32_t>& simplified);
+
+#endif
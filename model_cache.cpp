@@ -0,0 +1,529 @@
+#include "model_cache.h"
+#include "mesh_lod.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// bump whenever the layout of the header or any record changes
+static const uint32_t MODEL_CACHE_VERSION = 2;
+static const char MODEL_CACHE_MAGIC[4] = { 'D', 'B', 'M', 'C' };
+
+struct ModelCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint32_t vertexCount, indexCount, meshCount, materialCount, textureCount, stringBytes, lodLevels;
+    uint64_t vertexOffset, indexOffset, meshOffset, materialOffset, textureOffset, stringOffset, lodOffset;
+    float boundsMin[3];
+    float boundsMax[3];
+    float lodError[MODEL_LOD_LEVELS];
+};
+
+// mapped file
+// ---------------------------------------------------------------------------------------------
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        bytes = other.bytes;
+        length = other.length;
+        other.bytes = nullptr;
+        other.length = 0;
+#ifdef _WIN32
+        file = other.file;
+        mapping = other.mapping;
+        other.file = other.mapping = nullptr;
+#endif
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(handle);
+        return false;
+    }
+    HANDLE view = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!view)
+    {
+        CloseHandle(handle);
+        return false;
+    }
+    bytes = static_cast<const unsigned char*>(MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0));
+    if (!bytes)
+    {
+        CloseHandle(view);
+        CloseHandle(handle);
+        return false;
+    }
+    file = handle;
+    mapping = view;
+    length = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+        return false;
+    bytes = static_cast<const unsigned char*>(view);
+    length = static_cast<std::size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (!bytes)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(bytes);
+    CloseHandle(static_cast<HANDLE>(mapping));
+    CloseHandle(static_cast<HANDLE>(file));
+    file = mapping = nullptr;
+#else
+    munmap(const_cast<unsigned char*>(bytes), length);
+#endif
+    bytes = nullptr;
+    length = 0;
+}
+
+// model data
+// ---------------------------------------------------------------------------------------------
+void ModelData::pointAtOwned()
+{
+    vertices = ownedVertices.data();
+    indices = ownedIndices.data();
+    meshes = ownedMeshes.data();
+    materials = ownedMaterials.data();
+    textures = ownedTextures.data();
+    strings = ownedStrings.data();
+    lods = ownedLods.data();
+    vertexCount = static_cast<uint32_t>(ownedVertices.size());
+    indexCount = static_cast<uint32_t>(ownedIndices.size());
+    meshCount = static_cast<uint32_t>(ownedMeshes.size());
+    materialCount = static_cast<uint32_t>(ownedMaterials.size());
+    textureCount = static_cast<uint32_t>(ownedTextures.size());
+    stringBytes = static_cast<uint32_t>(ownedStrings.size());
+}
+
+void ModelData::collectTriangles(std::vector<glm::vec3>& positions, std::vector<uint32_t>& triangleIndices) const
+{
+    positions.reserve(positions.size() + vertexCount);
+    uint32_t base = static_cast<uint32_t>(positions.size());
+    for (uint32_t i = 0; i < vertexCount; i++)
+        positions.push_back(glm::vec3(vertices[i].position[0], vertices[i].position[1], vertices[i].position[2]));
+    for (uint32_t m = 0; m < meshCount; m++)
+        for (uint32_t i = 0; i < meshes[m].indexCount; i++)
+            triangleIndices.push_back(base + meshes[m].firstVertex + indices[meshes[m].firstIndex + i]);
+}
+
+// grid resolution across the model's longest side for each coarser level
+static const float LOD_GRID_CELLS[MODEL_LOD_LEVELS] = { 0.0f, 96.0f, 32.0f, 10.0f };
+
+void ModelData::buildLods()
+{
+    ownedLods.assign(std::size_t(meshCount) * MODEL_LOD_LEVELS, ModelLodRange{ 0, 0 });
+    for (uint32_t m = 0; m < meshCount; m++)
+        ownedLods[m * MODEL_LOD_LEVELS] = { ownedMeshes[m].firstIndex, ownedMeshes[m].indexCount };
+
+    // one grid for the whole model so neighbouring meshes collapse onto the same cells
+    glm::vec3 extent = boundsMax - boundsMin;
+    float longest = std::max(extent.x, std::max(extent.y, extent.z));
+    std::vector<uint32_t> simplified;
+    for (uint32_t level = 1; level < MODEL_LOD_LEVELS; level++)
+    {
+        float cellSize = longest / LOD_GRID_CELLS[level];
+        lodError[level] = lodError[level - 1];
+        for (uint32_t m = 0; m < meshCount; m++)
+        {
+            // the mesh's own index data; everything appended for earlier levels lies past it
+            const ModelMesh& mesh = ownedMeshes[m];
+            // an empty mesh keeps its empty ranges (and has no first vertex to point at)
+            if (mesh.vertexCount == 0)
+                continue;
+            float error = clusterSimplify(ownedVertices[mesh.firstVertex].position, sizeof(ModelVertex), mesh.vertexCount,
+                                          ownedIndices.data() + mesh.firstIndex, mesh.indexCount, boundsMin, cellSize, simplified);
+            lodError[level] = std::max(lodError[level], error);
+            ownedLods[m * MODEL_LOD_LEVELS + level] = { static_cast<uint32_t>(ownedIndices.size()), static_cast<uint32_t>(simplified.size()) };
+            ownedIndices.insert(ownedIndices.end(), simplified.begin(), simplified.end());
+        }
+    }
+    pointAtOwned();
+}
+
+std::string modelCachePath(const std::string& sourcePath)
+{
+    return sourcePath + ".dbmc";
+}
+
+static std::string directoryOf(const std::string& path)
+{
+    return path.substr(0, path.find_last_of('/'));
+}
+
+bool sourceStamp(const std::string& sourcePath, uint64_t& size, int64_t& time)
+{
+    std::error_code error;
+    size = std::filesystem::file_size(sourcePath, error);
+    if (error)
+        return false;
+    time = static_cast<int64_t>(std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count());
+    return !error;
+}
+
+// assimp
+// ---------------------------------------------------------------------------------------------
+struct AssimpBuilder
+{
+    std::vector<ModelVertex>& vertices;
+    std::vector<uint32_t>& indices;
+    std::vector<ModelMesh>& meshes;
+    std::vector<ModelMaterial>& materials;
+    std::vector<ModelTextureRef>& textures;
+    std::vector<char>& strings;
+    const aiScene* scene;
+    std::map<unsigned int, uint32_t> materialLookup;
+    std::map<std::string, uint32_t> stringLookup;
+
+    uint32_t addString(const std::string& text)
+    {
+        auto found = stringLookup.find(text);
+        if (found != stringLookup.end())
+            return found->second;
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.insert(strings.end(), text.begin(), text.end());
+        strings.push_back('\0');
+        stringLookup[text] = offset;
+        return offset;
+    }
+
+    void addTextures(aiMaterial* material, aiTextureType type, ModelTextureType modelType)
+    {
+        for (unsigned int i = 0; i < material->GetTextureCount(type); i++)
+        {
+            aiString path;
+            material->GetTexture(type, i, &path);
+            textures.push_back({ static_cast<uint32_t>(modelType), addString(path.C_Str()) });
+        }
+    }
+
+    // same texture slots Model::processMesh asks Assimp for
+    uint32_t addMaterial(unsigned int sceneMaterial)
+    {
+        auto found = materialLookup.find(sceneMaterial);
+        if (found != materialLookup.end())
+            return found->second;
+        aiMaterial* material = scene->mMaterials[sceneMaterial];
+        ModelMaterial record;
+        record.firstTexture = static_cast<uint32_t>(textures.size());
+        addTextures(material, aiTextureType_DIFFUSE, MODEL_TEXTURE_DIFFUSE);
+        addTextures(material, aiTextureType_SPECULAR, MODEL_TEXTURE_SPECULAR);
+        addTextures(material, aiTextureType_HEIGHT, MODEL_TEXTURE_NORMAL);
+        addTextures(material, aiTextureType_AMBIENT, MODEL_TEXTURE_HEIGHT);
+        record.textureCount = static_cast<uint32_t>(textures.size()) - record.firstTexture;
+        uint32_t index = static_cast<uint32_t>(materials.size());
+        materials.push_back(record);
+        materialLookup[sceneMaterial] = index;
+        return index;
+    }
+
+    void addMesh(aiMesh* mesh)
+    {
+        ModelMesh record;
+        record.firstVertex = static_cast<uint32_t>(vertices.size());
+        record.vertexCount = mesh->mNumVertices;
+        record.firstIndex = static_cast<uint32_t>(indices.size());
+        glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+        {
+            ModelVertex vertex;
+            std::memset(&vertex, 0, sizeof(vertex));
+            vertex.position[0] = mesh->mVertices[i].x;
+            vertex.position[1] = mesh->mVertices[i].y;
+            vertex.position[2] = mesh->mVertices[i].z;
+            boundsMin = glm::min(boundsMin, glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]));
+            boundsMax = glm::max(boundsMax, glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]));
+            if (mesh->HasNormals())
+            {
+                vertex.normal[0] = mesh->mNormals[i].x;
+                vertex.normal[1] = mesh->mNormals[i].y;
+                vertex.normal[2] = mesh->mNormals[i].z;
+            }
+            if (mesh->mTextureCoords[0])
+            {
+                vertex.texCoords[0] = mesh->mTextureCoords[0][i].x;
+                vertex.texCoords[1] = mesh->mTextureCoords[0][i].y;
+                vertex.tangent[0] = mesh->mTangents[i].x;
+                vertex.tangent[1] = mesh->mTangents[i].y;
+                vertex.tangent[2] = mesh->mTangents[i].z;
+                vertex.bitangent[0] = mesh->mBitangents[i].x;
+                vertex.bitangent[1] = mesh->mBitangents[i].y;
+                vertex.bitangent[2] = mesh->mBitangents[i].z;
+            }
+            vertices.push_back(vertex);
+        }
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+        {
+            const aiFace& face = mesh->mFaces[i];
+            for (unsigned int j = 0; j < face.mNumIndices; j++)
+                indices.push_back(face.mIndices[j]);
+        }
+        record.indexCount = static_cast<uint32_t>(indices.size()) - record.firstIndex;
+        record.material = addMaterial(mesh->mMaterialIndex);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            record.boundsMin[axis] = mesh->mNumVertices ? boundsMin[axis] : 0.0f;
+            record.boundsMax[axis] = mesh->mNumVertices ? boundsMax[axis] : 0.0f;
+        }
+        meshes.push_back(record);
+    }
+
+    void addNode(aiNode* node)
+    {
+        for (unsigned int i = 0; i < node->mNumMeshes; i++)
+            addMesh(scene->mMeshes[node->mMeshes[i]]);
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
+            addNode(node->mChildren[i]);
+    }
+};
+
+static void computeModelBounds(ModelData& data)
+{
+    glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+    for (uint32_t m = 0; m < data.meshCount; m++)
+    {
+        boundsMin = glm::min(boundsMin, glm::vec3(data.meshes[m].boundsMin[0], data.meshes[m].boundsMin[1], data.meshes[m].boundsMin[2]));
+        boundsMax = glm::max(boundsMax, glm::vec3(data.meshes[m].boundsMax[0], data.meshes[m].boundsMax[1], data.meshes[m].boundsMax[2]));
+    }
+    data.boundsMin = data.meshCount ? boundsMin : glm::vec3(0.0f);
+    data.boundsMax = data.meshCount ? boundsMax : glm::vec3(0.0f);
+}
+
+bool loadModelAssimp(const std::string& path, ModelData& data)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+        return false;
+    }
+
+    data.mapping.close();
+    data.ownedVertices.clear();
+    data.ownedIndices.clear();
+    data.ownedMeshes.clear();
+    data.ownedMaterials.clear();
+    data.ownedTextures.clear();
+    data.ownedStrings.clear();
+    data.ownedLods.clear();
+    AssimpBuilder builder{ data.ownedVertices, data.ownedIndices, data.ownedMeshes, data.ownedMaterials,
+                           data.ownedTextures, data.ownedStrings, scene, {}, {} };
+    builder.addNode(scene->mRootNode);
+    data.ownedStrings.push_back('\0');
+
+    data.pointAtOwned();
+    computeModelBounds(data);
+    data.buildLods();
+    data.directory = directoryOf(path);
+    data.fromCache = false;
+    return true;
+}
+
+// cache file
+// ---------------------------------------------------------------------------------------------
+static uint64_t alignTo16(uint64_t offset)
+{
+    return (offset + 15) & ~uint64_t(15);
+}
+
+bool writeModelCache(const std::string& cachePath, const std::string& sourcePath, const ModelData& data)
+{
+    ModelCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MODEL_CACHE_MAGIC, 4);
+    header.version = MODEL_CACHE_VERSION;
+    if (!sourceStamp(sourcePath, header.sourceSize, header.sourceTime))
+        return false;
+    header.vertexCount = data.vertexCount;
+    header.indexCount = data.indexCount;
+    header.meshCount = data.meshCount;
+    header.materialCount = data.materialCount;
+    header.textureCount = data.textureCount;
+    header.stringBytes = data.stringBytes;
+    header.lodLevels = MODEL_LOD_LEVELS;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        header.boundsMin[axis] = data.boundsMin[axis];
+        header.boundsMax[axis] = data.boundsMax[axis];
+    }
+    for (uint32_t level = 0; level < MODEL_LOD_LEVELS; level++)
+        header.lodError[level] = data.lodError[level];
+
+    struct Section { uint64_t* offset; const void* bytes; uint64_t size; };
+    Section sections[] = {
+        { &header.vertexOffset, data.vertices, uint64_t(data.vertexCount) * sizeof(ModelVertex) },
+        { &header.indexOffset, data.indices, uint64_t(data.indexCount) * sizeof(uint32_t) },
+        { &header.meshOffset, data.meshes, uint64_t(data.meshCount) * sizeof(ModelMesh) },
+        { &header.materialOffset, data.materials, uint64_t(data.materialCount) * sizeof(ModelMaterial) },
+        { &header.textureOffset, data.textures, uint64_t(data.textureCount) * sizeof(ModelTextureRef) },
+        { &header.stringOffset, data.strings, uint64_t(data.stringBytes) },
+        { &header.lodOffset, data.lods, uint64_t(data.meshCount) * MODEL_LOD_LEVELS * sizeof(ModelLodRange) },
+    };
+    uint64_t offset = alignTo16(sizeof(header));
+    for (Section& section : sections)
+    {
+        *section.offset = offset;
+        offset = alignTo16(offset + section.size);
+    }
+
+    // write to a temporary name and rename so a crash never leaves a half written cache behind
+    std::string temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        static const char zeros[16] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t written = sizeof(header);
+        for (const Section& section : sections)
+        {
+            out.write(zeros, static_cast<std::streamsize>(*section.offset - written));
+            if (section.size)
+                out.write(static_cast<const char*>(section.bytes), static_cast<std::streamsize>(section.size));
+            written = *section.offset + section.size;
+        }
+        if (!out)
+            return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, cachePath, error);
+    return !error;
+}
+
+bool loadModelCache(const std::string& cachePath, const std::string& sourcePath, ModelData& data)
+{
+    MappedFile file;
+    if (!file.open(cachePath) || file.size() < sizeof(ModelCacheHeader))
+        return false;
+
+    ModelCacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MODEL_CACHE_MAGIC, 4) != 0 || header.version != MODEL_CACHE_VERSION || header.lodLevels != MODEL_LOD_LEVELS)
+        return false;
+
+    // a source that is not shipped is fine, one that changed since the bake is not
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    if (sourceStamp(sourcePath, sourceSize, sourceTime) && (sourceSize != header.sourceSize || sourceTime != header.sourceTime))
+        return false;
+
+    // every section has to lie inside the file before anything points into it
+    uint64_t sectionEnds[] = {
+        header.vertexOffset + uint64_t(header.vertexCount) * sizeof(ModelVertex),
+        header.indexOffset + uint64_t(header.indexCount) * sizeof(uint32_t),
+        header.meshOffset + uint64_t(header.meshCount) * sizeof(ModelMesh),
+        header.materialOffset + uint64_t(header.materialCount) * sizeof(ModelMaterial),
+        header.textureOffset + uint64_t(header.textureCount) * sizeof(ModelTextureRef),
+        header.stringOffset + uint64_t(header.stringBytes),
+        header.lodOffset + uint64_t(header.meshCount) * MODEL_LOD_LEVELS * sizeof(ModelLodRange),
+    };
+    for (uint64_t end : sectionEnds)
+        if (end > file.size())
+            return false;
+    if (header.stringBytes == 0)
+        return false;
+
+    const unsigned char* base = file.data();
+    data.ownedVertices.clear();
+    data.ownedIndices.clear();
+    data.ownedMeshes.clear();
+    data.ownedMaterials.clear();
+    data.ownedTextures.clear();
+    data.ownedStrings.clear();
+    data.ownedLods.clear();
+    data.vertices = reinterpret_cast<const ModelVertex*>(base + header.vertexOffset);
+    data.indices = reinterpret_cast<const uint32_t*>(base + header.indexOffset);
+    data.meshes = reinterpret_cast<const ModelMesh*>(base + header.meshOffset);
+    data.materials = reinterpret_cast<const ModelMaterial*>(base + header.materialOffset);
+    data.textures = reinterpret_cast<const ModelTextureRef*>(base + header.textureOffset);
+    data.strings = reinterpret_cast<const char*>(base + header.stringOffset);
+    data.lods = reinterpret_cast<const ModelLodRange*>(base + header.lodOffset);
+    data.vertexCount = header.vertexCount;
+    data.indexCount = header.indexCount;
+    data.meshCount = header.meshCount;
+    data.materialCount = header.materialCount;
+    data.textureCount = header.textureCount;
+    data.stringBytes = header.stringBytes;
+    data.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    data.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    for (uint32_t level = 0; level < MODEL_LOD_LEVELS; level++)
+        data.lodError[level] = header.lodError[level];
+    data.directory = directoryOf(sourcePath);
+    data.fromCache = true;
+    data.mapping = std::move(file);
+    return true;
+}
+
+bool bakeModel(const std::string& sourcePath)
+{
+    ModelData data;
+    if (!loadModelAssimp(sourcePath, data))
+        return false;
+    std::string cachePath = modelCachePath(sourcePath);
+    if (!writeModelCache(cachePath, sourcePath, data))
+    {
+        std::cout << "Failed to write model cache: " << cachePath << std::endl;
+        return false;
+    }
+    std::cout << "Baked " << sourcePath << " (" << data.meshCount << " meshes, " << data.vertexCount << " vertices) -> " << cachePath << std::endl;
+    return true;
+}
+
+bool loadModelData(const std::string& sourcePath, ModelData& data)
+{
+    if (loadModelCache(modelCachePath(sourcePath), sourcePath, data))
+        return true;
+    std::cout << "Model cache missing or stale, parsing " << sourcePath << " (run with --bake-models to rebuild)" << std::endl;
+    return loadModelAssimp(sourcePath, data);
+}
@@ -0,0 +1,160 @@
+#ifndef MODEL_CACHE_H
+#define MODEL_CACHE_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// CPU side of a model: everything learnopengl's Model pulls out of Assimp, packed into a few flat
+// arrays so it can be written to disk as-is and memory-mapped back. nothing in here needs GL.
+
+// interleaved vertex, attribute locations 0..4 match Mesh::setupMesh
+struct ModelVertex
+{
+    float position[3];
+    float normal[3];
+    float texCoords[2];
+    float tangent[3];
+    float bitangent[3];
+};
+
+// a draw range inside the model's shared vertex/index arrays. indices are relative to firstVertex.
+struct ModelMesh
+{
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t material;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+enum ModelTextureType
+{
+    MODEL_TEXTURE_DIFFUSE,
+    MODEL_TEXTURE_SPECULAR,
+    MODEL_TEXTURE_NORMAL,
+    MODEL_TEXTURE_HEIGHT
+};
+
+// texture file relative to the model directory; path is an offset into the string table
+struct ModelTextureRef
+{
+    uint32_t type;
+    uint32_t path;
+};
+
+// levels of detail per mesh: level 0 is the mesh itself, the coarser ones are clustered index lists
+// (mesh_lod.h) stored after the full-detail indices and drawn over the same vertices
+const uint32_t MODEL_LOD_LEVELS = 4;
+
+struct ModelLodRange
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+struct ModelMaterial
+{
+    uint32_t firstTexture;
+    uint32_t textureCount;
+};
+
+// read-only view of a file mapped into memory
+class MappedFile
+{
+public:
+    MappedFile() {}
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+    const unsigned char* data() const { return bytes; }
+    std::size_t size() const { return length; }
+
+private:
+    const unsigned char* bytes = nullptr;
+    std::size_t length = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+class ModelData
+{
+public:
+    // either point into `mapping` (cache) or into the owned vectors (Assimp)
+    const ModelVertex* vertices = nullptr;
+    const uint32_t* indices = nullptr;
+    const ModelMesh* meshes = nullptr;
+    const ModelMaterial* materials = nullptr;
+    const ModelTextureRef* textures = nullptr;
+    const char* strings = nullptr;
+    // meshCount * MODEL_LOD_LEVELS ranges, mesh by mesh
+    const ModelLodRange* lods = nullptr;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    uint32_t meshCount = 0;
+    uint32_t materialCount = 0;
+    uint32_t textureCount = 0;
+    uint32_t stringBytes = 0;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    // how far (model units) the vertices of each level are from where they really are; 0 for level 0
+    float lodError[MODEL_LOD_LEVELS] = {};
+
+    // directory textures are resolved against, like Model::directory
+    std::string directory;
+    bool fromCache = false;
+
+    const char* texturePath(const ModelTextureRef& texture) const { return strings + texture.path; }
+    const ModelLodRange& lod(uint32_t mesh, uint32_t level) const { return lods[mesh * MODEL_LOD_LEVELS + level]; }
+
+    // positions and absolute indices of every mesh, as MeshBvh::build wants them
+    void collectTriangles(std::vector<glm::vec3>& positions, std::vector<uint32_t>& triangleIndices) const;
+
+private:
+    friend bool loadModelAssimp(const std::string& path, ModelData& data);
+    friend bool loadModelCache(const std::string& cachePath, const std::string& sourcePath, ModelData& data);
+
+    std::vector<ModelVertex> ownedVertices;
+    std::vector<uint32_t> ownedIndices;
+    std::vector<ModelMesh> ownedMeshes;
+    std::vector<ModelMaterial> ownedMaterials;
+    std::vector<ModelTextureRef> ownedTextures;
+    std::vector<char> ownedStrings;
+    std::vector<ModelLodRange> ownedLods;
+    MappedFile mapping;
+
+    void pointAtOwned();
+    void buildLods();
+};
+
+// size and modification time of a source file, stored in baked files to detect stale caches
+bool sourceStamp(const std::string& sourcePath, uint64_t& size, int64_t& time);
+
+// binary cache next to the source: akagi.obj -> akagi.obj.dbmc
+std::string modelCachePath(const std::string& sourcePath);
+
+// parses the source through Assimp with the same post-processing and traversal as Model::loadModel
+bool loadModelAssimp(const std::string& path, ModelData& data);
+// maps a baked cache; fails when it is missing, has another format version or the source changed since the bake
+bool loadModelCache(const std::string& cachePath, const std::string& sourcePath, ModelData& data);
+bool writeModelCache(const std::string& cachePath, const std::string& sourcePath, const ModelData& data);
+
+// the offline bake step: Assimp parse of the source written to modelCachePath(sourcePath)
+bool bakeModel(const std::string& sourcePath);
+// cache when it is fresh, Assimp otherwise
+bool loadModelData(const std::string& sourcePath, ModelData& data);
+
+#endif
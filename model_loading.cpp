@@ -7,116 +7,337 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <learnopengl/filesystem.h>
-#include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
+#include "simulation.h"
+#include "mesh_bvh.h"
+#include "model_cache.h"
+#include "gpu_model.h"
+#include "instance_batcher.h"
+#include "transform_graph.h"
+#include "profiler.h"
+#include "gpu_timers.h"
+#include "job_system.h"
+#include "asset_loader.h"
+#include "headless.h"
+#include "input_recording.h"
+#include "benchmarks.h"
+#include "bombing_evaluator.h"
+#include "offscreen_context.h"
+#include "shader_manager.h"
+#include "camera_uniforms.h"
+#include "particles.h"
+#include "particle_renderer.h"
+#include "sim_thread.h"
+#include "world_streaming.h"
+#include "ocean_renderer.h"
+#include "raid_ai.h"
+#include "shadow_cascades.h"
+#include "shadow_renderer.h"
+#include "debug_draw.h"
+#include "frame_arena.h"
+#include "allocation_counter.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <thread>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow *window);
-unsigned int loadCubemap(vector<std::string> faces);
-void planeTurn(float direction);
-bool checkSphereBoxCollision(glm::vec3 sphereCenter, float sphereRadius, glm::vec3 boxCenter, glm::vec3 boxHalfSize);
+SimInput processInput(GLFWwindow *window);
+InputTick sampleInputTick(const SimInput& input);
+double appTime();
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+// size of what is drawn: the window's framebuffer, or the offscreen frame
+int viewportWidth = SCR_WIDTH;
+int viewportHeight = SCR_HEIGHT;
 
 // camera
 Camera firstPersonCamera(glm::vec3(0.0f, 0.9f, -0.45f));  
 Camera thirdPersonCamera(glm::vec3(0.0f, 2.0f, 5.0f));  
-bool useThirdPersonCamera = false;  
+bool useThirdPersonCamera = false; // requested with 1 and 2, the sim tick that reads it switches the view
 glm::vec3 cockpitOffsetLocal(0.0f, 0.9f, -0.45f);
-float cameraYawOffset = 0.0f;  // mouse relative yaw
-float cameraPitchOffset = 0.0f; // mouse relative pitch
+glm::vec3 thirdPersonOffsetLocal(0.0f, 1.8f, 10.0f);
 float cameraMoveSpeed = 0.5f;
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
+// raw mouse and wheel movement since the last sim tick, consumed by sampleInputTick
+float pendingMouseX = 0.0f;
+float pendingMouseY = 0.0f;
+float pendingScroll = 0.0f;
 
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-glm::vec3 planePosition = glm::vec3(60.0f, 400.0f, 8000.0f);
-float accelerate = 10.0f;
-float maxSpeed = 80.0f;
-float avgSpeed = 50.0f;
-float minSpeed = 30.0f;
-float planeSpeed = avgSpeed;
-bool planeTurning = false;
-bool planeModSpeed = false;
 float planeScale = 0.2f;
-float planeYaw = 0.0f; // left-right
-float yawSpeed = 20.0f;
-float planePitch = 0.0f; // up-down
-float pitchSpeed = 20.0f;
-float planeRoll = 0.0f; // swing sideward
-float rollSpeed = 20.0f;
-
-glm::vec3 bombPosition = glm::vec3(0.0f, -0.5f, 1.8f);
 float bombScale = 5.0f;
-float bombYaw = 0.0f;
-float bombPitch = 0.0f;
-float bombRoll = 0.0f; 
-bool bombAttached = true;      
-bool bombReleased = false;     
-glm::vec3 bombVelocity(0.0f);  
-float gravity = -9.81f;        
-
-int hitCount = 0;
-bool bombHit = false;
-float bombHitRadius = 0.3f; 
-
-bool showExplosion = false;
-glm::vec3 explosionPosition(0.0f);
 float explosionScale = 5.0f;
 
-bool showHitboxes = false;
+// explosion, smoke and splash particles; a bomb falling past sea level throws up a splash
+const std::size_t PARTICLE_CAPACITY = 16384;
+float seaLevel = 0.0f;
 
-glm::vec3 shipBoxHalfSize(15.0f, 10.0f, 100.0f);
-glm::vec3 shipPosition(0.0f, -5.0f, 0.0f);
-float shipScale = 60.0f;
+bool showHitboxes = false;
 
-int main()
+// profiling: P toggles the stats in the window title
+bool showProfilerOverlay = false;
+
+// GL uploads of streamed assets allowed per frame
+double uploadBudgetMs = 4.0;
+// streamed ocean tiles uploaded per frame
+const std::size_t TILE_UPLOADS_PER_FRAME = 2;
+
+// AI bombers flying in formation on the player
+const std::size_t RAID_WINGMEN = 6;
+// ships the gunners can man: the carrier and up to four on each of the 40 resident tiles
+const std::size_t MAX_RAID_SHIPS = 1 + 4 * 40;
+// objects one frame can submit: every ship, the wingmen and their bombs, and a few more
+const std::size_t MAX_FRAME_INSTANCES = 256;
+// view distance, which the sun's shadow cascades cover too: split mostly logarithmically, with casters
+// up to two kilometres above a cascade (the raid's altitude and then some) still drawn into it
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 8000.0f;
+const float SHADOW_SPLIT_LAMBDA = 0.9f;
+const float SHADOW_CASTER_REACH = 2000.0f;
+// frames after the assets are resident before --check-allocations starts counting
+const long long ALLOCATION_WARMUP_FRAMES = 30;
+
+// the game's models, in the order they are loaded
+std::vector<std::string> modelPaths()
 {
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    return {
+        FileSystem::getPath("resources/objects/bomber_plane/untitled.obj"),
+        FileSystem::getPath("resources/objects/ijn_akagi/akagi.obj"),
+        FileSystem::getPath("resources/objects/bomb/bomb.obj"),
+        FileSystem::getPath("resources/objects/explosion/explosion.obj")
+    };
+}
 
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
+// skybox faces in cubemap order: +X (right), -X (left), +Y (top), -Y (bottom), +Z (front), -Z (back)
+std::vector<std::string> skyboxFaces()
+{
+    return {
+        FileSystem::getPath("resources/textures/skybox/ocean/right.jpg"),
+        FileSystem::getPath("resources/textures/skybox/ocean/left.jpg"),
+        FileSystem::getPath("resources/textures/skybox/ocean/top.jpg"),
+        FileSystem::getPath("resources/textures/skybox/ocean/bottom.jpg"),
+        FileSystem::getPath("resources/textures/skybox/ocean/front.jpg"),
+        FileSystem::getPath("resources/textures/skybox/ocean/back.jpg")
+    };
+}
 
-    // glfw window creation
-    // --------------------
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
-    if (window == NULL)
+int main(int argc, char** argv)
+{
+    appTime(); // start the clock
+    // command line: --headless --ticks N [--dt seconds] runs the sim without a window,
+    // --bench name [--count N] [--iterations N] runs a CPU microbenchmark,
+    // --bake-models writes the binary model caches, --bake-textures the compressed textures,
+    // --profile times the frame and --profile-csv/--profile-trace file dump it at exit,
+    // --record file saves the input at a fixed dt, --replay file [--expect-hash H] plays it back
+    // (both also work with --headless), --offscreen WxH [--frames N] [--out dir] renders without a
+    // window and writes every frame as a PNG, --evaluate-bombing dir [--count drops] [--dt seconds]
+    // maps the hit probability of every release distance and altitude, --check-allocations fails the
+    // run when a steady frame allocates, --shadows off|low|medium|high sets the shadow quality and
+    // --shadow-budget ms lets it change to keep the shadow pass within that time
+    // --------------------------------------------------------------------------------
+    bool headless = false;
+    long long headlessTicks = 100000;
+    float headlessDt = 1.0f / 60.0f;
+    std::string benchmark;
+    BenchmarkOptions benchOptions;
+    bool bakeModels = false;
+    bool bakeTextures = false;
+    bool profile = false;
+    std::string profileCsv, profileTrace;
+    std::string recordPath, replayPath, expectedHash;
+    bool offscreen = false;
+    int offscreenWidth = SCR_WIDTH, offscreenHeight = SCR_HEIGHT;
+    long long offscreenFrames = 120;
+    std::string offscreenDir = "frames";
+    std::string bombingDir;
+    bool checkAllocations = false;
+    ShadowQuality shadowQuality = SHADOWS_MEDIUM;
+    double shadowBudgetMs = 0.0;
+    for (int i = 1; i < argc; i++)
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+        if (std::strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+            headlessTicks = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--dt") == 0 && i + 1 < argc)
+            headlessDt = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+            benchmark = argv[++i];
+        else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+            benchOptions.count = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            benchOptions.iterations = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--bake-models") == 0)
+            bakeModels = true;
+        else if (std::strcmp(argv[i], "--bake-textures") == 0)
+            bakeTextures = true;
+        else if (std::strcmp(argv[i], "--profile") == 0)
+            profile = true;
+        else if (std::strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc)
+            profileCsv = argv[++i];
+        else if (std::strcmp(argv[i], "--profile-trace") == 0 && i + 1 < argc)
+            profileTrace = argv[++i];
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (std::strcmp(argv[i], "--expect-hash") == 0 && i + 1 < argc)
+            expectedHash = argv[++i];
+        else if (std::strcmp(argv[i], "--offscreen") == 0 && i + 1 < argc &&
+                 std::sscanf(argv[i + 1], "%dx%d", &offscreenWidth, &offscreenHeight) == 2 && offscreenWidth > 0 && offscreenHeight > 0)
+        {
+            offscreen = true;
+            i++;
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            offscreenFrames = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            offscreenDir = argv[++i];
+        else if (std::strcmp(argv[i], "--evaluate-bombing") == 0 && i + 1 < argc)
+            bombingDir = argv[++i];
+        else if (std::strcmp(argv[i], "--check-allocations") == 0)
+            checkAllocations = true;
+        else if (std::strcmp(argv[i], "--shadows") == 0 && i + 1 < argc && parseShadowQuality(argv[i + 1], shadowQuality))
+            i++;
+        else if (std::strcmp(argv[i], "--shadow-budget") == 0 && i + 1 < argc)
+            shadowBudgetMs = std::atof(argv[++i]);
+        else
+        {
+            std::cout << "Usage: " << argv[0] << " [--headless] [--ticks N] [--dt seconds]"
+                      << " [--bench name] [--count N] [--iterations N] [--bake-models] [--bake-textures]"
+                      << " [--profile] [--profile-csv file] [--profile-trace file]"
+                      << " [--record file] [--replay file] [--expect-hash H]"
+                      << " [--offscreen WxH] [--frames N] [--out dir] [--evaluate-bombing dir] [--check-allocations]"
+                      << " [--shadows off|low|medium|high] [--shadow-budget ms]" << std::endl;
+            return -1;
+        }
+    }
+    if (bakeModels || bakeTextures)
+    {
+        bool baked = true;
+        if (bakeModels)
+            for (const std::string& path : modelPaths())
+                baked = bakeModel(path) && baked;
+        if (bakeTextures)
+        {
+            // the skybox faces and every texture the models reference
+            std::vector<std::string> textures = skyboxFaces();
+            for (const std::string& path : modelPaths())
+            {
+                ModelData data;
+                if (loadModelData(path, data))
+                    for (const std::string& file : modelTextureFiles(data))
+                        textures.push_back(file);
+            }
+            for (const std::string& path : textures)
+                baked = bakeTexture(path) && baked;
+        }
+        return baked ? 0 : -1;
+    }
+    if (!benchmark.empty())
+    {
+        benchOptions.modelPaths = modelPaths();
+        return runBenchmark(benchmark, benchOptions);
+    }
+    if (!bombingDir.empty())
+        return runBombingEvaluation(bombingDir, benchOptions.count, headlessDt);
+    if (headless && !replayPath.empty())
+        return runReplay(replayPath, modelPaths()[1], expectedHash);
+    if (headless && !recordPath.empty())
+        return recordAutopilot(recordPath, headlessTicks, headlessDt);
+    if (headless)
+        return runHeadless(headlessTicks, headlessDt);
+
+    // recording steps the sim at a fixed dt (--dt), replay at the recorded one. both start once
+    // every asset is resident so the carrier collider is the same on every run.
+    InputRecording recording;
+    recording.dt = headlessDt;
+    if (!replayPath.empty() && !recording.load(replayPath))
+    {
+        std::cout << "Failed to read recording: " << replayPath << std::endl;
         return -1;
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+    std::size_t replayTick = 0;
+    double replayStart = 0.0;
+    float tickAccumulator = 0.0f;
+    int exitCode = 0;
+
+    // simulation (plane, bomb, hits): on its own thread at a fixed --dt in live play, overlapping
+    // with drawing; stepped by the render loop in lockstep when the run must be reproducible
+    SimThread simThread;
+    bool lockstep = offscreen || !recordPath.empty() || !replayPath.empty();
+    bool shipMeshPlaced = false;
+
+    // offscreen: a window-less GL context (software rasterised on machines without a GPU) drawing
+    // into a framebuffer object. no GLFW at all, so window is null and there is no live input.
+    // ------------------------------------------------------------------------------------------
+    GLFWwindow* window = NULL;
+    OffscreenContext offscreenContext;
+    std::vector<double> offscreenFrameMs;
+    if (offscreen)
+    {
+        if (!offscreenContext.create(offscreenWidth, offscreenHeight))
+            return -1;
+        std::error_code error;
+        std::filesystem::create_directories(offscreenDir, error);
+        viewportWidth = offscreenWidth;
+        viewportHeight = offscreenHeight;
+        offscreenFrameMs.reserve(static_cast<std::size_t>(std::max(offscreenFrames, 0LL)));
+    }
+    else
+    {
+        // glfw: initialize and configure
+        // ------------------------------
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
 
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        // glfw window creation
+        // --------------------
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+        if (window == NULL)
+        {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
 
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        // tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+        // glad: load all OpenGL function pointers
+        // ---------------------------------------
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
     }
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
@@ -125,20 +346,146 @@ int main()
     // configure global opengl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
+    // the skybox is mipmapped, filter across its face edges
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
     // build and compile shaders
     // -------------------------
-    Shader ourShader("1.model_loading.vs", "1.model_loading.fs");
-    Shader skyboxShader("6.1.skybox.vs", "6.1.skybox.fs");
-    Shader hitboxShader("hitbox.vs", "hitbox.fs");
+    // linked programs are cached as driver binaries and rebuilt when a shader file is saved
+    ShaderManager shaders;
+    void* (*procAddress)(const char*) = offscreen ? OffscreenContext::procAddress : (void* (*)(const char*))glfwGetProcAddress;
+    shaders.enableBinaryCache(procAddress);
+    // models are drawn instanced: the model matrix comes from a per-instance attribute
+    ShaderProgram& ourShader = shaders.add("1.model_loading_instanced.vs", "1.model_loading.fs");
+    ShaderProgram& skyboxShader = shaders.add("6.1.skybox.vs", "6.1.skybox.fs");
+    ShaderProgram& debugShader = shaders.add("debug_draw.vs", "debug_draw.fs");
+    ShaderProgram& particleShader = shaders.add("particle.vs", "particle.fs");
+    ShaderProgram& oceanShader = shaders.add("ocean.vs", "ocean.fs");
+    ShaderProgram& shadowShader = shaders.add("shadow_depth.vs", "shadow_depth.fs");
+    // projection, view and camera position come from one uniform buffer written once per frame,
+    // the sun and its shadow cascades from another
+    shaders.bindUniformBlock("Camera", CAMERA_UNIFORM_BINDING);
+    shaders.bindUniformBlock("Lighting", LIGHTING_UNIFORM_BINDING);
+    shaders.watch();
+    std::cout << "Shaders: " << shaders.cacheHits << " from the binary cache, " << shaders.compiled << " compiled" << std::endl;
+    CameraUniformBuffer cameraBuffer;
+    const int skyboxSampler = skyboxShader.uniformId("skybox");
+    const int modelShadowSampler = ourShader.uniformId("shadowMap");
+    const int oceanShadowSampler = oceanShader.uniformId("shadowMap");
+    const int shadowLightSpace = shadowShader.uniformId("lightSpace");
+
+
+    // load models (from the baked binary cache when it is up to date, Assimp otherwise)
+    // -----------
+    // parsing and texture decoding run on the job system; the render loop uploads whatever is
+    // ready and draws it, so the plane and sky show up first and the carrier streams in after
+    std::vector<std::string> paths = modelPaths();
+    GpuModel ourModel, shipModel, bombModel, explosionModel;
+    MeshBvh shipBvh;
+    MeshCollider shipCollider;
+    unsigned int cubemapTexture = 0;
+
+    JobSystem jobs;
+    AssetLoader assets(jobs);
+
+    assets.loadCubemapAsync(skyboxFaces(), cubemapTexture);
+    assets.loadModelAsync(paths[0], ourModel);
+    assets.loadModelAsync(paths[2], bombModel);
+    assets.loadModelAsync(paths[3], explosionModel);
+    // triangle BVH of the carrier so hits are mesh accurate; the ship box stays the broadphase
+    assets.loadModelAsync(paths[1], shipModel, [&shipBvh](const ModelData& data) {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+        data.collectTriangles(positions, indices);
+        shipBvh.build(positions, indices);
+    });
+
+    // every object using one of these models is batched with the others using it into a single draw per mesh
+    InstanceRenderer instanceRenderer;
+    InstanceBatcher instances;
+    const uint32_t planeInstances = instanceRenderer.addModel(ourModel, "draw plane");
+    const uint32_t shipInstances = instanceRenderer.addModel(shipModel, "draw carrier");
+    const uint32_t bombInstances = instanceRenderer.addModel(bombModel, "draw bomb");
+    const uint32_t explosionInstances = instanceRenderer.addModel(explosionModel, "draw explosion");
+    // every ship the resident tiles can hold, plus the plane, bomb, carrier and explosion
+    instances.reserve(MAX_FRAME_INSTANCES, explosionInstances + MODEL_LOD_LEVELS);
+
+    // objects outside the view or smaller than a pixel are not submitted, the rest at the coarsest
+    // level of detail that still looks the same; the carrier's meshes are also culled one by one
+    ViewCuller viewCuller;
+    instanceRenderer.meshFrustum = &viewCuller.frustum;
+    auto submitVisible = [&](uint32_t id, const GpuModel& model, const glm::mat4& matrix) {
+        int lod = viewCuller.select(model.boundsMin, model.boundsMax, model.lodError, MODEL_LOD_LEVELS, matrix);
+        if (lod >= 0)
+            instances.add(id + static_cast<uint32_t>(lod), matrix);
+    };
 
+    // sun shadows: each cascade draws the casters inside its box, at the level of detail its texel
+    // size allows, with its own batcher and the same model ids as the main pass. the quality is fixed
+    // by --shadows, or adapted to --shadow-budget from the measured pass time
+    InstanceRenderer casterRenderer;
+    casterRenderer.addModel(ourModel, "shadow plane");
+    casterRenderer.addModel(shipModel, "shadow carrier");
+    casterRenderer.addModel(bombModel, "shadow bomb");
+    InstanceBatcher casters[SHADOW_MAX_CASCADES];
+    for (InstanceBatcher& batcher : casters)
+        batcher.reserve(MAX_FRAME_INSTANCES, explosionInstances + MODEL_LOD_LEVELS);
+    ShadowCascade cascades[SHADOW_MAX_CASCADES];
+    float cascadeEnds[SHADOW_MAX_CASCADES];
+    ShadowCasterCuller casterCuller;
+    ShadowRenderer shadowMaps;
+    ShadowBudget shadowBudget(shadowBudgetMs, shadowQuality);
+    uint64_t shadowFrames = 0, shadowCasters = 0;
+    auto submitObject = [&](uint32_t id, const GpuModel& model, const glm::mat4& matrix) {
+        submitVisible(id, model, matrix);
+        int levels[SHADOW_MAX_CASCADES];
+        if (casterCuller.select(model.boundsMin, model.boundsMax, model.lodError, MODEL_LOD_LEVELS, matrix, levels) == 0)
+            return;
+        for (int c = 0; c < casterCuller.count; c++)
+            if (levels[c] >= 0)
+                casters[c].add(id + static_cast<uint32_t>(levels[c]), matrix);
+    };
 
-    // load models
-    // -----------
-    Model ourModel(FileSystem::getPath("resources/objects/bomber_plane/untitled.obj"));
-    Model shipModel(FileSystem::getPath("resources/objects/ijn_akagi/akagi.obj"));
-    Model bombModel(FileSystem::getPath("resources/objects/bomb/bomb.obj"));
-    Model explosionModel(FileSystem::getPath("resources/objects/explosion/explosion.obj"));
+    // effects: one pool for every explosion and splash, streamed to the GPU each frame
+    ParticlePool particles(PARTICLE_CAPACITY);
+    ParticleRenderer particleRenderer;
+    particleRenderer.create(particles.capacity());
+    const SimdKernel particleKernel = bestSimdKernel();
+    int effectHitCount = simThread.frame().state.hitCount;
+    float effectBombY = simThread.frame().state.bombPosition.y;
+
+    // the ocean and its task groups, streamed in tiles around the plane
+    WorldStreamer world(jobs);
+    OceanRenderer oceanRenderer;
+    oceanRenderer.create();
+    auto uploadTile = [&oceanRenderer](WorldTile& tile) { oceanRenderer.upload(tile); };
+    auto releaseTile = [&oceanRenderer](WorldTile& tile) { oceanRenderer.release(tile); };
+    // particles live in the drawn frame's coordinates and move with it when the origin does
+    int32_t drawnOriginX = simThread.frame().state.originTileX;
+    int32_t drawnOriginZ = simThread.frame().state.originTileZ;
+
+    // wingmen and the flak gunners on every ship in the world; their decisions are time-sliced on
+    // the job system, except offscreen where every agent decides every frame so images repeat
+    RaidSettings raidSettings;
+    if (offscreen)
+        raidSettings.decisionBudgetMs = 0.0;
+    RaidAi raid(&jobs, raidSettings);
+    raid.reserve(RAID_WINGMEN, MAX_RAID_SHIPS, RAID_WINGMEN * 2);
+    raid.addWingmen(RAID_WINGMEN, simThread.frame().state.plane);
+    std::vector<RaidShip> raidShips;
+    raidShips.reserve(MAX_RAID_SHIPS);
+    uint64_t raidTileChanges = ~0ull;
+
+    // world transforms of the plane, its camera and bomb, and the carrier, recomputed only when they move
+    TransformGraph scene;
+    AircraftRig planeRig = addAircraftRig(scene, simThread.frame().state, planeScale, bombScale);
+    ShipRig shipRig = addShipRig(scene, simThread.frame().state);
+
+    // frame profiling, with GPU timestamps next to the CPU scopes
+    profile = profile || !profileCsv.empty() || !profileTrace.empty();
+    profiler().enabled = profile;
+    GpuTimers gpuTimers;
+    GpuTimers* activeGpuTimers = nullptr;
 
     float skyboxVertices[] = {
         // positions          
@@ -196,117 +543,230 @@ int main()
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
 
-    // Ship hitbox setup
-    unsigned int hitboxVAO, hitboxVBO;
-    float hitboxVertices[] = {
-        -0.5f, -0.5f, -0.5f,
-         0.5f, -0.5f, -0.5f,
-         0.5f,  0.5f, -0.5f,
-        -0.5f,  0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-         0.5f, -0.5f,  0.5f,
-         0.5f,  0.5f,  0.5f,
-        -0.5f,  0.5f,  0.5f
-    };
-    unsigned int hitboxIndices[] = {
-        0, 1, 1, 2, 2, 3, 3, 0, // back face
-        4, 5, 5, 6, 6, 7, 7, 4, // front face
-        0, 4, 1, 5, 2, 6, 3, 7  // sides
-    };
-    unsigned int hitboxEBO;
-    glGenVertexArrays(1, &hitboxVAO);
-    glGenBuffers(1, &hitboxVBO);
-    glGenBuffers(1, &hitboxEBO);
-    glBindVertexArray(hitboxVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, hitboxVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(hitboxVertices), hitboxVertices, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, hitboxEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(hitboxIndices), hitboxIndices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glBindVertexArray(0);
-
-    // Bomb hitbox sphere setup
-    unsigned int bombSphereVAO, bombSphereVBO;
-    std::vector<float> bombSphereVertices;
-    const int sectorCount = 24;
-    const int stackCount = 12;
-    for (int i = 0; i <= stackCount; ++i) {
-        float stackAngle = glm::pi<float>() / 2 - i * glm::pi<float>() / stackCount;
-        float xy = cosf(stackAngle);
-        float z = sinf(stackAngle);
-        for (int j = 0; j <= sectorCount; ++j) {
-            float sectorAngle = j * 2 * glm::pi<float>() / sectorCount;
-            float x = xy * cosf(sectorAngle);
-            float y = xy * sinf(sectorAngle);
-            bombSphereVertices.push_back(x);
-            bombSphereVertices.push_back(y);
-            bombSphereVertices.push_back(z);
-        }
-    }
-    glGenVertexArrays(1, &bombSphereVAO);
-    glGenBuffers(1, &bombSphereVBO);
-    glBindVertexArray(bombSphereVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, bombSphereVBO);
-    glBufferData(GL_ARRAY_BUFFER, bombSphereVertices.size() * sizeof(float), bombSphereVertices.data(), GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glBindVertexArray(0);
+    // hitboxes, the predicted bomb arc and anything else worth seeing, drawn from one streaming buffer
+    DebugDraw debugDraw;
+    debugDraw.create(procAddress);
+    glm::vec3 bombPath[256];
 
 
-    vector<std::string> faces
+    // offscreen frames are compared image by image, so they start with every asset resident
+    if (offscreen)
     {
-        FileSystem::getPath("resources/textures/skybox/ocean/right.jpg"),
-        FileSystem::getPath("resources/textures/skybox/ocean/left.jpg"),
-        FileSystem::getPath("resources/textures/skybox/ocean/top.jpg"),
-        FileSystem::getPath("resources/textures/skybox/ocean/bottom.jpg"),
-        FileSystem::getPath("resources/textures/skybox/ocean/front.jpg"),
-        FileSystem::getPath("resources/textures/skybox/ocean/back.jpg")
-    };
-    unsigned int cubemapTexture = loadCubemap(faces);
+        while (!assets.idle())
+        {
+            assets.pumpUploads(uploadBudgetMs);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
 
-    skyboxShader.use();
-    skyboxShader.setInt("skybox", 0);
-    
+    if (!lockstep)
+        simThread.start(headlessDt);
 
     // render loop
     // -----------
-    while (!glfwWindowShouldClose(window))
+    bool closeRequested = false;
+    bool firstFrameShown = false;
+    bool assetsResident = false;
+    int titleHitCount = -1;
+    bool titleShowsOverlay = false;
+    float titleUpdateTime = 0.0f;
+    char windowTitle[256];
+
+    // per-frame scratch, handed back at the end of every frame. once the assets are in and the
+    // frame has warmed up, a frame that reloads nothing must not allocate at all
+    FrameArena frameArena;
+    AllocationWatch allocationWatch;
+    long long residentFrames = 0;
+    while (!closeRequested && (window ? !glfwWindowShouldClose(window) : (long long)offscreenFrameMs.size() < offscreenFrames))
     {
         // per-frame time logic
         // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
+        double frameStart = appTime();
+        float currentFrame = static_cast<float>(frameStart);
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        // offscreen frames step the sim by a fixed 60 Hz so the same run always renders the same images
+        if (offscreen)
+            deltaTime = 1.0f / 60.0f;
+
+        profiler().enabled = profile || showProfilerOverlay;
+        activeGpuTimers = profiler().enabled ? &gpuTimers : nullptr;
+        instanceRenderer.gpuTimers = activeGpuTimers;
+        profiler().beginFrame();
+        allocationWatch.beginFrame();
+
+        // edited shaders are swapped in here, before anything of the frame is drawn
+        bool shadersReloaded = shaders.poll() > 0;
+
+        // streamed assets
+        // ---------------
+        {
+            PROFILE_SCOPE("asset uploads");
+            assets.pumpUploads(uploadBudgetMs);
+        }
+        if (!shipMeshPlaced && shipModel.ready() && !shipBvh.empty())
+        {
+            const SimState& shipState = simThread.latest().current.state;
+            shipCollider.place(shipBvh, shipColliderMatrix(shipState), shipState.shipScale);
+            simThread.setShipMesh(&shipCollider);
+            shipMeshPlaced = true;
+        }
+        if (!assetsResident && assets.idle())
+        {
+            assetsResident = true;
+            std::cout << "All assets resident after " << appTime() << " s" << std::endl;
+        }
 
         // input
         // -----
-        processInput(window);
+        SimInput input;
+        {
+            PROFILE_SCOPE("input");
+            if (window)
+                input = processInput(window);
+        }
 
-        if (planeTurning == false) {
-            if (planeRoll > 0.0f) {
-                planeRoll -= rollSpeed * deltaTime * 0.8;
-                planeRoll = max(planeRoll, 0.0f);
+        // simulation
+        // ----------
+        {
+            PROFILE_SCOPE("sim step");
+            if (!replayPath.empty())
+            {
+                // one recorded tick per frame, live keys and mouse are ignored
+                if (assetsResident && replayTick < recording.ticks.size())
+                {
+                    if (replayTick == 0)
+                    {
+                        replayStart = appTime();
+                        if (recording.shipMesh != shipMeshPlaced)
+                            std::cout << "Replay: the carrier collider differs from the recording, the final state will not match" << std::endl;
+                    }
+                    simThread.step(recording.ticks[replayTick++], recording.dt);
+                    if (replayTick == recording.ticks.size())
+                    {
+                        double seconds = appTime() - replayStart;
+                        char hash[32];
+                        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(hashSimState(simThread.frame().state, simThread.frame().cameraYawOffset, simThread.frame().cameraPitchOffset)));
+                        std::cout << "Replay: " << replayTick << " ticks in " << seconds << " s (" << seconds * 1000.0 / replayTick
+                                  << " ms per frame), final state " << hash << std::endl;
+                        if (!expectedHash.empty() && expectedHash != hash)
+                        {
+                            std::cout << "Replay: MISMATCH, expected " << expectedHash << std::endl;
+                            exitCode = 1;
+                        }
+                        closeRequested = true;
+                    }
+                }
+                pendingMouseX = pendingMouseY = pendingScroll = 0.0f;
+            }
+            else if (!recordPath.empty())
+            {
+                if (assetsResident)
+                {
+                    if (recording.ticks.empty())
+                        recording.shipMesh = shipMeshPlaced;
+                    // the frame's mouse movement goes to its first tick
+                    for (tickAccumulator += deltaTime; tickAccumulator >= recording.dt; tickAccumulator -= recording.dt)
+                    {
+                        InputTick tick = sampleInputTick(input);
+                        recording.ticks.push_back(tick);
+                        simThread.step(tick, recording.dt);
+                    }
+                }
+                else
+                {
+                    pendingMouseX = pendingMouseY = pendingScroll = 0.0f;
+                }
+            }
+            else if (simThread.running())
+            {
+                // movement the sim thread has no room for yet goes out with the next frame
+                InputTick tick = sampleInputTick(input);
+                if (!simThread.pushInput(tick))
+                {
+                    pendingMouseX += tick.mouseX;
+                    pendingMouseY += tick.mouseY;
+                    pendingScroll += tick.scroll;
+                }
             }
-            if (planeRoll < 0.0f) {
-                planeRoll += rollSpeed * deltaTime * 0.8;
-                planeRoll = min(planeRoll, 0.0f);
+            else
+            {
+                simThread.step(sampleInputTick(input), deltaTime);
             }
         }
-        planeTurning = false;
 
-        if (planeModSpeed == false) {
-            if (planeSpeed > avgSpeed) {
-                planeSpeed -= accelerate * deltaTime * 0.5;
-                planeSpeed = max(planeSpeed, avgSpeed);
+        // what this frame draws: the newest tick, or a blend of the last two while the sim runs on its thread
+        const SimFrame drawn = simThread.frameForDrawing();
+        const SimState& sim = drawn.state;
+
+        // world streaming
+        // ---------------
+        bool originMoved = sim.originTileX != drawnOriginX || sim.originTileZ != drawnOriginZ;
+        if (originMoved)
+        {
+            glm::vec3 shift((drawnOriginX - sim.originTileX) * WORLD_TILE_SIZE, 0.0f, (drawnOriginZ - sim.originTileZ) * WORLD_TILE_SIZE);
+            particles.translate(shift);
+            raid.translate(shift);
+            drawnOriginX = sim.originTileX;
+            drawnOriginZ = sim.originTileZ;
+        }
+        world.update(tileAt(sim.originTileX, sim.originTileZ, sim.plane.position), releaseTile);
+        // offscreen runs draw the same tiles every time, so they wait for them. waiting runs queued
+        // generation jobs on this thread, so a frame that waited is not steady
+        bool waitedForTiles = false;
+        if (offscreen && world.loading())
+        {
+            waitedForTiles = true;
+            world.waitForLoads();
+        }
+        world.collect(offscreen ? world.settings().maxResident : TILE_UPLOADS_PER_FRAME, uploadTile);
+
+        // AI
+        // --
+        {
+            PROFILE_SCOPE("raid ai");
+            // the gunners' ships: the carrier plus every resident task group, gathered again when tiles come or go
+            uint64_t tileChanges = world.stats().loaded + world.stats().unloaded;
+            if (tileChanges != raidTileChanges || originMoved)
+            {
+                raidTileChanges = tileChanges;
+                raidShips.clear();
+                raidShips.push_back(RaidShip{ sim.shipPosition, 0.0f, sim.shipBoxHalfSize });
+                for (const std::unique_ptr<WorldTile>& tile : world.resident())
+                {
+                    glm::vec3 corner = tileOffset(tile->coord, sim.originTileX, sim.originTileZ);
+                    for (const StreamedShip& ship : tile->ships)
+                        if (raidShips.size() < MAX_RAID_SHIPS)
+                            raidShips.push_back(RaidShip{ corner + glm::vec3(ship.offset.x, sim.shipPosition.y, ship.offset.y), ship.heading, sim.shipBoxHalfSize });
+                }
+                raid.setShips(raidShips.data(), raidShips.size());
             }
-            if (planeSpeed < avgSpeed) {
-                planeSpeed += accelerate * deltaTime * 0.5;
-                planeSpeed = min(planeSpeed, avgSpeed);
+            raid.step(sim.plane, deltaTime);
+        }
+
+        // effects
+        // -------
+        {
+            PROFILE_SCOPE("particles");
+            if (sim.hitCount != effectHitCount)
+                particles.emitExplosion(sim.explosionPosition, 1.0f);
+            else if (sim.bombReleased && !sim.bombHit && effectBombY > seaLevel && sim.bombPosition.y <= seaLevel)
+                particles.emitSplash(glm::vec3(sim.bombPosition.x, seaLevel, sim.bombPosition.z), 1.0f);
+            effectHitCount = sim.hitCount;
+            effectBombY = sim.bombPosition.y;
+            for (const RaidEvent& event : raid.events())
+            {
+                if (event.type == RAID_FLAK_BURST)
+                    particles.emitExplosion(event.position, 0.25f);
+                else if (event.type == RAID_WINGMAN_DOWN)
+                    particles.emitExplosion(event.position, 0.5f);
+                else if (event.type == RAID_BOMB_HIT)
+                    particles.emitExplosion(event.position, 1.0f);
+                else
+                    particles.emitSplash(event.position, 0.6f);
             }
+            particles.update(deltaTime, particleKernel);
         }
-        planeModSpeed = false;
-        //std::cout << "planeSpeed: " << planeSpeed << std::endl;
 
         // render
         // ------
@@ -314,195 +774,335 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 
-        Camera& activeCamera = useThirdPersonCamera ? thirdPersonCamera : firstPersonCamera;
-
-        // Plane rotation
-        glm::mat4 planeRotationMatrix = glm::mat4(1.0f);
-        planeRotationMatrix = glm::rotate(planeRotationMatrix, glm::radians(planeYaw), glm::vec3(0, 1, 0));   // yaw
-        planeRotationMatrix = glm::rotate(planeRotationMatrix, glm::radians(-planePitch), glm::vec3(1, 0, 0));  // inverted pitch
-        planeRotationMatrix = glm::rotate(planeRotationMatrix, glm::radians(-planeRoll), glm::vec3(0, 0, 1));  // inverted roll
-
-        glm::vec3 planeForward = glm::normalize(glm::vec3(planeRotationMatrix * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f)));
-
-        // Cockpit offset
-        glm::vec3 cockpitOffsetLocal = glm::vec3(0.0f, 0.9f, -0.45f);
-        if (useThirdPersonCamera) cockpitOffsetLocal = glm::vec3(0.0f, 1.8f, 10.0f);
-        glm::vec3 rotatedOffset = glm::vec3(planeRotationMatrix * glm::vec4(cockpitOffsetLocal, 1.0f));
-        glm::vec3 cockpitWorldPos = planePosition + rotatedOffset;
-
-        // Camera rotation (plane + mouse look)
-        glm::mat4 cameraRotation = planeRotationMatrix;
-        cameraRotation = glm::rotate(cameraRotation, glm::radians(cameraYawOffset), glm::vec3(0, 1, 0));
-        cameraRotation = glm::rotate(cameraRotation, glm::radians(cameraPitchOffset), glm::vec3(1, 0, 0));
+        Camera& activeCamera = drawn.thirdPerson ? thirdPersonCamera : firstPersonCamera;
+        firstPersonCamera.Zoom = drawn.zoom;
 
-        // Extract camera basis vectors
-        glm::vec3 cameraFront = glm::normalize(glm::vec3(cameraRotation * glm::vec4(0, 0, -1, 0)));
-        glm::vec3 cameraUp = glm::normalize(glm::vec3(cameraRotation * glm::vec4(0, 1, 0, 0)));
-
-        // --- Update camera ---
-        activeCamera.Position = cockpitWorldPos;
-        activeCamera.Front = cameraFront;
-        activeCamera.Up = cameraUp;
+        // transforms
+        // ----------
+        {
+            PROFILE_SCOPE("transforms");
+            updateAircraftRig(scene, planeRig, sim);
+            updateShipRig(scene, shipRig, sim);
+            setCockpitView(scene, planeRig, drawn.thirdPerson ? thirdPersonOffsetLocal : cockpitOffsetLocal, drawn.cameraYawOffset, drawn.cameraPitchOffset);
+            scene.update();
+        }
 
+        // camera at the cockpit node (plane + mouse look)
+        const glm::mat4& cockpit = scene.world(planeRig.cockpit);
+        activeCamera.Position = glm::vec3(cockpit[3]);
+        activeCamera.Front = glm::normalize(-glm::vec3(cockpit[2]));
+        activeCamera.Up = glm::normalize(glm::vec3(cockpit[1]));
 
 
-        // don't forget to enable shader before setting uniforms
-        ourShader.use();
 
         // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(activeCamera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 8000.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(activeCamera.Zoom), (float)viewportWidth / (float)viewportHeight, NEAR_PLANE, FAR_PLANE);
         glm::mat4 view = activeCamera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, shipPosition); 
-        model = glm::scale(model, glm::vec3(shipScale, shipScale, shipScale));
-        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0, 1.0, 0.0));
-        ourShader.setMat4("model", model);
-        shipModel.Draw(ourShader);
+        viewCuller.setView(projection, view, glm::radians(activeCamera.Zoom), (float)viewportHeight);
+        cameraBuffer.update({ projection, view, glm::vec4(activeCamera.Position, 1.0f) });
 
-        // Draw ship hitbox
-        if (showHitboxes) {
-            hitboxShader.use();
-            hitboxShader.setMat4("projection", projection);
-            hitboxShader.setMat4("view", view);
-            glm::mat4 hitboxModel = glm::mat4(1.0f);
-            hitboxModel = glm::translate(hitboxModel, glm::vec3(0.0f, -10.0f, 0.0f));
-            hitboxModel = glm::scale(hitboxModel, glm::vec3(30.0f, 20.0f, 200.0f)); // width, height, length
-            hitboxModel = glm::rotate(hitboxModel, glm::radians(90.0f), glm::vec3(0, 1, 0));
-            hitboxShader.setMat4("model", hitboxModel);
-            hitboxShader.setVec3("color", glm::vec3(1.0f, 0.0f, 0.0f));
-            glBindVertexArray(hitboxVAO);
-            glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
+        // the sun's cascades for this view
+        ShadowLevel shadows = shadowLevel(shadowQuality);
+        {
+            PROFILE_SCOPE("shadow cascades");
+            shadowMaps.configure(shadows);
+            cascadeSplits(NEAR_PLANE, FAR_PLANE, shadows.cascades, SHADOW_SPLIT_LAMBDA, cascadeEnds);
+            fitCascades(view, glm::radians(activeCamera.Zoom), (float)viewportWidth / (float)viewportHeight, NEAR_PLANE, cascadeEnds,
+                        shadows.cascades, SUN_DIRECTION, shadows.resolution, SHADOW_CASTER_REACH, cascades);
+            casterCuller.setCascades(cascades, shadows.cascades);
+            shadowMaps.updateLighting(cascades, shadows.cascades);
+            for (InstanceBatcher& batcher : casters)
+                batcher.clear();
         }
 
+        // collect this frame's visible objects by model and level of detail, and the shadow casters
+        instances.clear();
+        submitObject(shipInstances, shipModel, scene.world(shipRig.shipModel));
+        submitObject(bombInstances, bombModel, scene.world(planeRig.bombModel));
 
-        ourShader.use();
-        
-        if (bombAttached) {
-            // Bomb follows the plane
-            glm::vec3 bombOffsetLocal(0.0f, -0.5f, 1.8f);
-            glm::mat4 planeRotationMatrix = glm::mat4(1.0f);
-            planeRotationMatrix = glm::rotate(planeRotationMatrix, glm::radians(planeYaw), glm::vec3(0, 1, 0));
-            planeRotationMatrix = glm::rotate(planeRotationMatrix, glm::radians(-planePitch), glm::vec3(1, 0, 0));
-            planeRotationMatrix = glm::rotate(planeRotationMatrix, glm::radians(-planeRoll), glm::vec3(0, 0, 1));
-
-            glm::vec3 rotatedBombOffset = glm::vec3(planeRotationMatrix * glm::vec4(bombOffsetLocal, 1.0f));
-            bombPosition = planePosition + rotatedBombOffset;
-
-            bombYaw = planeYaw;
-            bombPitch = planePitch;
-            bombRoll = planeRoll;
-
-        }
-        else if (bombReleased) {
-            // Apply gravity and motion
-            bombVelocity.y += gravity * deltaTime;
-            bombPosition += bombVelocity * deltaTime;
-        }
-        
-        glm::mat4 bombRotationMatrix = glm::mat4(1.0f);
-        bombRotationMatrix = glm::rotate(bombRotationMatrix, glm::radians(planeYaw), glm::vec3(0, 1, 0));
-        bombRotationMatrix = glm::rotate(bombRotationMatrix, glm::radians(-planePitch), glm::vec3(1, 0, 0));
-        bombRotationMatrix = glm::rotate(bombRotationMatrix, glm::radians(-planeRoll), glm::vec3(0, 0, 1));
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, bombPosition);
-        model *= bombRotationMatrix;
-        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0, 1, 0));
-        model = glm::scale(model, glm::vec3(bombScale));
-        ourShader.setMat4("model", model);
-        bombModel.Draw(ourShader);
-
-        // Check bomb collision with ship
-        if (bombReleased && !bombHit) {
-            if (checkSphereBoxCollision(bombPosition, bombHitRadius, shipPosition, shipBoxHalfSize)) {
-                bombHit = true;
-                hitCount++;
-                showExplosion = true;
-                explosionPosition = bombPosition;
-                std::cout << "Hit Target!" << std::endl;
+        // the streamed task groups share the carrier's model; only the sim's carrier can be hit
+        for (const std::unique_ptr<WorldTile>& tile : world.resident())
+        {
+            glm::vec3 corner = tileOffset(tile->coord, sim.originTileX, sim.originTileZ);
+            for (const StreamedShip& ship : tile->ships)
+            {
+                glm::mat4 shipMat = glm::translate(glm::mat4(1.0f), corner + glm::vec3(ship.offset.x, sim.shipPosition.y, ship.offset.y));
+                shipMat = glm::scale(shipMat, glm::vec3(sim.shipScale));
+                shipMat = glm::rotate(shipMat, glm::radians(90.0f) + ship.heading, glm::vec3(0.0f, 1.0f, 0.0f));
+                submitObject(shipInstances, shipModel, shipMat);
             }
         }
 
-        // Draw explosion when bomb hits
-        if (showExplosion) {
-            ourShader.use();
+        // explosion when bomb hits
+        if (sim.showExplosion) {
             glm::mat4 explosionModelMat = glm::mat4(1.0f);
-            explosionModelMat = glm::translate(explosionModelMat, explosionPosition + glm::vec3(0.0f, -10.0f, 0.0f));
+            explosionModelMat = glm::translate(explosionModelMat, sim.explosionPosition + glm::vec3(0.0f, -10.0f, 0.0f));
             explosionModelMat = glm::scale(explosionModelMat, glm::vec3(explosionScale));
-            ourShader.setMat4("model", explosionModelMat);
-            explosionModel.Draw(ourShader);
+            submitVisible(explosionInstances, explosionModel, explosionModelMat);
+        }
+
+        // the plane, its wingmen and their bombs
+        submitObject(planeInstances, ourModel, scene.world(planeRig.planeModel));
+        const glm::mat4 wingmanModel = glm::scale(glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(planeScale));
+        for (std::size_t i = 0; i < raid.wingmanCount(); i++)
+        {
+            FlightBody wingman = raid.wingman(i);
+            if (wingman.position.y < seaLevel)
+                continue;
+            glm::mat4 wingmanMat = flightRotationMatrix(wingman.orientation, wingman.roll);
+            wingmanMat[3] = glm::vec4(wingman.position, 1.0f);
+            submitObject(planeInstances, ourModel, wingmanMat * wingmanModel);
+        }
+        const EntityArrays& raidBombs = raid.bombs();
+        for (std::size_t i = 0; i < raidBombs.size(); i++)
+        {
+            glm::vec3 velocity = raidBombs.velocity(i);
+            glm::mat4 bombMat = glm::translate(glm::mat4(1.0f), raidBombs.position(i));
+            bombMat = glm::rotate(bombMat, std::atan2(-velocity.x, -velocity.z) + glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            submitObject(bombInstances, bombModel, glm::scale(bombMat, glm::vec3(bombScale)));
+        }
+
+        // shadow pass: every cascade's casters into its layer of the shadow map
+        double shadowPassMs = 0.0;
+        if (shadows.cascades > 0)
+        {
+            PROFILE_SCOPE("shadow pass");
+            GpuScope gpuScope(activeGpuTimers, "shadows");
+            double passStart = appTime();
+            shadowMaps.begin();
+            for (int c = 0; c < shadows.cascades; c++)
+            {
+                shadowMaps.beginCascade(shadowShader, shadowLightSpace, c, cascades[c].viewProjection);
+                casters[c].build();
+                casterRenderer.meshFrustum = &casterCuller.cascades[c].frustum;
+                casterRenderer.draw(shadowShader, casters[c]);
+                shadowCasters += casters[c].instanceCount();
+            }
+            shadowMaps.end();
+            shadowFrames++;
+            shadowPassMs = (appTime() - passStart) * 1000.0 + shadowMaps.lastGpuMs;
+        }
+        if (shadowBudgetMs > 0.0)
+            shadowQuality = shadowBudget.update(shadowPassMs);
+
+        // the lit programs find the cascades on their own texture unit
+        ourShader.use();
+        ourShader.setInt(modelShadowSampler, SHADOW_TEXTURE_UNIT);
+        oceanShader.use();
+        oceanShader.setInt(oceanShadowSampler, SHADOW_TEXTURE_UNIT);
+
+        // ocean under everything
+        {
+            PROFILE_SCOPE("draw ocean");
+            GpuScope gpuScope(activeGpuTimers, "ocean");
+            oceanRenderer.draw(oceanShader, world.resident(), sim.originTileX, sim.originTileZ, viewCuller.frustum);
         }
 
+        // each program is bound once, for everything it draws this frame
+        ourShader.use();
+        {
+            PROFILE_SCOPE("draw models");
+            instances.build();
+            instanceRenderer.draw(ourShader, instances);
+        }
 
-        // Draw bomb hitbox sphere
+        // hitboxes and where the bomb will land: every shape goes into the debug buffer, two draws in all
         if (showHitboxes) {
-            hitboxShader.use();
-            hitboxShader.setMat4("projection", projection);
-            hitboxShader.setMat4("view", view);
-            glm::mat4 bombSphereModel = glm::mat4(1.0f);
-            bombSphereModel = glm::translate(bombSphereModel, bombPosition);
-            bombSphereModel = glm::scale(bombSphereModel, glm::vec3(bombHitRadius));
-            hitboxShader.setMat4("model", bombSphereModel);
-            hitboxShader.setVec3("color", bombHit ? glm::vec3(0.0f, 1.0f, 0.0f)
-                : glm::vec3(1.0f, 1.0f, 0.0f));
-            glBindVertexArray(bombSphereVAO);
-            glDrawArrays(GL_LINE_LOOP, 0, bombSphereVertices.size() / 3);
+            PROFILE_SCOPE("draw hitboxes");
+            GpuScope gpuScope(activeGpuTimers, "debug draw");
+            // drawn from the same box the broadphase uses
+            debugDraw.box(scene.world(shipRig.shipHitbox), glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+            debugDraw.sphere(glm::vec3(scene.world(planeRig.bombHitbox)[3]), sim.bombHitRadius,
+                             sim.bombHit ? glm::vec4(0.0f, 1.0f, 0.0f, 1.0f) : glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));
+            // the streamed ships cannot be hit, their boxes are only for reference
+            for (const std::unique_ptr<WorldTile>& tile : world.resident())
+            {
+                glm::vec3 corner = tileOffset(tile->coord, sim.originTileX, sim.originTileZ);
+                for (const StreamedShip& ship : tile->ships)
+                {
+                    glm::mat4 box = glm::translate(glm::mat4(1.0f), corner + glm::vec3(ship.offset.x, sim.shipPosition.y, ship.offset.y));
+                    box = glm::rotate(box, ship.heading, glm::vec3(0.0f, 1.0f, 0.0f));
+                    debugDraw.box(glm::scale(box, sim.shipBoxHalfSize * 2.0f), glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
+                }
+            }
+            // each flak gun to the aircraft it is tracking
+            for (std::size_t i = 0; i < raid.gunnerCount(); i++)
+                if (raid.gunnerTarget(i) >= 0)
+                    debugDraw.line(raid.gunnerPosition(i), raid.hash().position(static_cast<uint32_t>(raid.gunnerTarget(i))), glm::vec4(1.0f, 0.3f, 0.3f, 0.6f));
+            if (!sim.bombHit) {
+                glm::vec3 impact;
+                bool hitsShip = false;
+                std::size_t count = predictBombPath(sim, headlessDt, bombPath, sizeof(bombPath) / sizeof(bombPath[0]), impact, hitsShip);
+                glm::vec4 arcColor = hitsShip ? glm::vec4(0.0f, 1.0f, 0.0f, 1.0f) : glm::vec4(1.0f, 0.5f, 0.0f, 1.0f);
+                debugDraw.path(bombPath, count, arcColor);
+                debugDraw.disc(impact + glm::vec3(0.0f, 0.2f, 0.0f), 12.0f, arcColor);
+            }
+            debugDraw.flush(debugShader);
+        }
+
+        // draw skybox (once its faces have been uploaded)
+        if (cubemapTexture != 0) {
+            PROFILE_SCOPE("skybox");
+            GpuScope gpuScope(activeGpuTimers, "skybox");
+            glDepthFunc(GL_LEQUAL);
+            skyboxShader.use();
+            skyboxShader.setInt(skyboxSampler, 0);
+            // skybox cube
+            glBindVertexArray(skyboxVAO);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
             glBindVertexArray(0);
+            glDepthFunc(GL_LESS);
+        }
+
+        // particles last: they blend over the scene and the sky
+        {
+            PROFILE_SCOPE("draw particles");
+            GpuScope gpuScope(activeGpuTimers, "particles");
+            particleRenderer.draw(particleShader, particles);
         }
 
+        if (!firstFrameShown && (cubemapTexture != 0 || ourModel.ready())) {
+            firstFrameShown = true;
+            std::cout << "First frame after " << appTime() << " s" << std::endl;
+        }
 
-        ourShader.use();
 
-        // render the loaded model
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, planePosition);
-        model = glm::scale(model, glm::vec3(planeScale, planeScale, planeScale));
-        model = glm::rotate(model, glm::radians(180.0f + planeYaw), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(planePitch), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(planeRoll), glm::vec3(0.0, 0.0, 1.0f));
-        ourShader.setMat4("model", model);
-        ourModel.Draw(ourShader);
-
-        planePosition += planeForward * planeSpeed * deltaTime;
-
-        // draw skybox
-        glDepthFunc(GL_LEQUAL);
-        skyboxShader.use();
-        view = glm::mat4(glm::mat3(activeCamera.GetViewMatrix()));
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
-        // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
-
-
-        std::string windowTitle = "LearnOpenGL - Hit: " + std::to_string(hitCount);
-        glfwSetWindowTitle(window, windowTitle.c_str());
+        // window title: rebuilt when the hit count changes, or a few times a second with the profiler overlay
+        if (window && (sim.hitCount != titleHitCount || showProfilerOverlay != titleShowsOverlay || (showProfilerOverlay && currentFrame - titleUpdateTime > 0.25f))) {
+            titleHitCount = sim.hitCount;
+            titleShowsOverlay = showProfilerOverlay;
+            titleUpdateTime = currentFrame;
+            int length = std::snprintf(windowTitle, sizeof(windowTitle), "LearnOpenGL - Hit: %d", sim.hitCount);
+            if (showProfilerOverlay && length > 0) {
+                // visibility of the last frame, then the slowest scopes
+                const CullStats& culled = viewCuller.stats;
+                length += std::snprintf(windowTitle + length, sizeof(windowTitle) - length, " | objects %llu/%llu lod %llu/%llu/%llu/%llu tris %lluk particles %llu tiles %llu/%llu wingmen %llu/%llu shadows %s casters %llu | ",
+                                        (unsigned long long)instances.instanceCount(), (unsigned long long)culled.tested,
+                                        (unsigned long long)culled.drawn[0], (unsigned long long)culled.drawn[1],
+                                        (unsigned long long)culled.drawn[2], (unsigned long long)culled.drawn[3],
+                                        (unsigned long long)(instanceRenderer.lastFrame.triangles / 1000),
+                                        (unsigned long long)particleRenderer.lastCount,
+                                        (unsigned long long)oceanRenderer.lastCount, (unsigned long long)world.stats().resident,
+                                        (unsigned long long)raid.stats().flying, (unsigned long long)raid.wingmanCount(),
+                                        shadowQualityName(shadowQuality),
+                                        (unsigned long long)(casters[0].instanceCount() + casters[1].instanceCount() + casters[2].instanceCount() + casters[3].instanceCount()));
+                if (length > 0 && length < (int)sizeof(windowTitle))
+                    profiler().formatOverlay(windowTitle + length, sizeof(windowTitle) - length, 4, frameArena);
+            }
+            glfwSetWindowTitle(window, windowTitle);
+        }
+
 
+        // the frame's own work ends here: swapping and writing offscreen images are not checked
+        residentFrames = assetsResident ? residentFrames + 1 : 0;
+        bool steadyFrame = residentFrames > ALLOCATION_WARMUP_FRAMES && !shadersReloaded && !waitedForTiles && recordPath.empty();
+        uint64_t frameAllocations = allocationWatch.endFrame(steadyFrame);
+        if (checkAllocations && steadyFrame && frameAllocations > 0 && allocationWatch.allocatingFrames <= 10)
+            std::cout << "Allocation check: frame " << profiler().frame() << " allocated " << frameAllocations << " times" << std::endl;
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (window)
+        {
+            {
+                PROFILE_SCOPE("swap");
+                glfwSwapBuffers(window);
+            }
+            glfwPollEvents();
+        }
+        else
+        {
+            // the frame time includes the rasterising; reading it back and writing the PNG does not
+            {
+                PROFILE_SCOPE("finish");
+                glFinish();
+            }
+            offscreenFrameMs.push_back((appTime() - frameStart) * 1000.0);
+            char framePath[32];
+            std::snprintf(framePath, sizeof(framePath), "frame_%04zu.png", offscreenFrameMs.size() - 1);
+            if (!writePng(offscreenDir + "/" + framePath, offscreenContext.readPixels()))
+            {
+                std::cout << "Failed to write frame: " << offscreenDir << "/" << framePath << std::endl;
+                exitCode = -1;
+                closeRequested = true;
+            }
+        }
+
+        if (activeGpuTimers)
+            gpuTimers.endFrame();
+        profiler().endFrame();
+        frameArena.reset();
+    }
+
+    // before the carrier collider it reads goes away
+    simThread.stop();
+
+    if (offscreen)
+        reportFrameTimes(offscreenFrameMs, offscreenDir + "/frame_times.csv");
+
+    if (profile || checkAllocations)
+    {
+        std::cout << "Allocations: " << allocationWatch.allocations << " (" << allocationWatch.bytes << " bytes) in "
+                  << allocationWatch.steadyFrames << " steady frames, " << allocationWatch.allocatingFrames << " of them allocating, at most "
+                  << allocationWatch.maxInFrame << " in one; frame arena peak " << frameArena.highWater() / 1024 << " of "
+                  << frameArena.capacity() / 1024 << " KB" << std::endl;
+        if (checkAllocations && allocationWatch.allocatingFrames > 0)
+        {
+            std::cout << "Allocation check: FAILED" << std::endl;
+            exitCode = 1;
+        }
+    }
+
+    if (profile)
+    {
+        profiler().printSummary();
+        const StreamingStats& streaming = world.stats();
+        std::cout << "World streaming: " << streaming.loaded << " tiles loaded, " << streaming.unloaded << " unloaded, "
+                  << streaming.cancelled << " cancelled, peak " << streaming.peakResident << " resident ("
+                  << streaming.peakResident * WorldTile::meshBytes() / 1024 << " KB), load "
+                  << (streaming.loaded ? streaming.totalLoadMs / streaming.loaded : 0.0) << " ms avg " << streaming.maxLoadMs << " ms max" << std::endl;
+        const RaidStats& ai = raid.stats();
+        std::cout << "Raid AI: " << ai.decisions << " decisions (" << ai.queries << " spatial queries), " << ai.shots << " flak shots, "
+                  << ai.losses << " wingmen lost, " << ai.bombs << " bombs, " << ai.shipHits << " ship hits" << std::endl;
+        ShadowLevel shadows = shadowLevel(shadowQuality);
+        std::cout << "Shadows: " << shadowQualityName(shadowQuality) << " (" << shadows.cascades << " cascades of " << shadows.resolution
+                  << "), " << (shadowFrames ? static_cast<double>(shadowCasters) / shadowFrames : 0.0) << " casters drawn per frame over all cascades";
+        if (shadowBudgetMs > 0.0)
+            std::cout << ", " << shadowBudget.averageMs() << " ms of a " << shadowBudgetMs << " ms budget after " << shadowBudget.changes() << " quality changes";
+        std::cout << std::endl;
+        if (!profileCsv.empty() && !profiler().writeCsv(profileCsv))
+            std::cout << "Failed to write profile: " << profileCsv << std::endl;
+        if (!profileTrace.empty() && !profiler().writeChromeTrace(profileTrace))
+            std::cout << "Failed to write profile: " << profileTrace << std::endl;
+    }
+    gpuTimers.release();
+    cameraBuffer.release();
+    particleRenderer.release();
+    world.clear(releaseTile);
+    oceanRenderer.destroy();
+    debugDraw.release();
+    shadowMaps.release();
+
+    if (!recordPath.empty())
+    {
+        if (recording.save(recordPath))
+            std::cout << "Recorded " << recording.ticks.size() << " ticks to " << recordPath << std::endl;
+        else
+            std::cout << "Failed to write recording: " << recordPath << std::endl;
     }
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
-    glfwTerminate();
-    return 0;
+    if (window)
+        glfwTerminate();
+    return exitCode;
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow* window)
+SimInput processInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
@@ -515,42 +1115,26 @@ void processInput(GLFWwindow* window)
         useThirdPersonCamera = true; 
     }
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        planePitch -= pitchSpeed * deltaTime;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        planePitch += pitchSpeed * deltaTime;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        planeTurn(1);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        planeTurn(-1);
-    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS) {
-        planeModSpeed = true;
-        planeSpeed += accelerate * deltaTime;
-        planeSpeed = min(planeSpeed, maxSpeed);
+    // flight and bomb controls are applied by stepSimulation
+    SimInput input;
+    input.pitchDown = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+    input.pitchUp = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+    input.turnLeft = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+    input.turnRight = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+    input.speedUp = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+    input.slowDown = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+    input.dropBomb = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
+    input.reloadBomb = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+
+    static bool pKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && !pKeyPressed) {
+        showProfilerOverlay = !showProfilerOverlay;
+        pKeyPressed = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS) {
-        planeModSpeed = true;
-        planeSpeed -= accelerate * deltaTime;
-        planeSpeed = max(planeSpeed, minSpeed);
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE) {
+        pKeyPressed = false;
     }
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && bombAttached) {
-        bombAttached = false;
-        bombReleased = true;
-
-        glm::mat4 planeRotationMatrix = glm::mat4(1.0f);
-        planeRotationMatrix = glm::rotate(planeRotationMatrix, glm::radians(planeYaw), glm::vec3(0, 1, 0));
-        planeRotationMatrix = glm::rotate(planeRotationMatrix, glm::radians(-planePitch), glm::vec3(1, 0, 0));
-        planeRotationMatrix = glm::rotate(planeRotationMatrix, glm::radians(-planeRoll), glm::vec3(0, 0, 1));
-        glm::vec3 planeForward = glm::normalize(glm::vec3(planeRotationMatrix * glm::vec4(0, 0, -1, 0)));
 
-        bombVelocity = planeForward * planeSpeed;
-    }
-    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
-        bombAttached = true;
-        bombReleased = false;
-        bombVelocity = glm::vec3(0.0f);
-        bombHit = false;
-    }
     static bool hKeyPressed = false;
     if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS && !hKeyPressed) {
         showHitboxes = !showHitboxes;
@@ -560,8 +1144,29 @@ void processInput(GLFWwindow* window)
         hKeyPressed = false;
     }
 
+    return input;
+}
+
+// the live input for one sim tick: held keys, camera choice and the mouse movement not yet consumed
+// -------------------------------------------------------------------------------------------------
+InputTick sampleInputTick(const SimInput& input)
+{
+    InputTick tick;
+    tick.keys = static_cast<uint16_t>(packSimInput(input) | (useThirdPersonCamera ? INPUT_THIRD_PERSON : 0));
+    tick.mouseX = pendingMouseX;
+    tick.mouseY = pendingMouseY;
+    tick.scroll = pendingScroll;
+    pendingMouseX = pendingMouseY = pendingScroll = 0.0f;
+    return tick;
 }
 
+// seconds since main() started; glfwGetTime would need GLFW, which the offscreen mode never starts
+// -------------------------------------------------------------------------------------------------
+double appTime()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
@@ -570,6 +1175,11 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+    if (width > 0 && height > 0)
+    {
+        viewportWidth = width;
+        viewportHeight = height;
+    }
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -592,17 +1202,9 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
     lastX = xpos;
     lastY = ypos;
 
-    float sensitivity = 0.05f;
-    xoffset *= sensitivity;
-    yoffset *= sensitivity;
-
-    cameraYawOffset += xoffset;
-    cameraPitchOffset += yoffset;
-
-    if (cameraPitchOffset > 89.0f)
-        cameraPitchOffset = 89.0f;
-    if (cameraPitchOffset < -89.0f)
-        cameraPitchOffset = -89.0f;
+    // applied (with sensitivity and the pitch clamp) on the next sim tick so it can be recorded
+    pendingMouseX += xoffset;
+    pendingMouseY += yoffset;
 }
 
 
@@ -610,64 +1212,5 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    firstPersonCamera.ProcessMouseScroll(static_cast<float>(yoffset));
+    pendingScroll += static_cast<float>(yoffset);
 }
-
-// loads a cubemap texture from 6 individual texture faces
-// order:
-// +X (right)
-// -X (left)
-// +Y (top)
-// -Y (bottom)
-// +Z (front) 
-// -Z (back)
-// -------------------------------------------------------
-unsigned int loadCubemap(vector<std::string> faces)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++)
-    {
-        unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
-}
-
-void planeTurn(float direction) {
-    planeTurning = true;
-    planeYaw += yawSpeed * direction * deltaTime;
-    planeRoll -= rollSpeed * direction * deltaTime;
-    if (planeRoll > 45.0f) planeRoll = 45.0f;
-    if (planeRoll < -45.0f) planeRoll = -45.0f;
-}
-
-bool checkSphereBoxCollision(glm::vec3 sphereCenter, float sphereRadius, glm::vec3 boxCenter, glm::vec3 boxHalfSize)
-{
-    float x = std::max(boxCenter.x - boxHalfSize.x, std::min(sphereCenter.x, boxCenter.x + boxHalfSize.x));
-    float y = std::max(boxCenter.y - boxHalfSize.y, std::min(sphereCenter.y, boxCenter.y + boxHalfSize.y));
-    float z = std::max(boxCenter.z - boxHalfSize.z, std::min(sphereCenter.z, boxCenter.z + boxHalfSize.z));
-
-    float distance = glm::distance(sphereCenter, glm::vec3(x, y, z));
-
-    return distance < sphereRadius;
-}
-
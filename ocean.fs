@@ -0,0 +1,68 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 WorldPos;
+in vec3 Normal;
+
+uniform sampler2DArrayShadow shadowMap;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec4 cameraPosition;
+};
+
+layout (std140) uniform Lighting
+{
+    mat4 lightSpace[4];
+    vec4 cascadeFar;
+    vec4 cascadeTexel;
+    vec4 sunDirection; // towards the sun, w = cascades
+    vec4 sunColor;
+    vec4 ambientColor;
+};
+
+const vec3 deepColor = vec3(0.02, 0.10, 0.18);
+const vec3 shallowColor = vec3(0.05, 0.25, 0.32);
+const vec3 hazeColor = vec3(0.55, 0.65, 0.75);
+
+// as in 1.model_loading.fs: 1 in full sun, 0 under a ship or plane
+float sunVisibility(vec3 normal, float viewDepth)
+{
+    int cascades = int(sunDirection.w);
+    int cascade = 0;
+    while (cascade < cascades && viewDepth > cascadeFar[cascade])
+        cascade++;
+    if (cascade >= cascades)
+        return 1.0;
+
+    vec4 clip = lightSpace[cascade] * vec4(WorldPos + normal * cascadeTexel[cascade] * 1.5, 1.0);
+    vec3 coords = clip.xyz * 0.5 + 0.5;
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++)
+            lit += texture(shadowMap, vec4(coords.xy + vec2(x, y) * texel, float(cascade), coords.z));
+    return lit / 9.0;
+}
+
+void main()
+{
+    vec3 normal = normalize(Normal);
+    vec3 toEye = cameraPosition.xyz - WorldPos;
+    float distance = length(toEye);
+    toEye /= distance;
+    vec3 lightDirection = sunDirection.xyz;
+    float visibility = sunVisibility(normal, -(view * vec4(WorldPos, 1.0)).z);
+
+    // grazing angles reflect the sky, looking straight down shows the water
+    float fresnel = pow(1.0 - max(dot(normal, toEye), 0.0), 5.0);
+    vec3 water = mix(deepColor, shallowColor, max(dot(normal, lightDirection), 0.0) * mix(0.3, 1.0, visibility));
+    vec3 color = mix(water, hazeColor, fresnel * 0.6);
+    color += pow(max(dot(reflect(-lightDirection, normal), toEye), 0.0), 64.0) * sunColor.rgb * 0.8 * visibility;
+
+    // the edge of the streamed area fades into the haze before the far plane
+    float fog = smoothstep(3000.0, 7500.0, distance);
+    FragColor = vec4(mix(color, hazeColor, fog), 1.0);
+}
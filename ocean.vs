@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;    // relative to the tile corner
+layout (location = 1) in vec3 aNormal;
+
+out vec3 WorldPos;
+out vec3 Normal;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec4 cameraPosition;
+};
+
+// the tile corner relative to the floating origin
+uniform vec3 tileOffset;
+
+void main()
+{
+    WorldPos = aPos + tileOffset;
+    Normal = aNormal;
+    gl_Position = projection * view * vec4(WorldPos, 1.0);
+}
@@ -0,0 +1,93 @@
+#include "ocean_renderer.h"
+#include "shader_manager.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+static const int OCEAN_INDEX_COUNT = (WORLD_TILE_VERTICES - 1) * (WORLD_TILE_VERTICES - 1) * 6;
+
+void OceanRenderer::create()
+{
+    const int n = WORLD_TILE_VERTICES;
+    std::vector<uint32_t> indices;
+    indices.reserve(OCEAN_INDEX_COUNT);
+    for (int row = 0; row < n - 1; row++)
+    {
+        for (int column = 0; column < n - 1; column++)
+        {
+            uint32_t corner = static_cast<uint32_t>(row * n + column);
+            indices.push_back(corner);
+            indices.push_back(corner + n);
+            indices.push_back(corner + 1);
+            indices.push_back(corner + 1);
+            indices.push_back(corner + n);
+            indices.push_back(corner + n + 1);
+        }
+    }
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void OceanRenderer::upload(WorldTile& tile)
+{
+    glGenVertexArrays(1, &tile.vao);
+    glGenBuffers(1, &tile.vbo);
+    glBindVertexArray(tile.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, tile.vbo);
+    glBufferData(GL_ARRAY_BUFFER, tile.vertices.size() * sizeof(float), tile.vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    std::vector<float>().swap(tile.vertices);
+}
+
+void OceanRenderer::release(WorldTile& tile)
+{
+    if (tile.vao)
+    {
+        glDeleteVertexArrays(1, &tile.vao);
+        glDeleteBuffers(1, &tile.vbo);
+    }
+    tile.vao = tile.vbo = 0;
+}
+
+void OceanRenderer::draw(ShaderProgram& shader, const std::vector<std::unique_ptr<WorldTile>>& tiles, int32_t originTileX, int32_t originTileZ, const Frustum& frustum)
+{
+    lastCount = 0;
+    if (!indexBuffer || tiles.empty())
+        return;
+    if (tileOffsetUniform < 0)
+        tileOffsetUniform = shader.uniformId("tileOffset");
+
+    shader.use();
+    for (const std::unique_ptr<WorldTile>& tile : tiles)
+    {
+        if (!tile->vao)
+            continue;
+        glm::vec3 offset = tileOffset(tile->coord, originTileX, originTileZ);
+        glm::vec3 boxMin = offset + glm::vec3(0.0f, -OCEAN_SWELL_HEIGHT, 0.0f);
+        glm::vec3 boxMax = offset + glm::vec3(WORLD_TILE_SIZE, OCEAN_SWELL_HEIGHT, WORLD_TILE_SIZE);
+        if (!boxInFrustum(frustum, boxMin, boxMax))
+            continue;
+        shader.setVec3(tileOffsetUniform, offset);
+        glBindVertexArray(tile->vao);
+        glDrawElements(GL_TRIANGLES, OCEAN_INDEX_COUNT, GL_UNSIGNED_INT, 0);
+        lastCount++;
+    }
+    glBindVertexArray(0);
+}
+
+void OceanRenderer::destroy()
+{
+    if (indexBuffer)
+        glDeleteBuffers(1, &indexBuffer);
+    indexBuffer = 0;
+}
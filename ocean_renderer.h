@@ -0,0 +1,35 @@
+#ifndef OCEAN_RENDERER_H
+#define OCEAN_RENDERER_H
+
+#include "culling.h"
+#include "world_streaming.h"
+
+#include <memory>
+#include <vector>
+
+class ShaderProgram;
+
+// draws the streamed ocean tiles. every tile has its own small vertex buffer (positions relative to
+// its corner) and shares one grid index buffer; the tile's place relative to the floating origin is
+// a uniform computed from integer tile coordinates, so the surface never jitters far from home.
+class OceanRenderer
+{
+public:
+    void create();
+    // main thread, from WorldStreamer::collect: moves the tile's mesh to the GPU and frees the CPU copy
+    void upload(WorldTile& tile);
+    // main thread, from WorldStreamer::update
+    void release(WorldTile& tile);
+    // tiles outside the frustum are skipped
+    void draw(ShaderProgram& shader, const std::vector<std::unique_ptr<WorldTile>>& tiles, int32_t originTileX, int32_t originTileZ, const Frustum& frustum);
+    void destroy();
+
+    // tiles drawn by the last draw()
+    std::size_t lastCount = 0;
+
+private:
+    unsigned int indexBuffer = 0;
+    int tileOffsetUniform = -1;
+};
+
+#endif
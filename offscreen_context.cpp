@@ -0,0 +1,283 @@
+#include "offscreen_context.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+// the few EGL and OSMesa entry points and enums used, declared here so their headers are not needed
+// -------------------------------------------------------------------------------------------------
+typedef int32_t EGLint;
+typedef void (*ProcAddress)();
+
+static const EGLint EGL_NONE = 0x3038;
+static const EGLint EGL_SURFACE_TYPE = 0x3033, EGL_PBUFFER_BIT = 0x0001;
+static const EGLint EGL_RENDERABLE_TYPE = 0x3040, EGL_OPENGL_BIT = 0x0008;
+static const EGLint EGL_RED_SIZE = 0x3024, EGL_GREEN_SIZE = 0x3023, EGL_BLUE_SIZE = 0x3022, EGL_DEPTH_SIZE = 0x3025;
+static const EGLint EGL_CONTEXT_MAJOR_VERSION = 0x3098, EGL_CONTEXT_MINOR_VERSION = 0x30FB;
+static const EGLint EGL_CONTEXT_OPENGL_PROFILE_MASK = 0x30FD, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT = 0x0001;
+static const unsigned int EGL_OPENGL_API = 0x30A2;
+static const unsigned int EGL_PLATFORM_SURFACELESS_MESA = 0x31DD;
+
+static const int OSMESA_FORMAT = 0x22, OSMESA_RGBA = 0x1908, OSMESA_DEPTH_BITS = 0x30, OSMESA_PROFILE = 0x33;
+static const int OSMESA_CORE_PROFILE = 0x34, OSMESA_CONTEXT_MAJOR_VERSION = 0x36, OSMESA_CONTEXT_MINOR_VERSION = 0x37;
+
+static struct
+{
+    ProcAddress (*getProcAddress)(const char*);
+    void* (*getDisplay)(void*);
+    void* (*getPlatformDisplay)(unsigned int, void*, const EGLint*);
+    unsigned int (*initialize)(void*, EGLint*, EGLint*);
+    unsigned int (*chooseConfig)(void*, const EGLint*, void**, EGLint, EGLint*);
+    unsigned int (*bindApi)(unsigned int);
+    void* (*createContext)(void*, void*, void*, const EGLint*);
+    unsigned int (*makeCurrent)(void*, void*, void*, void*);
+    unsigned int (*destroyContext)(void*, void*);
+    unsigned int (*terminate)(void*);
+} egl;
+
+static struct
+{
+    void* (*createContextAttribs)(const int*, void*);
+    unsigned char (*makeCurrent)(void*, void*, unsigned int, int, int);
+    ProcAddress (*getProcAddress)(const char*);
+    void (*destroyContext)(void*);
+} osmesa;
+
+// GL loader of whichever backend is current
+static ProcAddress (*currentProcAddress)(const char*) = nullptr;
+
+template <typename T>
+static bool loadSymbol(void* library, const char* name, T& function)
+{
+#ifdef _WIN32
+    function = nullptr;
+#else
+    function = reinterpret_cast<T>(dlsym(library, name));
+#endif
+    return function != nullptr;
+}
+
+static void* openLibrary(const char* name)
+{
+#ifdef _WIN32
+    return nullptr;
+#else
+    return dlopen(name, RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+static void closeLibrary(void* library)
+{
+#ifndef _WIN32
+    if (library)
+        dlclose(library);
+#endif
+}
+
+// offscreen context
+// ---------------------------------------------------------------------------------------------
+void* OffscreenContext::procAddress(const char* name)
+{
+    return currentProcAddress ? reinterpret_cast<void*>(currentProcAddress(name)) : nullptr;
+}
+
+bool OffscreenContext::createEgl()
+{
+    library = openLibrary("libEGL.so.1");
+    if (!library)
+        return false;
+    bool loaded = loadSymbol(library, "eglGetProcAddress", egl.getProcAddress) && loadSymbol(library, "eglGetDisplay", egl.getDisplay) &&
+                  loadSymbol(library, "eglInitialize", egl.initialize) && loadSymbol(library, "eglChooseConfig", egl.chooseConfig) &&
+                  loadSymbol(library, "eglBindAPI", egl.bindApi) && loadSymbol(library, "eglCreateContext", egl.createContext) &&
+                  loadSymbol(library, "eglMakeCurrent", egl.makeCurrent) && loadSymbol(library, "eglDestroyContext", egl.destroyContext) &&
+                  loadSymbol(library, "eglTerminate", egl.terminate);
+    if (!loaded)
+        return false;
+
+    // surfaceless needs no X server or GPU device; the default display is the fallback
+    egl.getPlatformDisplay = reinterpret_cast<void* (*)(unsigned int, void*, const EGLint*)>(egl.getProcAddress("eglGetPlatformDisplayEXT"));
+    if (egl.getPlatformDisplay)
+        display = egl.getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+    if (!display || !egl.initialize(display, nullptr, nullptr))
+    {
+        display = egl.getDisplay(nullptr);
+        if (!display || !egl.initialize(display, nullptr, nullptr))
+        {
+            display = nullptr;
+            return false;
+        }
+    }
+
+    const EGLint configAttribs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_RED_SIZE, 8,
+                                     EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24, EGL_NONE };
+    void* config = nullptr;
+    EGLint configCount = 0;
+    if (!egl.chooseConfig(display, configAttribs, &config, 1, &configCount) || configCount < 1 || !egl.bindApi(EGL_OPENGL_API))
+        return false;
+
+    const EGLint contextAttribs[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+    context = egl.createContext(display, config, nullptr, contextAttribs);
+    // no surface at all: everything is drawn into our framebuffer object
+    if (!context || !egl.makeCurrent(display, nullptr, nullptr, context))
+        return false;
+    currentProcAddress = egl.getProcAddress;
+    backendName = "EGL";
+    return true;
+}
+
+bool OffscreenContext::createOsMesa()
+{
+    library = openLibrary("libOSMesa.so.8");
+    if (!library)
+        library = openLibrary("libOSMesa.so");
+    if (!library)
+        return false;
+    bool loaded = loadSymbol(library, "OSMesaCreateContextAttribs", osmesa.createContextAttribs) &&
+                  loadSymbol(library, "OSMesaMakeCurrent", osmesa.makeCurrent) &&
+                  loadSymbol(library, "OSMesaGetProcAddress", osmesa.getProcAddress) &&
+                  loadSymbol(library, "OSMesaDestroyContext", osmesa.destroyContext);
+    if (!loaded)
+        return false;
+
+    const int attribs[] = { OSMESA_FORMAT, OSMESA_RGBA, OSMESA_DEPTH_BITS, 24, OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+                            OSMESA_CONTEXT_MAJOR_VERSION, 3, OSMESA_CONTEXT_MINOR_VERSION, 3, 0 };
+    context = osmesa.createContextAttribs(attribs, nullptr);
+    // OSMesa wants a colour buffer of its own even though the frames go to the framebuffer object
+    osmesaBuffer.assign(std::size_t(frameWidth) * frameHeight * 4, 0);
+    if (!context || !osmesa.makeCurrent(context, osmesaBuffer.data(), GL_UNSIGNED_BYTE, frameWidth, frameHeight))
+        return false;
+    currentProcAddress = osmesa.getProcAddress;
+    backendName = "OSMesa";
+    return true;
+}
+
+bool OffscreenContext::create(int width, int height)
+{
+    destroy();
+    frameWidth = width;
+    frameHeight = height;
+    if (width <= 0 || height <= 0)
+        return false;
+
+    if (!createEgl())
+    {
+        destroy();
+        frameWidth = width;
+        frameHeight = height;
+        if (!createOsMesa())
+        {
+            std::cout << "Failed to create an offscreen GL 3.3 context (neither libEGL nor libOSMesa worked)" << std::endl;
+            destroy();
+            return false;
+        }
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)procAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        destroy();
+        return false;
+    }
+
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Offscreen framebuffer is not complete" << std::endl;
+        destroy();
+        return false;
+    }
+    glViewport(0, 0, width, height);
+
+    std::cout << "Offscreen " << width << "x" << height << " via " << backendName << ": " << glGetString(GL_RENDERER) << ", "
+              << glGetString(GL_VERSION) << std::endl;
+    return true;
+}
+
+void OffscreenContext::destroy()
+{
+    if (framebuffer)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        framebuffer = colorBuffer = depthBuffer = 0;
+    }
+    if (display)
+    {
+        egl.makeCurrent(display, nullptr, nullptr, nullptr);
+        if (context)
+            egl.destroyContext(display, context);
+        egl.terminate(display);
+    }
+    else if (context)
+    {
+        osmesa.destroyContext(context);
+    }
+    display = context = nullptr;
+    osmesaBuffer.clear();
+    closeLibrary(library);
+    library = nullptr;
+    currentProcAddress = nullptr;
+    backendName = "none";
+    frameWidth = frameHeight = 0;
+}
+
+RgbaImage OffscreenContext::readPixels() const
+{
+    RgbaImage image;
+    image.width = frameWidth;
+    image.height = frameHeight;
+    image.pixels.resize(std::size_t(frameWidth) * frameHeight * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, frameWidth, frameHeight, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+
+    // GL's first row is the bottom one
+    std::size_t rowBytes = std::size_t(frameWidth) * 4;
+    for (int y = 0; y < frameHeight / 2; y++)
+        std::swap_ranges(image.pixels.begin() + y * rowBytes, image.pixels.begin() + (y + 1) * rowBytes,
+                         image.pixels.begin() + (frameHeight - 1 - y) * rowBytes);
+    return image;
+}
+
+// frame times
+// ---------------------------------------------------------------------------------------------
+void reportFrameTimes(const std::vector<double>& frameMs, const std::string& csvPath)
+{
+    if (frameMs.empty())
+        return;
+    std::vector<double> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double ms : frameMs)
+        total += ms;
+    double average = total / frameMs.size();
+    std::cout << "Frames: " << frameMs.size() << ", average " << average << " ms (" << 1000.0 / average << " fps), median "
+              << sorted[sorted.size() / 2] << " ms, 95% " << sorted[(sorted.size() * 95) / 100] << " ms, worst " << sorted.back()
+              << " ms" << std::endl;
+
+    if (csvPath.empty())
+        return;
+    std::ofstream out(csvPath, std::ios::trunc);
+    out << "frame,ms\n";
+    for (std::size_t i = 0; i < frameMs.size(); i++)
+        out << i << ',' << frameMs[i] << '\n';
+    if (!out)
+        std::cout << "Failed to write frame times: " << csvPath << std::endl;
+}
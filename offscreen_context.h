@@ -0,0 +1,53 @@
+#ifndef OFFSCREEN_CONTEXT_H
+#define OFFSCREEN_CONTEXT_H
+
+#include "texture_codec.h"
+
+#include <string>
+#include <vector>
+
+// a GL 3.3 core context without a window, for rendering on machines with no GPU or display: EGL on
+// Mesa's surfaceless platform (llvmpipe when there is no GPU), OSMesa when EGL is not available.
+// both libraries are opened at runtime, so nothing extra is linked and the windowed game is unaffected.
+// frames are drawn into a framebuffer object of the requested size that create() leaves bound.
+class OffscreenContext
+{
+public:
+    OffscreenContext() {}
+    ~OffscreenContext() { destroy(); }
+    OffscreenContext(const OffscreenContext&) = delete;
+    OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+    // makes the context current, loads GL through glad and binds the framebuffer
+    bool create(int width, int height);
+    void destroy();
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    const char* backend() const { return backendName; }
+    // GL entry points of the current offscreen context, for loaders like gladLoadGLLoader
+    static void* procAddress(const char* name);
+
+    // waits for the frame to finish and copies it out, rows top to bottom
+    RgbaImage readPixels() const;
+
+private:
+    int frameWidth = 0;
+    int frameHeight = 0;
+    const char* backendName = "none";
+    void* library = nullptr;
+    void* display = nullptr;
+    void* context = nullptr;
+    std::vector<unsigned char> osmesaBuffer;
+    unsigned int framebuffer = 0;
+    unsigned int colorBuffer = 0;
+    unsigned int depthBuffer = 0;
+
+    bool createEgl();
+    bool createOsMesa();
+};
+
+// per-frame milliseconds: average, median, 95th percentile and worst on stdout, one line per frame to csvPath
+void reportFrameTimes(const std::vector<double>& frameMs, const std::string& csvPath);
+
+#endif
@@ -0,0 +1,14 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 Corner;
+in vec4 Color;
+
+void main()
+{
+    // soft round puff inside the quad
+    float falloff = 1.0 - dot(Corner, Corner);
+    if (falloff <= 0.0)
+        discard;
+    FragColor = Color * falloff;
+}
@@ -0,0 +1,70 @@
+#include "particle_renderer.h"
+#include "shader_manager.h"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+void ParticleRenderer::create(std::size_t particleCapacity)
+{
+    capacity = particleCapacity;
+    vertices.resize(capacity);
+
+    const float corners[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &cornerVBO);
+    glGenBuffers(1, &particleVBO);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, cornerVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+    // per particle: centre and half size, then the colour as normalized bytes
+    glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(ParticleVertex), nullptr, GL_STREAM_DRAW);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, position));
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, color));
+    glVertexAttribDivisor(2, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ParticleRenderer::draw(ShaderProgram& shader, const ParticlePool& particles)
+{
+    lastCount = 0;
+    if (!vao || particles.size() == 0)
+        return;
+
+    std::size_t count = particles.buildVertices(vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(ParticleVertex), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(ParticleVertex), vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // colours are premultiplied: fire adds light, smoke and spray cover what is behind them
+    shader.use();
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(count));
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    lastCount = count;
+}
+
+void ParticleRenderer::release()
+{
+    if (vao)
+    {
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &cornerVBO);
+        glDeleteBuffers(1, &particleVBO);
+    }
+    vao = cornerVBO = particleVBO = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef PARTICLE_RENDERER_H
+#define PARTICLE_RENDERER_H
+
+#include "particles.h"
+
+#include <cstddef>
+#include <vector>
+
+class ShaderProgram;
+
+// draws a ParticlePool as camera-facing quads, one instanced draw per frame. the vertex buffer is
+// sized for the whole pool once and orphaned before every upload, so the driver never waits for
+// the previous frame's draw to finish reading it.
+class ParticleRenderer
+{
+public:
+    void create(std::size_t capacity);
+    // blended over everything already drawn, without writing depth; call after the skybox
+    void draw(ShaderProgram& shader, const ParticlePool& particles);
+    void release();
+
+    // particles drawn by the last draw()
+    std::size_t lastCount = 0;
+
+private:
+    unsigned int vao = 0;
+    unsigned int cornerVBO = 0;
+    unsigned int particleVBO = 0;
+    std::size_t capacity = 0;
+    std::vector<ParticleVertex> vertices;
+};
+
+#endif
@@ -0,0 +1,316 @@
+#include "particles.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// kernels run over whole blocks of 8, so the pool is sized in blocks
+static std::size_t paddedCount(std::size_t count)
+{
+    return (count + 7) & ~static_cast<std::size_t>(7);
+}
+
+ParticlePool::ParticlePool(std::size_t capacity)
+{
+    allocated = paddedCount(std::max<std::size_t>(capacity, 8));
+    float** arrays[] = { &posX, &posY, &posZ, &velX, &velY, &velZ, &lifeLeft, &inverseLife, &sizes, &growth, &lift, &drag };
+    for (float** array : arrays)
+    {
+        *array = allocateFloats(allocated);
+        std::fill(*array, *array + allocated, 0.0f);
+    }
+    kinds = new uint8_t[allocated]();
+}
+
+ParticlePool::~ParticlePool()
+{
+    float** arrays[] = { &posX, &posY, &posZ, &velX, &velY, &velZ, &lifeLeft, &inverseLife, &sizes, &growth, &lift, &drag };
+    for (float** array : arrays)
+        freeFloats(*array);
+    delete[] kinds;
+}
+
+bool ParticlePool::spawn(ParticleKind kind, glm::vec3 position, glm::vec3 velocity, float life, float size, float sizeGrowth, float verticalLift, float dragPerSecond)
+{
+    if (count == allocated)
+    {
+        stats.dropped++;
+        return false;
+    }
+    std::size_t i = count++;
+    posX[i] = position.x;
+    posY[i] = position.y;
+    posZ[i] = position.z;
+    velX[i] = velocity.x;
+    velY[i] = velocity.y;
+    velZ[i] = velocity.z;
+    lifeLeft[i] = life;
+    inverseLife[i] = 1.0f / life;
+    sizes[i] = size;
+    growth[i] = sizeGrowth;
+    lift[i] = verticalLift;
+    drag[i] = dragPerSecond;
+    kinds[i] = kind;
+    stats.spawned++;
+    return true;
+}
+
+// same LCG as the benchmarks, so effects look the same on every run
+float ParticlePool::random(float lo, float hi)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return lo + (hi - lo) * ((seed >> 8) * (1.0f / 16777216.0f));
+}
+
+glm::vec3 ParticlePool::randomDirection()
+{
+    float z = random(-1.0f, 1.0f);
+    float angle = random(0.0f, glm::two_pi<float>());
+    float r = std::sqrt(1.0f - z * z);
+    return glm::vec3(r * std::cos(angle), z, r * std::sin(angle));
+}
+
+// effects
+// ---------------------------------------------------------------------------------------------
+void ParticlePool::emitExplosion(glm::vec3 position, float scale)
+{
+    // fireball: fast, short lived, swelling and rising as it burns out
+    for (int i = 0; i < 64; i++)
+    {
+        glm::vec3 direction = randomDirection();
+        spawn(PARTICLE_FIRE, position + direction * random(0.0f, 2.0f) * scale, direction * random(5.0f, 25.0f) * scale,
+              random(0.4f, 0.9f), random(2.0f, 4.0f) * scale, 6.0f * scale, 4.0f, 2.5f);
+    }
+    // debris thrown up and out, falling back under gravity
+    for (int i = 0; i < 32; i++)
+    {
+        glm::vec3 direction = randomDirection();
+        direction.y = std::abs(direction.y) + 0.3f;
+        spawn(PARTICLE_DEBRIS, position, glm::normalize(direction) * random(20.0f, 50.0f) * scale,
+              random(1.5f, 2.5f), random(0.2f, 0.4f) * scale, 0.0f, -9.81f, 0.3f);
+    }
+    // smoke that lingers, spreading as it climbs
+    for (int i = 0; i < 48; i++)
+    {
+        glm::vec3 direction = randomDirection();
+        glm::vec3 velocity = direction * random(1.0f, 6.0f) * scale + glm::vec3(0.0f, random(3.0f, 8.0f), 0.0f);
+        spawn(PARTICLE_SMOKE, position + direction * random(0.0f, 3.0f) * scale, velocity,
+              random(4.0f, 7.0f), random(2.5f, 4.0f) * scale, random(2.0f, 4.0f) * scale, 1.5f, 0.8f);
+    }
+}
+
+void ParticlePool::emitSplash(glm::vec3 position, float scale)
+{
+    // a column of spray with a ring of slower droplets around it
+    for (int i = 0; i < 48; i++)
+    {
+        float angle = random(0.0f, glm::two_pi<float>());
+        float spread = random(1.0f, 8.0f);
+        glm::vec3 velocity(std::cos(angle) * spread * scale, random(12.0f, 30.0f) * scale, std::sin(angle) * spread * scale);
+        spawn(PARTICLE_SPRAY, position, velocity, random(1.2f, 2.0f), random(0.6f, 1.2f) * scale, 1.5f * scale, -9.81f, 0.4f);
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        float angle = random(0.0f, glm::two_pi<float>());
+        glm::vec3 velocity(std::cos(angle) * 6.0f * scale, random(2.0f, 5.0f) * scale, std::sin(angle) * 6.0f * scale);
+        spawn(PARTICLE_SPRAY, position, velocity, random(1.5f, 2.5f), 2.0f * scale, 3.0f * scale, -2.0f, 1.0f);
+    }
+}
+
+// update
+// ---------------------------------------------------------------------------------------------
+// all three kernels use the same operation order (no FMA) so they produce identical results:
+// life -= dt; velocity = (velocity + lift * dt) * max(1 - drag * dt, 0); position += velocity * dt;
+// size += growth * dt
+struct ParticleKernels
+{
+    static void scalar(ParticlePool& p, std::size_t n, float dt)
+    {
+        for (std::size_t i = 0; i < n; i++)
+        {
+            float damping = std::max(1.0f - p.drag[i] * dt, 0.0f);
+            p.lifeLeft[i] -= dt;
+            p.velX[i] = p.velX[i] * damping;
+            p.velY[i] = (p.velY[i] + p.lift[i] * dt) * damping;
+            p.velZ[i] = p.velZ[i] * damping;
+            p.posX[i] += p.velX[i] * dt;
+            p.posY[i] += p.velY[i] * dt;
+            p.posZ[i] += p.velZ[i] * dt;
+            p.sizes[i] += p.growth[i] * dt;
+        }
+    }
+
+#ifdef SIMD_SSE2
+    static void sse(ParticlePool& p, std::size_t n, float dt)
+    {
+        const __m128 vdt = _mm_set1_ps(dt);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 zero = _mm_setzero_ps();
+        for (std::size_t i = 0; i < n; i += 4)
+        {
+            __m128 damping = _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(_mm_load_ps(p.drag + i), vdt)), zero);
+            _mm_store_ps(p.lifeLeft + i, _mm_sub_ps(_mm_load_ps(p.lifeLeft + i), vdt));
+            __m128 vx = _mm_mul_ps(_mm_load_ps(p.velX + i), damping);
+            __m128 vy = _mm_mul_ps(_mm_add_ps(_mm_load_ps(p.velY + i), _mm_mul_ps(_mm_load_ps(p.lift + i), vdt)), damping);
+            __m128 vz = _mm_mul_ps(_mm_load_ps(p.velZ + i), damping);
+            _mm_store_ps(p.velX + i, vx);
+            _mm_store_ps(p.velY + i, vy);
+            _mm_store_ps(p.velZ + i, vz);
+            _mm_store_ps(p.posX + i, _mm_add_ps(_mm_load_ps(p.posX + i), _mm_mul_ps(vx, vdt)));
+            _mm_store_ps(p.posY + i, _mm_add_ps(_mm_load_ps(p.posY + i), _mm_mul_ps(vy, vdt)));
+            _mm_store_ps(p.posZ + i, _mm_add_ps(_mm_load_ps(p.posZ + i), _mm_mul_ps(vz, vdt)));
+            _mm_store_ps(p.sizes + i, _mm_add_ps(_mm_load_ps(p.sizes + i), _mm_mul_ps(_mm_load_ps(p.growth + i), vdt)));
+        }
+    }
+
+    SIMD_TARGET_AVX2 static void avx2(ParticlePool& p, std::size_t n, float dt)
+    {
+        const __m256 vdt = _mm256_set1_ps(dt);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 zero = _mm256_setzero_ps();
+        for (std::size_t i = 0; i < n; i += 8)
+        {
+            __m256 damping = _mm256_max_ps(_mm256_sub_ps(one, _mm256_mul_ps(_mm256_load_ps(p.drag + i), vdt)), zero);
+            _mm256_store_ps(p.lifeLeft + i, _mm256_sub_ps(_mm256_load_ps(p.lifeLeft + i), vdt));
+            __m256 vx = _mm256_mul_ps(_mm256_load_ps(p.velX + i), damping);
+            __m256 vy = _mm256_mul_ps(_mm256_add_ps(_mm256_load_ps(p.velY + i), _mm256_mul_ps(_mm256_load_ps(p.lift + i), vdt)), damping);
+            __m256 vz = _mm256_mul_ps(_mm256_load_ps(p.velZ + i), damping);
+            _mm256_store_ps(p.velX + i, vx);
+            _mm256_store_ps(p.velY + i, vy);
+            _mm256_store_ps(p.velZ + i, vz);
+            _mm256_store_ps(p.posX + i, _mm256_add_ps(_mm256_load_ps(p.posX + i), _mm256_mul_ps(vx, vdt)));
+            _mm256_store_ps(p.posY + i, _mm256_add_ps(_mm256_load_ps(p.posY + i), _mm256_mul_ps(vy, vdt)));
+            _mm256_store_ps(p.posZ + i, _mm256_add_ps(_mm256_load_ps(p.posZ + i), _mm256_mul_ps(vz, vdt)));
+            _mm256_store_ps(p.sizes + i, _mm256_add_ps(_mm256_load_ps(p.sizes + i), _mm256_mul_ps(_mm256_load_ps(p.growth + i), vdt)));
+        }
+    }
+#endif
+};
+
+void ParticlePool::integrate(float dt, SimdKernel kernel)
+{
+    // the slots past size() in the last block are stale copies of live particles, harmless to update
+    std::size_t n = paddedCount(count);
+    if (n == 0)
+        return;
+
+    switch (kernel)
+    {
+#ifdef SIMD_SSE2
+    case KERNEL_AVX2:
+        if (cpuHasAvx2())
+        {
+            ParticleKernels::avx2(*this, n, dt);
+            return;
+        }
+        // fall through
+    case KERNEL_SSE:
+        ParticleKernels::sse(*this, n, dt);
+        return;
+#endif
+    default:
+        ParticleKernels::scalar(*this, n, dt);
+        return;
+    }
+}
+
+void ParticlePool::removeExpired()
+{
+    // one pass: live particles slide down over the expired ones, so older particles stay in front
+    std::size_t live = 0;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (lifeLeft[i] <= 0.0f)
+            continue;
+        if (live != i)
+        {
+            posX[live] = posX[i];
+            posY[live] = posY[i];
+            posZ[live] = posZ[i];
+            velX[live] = velX[i];
+            velY[live] = velY[i];
+            velZ[live] = velZ[i];
+            lifeLeft[live] = lifeLeft[i];
+            inverseLife[live] = inverseLife[i];
+            sizes[live] = sizes[i];
+            growth[live] = growth[i];
+            lift[live] = lift[i];
+            drag[live] = drag[i];
+            kinds[live] = kinds[i];
+        }
+        live++;
+    }
+    stats.expired += count - live;
+    count = live;
+}
+
+void ParticlePool::translate(glm::vec3 offset)
+{
+    for (std::size_t i = 0; i < count; i++)
+    {
+        posX[i] += offset.x;
+        posY[i] += offset.y;
+        posZ[i] += offset.z;
+    }
+}
+
+void ParticlePool::update(float dt, SimdKernel kernel)
+{
+    integrate(dt, kernel);
+    removeExpired();
+}
+
+// vertices
+// ---------------------------------------------------------------------------------------------
+static uint8_t unorm(float value)
+{
+    return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// colour ramps over the particle's age (0 = born, 1 = expired), premultiplied so fire can add
+// light (low alpha) while smoke covers what is behind it, in one blend mode
+static glm::vec4 particleColor(uint8_t kind, float age)
+{
+    switch (kind)
+    {
+    case PARTICLE_FIRE:
+    {
+        glm::vec3 color = age < 0.4f ? glm::mix(glm::vec3(1.0f, 0.9f, 0.5f), glm::vec3(1.0f, 0.45f, 0.1f), age / 0.4f)
+                                     : glm::mix(glm::vec3(1.0f, 0.45f, 0.1f), glm::vec3(0.3f, 0.08f, 0.02f), (age - 0.4f) / 0.6f);
+        float fade = 1.0f - age;
+        return glm::vec4(color * fade, 0.2f * fade);
+    }
+    case PARTICLE_SMOKE:
+    {
+        // fades in over the first moments so it does not pop out of the fireball
+        float alpha = 0.5f * std::min(age * 8.0f, 1.0f) * (1.0f - age);
+        return glm::vec4(glm::vec3(glm::mix(0.25f, 0.15f, age)) * alpha, alpha);
+    }
+    case PARTICLE_DEBRIS:
+    {
+        float alpha = age < 0.8f ? 1.0f : (1.0f - age) / 0.2f;
+        return glm::vec4(glm::vec3(0.1f, 0.08f, 0.06f) * alpha, alpha);
+    }
+    default:
+    {
+        float alpha = 0.7f * (1.0f - age);
+        return glm::vec4(glm::vec3(0.85f, 0.9f, 0.95f) * alpha, alpha);
+    }
+    }
+}
+
+std::size_t ParticlePool::buildVertices(ParticleVertex* out) const
+{
+    for (std::size_t i = 0; i < count; i++)
+    {
+        glm::vec4 color = particleColor(kinds[i], 1.0f - lifeLeft[i] * inverseLife[i]);
+        out[i].position = glm::vec3(posX[i], posY[i], posZ[i]);
+        out[i].size = sizes[i];
+        out[i].color[0] = unorm(color.x);
+        out[i].color[1] = unorm(color.y);
+        out[i].color[2] = unorm(color.z);
+        out[i].color[3] = unorm(color.w);
+    }
+    return count;
+}
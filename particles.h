@@ -0,0 +1,100 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "simd.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// what a particle looks like as it ages
+enum ParticleKind : uint8_t
+{
+    PARTICLE_FIRE,
+    PARTICLE_SMOKE,
+    PARTICLE_DEBRIS,
+    PARTICLE_SPRAY
+};
+
+// one camera-facing quad in the streamed vertex buffer: centre, half size and premultiplied colour
+struct ParticleVertex
+{
+    glm::vec3 position;
+    float size;
+    uint8_t color[4];
+};
+static_assert(sizeof(ParticleVertex) == 20, "ParticleVertex is uploaded as is");
+
+struct ParticleStats
+{
+    uint64_t spawned = 0;
+    uint64_t dropped = 0; // asked for while the pool was full
+    uint64_t expired = 0;
+};
+
+// explosions, smoke and splashes in a fixed-capacity structure-of-arrays pool. every array is
+// allocated once by the constructor; a full pool drops new particles instead of growing. update()
+// runs the same SIMD kernels as the raid ballistics, then packs the live particles to the front
+// (keeping their order) so the kernels and the vertex build only touch live slots.
+class ParticlePool
+{
+public:
+    explicit ParticlePool(std::size_t capacity);
+    ~ParticlePool();
+    ParticlePool(const ParticlePool&) = delete;
+    ParticlePool& operator=(const ParticlePool&) = delete;
+
+    std::size_t size() const { return count; }
+    std::size_t capacity() const { return allocated; }
+    void clear() { count = 0; }
+
+    // life in seconds; size grows by sizeGrowth per second, verticalLift is the vertical acceleration
+    // (gravity for debris and spray, positive for hot smoke) and dragPerSecond the fraction of
+    // velocity lost per second. false when the pool is full
+    bool spawn(ParticleKind kind, glm::vec3 position, glm::vec3 velocity, float life, float size, float sizeGrowth, float verticalLift, float dragPerSecond);
+
+    // effects, sized by scale (1 = a bomb on the carrier)
+    void emitExplosion(glm::vec3 position, float scale);
+    void emitSplash(glm::vec3 position, float scale);
+
+    // ages and moves every particle by dt, then drops the expired ones
+    void update(float dt, SimdKernel kernel);
+    void integrate(float dt, SimdKernel kernel);
+    void removeExpired();
+    // moves every particle, e.g. by the opposite of a floating origin shift
+    void translate(glm::vec3 offset);
+
+    // writes size() vertices and returns how many
+    std::size_t buildVertices(ParticleVertex* out) const;
+
+    glm::vec3 position(std::size_t index) const { return glm::vec3(posX[index], posY[index], posZ[index]); }
+    float life(std::size_t index) const { return lifeLeft[index]; }
+
+    ParticleStats stats;
+
+private:
+    float* posX = nullptr;
+    float* posY = nullptr;
+    float* posZ = nullptr;
+    float* velX = nullptr;
+    float* velY = nullptr;
+    float* velZ = nullptr;
+    float* lifeLeft = nullptr;
+    float* inverseLife = nullptr;
+    float* sizes = nullptr;
+    float* growth = nullptr;
+    float* lift = nullptr;
+    float* drag = nullptr;
+    uint8_t* kinds = nullptr;
+    std::size_t count = 0;
+    std::size_t allocated = 0;
+    uint32_t seed = 12345u;
+
+    float random(float lo, float hi);
+    glm::vec3 randomDirection();
+
+    friend struct ParticleKernels;
+};
+
+#endif
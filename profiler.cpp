@@ -0,0 +1,272 @@
+#include "profiler.h"
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+static int64_t steadyNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler::Profiler(std::size_t capacity)
+{
+    std::size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    slots.reset(new Slot[size]);
+    mask = size - 1;
+    // start at 1 so a recorded start of 0 can mean "not timed"
+    epoch = steadyNs() - 1;
+}
+
+uint64_t Profiler::nowNs() const
+{
+    return static_cast<uint64_t>(steadyNs() - epoch);
+}
+
+uint32_t Profiler::threadTrack()
+{
+    static std::atomic<uint32_t> nextTrack{ 0 };
+    thread_local uint32_t track = nextTrack.fetch_add(1, std::memory_order_relaxed);
+    return track;
+}
+
+void Profiler::record(const char* name, uint64_t startNs, uint64_t durationNs, uint32_t track, uint32_t frame)
+{
+    uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots[index & mask];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.startNs.store(startNs, std::memory_order_relaxed);
+    slot.durationNs.store(durationNs, std::memory_order_relaxed);
+    slot.frameTrack.store((uint64_t(frame) << 32) | track, std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::beginFrame()
+{
+    frameStart = enabled.load(std::memory_order_relaxed) ? nowNs() : 0;
+}
+
+void Profiler::endFrame()
+{
+    if (frameStart)
+        record("frame", frameStart, nowNs() - frameStart, threadTrack(), frame());
+    currentFrame.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::size_t Profiler::snapshot(ProfileEvent* out) const
+{
+    std::size_t count = 0;
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = end > mask + 1 ? end - (mask + 1) : 0;
+    for (uint64_t index = begin; index < end; index++)
+    {
+        const Slot& slot = slots[index & mask];
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        ProfileEvent event;
+        event.name = slot.name.load(std::memory_order_relaxed);
+        event.startNs = slot.startNs.load(std::memory_order_relaxed);
+        event.durationNs = slot.durationNs.load(std::memory_order_relaxed);
+        uint64_t frameTrack = slot.frameTrack.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (before != index + 1 || slot.sequence.load(std::memory_order_relaxed) != before)
+            continue; // not written yet or overwritten while we copied it
+        event.frame = static_cast<uint32_t>(frameTrack >> 32);
+        event.track = static_cast<uint32_t>(frameTrack & 0xffffffffu);
+        out[count++] = event;
+    }
+    return count;
+}
+
+std::vector<ProfileEvent> Profiler::snapshot() const
+{
+    std::vector<ProfileEvent> events(capacity());
+    events.resize(snapshot(events.data()));
+    return events;
+}
+
+// summaries
+// ---------------------------------------------------------------------------------------------
+// a scope is a name (by its text: the same literal in two files may have two addresses) on the
+// CPU or the GPU side
+static int compareScopes(const ProfileEvent& a, const ProfileEvent& b)
+{
+    int order = a.name == b.name ? 0 : std::strcmp(a.name, b.name);
+    if (order != 0)
+        return order;
+    bool gpuA = a.track == PROFILE_GPU_TRACK, gpuB = b.track == PROFILE_GPU_TRACK;
+    return gpuA == gpuB ? 0 : (gpuA ? 1 : -1);
+}
+
+// keeps the events of whole frames and sorts them by scope, then frame; returns how many are kept
+static std::size_t sortByScope(ProfileEvent* events, std::size_t count, uint32_t lastFrame)
+{
+    if (count == 0)
+        return 0;
+    // the oldest frame may have lost events to the ring wrapping, the current one is unfinished
+    uint32_t firstFrame = events[0].frame + 1;
+    ProfileEvent* end = std::remove_if(events, events + count, [&](const ProfileEvent& event) {
+        return event.frame < firstFrame || event.frame >= lastFrame;
+    });
+    std::sort(events, end, [](const ProfileEvent& a, const ProfileEvent& b) {
+        int order = compareScopes(a, b);
+        return order != 0 ? order < 0 : a.frame < b.frame;
+    });
+    return static_cast<std::size_t>(end - events);
+}
+
+static std::size_t countScopes(const ProfileEvent* events, std::size_t count)
+{
+    std::size_t scopes = 0;
+    for (std::size_t i = 0; i < count; i++)
+        if (i == 0 || compareScopes(events[i - 1], events[i]) != 0)
+            scopes++;
+    return scopes;
+}
+
+static double percentile(const double* sorted, std::size_t count, double fraction)
+{
+    std::size_t index = static_cast<std::size_t>(fraction * (count - 1) + 0.5);
+    return sorted[std::min(index, count - 1)];
+}
+
+// one summary per scope of the sorted events into out (countScopes of them), "frame" first. ms is
+// scratch for one scope's per-frame totals, as long as the events
+static void summarizeSorted(const ProfileEvent* events, std::size_t count, double* ms, ScopeSummary* out)
+{
+    std::size_t scopes = 0;
+    for (std::size_t begin = 0; begin < count;)
+    {
+        std::size_t frames = 0;
+        std::size_t end = begin;
+        for (; end < count && compareScopes(events[begin], events[end]) == 0; end++)
+        {
+            if (end == begin || events[end].frame != events[end - 1].frame)
+                ms[frames++] = 0.0;
+            ms[frames - 1] += events[end].durationNs / 1e6;
+        }
+        std::sort(ms, ms + frames);
+        double sum = 0.0;
+        for (std::size_t i = 0; i < frames; i++)
+            sum += ms[i];
+        ScopeSummary& summary = out[scopes++];
+        summary.name = events[begin].name;
+        summary.track = events[begin].track == PROFILE_GPU_TRACK ? PROFILE_GPU_TRACK : 0;
+        summary.frames = frames;
+        summary.meanMs = sum / frames;
+        summary.p50Ms = percentile(ms, frames, 0.5);
+        summary.p99Ms = percentile(ms, frames, 0.99);
+        summary.maxMs = ms[frames - 1];
+        begin = end;
+    }
+    for (std::size_t i = 0; i < scopes; i++)
+    {
+        if (out[i].track != PROFILE_GPU_TRACK && std::strcmp(out[i].name, "frame") == 0)
+        {
+            std::rotate(out, out + i, out + i + 1);
+            break;
+        }
+    }
+}
+
+std::vector<ScopeSummary> Profiler::summarize() const
+{
+    std::vector<ProfileEvent> events = snapshot();
+    std::size_t count = sortByScope(events.data(), events.size(), currentFrame.load(std::memory_order_relaxed));
+    std::vector<double> ms(count);
+    std::vector<ScopeSummary> summaries(countScopes(events.data(), count));
+    summarizeSorted(events.data(), count, ms.data(), summaries.data());
+    return summaries;
+}
+
+void Profiler::formatOverlay(char* out, std::size_t size, std::size_t maxScopes, FrameArena& scratch) const
+{
+    out[0] = '\0';
+    ProfileEvent* events = scratch.allocate<ProfileEvent>(capacity());
+    double* ms = scratch.allocate<double>(capacity());
+    if (!events || !ms)
+        return;
+    std::size_t count = sortByScope(events, snapshot(events), currentFrame.load(std::memory_order_relaxed));
+    std::size_t scopes = countScopes(events, count);
+    ScopeSummary* summaries = scratch.allocate<ScopeSummary>(scopes);
+    if (scopes == 0 || !summaries)
+        return;
+    summarizeSorted(events, count, ms, summaries);
+
+    // the frame first, then the scopes with the highest p99
+    std::sort(summaries + 1, summaries + scopes, [](const ScopeSummary& a, const ScopeSummary& b) { return a.p99Ms > b.p99Ms; });
+    std::size_t used = 0;
+    for (std::size_t i = 0; i < scopes && i <= maxScopes && used < size; i++)
+    {
+        const ScopeSummary& summary = summaries[i];
+        int written = std::snprintf(out + used, size - used, "%s%s%s %.2f/%.2f%s", i ? " | " : "", summary.track == PROFILE_GPU_TRACK ? "gpu " : "",
+                                    summary.name, summary.p50Ms, summary.p99Ms, i ? "" : " ms");
+        if (written < 0)
+            break;
+        used += static_cast<std::size_t>(written);
+    }
+}
+
+void Profiler::printSummary() const
+{
+    char line[160];
+    std::cout << "profile (ms per frame over the last frames in the ring):" << std::endl;
+    std::snprintf(line, sizeof(line), "  %-20s %8s %8s %8s %8s %8s", "scope", "frames", "mean", "p50", "p99", "max");
+    std::cout << line << std::endl;
+    for (const ScopeSummary& summary : summarize())
+    {
+        std::string name = (summary.track == PROFILE_GPU_TRACK ? "gpu " : "") + std::string(summary.name);
+        std::snprintf(line, sizeof(line), "  %-20s %8zu %8.3f %8.3f %8.3f %8.3f", name.c_str(), summary.frames,
+                      summary.meanMs, summary.p50Ms, summary.p99Ms, summary.maxMs);
+        std::cout << line << std::endl;
+    }
+}
+
+bool Profiler::writeCsv(const std::string& path) const
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    out << "frame,track,name,start_us,duration_us\n";
+    for (const ProfileEvent& event : snapshot())
+    {
+        out << event.frame << ',' << (event.track == PROFILE_GPU_TRACK ? std::string("gpu") : std::to_string(event.track)) << ','
+            << event.name << ',' << event.startNs / 1000.0 << ',' << event.durationNs / 1000.0 << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+// chrome://tracing / Perfetto "complete" events, one row per thread plus one for the GPU
+bool Profiler::writeChromeTrace(const std::string& path) const
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    char line[256];
+    for (const ProfileEvent& event : snapshot())
+    {
+        std::snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"frame\":%u}}",
+                      first ? "" : ",\n", event.name, event.startNs / 1000.0, event.durationNs / 1000.0,
+                      event.track == PROFILE_GPU_TRACK ? 1000u : event.track, event.frame);
+        out << line;
+        first = false;
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(out);
+}
+
+Profiler& profiler()
+{
+    static Profiler instance;
+    return instance;
+}
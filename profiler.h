@@ -0,0 +1,121 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class FrameArena;
+
+// frame and subsystem timing. scopes write into a fixed lock-free ring that keeps the last few
+// thousand events; summaries (p50/p99 per frame), CSV and Chrome trace JSON are built from it on
+// demand. nothing here touches GL, GPU times are fed in by GpuTimers.
+
+struct ProfileEvent
+{
+    const char* name; // string literal, compared by pointer
+    uint64_t startNs; // since the profiler was created
+    uint64_t durationNs;
+    uint32_t frame;
+    uint32_t track; // thread index, or PROFILE_GPU_TRACK
+};
+
+const uint32_t PROFILE_GPU_TRACK = 0xffff;
+
+// percentiles of one scope's per-frame total over the frames still in the ring
+struct ScopeSummary
+{
+    const char* name;
+    uint32_t track;
+    std::size_t frames;
+    double meanMs;
+    double p50Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+class Profiler
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit Profiler(std::size_t capacity = 1 << 16);
+
+    // off by default; a disabled scope costs one relaxed load
+    std::atomic<bool> enabled{ false };
+
+    uint64_t nowNs() const;
+    void record(const char* name, uint64_t startNs, uint64_t durationNs, uint32_t track, uint32_t frame);
+    // the whole frame is recorded as a "frame" event between these two
+    void beginFrame();
+    void endFrame();
+    uint32_t frame() const { return currentFrame.load(std::memory_order_relaxed); }
+
+    // events still in the ring, oldest first; slots being written during the copy are skipped
+    std::vector<ProfileEvent> snapshot() const;
+    // the same into out, which has room for capacity() events; returns how many were copied
+    std::size_t snapshot(ProfileEvent* out) const;
+    std::size_t capacity() const { return mask + 1; }
+    // "frame" first, then scopes by name
+    std::vector<ScopeSummary> summarize() const;
+
+    // one line for a window title: "frame p50/p99 ms | scope p50/p99 | ..." for the costliest scopes.
+    // works in scratch, so it can run every frame without allocating; empty when scratch is too small
+    void formatOverlay(char* out, std::size_t size, std::size_t maxScopes, FrameArena& scratch) const;
+    // table of every scope's mean/p50/p99/max to stdout
+    void printSummary() const;
+
+    bool writeCsv(const std::string& path) const;
+    bool writeChromeTrace(const std::string& path) const;
+
+    // small index for the calling thread, used as its track
+    static uint32_t threadTrack();
+
+private:
+    // every field is an atomic so a reader copying a slot while a writer reuses it is a detectable
+    // race (sequence changes) rather than undefined behaviour
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence{ 0 }; // index + 1 once written, 0 while being written
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<uint64_t> startNs{ 0 };
+        std::atomic<uint64_t> durationNs{ 0 };
+        std::atomic<uint64_t> frameTrack{ 0 };
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::size_t mask;
+    std::atomic<uint64_t> head{ 0 };
+    std::atomic<uint32_t> currentFrame{ 0 };
+    uint64_t frameStart = 0;
+    int64_t epoch;
+};
+
+// the process wide profiler the scopes write to
+Profiler& profiler();
+
+// times its own lifetime
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name) : name(name), startNs(profiler().enabled.load(std::memory_order_relaxed) ? profiler().nowNs() : 0) {}
+    ~ProfileScope()
+    {
+        if (startNs)
+            profiler().record(name, startNs, profiler().nowNs() - startNs, Profiler::threadTrack(), profiler().frame());
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    uint64_t startNs;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif
@@ -0,0 +1,466 @@
+#include "raid_ai.h"
+#include "simulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static float nextRandom(uint32_t& seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+static float wrapDegrees(float angle)
+{
+    angle = std::fmod(angle + 180.0f, 360.0f);
+    return (angle < 0.0f ? angle + 360.0f : angle) - 180.0f;
+}
+
+// a hull box is turned by its heading about y; turning by minus the heading goes back
+static glm::vec3 turnY(glm::vec3 v, float angle)
+{
+    float c = std::cos(angle), s = std::sin(angle);
+    return glm::vec3(v.x * c + v.z * s, v.y, -v.x * s + v.z * c);
+}
+
+// seconds a bomb released with vertical speed vy takes to fall drop metres
+static float fallTime(float drop, float vy, float gravity)
+{
+    float discriminant = vy * vy - 2.0f * gravity * drop;
+    if (drop <= 0.0f || discriminant < 0.0f)
+        return 0.0f;
+    return (vy + std::sqrt(discriminant)) / -gravity;
+}
+
+RaidAi::RaidAi(JobSystem* jobs, const RaidSettings& settings)
+    : jobs(jobs), config(settings), kernel(bestSimdKernel()), spatialHash(settings.cellSize)
+{
+}
+
+void RaidAi::reserve(std::size_t wingmanCount, std::size_t shipCount, std::size_t bombCount)
+{
+    std::size_t gunnerCount = shipCount * static_cast<std::size_t>(std::max(config.gunnersPerShip, 0));
+    std::size_t points = wingmanCount + 1 + shipCount + gunnerCount;
+    wingmen.reserve(wingmanCount);
+    wingmanDecisions.reserve(wingmanCount);
+    ships.reserve(shipCount);
+    gunners.reserve(gunnerCount);
+    gunnerTargets.reserve(gunnerCount);
+    // a gun fires every reloadSeconds and a shell flies at most gunRange / shellSpeed
+    std::size_t shellsPerGun = static_cast<std::size_t>(std::ceil(config.gunRange / config.shellSpeed / (0.75f * config.reloadSeconds))) + 1;
+    shells.reserve(gunnerCount * shellsPerGun);
+    bombArrays.reserve(bombCount);
+    previous.reserve(bombArrays.capacity() * 3);
+    stepEvents.reserve(shells.capacity() + bombArrays.capacity() + wingmanCount);
+    pointX.reserve(points);
+    pointY.reserve(points);
+    pointZ.reserve(points);
+    pointMask.reserve(points);
+    aircraftVelocity.reserve(wingmanCount + 1);
+    decidedStep.reserve(wingmanCount + gunnerCount);
+    spatialHash.reserve(points, points);
+}
+
+glm::vec3 RaidAi::formationSlot(std::size_t index, const FlightBody& leader) const
+{
+    glm::vec3 forward = flightForward(leader.orientation);
+    glm::vec3 flat(forward.x, 0.0f, forward.z);
+    float length = std::sqrt(flat.x * flat.x + flat.z * flat.z);
+    flat = length > 1e-3f ? flat / length : glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 right(-flat.z, 0.0f, flat.x);
+    // alternating left and right, one rank further back every pair
+    float rank = static_cast<float>(index / 2 + 1);
+    float side = index % 2 ? 1.0f : -1.0f;
+    return leader.position + (right * side - flat) * rank * config.formationSpacing;
+}
+
+void RaidAi::addWingmen(std::size_t count, const FlightBody& leader)
+{
+    leaderBody = leader;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        std::size_t index = wingmen.size();
+        FlightBody body = leader;
+        body.position = formationSlot(index, leader);
+        body.roll = 0.0f;
+        formation.add(body);
+        wingmen.push_back(Wingman{ config.wingmanHealth, 0.0f, 0.0f });
+        wingmanDecisions.push_back(WingmanDecision{ -1, glm::vec3(0.0f), 0u });
+        decidedStep.insert(decidedStep.begin() + static_cast<std::ptrdiff_t>(index), steps);
+    }
+}
+
+void RaidAi::setShips(const RaidShip* list, std::size_t count)
+{
+    ships.assign(list, list + count);
+    shipReach = 0.0f;
+    for (const RaidShip& ship : ships)
+        shipReach = std::max(shipReach, glm::length(ship.halfSize));
+
+    // two rows of guns along the deck edges
+    const int perShip = std::max(config.gunnersPerShip, 0);
+    const int rows = (perShip + 1) / 2;
+    gunners.clear();
+    for (std::size_t s = 0; s < ships.size(); s++)
+    {
+        const RaidShip& ship = ships[s];
+        for (int j = 0; j < perShip; j++)
+        {
+            float along = ((j / 2 + 0.5f) / rows * 2.0f - 1.0f) * 0.7f;
+            glm::vec3 local((j % 2 ? 0.8f : -0.8f) * ship.halfSize.x, ship.halfSize.y, along * ship.halfSize.z);
+            Gunner gunner;
+            gunner.ship = static_cast<uint32_t>(s);
+            gunner.position = ship.position + turnY(local, ship.heading);
+            gunner.seed = static_cast<uint32_t>(s * 131u + j) * 2654435761u + 1u;
+            gunner.cooldown = config.reloadSeconds * nextRandom(gunner.seed);
+            gunners.push_back(gunner);
+        }
+    }
+    gunnerTargets.assign(gunners.size(), -1);
+    decidedStep.resize(wingmen.size() + gunners.size());
+    std::fill(decidedStep.begin() + static_cast<std::ptrdiff_t>(wingmen.size()), decidedStep.end(), steps);
+    for (WingmanDecision& decision : wingmanDecisions)
+        decision.ship = -1;
+    cursor = decidedStep.empty() ? 0 : cursor % decidedStep.size();
+}
+
+void RaidAi::translate(glm::vec3 offset)
+{
+    formation.translate(offset);
+    leaderBody.position += offset;
+    for (RaidShip& ship : ships)
+        ship.position += offset;
+    for (Gunner& gunner : gunners)
+        gunner.position += offset;
+    for (Shell& shell : shells)
+        shell.burst += offset;
+    for (std::size_t i = 0; i < bombArrays.size(); i++)
+    {
+        bombArrays.posX[i] += offset.x;
+        bombArrays.posY[i] += offset.y;
+        bombArrays.posZ[i] += offset.z;
+    }
+}
+
+// step
+// ---------------------------------------------------------------------------------------------
+void RaidAi::step(const FlightBody& leader, float dt)
+{
+    auto start = std::chrono::steady_clock::now();
+    steps++;
+    clock += dt;
+    leaderBody = leader;
+    stepEvents.clear();
+
+    for (std::size_t i = 0; i < wingmen.size(); i++)
+        steerWingman(i, dt);
+    formation.step(config.flight, dt);
+
+    auto hashStart = std::chrono::steady_clock::now();
+    updateHash();
+    raidStats.hashMs = elapsedMs(hashStart);
+
+    decide();
+    fireFlak(dt);
+    stepBombs(dt);
+
+    raidStats.flying = 0;
+    for (const Wingman& wingman : wingmen)
+        raidStats.flying += wingman.health > 0 ? 1 : 0;
+    raidStats.gunners = gunners.size();
+    raidStats.stepMs = elapsedMs(start);
+}
+
+void RaidAi::steerWingman(std::size_t index, float dt)
+{
+    Wingman& wingman = wingmen[index];
+    FlightBody body = formation.body(index);
+    FlightControls controls;
+
+    if (wingman.health <= 0)
+    {
+        // spiral into the sea, then a replacement joins from behind the formation
+        if (body.position.y > config.seaLevel)
+        {
+            controls.pitch = flightPitch(body.orientation) < 60.0f ? 1.0f : 0.0f;
+            controls.turn = 0.3f;
+        }
+        else if ((wingman.downTime += dt) >= config.respawnSeconds)
+        {
+            FlightBody fresh = leaderBody;
+            fresh.position = formationSlot(index, leaderBody) - flightForward(leaderBody.orientation) * 600.0f;
+            fresh.roll = 0.0f;
+            formation.setBody(index, fresh);
+            wingman = Wingman{ config.wingmanHealth, config.rearmSeconds, 0.0f };
+        }
+        formation.setControls(index, controls);
+        return;
+    }
+
+    wingman.rearm = std::max(wingman.rearm - dt, 0.0f);
+    const WingmanDecision& decision = wingmanDecisions[index];
+    glm::vec3 velocity = flightForward(body.orientation) * body.speed;
+    glm::vec3 goal;
+    float goalSpeed;
+    bool steady = false;
+    if (wingman.rearm <= 0.0f && decision.ship >= 0 && static_cast<std::size_t>(decision.ship) < ships.size())
+    {
+        // head for the point a bomb let go from falls onto the ship, at bombing height, and let
+        // go once the bomb would come down on the deck
+        const RaidShip& ship = ships[static_cast<std::size_t>(decision.ship)];
+        float drop = body.position.y - (ship.position.y + ship.halfSize.y);
+        float fall = fallTime(drop, velocity.y, config.gravity);
+        glm::vec3 flat(velocity.x, 0.0f, velocity.z);
+        goal = ship.position - flat * fall;
+        goal.y = ship.position.y + config.bombingAltitude;
+        goalSpeed = config.flight.avgSpeed;
+        steady = glm::length(goal - body.position) < 1000.0f;
+
+        glm::vec3 impact = turnY(body.position + flat * fall - ship.position, -ship.heading);
+        if (drop > 0.0f && std::abs(impact.x) < ship.halfSize.x && std::abs(impact.z) < ship.halfSize.z)
+        {
+            bombArrays.spawn(body.position - glm::vec3(0.0f, 2.0f, 0.0f), velocity);
+            wingman.rearm = config.rearmSeconds;
+            raidStats.bombs++;
+        }
+    }
+    else
+    {
+        // chase a point ahead of the slot and close the gap along the leader's track
+        glm::vec3 slot = formationSlot(index, leaderBody);
+        glm::vec3 leaderForward = flightForward(leaderBody.orientation);
+        goal = slot + leaderForward * 150.0f;
+        goalSpeed = leaderBody.speed + glm::clamp(glm::dot(slot - body.position, leaderForward) * 0.1f, -15.0f, 15.0f);
+    }
+    goal += decision.avoid;
+    float weave = decision.threats > 0 && !steady ? 25.0f * std::sin(clock * 1.3f + static_cast<float>(index)) : 0.0f;
+
+    glm::vec3 toGoal = goal - body.position;
+    float across = std::sqrt(toGoal.x * toGoal.x + toGoal.z * toGoal.z);
+    float heading = glm::degrees(std::atan2(-toGoal.x, -toGoal.z)) + weave;
+    float pitch = glm::clamp(-glm::degrees(std::atan2(toGoal.y, std::max(across, 1.0f))), -25.0f, 25.0f);
+    controls.turn = glm::clamp(wrapDegrees(heading - flightHeading(body.orientation)) / 20.0f, -1.0f, 1.0f);
+    controls.pitch = glm::clamp((pitch - flightPitch(body.orientation)) / 10.0f, -1.0f, 1.0f);
+    controls.throttle = glm::clamp((goalSpeed - body.speed) / 5.0f, -1.0f, 1.0f);
+    formation.setControls(index, controls);
+}
+
+void RaidAi::updateHash()
+{
+    const std::size_t count = wingmen.size() + 1 + ships.size() + gunners.size();
+    pointX.resize(count);
+    pointY.resize(count);
+    pointZ.resize(count);
+    pointMask.resize(count);
+    aircraftVelocity.resize(wingmen.size() + 1);
+
+    auto setPoint = [this](std::size_t point, glm::vec3 position, uint32_t mask) {
+        pointX[point] = position.x;
+        pointY[point] = position.y;
+        pointZ[point] = position.z;
+        pointMask[point] = mask;
+    };
+    for (std::size_t i = 0; i < wingmen.size(); i++)
+    {
+        FlightBody body = formation.body(i);
+        setPoint(i, body.position, wingmen[i].health > 0 ? RAID_WINGMAN : 0u);
+        aircraftVelocity[i] = flightForward(body.orientation) * body.speed;
+    }
+    setPoint(leaderPoint(), leaderBody.position, RAID_LEADER);
+    aircraftVelocity[leaderPoint()] = flightForward(leaderBody.orientation) * leaderBody.speed;
+    for (std::size_t s = 0; s < ships.size(); s++)
+        setPoint(shipPoint(s), ships[s].position, RAID_SHIP);
+    for (std::size_t g = 0; g < gunners.size(); g++)
+        setPoint(gunnerPoint(g), gunners[g].position, RAID_GUNNER);
+    spatialHash.update(count, pointX.data(), pointY.data(), pointZ.data(), pointMask.data());
+}
+
+// decisions
+// ---------------------------------------------------------------------------------------------
+// runs of chunk * threads agents, round robin from where the last step stopped, until the budget
+// is spent. the job body only captures this, so handing it to the pool does not allocate
+void RaidAi::decide()
+{
+    const std::size_t agents = wingmen.size() + gunners.size();
+    raidStats.decided = 0;
+    if (agents == 0)
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    const std::size_t chunk = std::max<std::size_t>(config.decisionChunk, 1);
+    const std::size_t run = chunk * (jobs ? jobs->workerCount() + 1 : 1);
+    const std::function<void(std::size_t, std::size_t)> body = [this](std::size_t begin, std::size_t end) {
+        const std::size_t agents = wingmen.size() + gunners.size();
+        for (std::size_t i = begin; i < end; i++)
+            decideAgent((sliceFirst + i) % agents);
+    };
+
+    std::size_t done = 0;
+    std::size_t wingmenDone = 0;
+    while (done < agents)
+    {
+        std::size_t count = config.decisionBudgetMs > 0.0 ? std::min(agents - done, run) : agents - done;
+        sliceFirst = cursor;
+        if (jobs && count > chunk)
+            jobs->parallelFor(count, chunk, body);
+        else
+            body(0, count);
+
+        // wingmen are agents [0, wingmen.size()); the run may wrap past the last gunner
+        std::size_t end = cursor + count;
+        wingmenDone += std::min(end, wingmen.size()) - std::min(cursor, wingmen.size());
+        if (end > agents)
+            wingmenDone += std::min(end - agents, wingmen.size());
+        cursor = end % agents;
+        done += count;
+        if (config.decisionBudgetMs > 0.0 && elapsedMs(start) >= config.decisionBudgetMs)
+            break;
+    }
+
+    uint64_t oldest = 0;
+    for (uint64_t decided : decidedStep)
+        oldest = std::max(oldest, steps - decided);
+    raidStats.decided = done;
+    raidStats.oldestDecision = static_cast<uint32_t>(oldest);
+    raidStats.decisions += done;
+    raidStats.queries += wingmenDone * 3 + (done - wingmenDone);
+    raidStats.decisionMs = elapsedMs(start);
+}
+
+void RaidAi::decideAgent(std::size_t agent)
+{
+    decidedStep[agent] = steps;
+    if (agent >= wingmen.size())
+    {
+        std::size_t g = agent - wingmen.size();
+        uint32_t target = 0;
+        bool found = spatialHash.nearest(gunners[g].position, 1, config.gunRange, RAID_WINGMAN | RAID_LEADER, ~0u, &target, nullptr) > 0;
+        gunnerTargets[g] = found ? static_cast<int32_t>(target) : -1;
+        return;
+    }
+
+    WingmanDecision decision = { -1, glm::vec3(0.0f), 0u };
+    const uint32_t point = static_cast<uint32_t>(agent);
+    if (spatialHash.mask(point) & RAID_WINGMAN)
+    {
+        glm::vec3 position = spatialHash.position(point);
+        uint32_t neighbours[4];
+        float distances[4];
+        std::size_t count = spatialHash.nearest(position, 4, config.separation, RAID_WINGMAN | RAID_LEADER, point, neighbours, distances);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            float distance = std::sqrt(distances[i]);
+            if (distance > 1e-3f)
+                decision.avoid += (position - spatialHash.position(neighbours[i])) * ((config.separation - distance) / distance);
+        }
+        decision.threats = static_cast<uint32_t>(spatialHash.radius(position, config.threatRange, RAID_GUNNER, nullptr, 0));
+        uint32_t ship = 0;
+        if (wingmen[agent].rearm <= 0.0f && spatialHash.nearest(position, 1, config.attackRange, RAID_SHIP, ~0u, &ship, nullptr) > 0)
+            decision.ship = static_cast<int32_t>(ship - shipPoint(0));
+    }
+    wingmanDecisions[agent] = decision;
+}
+
+// flak and bombs
+// ---------------------------------------------------------------------------------------------
+void RaidAi::fireFlak(float dt)
+{
+    for (std::size_t g = 0; g < gunners.size(); g++)
+    {
+        Gunner& gunner = gunners[g];
+        gunner.cooldown -= dt;
+        int32_t target = gunnerTargets[g];
+        if (gunner.cooldown > 0.0f || target < 0 || !(spatialHash.mask(static_cast<uint32_t>(target)) & (RAID_WINGMAN | RAID_LEADER)))
+            continue;
+        glm::vec3 position = spatialHash.position(static_cast<uint32_t>(target));
+        float range = glm::length(position - gunner.position);
+        if (range > config.gunRange)
+            continue;
+
+        // lead the target by the shell's flight time, refined once for the longer path
+        glm::vec3 velocity = aircraftVelocity[static_cast<std::size_t>(target)];
+        float fuse = range / config.shellSpeed;
+        fuse = glm::length(position + velocity * fuse - gunner.position) / config.shellSpeed;
+        float spread = config.aimError * range;
+        glm::vec3 error(nextRandom(gunner.seed) - 0.5f, nextRandom(gunner.seed) - 0.5f, nextRandom(gunner.seed) - 0.5f);
+        shells.push_back(Shell{ position + velocity * fuse + error * (2.0f * spread), fuse });
+        gunner.cooldown = config.reloadSeconds * (0.75f + 0.5f * nextRandom(gunner.seed));
+        raidStats.shots++;
+    }
+
+    for (std::size_t i = shells.size(); i-- > 0;)
+    {
+        shells[i].fuse -= dt;
+        if (shells[i].fuse > 0.0f)
+            continue;
+        glm::vec3 burst = shells[i].burst;
+        stepEvents.push_back(RaidEvent{ RAID_FLAK_BURST, burst });
+        uint32_t hit[16];
+        std::size_t count = std::min<std::size_t>(spatialHash.radius(burst, config.burstRadius, RAID_WINGMAN, hit, 16), 16);
+        for (std::size_t h = 0; h < count; h++)
+        {
+            Wingman& wingman = wingmen[hit[h]];
+            if (wingman.health > 0 && --wingman.health == 0)
+            {
+                wingman.downTime = 0.0f;
+                stepEvents.push_back(RaidEvent{ RAID_WINGMAN_DOWN, spatialHash.position(hit[h]) });
+                raidStats.losses++;
+            }
+        }
+        shells[i] = shells.back();
+        shells.pop_back();
+    }
+}
+
+// bombs fall with the raid ballistics kernel and are swept against the hulls near them, in each
+// hull's own frame so the box test stays axis aligned
+void RaidAi::stepBombs(float dt)
+{
+    const std::size_t count = bombArrays.size();
+    if (count == 0)
+        return;
+    previous.resize(count * 3);
+    std::memcpy(previous.data(), bombArrays.posX, count * sizeof(float));
+    std::memcpy(previous.data() + count, bombArrays.posY, count * sizeof(float));
+    std::memcpy(previous.data() + 2 * count, bombArrays.posZ, count * sizeof(float));
+    integrateBallistics(bombArrays, config.gravity, dt, kernel);
+
+    bool anyDead = false;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        glm::vec3 start(previous[i], previous[count + i], previous[2 * count + i]);
+        glm::vec3 end = bombArrays.position(i);
+        bool hit = false;
+        uint32_t near[8];
+        std::size_t candidates = ships.empty() ? 0 : spatialHash.radius(end, shipReach + glm::length(end - start) + config.bombHitRadius, RAID_SHIP, near, 8);
+        for (std::size_t c = 0; c < std::min<std::size_t>(candidates, 8) && !hit; c++)
+        {
+            const RaidShip& ship = ships[near[c] - shipPoint(0)];
+            float timeOfImpact = 0.0f;
+            if (sweepSphereBox(turnY(start - ship.position, -ship.heading), turnY(end - ship.position, -ship.heading), config.bombHitRadius,
+                               glm::vec3(0.0f), ship.halfSize, timeOfImpact))
+            {
+                stepEvents.push_back(RaidEvent{ RAID_BOMB_HIT, start + (end - start) * timeOfImpact });
+                raidStats.shipHits++;
+                hit = true;
+            }
+        }
+        if (!hit && end.y < config.seaLevel)
+            stepEvents.push_back(RaidEvent{ RAID_BOMB_SPLASH, glm::vec3(end.x, config.seaLevel, end.z) });
+        if (hit || end.y < config.seaLevel)
+        {
+            bombArrays.kill(i);
+            anyDead = true;
+        }
+    }
+    if (anyDead)
+        bombArrays.removeDead();
+}
@@ -0,0 +1,202 @@
+#ifndef RAID_AI_H
+#define RAID_AI_H
+
+#include "flight_model.h"
+#include "job_system.h"
+#include "raid_world.h"
+#include "simd.h"
+#include "spatial_hash.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// query groups of the raid's agents in the spatial hash
+const uint32_t RAID_WINGMAN = 1u;
+const uint32_t RAID_LEADER = 2u;
+const uint32_t RAID_SHIP = 4u;
+const uint32_t RAID_GUNNER = 8u;
+
+struct RaidSettings
+{
+    FlightParams flight; // the wingmen's aircraft type
+    float cellSize = 500.0f;
+    float gravity = -9.81f;
+    float seaLevel = 0.0f;
+    float bombHitRadius = 0.3f;
+
+    // wingmen fly a V behind the leader, break off to bomb any ship within attackRange while armed
+    // and weave while a gunner is within threatRange (except on the last kilometre of a bombing run)
+    float formationSpacing = 35.0f;
+    float separation = 25.0f;
+    float attackRange = 2500.0f;
+    float threatRange = 900.0f;
+    float bombingAltitude = 400.0f;
+    float rearmSeconds = 20.0f;
+    int wingmanHealth = 3;         // flak hits it takes
+    float respawnSeconds = 30.0f;  // after going down, a replacement joins from behind
+
+    // every ship carries gunnersPerShip flak guns; a shell bursts where it aimed the target to be,
+    // off by aimError metres per metre of range
+    int gunnersPerShip = 8;
+    float gunRange = 2000.0f;
+    float shellSpeed = 700.0f;
+    float reloadSeconds = 3.0f;
+    float aimError = 0.05f;
+    float burstRadius = 12.0f;
+
+    // decisions (the spatial queries) in chunks of decisionChunk agents on the job system, until
+    // decisionBudgetMs has passed; the agents left over go first next step. 0 decides for every
+    // agent every step, which keeps a run deterministic
+    double decisionBudgetMs = 1.0;
+    std::size_t decisionChunk = 128;
+};
+
+// a ship the gunners man: centre, heading about y in radians (as StreamedShip) and hull box
+struct RaidShip
+{
+    glm::vec3 position;
+    float heading;
+    glm::vec3 halfSize;
+};
+
+enum RaidEventType
+{
+    RAID_FLAK_BURST,
+    RAID_BOMB_HIT,
+    RAID_BOMB_SPLASH,
+    RAID_WINGMAN_DOWN
+};
+
+// something the last step did that the effects should show
+struct RaidEvent
+{
+    RaidEventType type;
+    glm::vec3 position;
+};
+
+struct RaidStats
+{
+    std::size_t flying = 0;     // wingmen not down
+    std::size_t gunners = 0;
+    std::size_t decided = 0;    // agents that decided in the last step
+    uint32_t oldestDecision = 0; // steps since the agent that has waited longest decided
+    double decisionMs = 0.0;
+    double hashMs = 0.0;
+    double stepMs = 0.0;
+    uint64_t decisions = 0;
+    uint64_t queries = 0;
+    uint64_t shots = 0;
+    uint64_t bombs = 0;
+    uint64_t shipHits = 0;
+    uint64_t losses = 0;
+};
+
+// AI wingmen and ship flak gunners. every step the wingmen fly on their latest decision, all
+// positions go into the spatial hash in one incremental update, then as many agents as the budget
+// allows decide again from fresh queries: a wingman looks for its nearest neighbours (to keep
+// apart), gunners in reach (threat) and the nearest ship (target); a gunner for the nearest
+// aircraft. a decision only writes the agent's own slot, so decisions run in parallel; firing,
+// shell bursts and bombs then run on the calling thread from those decisions.
+class RaidAi
+{
+public:
+    // decisions run on jobs, or all on the calling thread when it is null
+    explicit RaidAi(JobSystem* jobs, const RaidSettings& settings = RaidSettings());
+
+    // sizes every array, so steps with up to this many of each do not allocate
+    void reserve(std::size_t wingmen, std::size_t ships, std::size_t bombs);
+    // count more wingmen, placed in the formation slots behind the leader
+    void addWingmen(std::size_t count, const FlightBody& leader);
+    // the ships the gunners stand on; gunners are recreated and wingmen drop their targets
+    void setShips(const RaidShip* ships, std::size_t count);
+    void step(const FlightBody& leader, float dt);
+    // moves everything, e.g. when the world origin is rebased
+    void translate(glm::vec3 offset);
+
+    std::size_t wingmanCount() const { return wingmen.size(); }
+    FlightBody wingman(std::size_t index) const { return formation.body(index); }
+    // hit and falling, or gone into the sea until respawnSeconds have passed
+    bool wingmanDown(std::size_t index) const { return wingmen[index].health <= 0; }
+    std::size_t gunnerCount() const { return gunners.size(); }
+    glm::vec3 gunnerPosition(std::size_t index) const { return gunners[index].position; }
+    // the gunner's aircraft as a hash point (wingman index, or wingmanCount() for the leader), -1 for none
+    int32_t gunnerTarget(std::size_t index) const { return gunnerTargets[index]; }
+    const EntityArrays& bombs() const { return bombArrays; }
+    const std::vector<RaidEvent>& events() const { return stepEvents; }
+    const SpatialHash& hash() const { return spatialHash; }
+    const RaidStats& stats() const { return raidStats; }
+    const RaidSettings& settings() const { return config; }
+
+private:
+    struct Wingman
+    {
+        int health;
+        float rearm;    // seconds until it may attack again
+        float downTime; // seconds since it went into the sea
+    };
+    struct WingmanDecision
+    {
+        int32_t ship;     // ship to bomb, -1 to hold formation
+        glm::vec3 avoid;  // away from neighbours that are too close, in metres
+        uint32_t threats; // gunners in reach
+    };
+    struct Gunner
+    {
+        uint32_t ship;
+        glm::vec3 position;
+        float cooldown;
+        uint32_t seed;
+    };
+    struct Shell
+    {
+        glm::vec3 burst;
+        float fuse;
+    };
+
+    JobSystem* jobs;
+    RaidSettings config;
+    SimdKernel kernel;
+    SpatialHash spatialHash;
+    FlightFormation formation;
+    FlightBody leaderBody;
+    std::vector<Wingman> wingmen;
+    std::vector<WingmanDecision> wingmanDecisions;
+    std::vector<RaidShip> ships;
+    float shipReach = 0.0f; // the largest hull half diagonal
+    std::vector<Gunner> gunners;
+    std::vector<int32_t> gunnerTargets;
+    std::vector<Shell> shells;
+    EntityArrays bombArrays;
+    std::vector<float> previous;
+    std::vector<RaidEvent> stepEvents;
+
+    // hash points: wingmen, the leader, ships, gunners
+    std::vector<float> pointX, pointY, pointZ;
+    std::vector<uint32_t> pointMask;
+    std::vector<glm::vec3> aircraftVelocity; // wingmen then the leader, for the gunners' lead
+
+    // time slicing: the next agent to decide (wingmen first, then gunners) and when each last did
+    std::vector<uint64_t> decidedStep;
+    std::size_t cursor = 0;
+    std::size_t sliceFirst = 0;
+    uint64_t steps = 0;
+    float clock = 0.0f;
+    RaidStats raidStats;
+
+    uint32_t leaderPoint() const { return static_cast<uint32_t>(wingmen.size()); }
+    uint32_t shipPoint(std::size_t ship) const { return static_cast<uint32_t>(wingmen.size() + 1 + ship); }
+    uint32_t gunnerPoint(std::size_t gunner) const { return static_cast<uint32_t>(wingmen.size() + 1 + ships.size() + gunner); }
+    glm::vec3 formationSlot(std::size_t index, const FlightBody& leader) const;
+
+    void steerWingman(std::size_t index, float dt);
+    void updateHash();
+    void decide();
+    void decideAgent(std::size_t agent);
+    void fireFlak(float dt);
+    void stepBombs(float dt);
+};
+
+#endif
@@ -0,0 +1,159 @@
+#include "raid_world.h"
+
+#include <algorithm>
+#include <cstring>
+
+// live slots are processed in whole blocks of 8; the padding past size() is kept dead
+static std::size_t paddedCount(std::size_t count)
+{
+    return (count + 7) & ~static_cast<std::size_t>(7);
+}
+
+void EntityArrays::reserve(std::size_t capacity)
+{
+    capacity = paddedCount(capacity);
+    if (capacity <= allocated)
+        return;
+
+    float** arrays[] = { &posX, &posY, &posZ, &velX, &velY, &velZ, &alive };
+    for (float** array : arrays)
+    {
+        float* grown = allocateFloats(capacity);
+        std::fill(grown, grown + capacity, 0.0f);
+        if (*array)
+        {
+            std::memcpy(grown, *array, count * sizeof(float));
+            freeFloats(*array);
+        }
+        *array = grown;
+    }
+    allocated = capacity;
+}
+
+std::size_t EntityArrays::spawn(glm::vec3 position, glm::vec3 velocity)
+{
+    if (count == allocated)
+        reserve(std::max<std::size_t>(64, allocated * 2));
+
+    std::size_t index = count++;
+    posX[index] = position.x;
+    posY[index] = position.y;
+    posZ[index] = position.z;
+    velX[index] = velocity.x;
+    velY[index] = velocity.y;
+    velZ[index] = velocity.z;
+    alive[index] = 1.0f;
+    return index;
+}
+
+void EntityArrays::removeDead()
+{
+    std::size_t i = 0;
+    while (i < count)
+    {
+        if (alive[i] != 0.0f)
+        {
+            i++;
+            continue;
+        }
+        std::size_t last = --count;
+        posX[i] = posX[last];
+        posY[i] = posY[last];
+        posZ[i] = posZ[last];
+        velX[i] = velX[last];
+        velY[i] = velY[last];
+        velZ[i] = velZ[last];
+        alive[i] = alive[last];
+        alive[last] = 0.0f;
+    }
+}
+
+void EntityArrays::clear()
+{
+    if (alive)
+        std::fill(alive, alive + paddedCount(count), 0.0f);
+    count = 0;
+}
+
+void EntityArrays::release()
+{
+    float** arrays[] = { &posX, &posY, &posZ, &velX, &velY, &velZ, &alive };
+    for (float** array : arrays)
+    {
+        if (*array)
+            freeFloats(*array);
+        *array = nullptr;
+    }
+    count = allocated = 0;
+}
+
+// all three kernels use the same operation order (no FMA) so they produce identical results
+static void integrateScalar(EntityArrays& e, std::size_t n, float gravity, float dt)
+{
+    for (std::size_t i = 0; i < n; i++)
+    {
+        float step = dt * e.alive[i];
+        e.velY[i] += gravity * step;
+        e.posX[i] += e.velX[i] * step;
+        e.posY[i] += e.velY[i] * step;
+        e.posZ[i] += e.velZ[i] * step;
+    }
+}
+
+#ifdef SIMD_SSE2
+static void integrateSse(EntityArrays& e, std::size_t n, float gravity, float dt)
+{
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 vgravity = _mm_set1_ps(gravity);
+    for (std::size_t i = 0; i < n; i += 4)
+    {
+        __m128 step = _mm_mul_ps(vdt, _mm_load_ps(e.alive + i));
+        __m128 vy = _mm_add_ps(_mm_load_ps(e.velY + i), _mm_mul_ps(vgravity, step));
+        _mm_store_ps(e.velY + i, vy);
+        _mm_store_ps(e.posX + i, _mm_add_ps(_mm_load_ps(e.posX + i), _mm_mul_ps(_mm_load_ps(e.velX + i), step)));
+        _mm_store_ps(e.posY + i, _mm_add_ps(_mm_load_ps(e.posY + i), _mm_mul_ps(vy, step)));
+        _mm_store_ps(e.posZ + i, _mm_add_ps(_mm_load_ps(e.posZ + i), _mm_mul_ps(_mm_load_ps(e.velZ + i), step)));
+    }
+}
+
+SIMD_TARGET_AVX2 static void integrateAvx2(EntityArrays& e, std::size_t n, float gravity, float dt)
+{
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 vgravity = _mm256_set1_ps(gravity);
+    for (std::size_t i = 0; i < n; i += 8)
+    {
+        __m256 step = _mm256_mul_ps(vdt, _mm256_load_ps(e.alive + i));
+        __m256 vy = _mm256_add_ps(_mm256_load_ps(e.velY + i), _mm256_mul_ps(vgravity, step));
+        _mm256_store_ps(e.velY + i, vy);
+        _mm256_store_ps(e.posX + i, _mm256_add_ps(_mm256_load_ps(e.posX + i), _mm256_mul_ps(_mm256_load_ps(e.velX + i), step)));
+        _mm256_store_ps(e.posY + i, _mm256_add_ps(_mm256_load_ps(e.posY + i), _mm256_mul_ps(vy, step)));
+        _mm256_store_ps(e.posZ + i, _mm256_add_ps(_mm256_load_ps(e.posZ + i), _mm256_mul_ps(_mm256_load_ps(e.velZ + i), step)));
+    }
+}
+#endif
+
+void integrateBallistics(EntityArrays& entities, float gravity, float dt, SimdKernel kernel)
+{
+    std::size_t n = paddedCount(entities.size());
+    if (n == 0)
+        return;
+
+    switch (kernel)
+    {
+#ifdef SIMD_SSE2
+    case KERNEL_AVX2:
+        if (cpuHasAvx2())
+        {
+            integrateAvx2(entities, n, gravity, dt);
+            return;
+        }
+        // fall through
+    case KERNEL_SSE:
+        integrateSse(entities, n, gravity, dt);
+        return;
+#endif
+    default:
+        integrateScalar(entities, n, gravity, dt);
+        return;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef RAID_WORLD_H
+#define RAID_WORLD_H
+
+#include "simd.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// structure-of-arrays storage for many bombs or aircraft. alive is a 1.0f/0.0f mask so the
+// kernels can freeze dead slots with a multiply instead of a branch.
+class EntityArrays
+{
+public:
+    float* posX = nullptr;
+    float* posY = nullptr;
+    float* posZ = nullptr;
+    float* velX = nullptr;
+    float* velY = nullptr;
+    float* velZ = nullptr;
+    float* alive = nullptr;
+
+    EntityArrays() {}
+    explicit EntityArrays(std::size_t capacity) { reserve(capacity); }
+    ~EntityArrays() { release(); }
+    EntityArrays(const EntityArrays&) = delete;
+    EntityArrays& operator=(const EntityArrays&) = delete;
+
+    std::size_t size() const { return count; }
+    std::size_t capacity() const { return allocated; }
+
+    // grows every array to hold at least capacity entities (rounded up to a whole AVX block)
+    void reserve(std::size_t capacity);
+    // appends an entity and returns its slot
+    std::size_t spawn(glm::vec3 position, glm::vec3 velocity);
+    void kill(std::size_t index) { alive[index] = 0.0f; }
+    // swap-removes dead slots so the live ones stay packed at the front
+    void removeDead();
+    // drops every entity; their slots go dead like the ones removeDead vacates
+    void clear();
+
+    glm::vec3 position(std::size_t index) const { return glm::vec3(posX[index], posY[index], posZ[index]); }
+    glm::vec3 velocity(std::size_t index) const { return glm::vec3(velX[index], velY[index], velZ[index]); }
+
+private:
+    std::size_t count = 0;
+    std::size_t allocated = 0;
+
+    void release();
+};
+
+// the render loop's Euler step (velocity.y += gravity * dt; position += velocity * dt) over every live slot
+void integrateBallistics(EntityArrays& entities, float gravity, float dt, SimdKernel kernel);
+
+// every bomb and aircraft of a large raid scenario
+struct RaidWorld
+{
+    EntityArrays bombs;
+    EntityArrays planes;
+    float gravity = -9.81f;
+
+    // bombs fall under gravity, aircraft hold their velocity
+    void step(float dt, SimdKernel kernel)
+    {
+        integrateBallistics(bombs, gravity, dt, kernel);
+        integrateBallistics(planes, 0.0f, dt, kernel);
+    }
+};
+
+#endif
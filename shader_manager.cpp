@@ -0,0 +1,446 @@
+#include "shader_manager.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// GL 4.1 / ARB_get_program_binary, loaded by hand because glad is generated for 3.3
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint, GLenum, const void*, GLsizei);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint, GLenum, GLint);
+static GetProgramBinaryProc getProgramBinary = nullptr;
+static ProgramBinaryProc programBinary = nullptr;
+static ProgramParameteriProc programParameteri = nullptr;
+
+// bump whenever the layout of the header changes
+static const uint32_t SHADER_CACHE_VERSION = 1;
+static const char SHADER_CACHE_MAGIC[4] = { 'D', 'B', 'S', 'P' };
+
+struct ShaderCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t hash;
+    uint32_t format;
+    uint32_t length;
+};
+
+static bool readText(const std::string& path, std::string& text)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    std::stringstream stream;
+    stream << in.rdbuf();
+    text = stream.str();
+    return true;
+}
+
+// FNV-1a over both sources and the driver: a binary is only valid for the GL that produced it
+static uint64_t programHash(const std::string& vertexSource, const std::string& fragmentSource)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const char* bytes, std::size_t size) {
+        for (std::size_t i = 0; i < size; i++)
+            hash = (hash ^ static_cast<unsigned char>(bytes[i])) * 1099511628211ull;
+        hash = (hash ^ 0xff) * 1099511628211ull; // separator, so "ab"+"c" differs from "a"+"bc"
+    };
+    mix(vertexSource.data(), vertexSource.size());
+    mix(fragmentSource.data(), fragmentSource.size());
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+    {
+        const char* text = reinterpret_cast<const char*>(glGetString(name));
+        if (text)
+            mix(text, std::strlen(text));
+    }
+    return hash;
+}
+
+// same checks and messages as learnopengl's Shader::checkCompileErrors
+static bool compileSucceeded(unsigned int shader, const char* type, const std::string& path)
+{
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        char infoLog[1024];
+        glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+        std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << " (" << path << ")\n" << infoLog
+                  << "\n -- --------------------------------------------------- -- " << std::endl;
+    }
+    return success != 0;
+}
+
+static bool linkSucceeded(unsigned int program, bool report)
+{
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success && report)
+    {
+        char infoLog[1024];
+        glGetProgramInfoLog(program, 1024, NULL, infoLog);
+        std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: PROGRAM\n" << infoLog
+                  << "\n -- --------------------------------------------------- -- " << std::endl;
+    }
+    return success != 0;
+}
+
+// shader program
+// ---------------------------------------------------------------------------------------------
+// the program last bound through use(); glUseProgram is skipped when it would change nothing
+static unsigned int currentProgram = 0;
+
+void ShaderProgram::use() const
+{
+    if (ID != currentProgram)
+    {
+        glUseProgram(ID);
+        currentProgram = ID;
+    }
+}
+
+int ShaderProgram::uniformId(const char* name)
+{
+    for (std::size_t i = 0; i < uniformNames.size(); i++)
+        if (uniformNames[i] == name)
+            return static_cast<int>(i);
+    for (std::size_t i = 0; i < uniformStrings.size(); i++)
+        if (uniformStrings[i] == name)
+            return static_cast<int>(i);
+    uniformNames.push_back(name);
+    uniformStrings.push_back(name);
+    locations.push_back(ID ? glGetUniformLocation(ID, name) : -1);
+    return static_cast<int>(locations.size() - 1);
+}
+
+void ShaderProgram::refreshLocations()
+{
+    for (std::size_t i = 0; i < uniformStrings.size(); i++)
+        locations[i] = ID ? glGetUniformLocation(ID, uniformStrings[i].c_str()) : -1;
+}
+
+void ShaderProgram::setInt(int uniform, int value) const
+{
+    glUniform1i(locations[uniform], value);
+}
+
+void ShaderProgram::setFloat(int uniform, float value) const
+{
+    glUniform1f(locations[uniform], value);
+}
+
+void ShaderProgram::setVec3(int uniform, const glm::vec3& value) const
+{
+    glUniform3fv(locations[uniform], 1, &value[0]);
+}
+
+void ShaderProgram::setMat4(int uniform, const glm::mat4& value) const
+{
+    glUniformMatrix4fv(locations[uniform], 1, GL_FALSE, &value[0][0]);
+}
+
+// shader manager
+// ---------------------------------------------------------------------------------------------
+ShaderManager::~ShaderManager()
+{
+    stopping = true;
+    if (watcher.joinable())
+        watcher.join();
+}
+
+void ShaderManager::enableBinaryCache(void* (*procAddress)(const char*))
+{
+    getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(procAddress("glGetProgramBinary"));
+    programBinary = reinterpret_cast<ProgramBinaryProc>(procAddress("glProgramBinary"));
+    programParameteri = reinterpret_cast<ProgramParameteriProc>(procAddress("glProgramParameteri"));
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    binaryCache = getProgramBinary && programBinary && programParameteri && formats > 0;
+}
+
+unsigned int ShaderManager::build(const ShaderProgram& program, const std::string& vertexSource, const std::string& fragmentSource)
+{
+    uint64_t hash = programHash(vertexSource, fragmentSource);
+    std::string cachePath = program.vertexPath + ".dbsp";
+
+    // a binary linked by this driver from exactly these sources
+    if (binaryCache)
+    {
+        std::string bytes;
+        ShaderCacheHeader header;
+        if (readText(cachePath, bytes) && bytes.size() >= sizeof(header))
+        {
+            std::memcpy(&header, bytes.data(), sizeof(header));
+            if (std::memcmp(header.magic, SHADER_CACHE_MAGIC, 4) == 0 && header.version == SHADER_CACHE_VERSION &&
+                header.hash == hash && bytes.size() == sizeof(header) + header.length)
+            {
+                unsigned int id = glCreateProgram();
+                programBinary(id, header.format, bytes.data() + sizeof(header), static_cast<GLsizei>(header.length));
+                // the driver may still refuse it (updated since), then it is rebuilt from source
+                if (linkSucceeded(id, false))
+                {
+                    cacheHits++;
+                    return id;
+                }
+                glDeleteProgram(id);
+            }
+        }
+    }
+
+    const char* vertexCode = vertexSource.c_str();
+    const char* fragmentCode = fragmentSource.c_str();
+    unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex, 1, &vertexCode, NULL);
+    glCompileShader(vertex);
+    unsigned int fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment, 1, &fragmentCode, NULL);
+    glCompileShader(fragment);
+    bool compiledBoth = compileSucceeded(vertex, "VERTEX", program.vertexPath);
+    compiledBoth = compileSucceeded(fragment, "FRAGMENT", program.fragmentPath) && compiledBoth;
+
+    unsigned int id = 0;
+    if (compiledBoth)
+    {
+        id = glCreateProgram();
+        glAttachShader(id, vertex);
+        glAttachShader(id, fragment);
+        if (binaryCache)
+            programParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(id);
+        if (!linkSucceeded(id, true))
+        {
+            glDeleteProgram(id);
+            id = 0;
+        }
+    }
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    if (!id)
+        return 0;
+    compiled++;
+
+    if (binaryCache)
+    {
+        GLint length = 0;
+        glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+        ShaderCacheHeader header;
+        std::memcpy(header.magic, SHADER_CACHE_MAGIC, 4);
+        header.version = SHADER_CACHE_VERSION;
+        header.hash = hash;
+        header.format = 0;
+        header.length = 0;
+        std::vector<char> binary(length > 0 ? length : 0);
+        GLsizei written = 0;
+        GLenum format = 0;
+        if (length > 0)
+            getProgramBinary(id, length, &written, &format, binary.data());
+        header.format = format;
+        header.length = static_cast<uint32_t>(written);
+
+        // same temporary file and rename as the model cache
+        std::string temporaryPath = cachePath + ".tmp";
+        bool saved = false;
+        if (written > 0)
+        {
+            std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(binary.data(), written);
+            saved = static_cast<bool>(out);
+        }
+        std::error_code error;
+        if (saved)
+            std::filesystem::rename(temporaryPath, cachePath, error);
+        if (!saved || error)
+            std::cout << "Failed to write shader cache: " << cachePath << std::endl;
+    }
+    return id;
+}
+
+ShaderProgram& ShaderManager::add(const char* vertexPath, const char* fragmentPath)
+{
+    programs.push_back(std::unique_ptr<ShaderProgram>(new ShaderProgram()));
+    ShaderProgram& program = *programs.back();
+    program.vertexPath = vertexPath;
+    program.fragmentPath = fragmentPath;
+
+    std::string vertexSource, fragmentSource;
+    if (!readText(program.vertexPath, vertexSource) || !readText(program.fragmentPath, fragmentSource))
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << vertexPath << ", " << fragmentPath << std::endl;
+    else
+        program.ID = build(program, vertexSource, fragmentSource);
+    applyBlockBindings(program);
+    return program;
+}
+
+void ShaderManager::bindUniformBlock(const char* name, unsigned int binding)
+{
+    blockBindings.push_back({ name, binding });
+    for (const auto& program : programs)
+        applyBlockBindings(*program);
+}
+
+void ShaderManager::applyBlockBindings(const ShaderProgram& program) const
+{
+    if (!program.ID)
+        return;
+    for (const auto& block : blockBindings)
+    {
+        unsigned int index = glGetUniformBlockIndex(program.ID, block.first.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program.ID, index, block.second);
+    }
+}
+
+int ShaderManager::poll()
+{
+    std::vector<Pending> reloads;
+    {
+        std::lock_guard<std::mutex> lock(pendingLock);
+        reloads.swap(pending);
+    }
+    if (reloads.empty())
+        return 0;
+
+    PROFILE_SCOPE("shader reload");
+    for (const Pending& reload : reloads)
+    {
+        ShaderProgram& program = *programs[reload.program];
+        unsigned int id = build(program, reload.vertexSource, reload.fragmentSource);
+        if (!id)
+        {
+            std::cout << "Shader reload failed, keeping the previous " << program.vertexPath << " + " << program.fragmentPath << std::endl;
+            continue;
+        }
+        // nothing of this frame has been drawn yet, so every draw from here on uses the new program
+        if (currentProgram == program.ID)
+            currentProgram = 0;
+        glDeleteProgram(program.ID);
+        program.ID = id;
+        program.refreshLocations();
+        applyBlockBindings(program);
+        std::cout << "Reloaded " << program.vertexPath << " + " << program.fragmentPath << std::endl;
+    }
+    return static_cast<int>(reloads.size());
+}
+
+// runs on the watcher thread: the file reads stay off the render thread
+void ShaderManager::queueReload(std::size_t index)
+{
+    Pending reload;
+    reload.program = index;
+    if (!readText(programs[index]->vertexPath, reload.vertexSource) || !readText(programs[index]->fragmentPath, reload.fragmentSource))
+        return;
+    std::lock_guard<std::mutex> lock(pendingLock);
+    for (Pending& queued : pending)
+        if (queued.program == index)
+        {
+            queued = std::move(reload);
+            return;
+        }
+    pending.push_back(std::move(reload));
+}
+
+void ShaderManager::watch()
+{
+    if (!watcher.joinable() && !programs.empty())
+        watcher = std::thread(&ShaderManager::watchLoop, this);
+}
+
+void ShaderManager::watchLoop()
+{
+    namespace fs = std::filesystem;
+    struct WatchedFile
+    {
+        std::string directory;
+        std::string name;
+        std::size_t program;
+        fs::file_time_type time;
+    };
+    std::vector<WatchedFile> files;
+    for (std::size_t p = 0; p < programs.size(); p++)
+        for (const std::string* path : { &programs[p]->vertexPath, &programs[p]->fragmentPath })
+        {
+            fs::path file(*path);
+            std::error_code error;
+            std::string directory = file.parent_path().string();
+            files.push_back({ directory.empty() ? "." : directory, file.filename().string(), p, fs::last_write_time(file, error) });
+        }
+
+#ifdef __linux__
+    // editors often save by writing a new file and renaming it over the old one, so the
+    // directories are watched rather than the files
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd >= 0)
+    {
+        std::vector<std::pair<int, std::string>> watches;
+        for (const WatchedFile& file : files)
+        {
+            bool seen = false;
+            for (const auto& existing : watches)
+                seen = seen || existing.second == file.directory;
+            if (!seen)
+                watches.push_back({ inotify_add_watch(fd, file.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO), file.directory });
+        }
+
+        alignas(inotify_event) char buffer[4096];
+        while (!stopping)
+        {
+            pollfd waiting = { fd, POLLIN, 0 };
+            if (::poll(&waiting, 1, 200) <= 0)
+                continue;
+            ssize_t size = read(fd, buffer, sizeof(buffer));
+            for (ssize_t offset = 0; offset < size; )
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+                if (event->len == 0)
+                    continue;
+                for (const auto& watched : watches)
+                    if (watched.first == event->wd)
+                        for (const WatchedFile& file : files)
+                            if (file.directory == watched.second && file.name == event->name)
+                                queueReload(file.program);
+            }
+        }
+        close(fd);
+        return;
+    }
+#endif
+
+    // no inotify: compare modification times a few times a second
+    while (!stopping)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        for (WatchedFile& file : files)
+        {
+            std::error_code error;
+            fs::file_time_type time = fs::last_write_time(fs::path(file.directory) / file.name, error);
+            if (!error && time != file.time)
+            {
+                file.time = time;
+                queueReload(file.program);
+            }
+        }
+    }
+}
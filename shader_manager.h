@@ -0,0 +1,102 @@
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// a linked vertex + fragment program owned by a ShaderManager. ID changes when the program is
+// reloaded, so hold on to the ShaderProgram, not the ID. uniforms are addressed by a small id from
+// uniformId(), whose GL location is looked up once per link instead of by name on every set.
+class ShaderProgram
+{
+public:
+    unsigned int ID = 0;
+
+    // binds the program unless it is already the current one
+    void use() const;
+
+    // registers the name on first use; the pointer is compared before the string, so passing the
+    // same literal every frame costs no string work
+    int uniformId(const char* name);
+
+    void setInt(int uniform, int value) const;
+    void setFloat(int uniform, float value) const;
+    void setVec3(int uniform, const glm::vec3& value) const;
+    void setMat4(int uniform, const glm::mat4& value) const;
+
+private:
+    friend class ShaderManager;
+
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<const char*> uniformNames;
+    std::vector<std::string> uniformStrings;
+    std::vector<int> locations;
+
+    void refreshLocations();
+};
+
+// compiles the game's programs, caches the linked binaries next to the vertex shader
+// (1.model_loading_instanced.vs.dbsp) keyed by a hash of both sources and the driver, and reloads
+// a program when one of its files changes. a watcher thread (inotify on Linux, timestamps
+// elsewhere) notices the edit and reads the new sources; the compile and the swap happen in poll()
+// on the render thread, between frames. a program that fails to build keeps its previous version.
+class ShaderManager
+{
+public:
+    ShaderManager() {}
+    ~ShaderManager();
+    ShaderManager(const ShaderManager&) = delete;
+    ShaderManager& operator=(const ShaderManager&) = delete;
+
+    // turns the binary cache on when the driver can hand out program binaries. procAddress is the
+    // context's GL loader (glad's 3.3 loader does not include the 4.1 binary entry points)
+    void enableBinaryCache(void* (*procAddress)(const char*));
+
+    // builds the program now (from the cache when it is current); the reference stays valid
+    ShaderProgram& add(const char* vertexPath, const char* fragmentPath);
+    // attaches the uniform block of that name to a buffer binding point in every program that has
+    // it, now and after every reload
+    void bindUniformBlock(const char* name, unsigned int binding);
+
+    // starts watching every added program's files
+    void watch();
+    // call once per frame before drawing: rebuilds and swaps programs whose files changed; returns
+    // how many were rebuilt (failed builds included)
+    int poll();
+
+    // programs built from source / from the binary cache since startup
+    uint32_t compiled = 0;
+    uint32_t cacheHits = 0;
+
+private:
+    struct Pending
+    {
+        std::size_t program;
+        std::string vertexSource;
+        std::string fragmentSource;
+    };
+
+    std::vector<std::unique_ptr<ShaderProgram>> programs;
+    std::vector<std::pair<std::string, unsigned int>> blockBindings;
+    bool binaryCache = false;
+
+    std::thread watcher;
+    std::atomic<bool> stopping{ false };
+    std::mutex pendingLock;
+    std::vector<Pending> pending;
+
+    unsigned int build(const ShaderProgram& program, const std::string& vertexSource, const std::string& fragmentSource);
+    void applyBlockBindings(const ShaderProgram& program) const;
+    void watchLoop();
+    void queueReload(std::size_t program);
+};
+
+#endif
@@ -0,0 +1,195 @@
+#include "shadow_cascades.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+ShadowLevel shadowLevel(ShadowQuality quality)
+{
+    switch (quality)
+    {
+    case SHADOWS_LOW:
+        return ShadowLevel{ 2, 1024 };
+    case SHADOWS_MEDIUM:
+        return ShadowLevel{ 3, 1536 };
+    case SHADOWS_HIGH:
+        return ShadowLevel{ 4, 2048 };
+    default:
+        return ShadowLevel{ 0, 0 };
+    }
+}
+
+const char* shadowQualityName(ShadowQuality quality)
+{
+    static const char* names[] = { "off", "low", "medium", "high" };
+    return names[quality];
+}
+
+bool parseShadowQuality(const char* name, ShadowQuality& quality)
+{
+    for (int q = SHADOWS_OFF; q <= SHADOWS_HIGH; q++)
+    {
+        if (std::strcmp(name, shadowQualityName(static_cast<ShadowQuality>(q))) == 0)
+        {
+            quality = static_cast<ShadowQuality>(q);
+            return true;
+        }
+    }
+    return false;
+}
+
+// splits
+// ---------------------------------------------------------------------------------------------
+void cascadeSplits(float nearPlane, float farPlane, int count, float lambda, float* splits)
+{
+    for (int i = 1; i <= count; i++)
+    {
+        float fraction = static_cast<float>(i) / static_cast<float>(count);
+        float logarithmic = nearPlane * std::pow(farPlane / nearPlane, fraction);
+        float uniform = nearPlane + (farPlane - nearPlane) * fraction;
+        splits[i - 1] = lambda * logarithmic + (1.0f - lambda) * uniform;
+    }
+    if (count > 0)
+        splits[count - 1] = farPlane;
+}
+
+// cascades
+// ---------------------------------------------------------------------------------------------
+void fitCascades(const glm::mat4& view, float fovY, float aspect, float nearPlane, const float* splits, int count,
+                 glm::vec3 toSun, int resolution, float casterReach, ShadowCascade* cascades)
+{
+    glm::mat4 cameraWorld = glm::inverse(view);
+    glm::vec3 eye(cameraWorld[3]);
+    glm::vec3 forward = -glm::normalize(glm::vec3(cameraWorld[2]));
+    // squared distance of a frustum corner from the view axis, per unit of depth squared
+    float tanHalf = std::tan(fovY * 0.5f);
+    float corner2 = tanHalf * tanHalf * (1.0f + aspect * aspect);
+
+    // the light's orientation alone: snapping happens in its xy plane
+    glm::vec3 up = std::fabs(toSun.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), -toSun, up);
+    glm::mat4 inverseRotation = glm::transpose(lightRotation);
+
+    for (int c = 0; c < count; c++)
+    {
+        float n = c == 0 ? nearPlane : splits[c - 1];
+        float f = splits[c];
+        // the smallest sphere through the slice's eight corners has its centre on the view axis;
+        // long thin slices are bounded by their far face instead
+        float centerDepth = std::min(0.5f * (n + f) * (1.0f + corner2), f);
+        float radius = std::sqrt(std::max((centerDepth - n) * (centerDepth - n) + n * n * corner2,
+                                          (f - centerDepth) * (f - centerDepth) + f * f * corner2));
+        // rounded up, so float noise in the camera matrix cannot change the texel size
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+        // a texel of margin on each side for the snapping below
+        float texel = 2.0f * radius / static_cast<float>(resolution - 2);
+        float halfSize = radius + texel;
+
+        glm::vec3 center = eye + forward * centerDepth;
+        glm::vec3 lightCenter(lightRotation * glm::vec4(center, 1.0f));
+        lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+        lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+        center = glm::vec3(inverseRotation * glm::vec4(lightCenter, 1.0f));
+
+        float back = radius + casterReach;
+        glm::mat4 lightView = glm::lookAt(center + toSun * back, center, up);
+        glm::mat4 lightProjection = glm::ortho(-halfSize, halfSize, -halfSize, halfSize, 0.0f, back + radius);
+
+        ShadowCascade& cascade = cascades[c];
+        cascade.viewProjection = lightProjection * lightView;
+        cascade.frustum = extractFrustum(cascade.viewProjection);
+        cascade.splitNear = n;
+        cascade.splitFar = f;
+        cascade.texelSize = texel;
+    }
+}
+
+// caster culling
+// ---------------------------------------------------------------------------------------------
+void ShadowCasterCuller::setCascades(const ShadowCascade* fitted, int cascadeCount)
+{
+    count = std::min(cascadeCount, SHADOW_MAX_CASCADES);
+    for (int c = 0; c < count; c++)
+        cascades[c] = fitted[c];
+    stats = ShadowCullStats();
+}
+
+int ShadowCasterCuller::select(glm::vec3 boundsMin, glm::vec3 boundsMax, const float* lodError, uint32_t lodLevels, const glm::mat4& matrix,
+                               int* levels)
+{
+    stats.tested++;
+    glm::vec3 worldMin, worldMax;
+    transformBounds(matrix, boundsMin, boundsMax, worldMin, worldMax);
+    // errors are in model units; the largest axis scale turns them into world units
+    float scale = std::max(glm::length(glm::vec3(matrix[0])), std::max(glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))));
+    float radius = 0.5f * glm::length(worldMax - worldMin);
+
+    int drawnTo = 0;
+    for (int c = 0; c < count; c++)
+    {
+        const ShadowCascade& cascade = cascades[c];
+        levels[c] = -1;
+        if (!boxInFrustum(cascade.frustum, worldMin, worldMax))
+        {
+            stats.outsideCascade++;
+            continue;
+        }
+        if (radius < minRadiusTexels * cascade.texelSize)
+        {
+            stats.tooSmall++;
+            continue;
+        }
+        // an orthographic map has the same texel size everywhere, so the level holds for the whole caster
+        int level = 0;
+        for (uint32_t l = 1; l < lodLevels && l < CULL_MAX_LODS; l++)
+            if (lodError[l] * scale <= maxErrorTexels * cascade.texelSize)
+                level = static_cast<int>(l);
+        levels[c] = level;
+        stats.drawn[c]++;
+        drawnTo++;
+    }
+    return drawnTo;
+}
+
+// budget
+// ---------------------------------------------------------------------------------------------
+ShadowBudget::ShadowBudget(double budgetMs, ShadowQuality start, ShadowQuality highest)
+    : budget(budgetMs), current(std::min(start, highest)), highest(highest)
+{
+    for (int& age : measuredAge)
+        age = MEMORY_WINDOWS;
+}
+
+ShadowQuality ShadowBudget::update(double passMs)
+{
+    windowSum += passMs;
+    if (++windowFrames < WINDOW_FRAMES)
+        return current;
+
+    lastAverage = windowSum / windowFrames;
+    windowSum = 0.0;
+    windowFrames = 0;
+    for (int& age : measuredAge)
+        age = std::min(age + 1, static_cast<int>(MEMORY_WINDOWS));
+    measured[current] = lastAverage;
+    measuredAge[current] = 0;
+
+    ShadowQuality next = current;
+    if (lastAverage > budget && current > SHADOWS_OFF)
+        next = static_cast<ShadowQuality>(current - 1);
+    else if (lastAverage < 0.5 * budget && current < highest)
+    {
+        ShadowQuality up = static_cast<ShadowQuality>(current + 1);
+        // a level that was just too slow stays off until its measurement is old
+        if (measuredAge[up] >= MEMORY_WINDOWS || measured[up] <= budget)
+            next = up;
+    }
+    if (next != current)
+    {
+        current = next;
+        changeCount++;
+    }
+    return current;
+}
@@ -0,0 +1,120 @@
+#ifndef SHADOW_CASCADES_H
+#define SHADOW_CASCADES_H
+
+#include "culling.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// CPU side of the sun's cascaded shadow maps: where the view frustum is split, the light matrix that
+// covers each slice, which casters each cascade has to draw (and at which level of detail), and the
+// quality a time budget allows. nothing in here needs GL, so all of it runs in --bench shadows.
+
+const int SHADOW_MAX_CASCADES = 4;
+
+// towards the sun of the ocean skybox (ocean.fs lit the water from here before there was a Lighting block)
+const glm::vec3 SUN_DIRECTION = glm::normalize(glm::vec3(-0.4f, 0.8f, -0.45f));
+
+enum ShadowQuality
+{
+    SHADOWS_OFF,
+    SHADOWS_LOW,
+    SHADOWS_MEDIUM,
+    SHADOWS_HIGH
+};
+
+// what a quality costs: cascades over the view distance and the side of each cascade's map
+struct ShadowLevel
+{
+    int cascades;
+    int resolution;
+};
+
+ShadowLevel shadowLevel(ShadowQuality quality);
+const char* shadowQualityName(ShadowQuality quality);
+// "off", "low", "medium" or "high"; false for anything else
+bool parseShadowQuality(const char* name, ShadowQuality& quality);
+
+// view depths where count cascades between near and far end: lambda 0 splits evenly, 1 logarithmically
+// (equal texel density per depth), in between blends the two. splits[count - 1] is far
+void cascadeSplits(float nearPlane, float farPlane, int count, float lambda, float* splits);
+
+struct ShadowCascade
+{
+    glm::mat4 viewProjection; // world to the cascade's clip space
+    Frustum frustum;          // the same box as planes, for caster culling
+    float splitNear;          // view depths of the slice it covers
+    float splitFar;
+    float texelSize;          // world size of one shadow map texel
+};
+
+// one cascade per slice between consecutive splits (the first from nearPlane). each slice is bounded
+// by a sphere, so the cascade's size does not change as the camera turns, and the light's origin moves
+// in whole texels, so the map does not shimmer as the camera moves. casterReach is how far towards the
+// sun beyond the slice a caster may be and still be drawn
+void fitCascades(const glm::mat4& view, float fovY, float aspect, float nearPlane, const float* splits, int count,
+                 glm::vec3 toSun, int resolution, float casterReach, ShadowCascade* cascades);
+
+struct ShadowCullStats
+{
+    uint64_t tested = 0;        // casters tried, once for all cascades
+    uint64_t outsideCascade = 0; // per cascade a caster is not drawn to
+    uint64_t tooSmall = 0;
+    uint64_t drawn[SHADOW_MAX_CASCADES] = {};
+};
+
+// picks the casters of each cascade: a caster outside the cascade's box or smaller than a texel or so
+// is left out, the rest get the coarsest level of detail whose error is still under a texel
+class ShadowCasterCuller
+{
+public:
+    float maxErrorTexels = 1.0f;
+    float minRadiusTexels = 0.5f;
+
+    ShadowCascade cascades[SHADOW_MAX_CASCADES];
+    int count = 0;
+    ShadowCullStats stats;
+
+    // once per frame; clears the stats
+    void setCascades(const ShadowCascade* fitted, int cascadeCount);
+    // levels[c] is the level to draw the caster with into cascade c, -1 where it is not drawn.
+    // returns the number of cascades it is drawn to
+    int select(glm::vec3 boundsMin, glm::vec3 boundsMax, const float* lodError, uint32_t lodLevels, const glm::mat4& matrix,
+               int* levels);
+};
+
+// picks the quality that fits a time budget for the shadow pass (CPU and GPU time together). the
+// cost is averaged over a window of frames: a window over budget steps one quality down; a window
+// well under it steps up, unless the next quality up went over budget in the last few windows
+class ShadowBudget
+{
+public:
+    static const int WINDOW_FRAMES = 30;
+    // windows a measured cost is remembered, before the level is tried again
+    static const int MEMORY_WINDOWS = 20;
+
+    ShadowBudget(double budgetMs, ShadowQuality start, ShadowQuality highest = SHADOWS_HIGH);
+
+    // the last frame's pass cost; returns the quality for the next frame
+    ShadowQuality update(double passMs);
+    ShadowQuality quality() const { return current; }
+    double budgetMs() const { return budget; }
+    // average over the last full window
+    double averageMs() const { return lastAverage; }
+    int changes() const { return changeCount; }
+
+private:
+    double budget;
+    ShadowQuality current;
+    ShadowQuality highest;
+    double windowSum = 0.0;
+    int windowFrames = 0;
+    double lastAverage = 0.0;
+    int changeCount = 0;
+    // the last average measured at each quality and how many windows ago
+    double measured[SHADOWS_HIGH + 1] = {};
+    int measuredAge[SHADOWS_HIGH + 1] = {};
+};
+
+#endif
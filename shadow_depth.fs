@@ -0,0 +1,6 @@
+#version 330 core
+
+// depth only: the framebuffer has no colour attachment
+void main()
+{
+}
@@ -0,0 +1,11 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 7) in mat4 aInstanceModel; // per instance, locations 7..10
+
+// world to the cascade being drawn
+uniform mat4 lightSpace;
+
+void main()
+{
+    gl_Position = lightSpace * aInstanceModel * vec4(aPos, 1.0);
+}
@@ -0,0 +1,147 @@
+#include "shadow_renderer.h"
+#include "shader_manager.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+// late afternoon sun over the ocean skybox, and the blue of its sky
+static const glm::vec4 SUN_COLOR(1.0f, 0.95f, 0.85f, 1.0f);
+static const glm::vec4 AMBIENT_COLOR(0.35f, 0.42f, 0.50f, 1.0f);
+
+void ShadowRenderer::configure(ShadowLevel level)
+{
+    if (level.cascades == current.cascades && level.resolution == current.resolution)
+        return;
+    current = level;
+    int layers = std::max(level.cascades, 1);
+    int size = level.cascades > 0 ? level.resolution : 1;
+
+    if (!depthTexture)
+        glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, layers, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    // hardware comparison with bilinear filtering: every tap of the shaders' PCF is itself 2x2
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    // outside a cascade is lit
+    const float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+// pass
+// ---------------------------------------------------------------------------------------------
+void ShadowRenderer::begin()
+{
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &savedFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+
+    // the query about to be reused went out GPU_TIMER_FRAMES passes ago; a late result is dropped rather than waited for
+    if (!queries[0])
+        glGenQueries(GpuTimers::GPU_TIMER_FRAMES, queries);
+    unsigned int query = queries[currentQuery];
+    if (queryIssued[currentQuery])
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            lastGpuMs = elapsed / 1.0e6;
+        }
+    }
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    queryIssued[currentQuery] = true;
+
+    // made here, where the caller's framebuffer is saved: offscreen there is no framebuffer 0 to go back to
+    if (!framebuffer)
+    {
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, current.resolution, current.resolution);
+    // slope scaled offset against acne; casters nearer the sun than the light's near plane are
+    // flattened onto it instead of clipped
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    glEnable(GL_DEPTH_CLAMP);
+}
+
+void ShadowRenderer::beginCascade(ShaderProgram& depthShader, int lightSpace, int cascade, const glm::mat4& viewProjection)
+{
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0, cascade);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    depthShader.use();
+    depthShader.setMat4(lightSpace, viewProjection);
+}
+
+void ShadowRenderer::end()
+{
+    glDisable(GL_DEPTH_CLAMP);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<unsigned int>(savedFramebuffer));
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    glEndQuery(GL_TIME_ELAPSED);
+    currentQuery = (currentQuery + 1) % GpuTimers::GPU_TIMER_FRAMES;
+}
+
+// lighting
+// ---------------------------------------------------------------------------------------------
+void ShadowRenderer::updateLighting(const ShadowCascade* cascades, int count)
+{
+    LightingUniforms lighting;
+    for (int c = 0; c < SHADOW_MAX_CASCADES; c++)
+    {
+        lighting.lightSpace[c] = c < count ? cascades[c].viewProjection : glm::mat4(1.0f);
+        lighting.cascadeFar[c] = c < count ? cascades[c].splitFar : 0.0f;
+        lighting.cascadeTexel[c] = c < count ? cascades[c].texelSize : 0.0f;
+    }
+    lighting.sunDirection = glm::vec4(SUN_DIRECTION, static_cast<float>(count));
+    lighting.sunColor = SUN_COLOR;
+    lighting.ambientColor = AMBIENT_COLOR;
+
+    if (!uniformBuffer)
+    {
+        glGenBuffers(1, &uniformBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(LightingUniforms), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTING_UNIFORM_BINDING, uniformBuffer);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightingUniforms), &lighting);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    if (!depthTexture)
+        configure(ShadowLevel{ 0, 0 });
+    glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void ShadowRenderer::release()
+{
+    if (depthTexture)
+        glDeleteTextures(1, &depthTexture);
+    if (framebuffer)
+        glDeleteFramebuffers(1, &framebuffer);
+    if (uniformBuffer)
+        glDeleteBuffers(1, &uniformBuffer);
+    if (queries[0])
+        glDeleteQueries(GpuTimers::GPU_TIMER_FRAMES, queries);
+    depthTexture = framebuffer = uniformBuffer = 0;
+    for (int i = 0; i < GpuTimers::GPU_TIMER_FRAMES; i++)
+    {
+        queries[i] = 0;
+        queryIssued[i] = false;
+    }
+    current = ShadowLevel{ -1, 0 };
+}
@@ -0,0 +1,70 @@
+#ifndef SHADOW_RENDERER_H
+#define SHADOW_RENDERER_H
+
+#include "shadow_cascades.h"
+#include "gpu_timers.h"
+
+#include <glm/glm.hpp>
+
+class ShaderProgram;
+
+// the sun and its shadows as every lit shader reads them, the std140 block
+//
+//     layout (std140) uniform Lighting { mat4 lightSpace[4]; vec4 cascadeFar; vec4 cascadeTexel;
+//                                        vec4 sunDirection; vec4 sunColor; vec4 ambientColor; };
+//
+// bound to LIGHTING_UNIFORM_BINDING; the cascades are layers of the sampler2DArrayShadow on
+// SHADOW_TEXTURE_UNIT, above the units the model textures take.
+
+const unsigned int LIGHTING_UNIFORM_BINDING = 1;
+const int SHADOW_TEXTURE_UNIT = 8;
+
+struct LightingUniforms
+{
+    glm::mat4 lightSpace[SHADOW_MAX_CASCADES];
+    glm::vec4 cascadeFar;   // view depth where each cascade ends
+    glm::vec4 cascadeTexel; // world size of a texel of each cascade
+    glm::vec4 sunDirection; // towards the sun; w = cascades in use, 0 for no shadows
+    glm::vec4 sunColor;
+    glm::vec4 ambientColor; // from the sky; the shaders darken it for surfaces facing down
+};
+static_assert(sizeof(LightingUniforms) == 336, "LightingUniforms must match the std140 Lighting block");
+
+// renders the cascades into one depth texture array through one framebuffer object, each layer a
+// depth-only pass with polygon offset, and writes the Lighting block. the pass carries its own
+// GL_TIME_ELAPSED query, read back frames later like GpuTimers, so the shadow budget has a GPU time
+// even with the profiler off.
+class ShadowRenderer
+{
+public:
+    // (re)allocates the depth array when the level changes. with no cascades a 1x1 layer keeps the
+    // sampler complete
+    void configure(ShadowLevel level);
+    ShadowLevel level() const { return current; }
+
+    // around the whole pass: saves and restores the bound framebuffer and viewport
+    void begin();
+    // clears cascade's layer and renders into it; lightSpace is the uniform of the depth program
+    void beginCascade(ShaderProgram& depthShader, int lightSpace, int cascade, const glm::mat4& viewProjection);
+    void end();
+
+    // once per frame, after the cascades are fitted (count 0 lights without shadows); binds the map
+    void updateLighting(const ShadowCascade* cascades, int count);
+    void release();
+
+    // GPU time of the newest pass whose query has come back
+    double lastGpuMs = 0.0;
+
+private:
+    ShadowLevel current = ShadowLevel{ -1, 0 };
+    unsigned int depthTexture = 0;
+    unsigned int framebuffer = 0;
+    unsigned int uniformBuffer = 0;
+    unsigned int queries[GpuTimers::GPU_TIMER_FRAMES] = {};
+    bool queryIssued[GpuTimers::GPU_TIMER_FRAMES] = {};
+    int currentQuery = 0;
+    int savedFramebuffer = 0;
+    int savedViewport[4] = {};
+};
+
+#endif
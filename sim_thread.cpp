@@ -0,0 +1,156 @@
+#include "sim_thread.h"
+#include "profiler.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+bool stepSimFrame(SimFrame& frame, const InputTick& tick, float dt)
+{
+    applyMouseLook(frame.cameraYawOffset, frame.cameraPitchOffset, tick.mouseX, tick.mouseY);
+    if (tick.scroll != 0.0f)
+        frame.zoom = std::min(std::max(frame.zoom - tick.scroll, 1.0f), 45.0f);
+    frame.thirdPerson = (tick.keys & INPUT_THIRD_PERSON) != 0;
+
+    bool hit = stepSimulation(frame.state, unpackSimInput(tick.keys), dt);
+    frame.tick++;
+    if (hit)
+        std::cout << "Hit Target!" << std::endl;
+    return hit;
+}
+
+SimFrame interpolateSimFrame(const SimFrame& previous, const SimFrame& current, float alpha)
+{
+    SimFrame frame = current;
+    SimState& state = frame.state;
+    // the current tick may have moved the origin; blend from the previous tick seen from the new origin
+    SimState from = previous.state;
+    if (from.originTileX != current.state.originTileX || from.originTileZ != current.state.originTileZ)
+        shiftOrigin(from, current.state.originTileX - from.originTileX, current.state.originTileZ - from.originTileZ);
+    state.plane.position = glm::mix(from.plane.position, current.state.plane.position, alpha);
+    state.plane.orientation = glm::slerp(from.plane.orientation, current.state.plane.orientation, alpha);
+    state.plane.roll = glm::mix(from.plane.roll, current.state.plane.roll, alpha);
+    // a bomb that was just released or reloaded jumps, it is not blended across the jump
+    if (from.bombAttached == current.state.bombAttached)
+        state.bombPosition = glm::mix(from.bombPosition, current.state.bombPosition, alpha);
+    frame.cameraYawOffset = glm::mix(previous.cameraYawOffset, current.cameraYawOffset, alpha);
+    frame.cameraPitchOffset = glm::mix(previous.cameraPitchOffset, current.cameraPitchOffset, alpha);
+    frame.zoom = glm::mix(previous.zoom, current.zoom, alpha);
+    return frame;
+}
+
+static double clockSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// snapshot buffer
+// ---------------------------------------------------------------------------------------------
+void SnapshotBuffer::publish()
+{
+    writeIndex = ready.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & (FRESH - 1);
+}
+
+const SimSnapshot& SnapshotBuffer::latest()
+{
+    if (ready.load(std::memory_order_relaxed) & FRESH)
+        readIndex = ready.exchange(readIndex, std::memory_order_acq_rel) & (FRESH - 1);
+    return slots[readIndex];
+}
+
+// sim thread
+// ---------------------------------------------------------------------------------------------
+void SimThread::start(float stepDt)
+{
+    if (running())
+        return;
+    dt = stepDt;
+    // the starting state, so the first frames have something to draw
+    SimSnapshot& snapshot = snapshots.writeSlot();
+    snapshot.previous = snapshot.current = simFrame;
+    snapshot.time = clockSeconds();
+    snapshots.publish();
+
+    stopping = false;
+    worker = std::thread([this] { run(); });
+}
+
+void SimThread::stop()
+{
+    stopping = true;
+    if (worker.joinable())
+        worker.join();
+}
+
+bool SimThread::step(const InputTick& input, float stepDt)
+{
+    dt = stepDt;
+    return tick(input, stepDt, clockSeconds());
+}
+
+SimFrame SimThread::frameForDrawing()
+{
+    // lockstep: the render thread is the sim thread
+    if (!running())
+        return simFrame;
+    const SimSnapshot& snapshot = snapshots.latest();
+    // drawn one tick behind the sim, blending towards the newest tick as its time passes
+    float alpha = static_cast<float>((clockSeconds() - snapshot.time) / dt);
+    return interpolateSimFrame(snapshot.previous, snapshot.current, std::min(std::max(alpha, 0.0f), 1.0f));
+}
+
+bool SimThread::tick(const InputTick& input, float stepDt, double time)
+{
+    PROFILE_SCOPE("sim tick");
+    simFrame.state.shipMesh = shipMesh.load(std::memory_order_acquire);
+    SimSnapshot& snapshot = snapshots.writeSlot();
+    snapshot.previous = simFrame;
+    bool hit = stepSimFrame(simFrame, input, stepDt);
+    snapshot.current = simFrame;
+    snapshot.time = time;
+    snapshots.publish();
+    ticks.fetch_add(1, std::memory_order_relaxed);
+    return hit;
+}
+
+void SimThread::run()
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(dt));
+    Clock::time_point next = Clock::now();
+    double nextSeconds = clockSeconds();
+    InputTick held;
+    while (!stopping.load(std::memory_order_acquire))
+    {
+        // keys seen in any frame since the last tick count, so a tap shorter than a tick is not lost;
+        // mouse and wheel movement adds up until a tick consumes it
+        InputTick input;
+        uint16_t keys = 0;
+        bool fresh = false;
+        while (inputs.pop(input))
+        {
+            keys |= input.keys;
+            fresh = true;
+            held.mouseX += input.mouseX;
+            held.mouseY += input.mouseY;
+            held.scroll += input.scroll;
+        }
+        if (fresh)
+            held.keys = keys;
+        tick(held, dt, nextSeconds);
+        held.mouseX = held.mouseY = held.scroll = 0.0f;
+
+        next += period;
+        nextSeconds += dt;
+        // after a long stall (debugger, window drag) skip ahead instead of fast-forwarding through it
+        Clock::time_point now = Clock::now();
+        if (now - next > period * 8)
+        {
+            next = now;
+            nextSeconds = clockSeconds();
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
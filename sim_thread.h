@@ -0,0 +1,110 @@
+#ifndef SIM_THREAD_H
+#define SIM_THREAD_H
+
+#include "input_recording.h"
+#include "simulation.h"
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+struct MeshCollider;
+
+// everything one sim tick produces: the sim itself plus the camera state the input drives
+struct SimFrame
+{
+    SimState state;
+    float cameraYawOffset = 0.0f;
+    float cameraPitchOffset = 0.0f;
+    float zoom = 45.0f; // first person field of view, changed by the wheel like Camera::ProcessMouseScroll
+    bool thirdPerson = false;
+    uint64_t tick = 0;
+};
+
+// one tick of live, recorded or replayed input: mouse look, zoom, camera choice and the sim step.
+// returns true on the tick the bomb hits the ship.
+bool stepSimFrame(SimFrame& frame, const InputTick& tick, float dt);
+
+// the state between two ticks for drawing: positions and the flight frame blended by alpha (0 =
+// previous, 1 = current), everything else from the current tick
+SimFrame interpolateSimFrame(const SimFrame& previous, const SimFrame& current, float alpha);
+
+// what the render thread reads: the last two ticks and when the current one was due
+struct SimSnapshot
+{
+    SimFrame previous;
+    SimFrame current;
+    double time = 0.0; // appTime() of the current tick
+};
+
+// lock-free triple buffer: the writer always owns one slot, the reader another, and the third holds
+// the newest finished snapshot. publishing and taking are a single atomic exchange each, so neither
+// side ever waits for the other and the reader always gets the newest complete tick.
+class SnapshotBuffer
+{
+public:
+    SimSnapshot& writeSlot() { return slots[writeIndex]; }
+    void publish();
+    // swaps in the newest snapshot when there is one; the returned reference stays valid until the next call
+    const SimSnapshot& latest();
+
+private:
+    static const unsigned int FRESH = 4;
+
+    SimSnapshot slots[3];
+    std::atomic<unsigned int> ready{ 1 };
+    unsigned int writeIndex = 0;
+    unsigned int readIndex = 2;
+};
+
+// runs the simulation at a fixed timestep on its own thread so stepping overlaps with drawing and
+// the swap. input goes in through a single-producer queue filled by the render thread; every tick
+// publishes a snapshot the render thread interpolates between. runs that must be reproducible (record,
+// replay, offscreen) skip start() and call step() from the render loop instead, in lockstep.
+class SimThread
+{
+public:
+    SimThread() {}
+    ~SimThread() { stop(); }
+    SimThread(const SimThread&) = delete;
+    SimThread& operator=(const SimThread&) = delete;
+
+    // the sim's own state; only touch it while the thread is not running
+    SimFrame& frame() { return simFrame; }
+
+    void start(float dt);
+    void stop();
+    bool running() const { return worker.joinable(); }
+    float tickSeconds() const { return dt; }
+
+    // render thread: input sampled this frame; false when the sim has fallen that far behind
+    bool pushInput(const InputTick& tick) { return inputs.push(tick); }
+    // render thread: the carrier collider once it is built, picked up by the next tick
+    void setShipMesh(const MeshCollider* mesh) { shipMesh.store(mesh, std::memory_order_release); }
+
+    // lockstep: one tick on the calling thread, published like a threaded one
+    bool step(const InputTick& tick, float stepDt);
+
+    // render thread: the newest snapshot
+    const SimSnapshot& latest() { return snapshots.latest(); }
+    // render thread: the state to draw now, interpolated between the last two ticks while threaded
+    SimFrame frameForDrawing();
+
+    // ticks run so far
+    std::atomic<uint64_t> ticks{ 0 };
+
+private:
+    SimFrame simFrame;
+    float dt = 1.0f / 60.0f;
+    std::thread worker;
+    std::atomic<bool> stopping{ false };
+    std::atomic<const MeshCollider*> shipMesh{ nullptr };
+    SpscQueue<InputTick, 256> inputs;
+    SnapshotBuffer snapshots;
+
+    bool tick(const InputTick& input, float stepDt, double time);
+    void run();
+};
+
+#endif
@@ -0,0 +1,53 @@
+#include "simd.h"
+
+#if defined(SIMD_AVX2) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+bool cpuHasAvx2()
+{
+#if !defined(SIMD_AVX2)
+    return false;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && ((_xgetbv(0) & 0x6) == 0x6);
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#else
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#endif
+}
+
+const char* simdKernelName(SimdKernel kernel)
+{
+    switch (kernel)
+    {
+    case KERNEL_SSE: return "sse";
+    case KERNEL_AVX2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+bool simdKernelSupported(SimdKernel kernel)
+{
+    switch (kernel)
+    {
+#ifdef SIMD_SSE2
+    case KERNEL_SSE: return true;
+    case KERNEL_AVX2: return cpuHasAvx2();
+#endif
+    case KERNEL_SCALAR: return true;
+    default: return false;
+    }
+}
+
+SimdKernel bestSimdKernel()
+{
+    if (simdKernelSupported(KERNEL_AVX2))
+        return KERNEL_AVX2;
+    if (simdKernelSupported(KERNEL_SSE))
+        return KERNEL_SSE;
+    return KERNEL_SCALAR;
+}
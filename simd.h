@@ -0,0 +1,47 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstddef>
+#include <new>
+
+// compile-time SSE2 detection plus a target attribute so AVX2 kernels can live next to the
+// baseline ones and be picked at runtime with cpuHasAvx2()
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#define SIMD_AVX2 1
+#endif
+
+// everything vectorized is laid out in 32 byte aligned blocks so AVX loads never split cache lines
+const std::size_t SIMD_ALIGNMENT = 32;
+
+inline float* allocateFloats(std::size_t count)
+{
+    return static_cast<float*>(::operator new(count * sizeof(float), std::align_val_t(SIMD_ALIGNMENT)));
+}
+
+inline void freeFloats(float* data)
+{
+    ::operator delete(data, std::align_val_t(SIMD_ALIGNMENT));
+}
+
+bool cpuHasAvx2();
+
+// which code path a vectorized kernel runs; KERNEL_AVX2 quietly drops to SSE on older CPUs
+enum SimdKernel
+{
+    KERNEL_SCALAR,
+    KERNEL_SSE,
+    KERNEL_AVX2
+};
+
+const char* simdKernelName(SimdKernel kernel);
+bool simdKernelSupported(SimdKernel kernel);
+SimdKernel bestSimdKernel();
+
+#endif
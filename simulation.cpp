@@ -0,0 +1,253 @@
+#include "simulation.h"
+#include "mesh_bvh.h"
+#include "profiler.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+glm::mat4 planeRotationMatrix(const SimState& state)
+{
+    return flightRotationMatrix(state.plane.orientation, state.plane.roll);
+}
+
+glm::mat4 shipModelMatrix(const SimState& state)
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, state.shipPosition);
+    model = glm::scale(model, glm::vec3(state.shipScale));
+    model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0, 1.0, 0.0));
+    return model;
+}
+
+glm::mat4 shipColliderMatrix(const SimState& state)
+{
+    glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(state.shipScale));
+    return glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0, 1.0, 0.0));
+}
+
+void shiftOrigin(SimState& state, int32_t tilesX, int32_t tilesZ)
+{
+    // a whole number of tiles is a multiple of every float spacing below 2^35, so the shift itself is exact
+    glm::vec3 shift(tilesX * WORLD_TILE_SIZE, 0.0f, tilesZ * WORLD_TILE_SIZE);
+    state.plane.position -= shift;
+    state.bombPosition -= shift;
+    state.shipPosition -= shift;
+    state.explosionPosition -= shift;
+    state.originTileX += tilesX;
+    state.originTileZ += tilesZ;
+}
+
+bool stepSimulation(SimState& state, const SimInput& input, float dt)
+{
+    // flight
+    // ------
+    FlightControls controls;
+    controls.pitch = (input.pitchUp ? 1.0f : 0.0f) - (input.pitchDown ? 1.0f : 0.0f);
+    controls.turn = (input.turnLeft ? 1.0f : 0.0f) - (input.turnRight ? 1.0f : 0.0f);
+    controls.throttle = (input.speedUp ? 1.0f : 0.0f) - (input.slowDown ? 1.0f : 0.0f);
+    stepFlight(state.plane, controls, state.flight, dt);
+
+    // bomb controls
+    // -------------
+    if (input.dropBomb && state.bombAttached) {
+        state.bombAttached = false;
+        state.bombReleased = true;
+        state.bombVelocity = flightForward(state.plane.orientation) * state.plane.speed;
+    }
+    if (input.reloadBomb) {
+        state.bombAttached = true;
+        state.bombReleased = false;
+        state.bombVelocity = glm::vec3(0.0f);
+        state.bombHit = false;
+    }
+
+    // bomb
+    // ----
+    glm::vec3 previousBombPosition = state.bombPosition;
+    if (state.bombAttached) {
+        // bomb follows the plane
+        glm::vec3 rotatedBombOffset = glm::vec3(planeRotationMatrix(state) * glm::vec4(state.bombOffsetLocal, 1.0f));
+        state.bombPosition = state.plane.position + rotatedBombOffset;
+        previousBombPosition = state.bombPosition;
+    }
+    else if (state.bombReleased) {
+        // apply gravity and motion
+        state.bombVelocity.y += state.gravity * dt;
+        state.bombPosition += state.bombVelocity * dt;
+    }
+
+    // explosion
+    // ---------
+    if (state.showExplosion) {
+        state.explosionTimer -= dt;
+        if (state.explosionTimer <= 0.0f)
+            state.showExplosion = false;
+    }
+
+    // check bomb collision with ship along the path it travelled this step
+    bool hit = false;
+    float timeOfImpact = 0.0f;
+    if (state.bombReleased && !state.bombHit) {
+        PROFILE_SCOPE("collision");
+        if (sweepSphereBox(previousBombPosition, state.bombPosition, state.bombHitRadius, state.shipPosition, state.shipBoxHalfSize, timeOfImpact)) {
+            hit = true;
+            if (state.shipMesh) {
+                // inside the box: only a bomb that touches the hull itself counts, swept over the same step
+                float meshImpact = 0.0f;
+                if (state.shipMesh->sweptSphereHits(previousBombPosition - state.shipPosition, state.bombPosition - state.shipPosition,
+                                                    state.bombHitRadius, meshImpact))
+                    timeOfImpact = meshImpact;
+                else
+                    hit = false;
+            }
+        }
+        if (hit) {
+            state.bombHit = true;
+            state.hitCount++;
+            state.showExplosion = true;
+            state.explosionTimer = state.explosionDuration;
+            state.explosionPosition = glm::mix(previousBombPosition, state.bombPosition, timeOfImpact);
+        }
+    }
+
+    // floating origin
+    // ---------------
+    if (std::abs(state.plane.position.x) > state.rebaseDistance || std::abs(state.plane.position.z) > state.rebaseDistance)
+    {
+        shiftOrigin(state, static_cast<int32_t>(std::floor(state.plane.position.x / WORLD_TILE_SIZE + 0.5f)),
+                    static_cast<int32_t>(std::floor(state.plane.position.z / WORLD_TILE_SIZE + 0.5f)));
+    }
+
+    return hit;
+}
+
+std::size_t predictBombPath(const SimState& state, float dt, glm::vec3* points, std::size_t maxPoints, glm::vec3& impact, bool& hitsShip)
+{
+    glm::vec3 position = state.bombPosition;
+    glm::vec3 velocity = state.bombVelocity;
+    if (state.bombAttached) {
+        position = state.plane.position + glm::vec3(planeRotationMatrix(state) * glm::vec4(state.bombOffsetLocal, 1.0f));
+        velocity = flightForward(state.plane.orientation) * state.plane.speed;
+    }
+
+    std::size_t count = 0;
+    if (maxPoints > 0)
+        points[count++] = position;
+    hitsShip = false;
+
+    // a point every few steps draws a smooth enough arc; the last slot is kept for the impact
+    const int maxSteps = static_cast<int>(120.0f / dt);
+    const int stride = 4;
+    for (int step = 1; step <= maxSteps && position.y > 0.0f; step++) {
+        glm::vec3 previous = position;
+        velocity.y += state.gravity * dt;
+        position += velocity * dt;
+
+        // the same test as stepSimulation: the box, then the hull when there is one
+        float timeOfImpact = 0.0f;
+        bool hit = sweepSphereBox(previous, position, state.bombHitRadius, state.shipPosition, state.shipBoxHalfSize, timeOfImpact);
+        if (hit && state.shipMesh)
+            hit = state.shipMesh->sweptSphereHits(previous - state.shipPosition, position - state.shipPosition, state.bombHitRadius, timeOfImpact);
+        if (hit) {
+            hitsShip = true;
+            position = glm::mix(previous, position, timeOfImpact);
+            break;
+        }
+        if (position.y <= 0.0f)
+            position = glm::mix(previous, position, previous.y / (previous.y - position.y));
+        else if (step % stride == 0 && count + 1 < maxPoints)
+            points[count++] = position;
+    }
+    impact = position;
+    if (count < maxPoints)
+        points[count++] = impact;
+    return count;
+}
+
+bool checkSphereBoxCollision(glm::vec3 sphereCenter, float sphereRadius, glm::vec3 boxCenter, glm::vec3 boxHalfSize)
+{
+    float x = std::max(boxCenter.x - boxHalfSize.x, std::min(sphereCenter.x, boxCenter.x + boxHalfSize.x));
+    float y = std::max(boxCenter.y - boxHalfSize.y, std::min(sphereCenter.y, boxCenter.y + boxHalfSize.y));
+    float z = std::max(boxCenter.z - boxHalfSize.z, std::min(sphereCenter.z, boxCenter.z + boxHalfSize.z));
+
+    // squared distances, no sqrt needed for the compare
+    float dx = sphereCenter.x - x, dy = sphereCenter.y - y, dz = sphereCenter.z - z;
+
+    return dx * dx + dy * dy + dz * dz < sphereRadius * sphereRadius;
+}
+
+// squared distance from p to the box, the same clamp checkSphereBoxCollision uses
+static float boxDistance2(glm::vec3 p, glm::vec3 boxMin, glm::vec3 boxMax)
+{
+    glm::vec3 d = p - glm::clamp(p, boxMin, boxMax);
+    return glm::dot(d, d);
+}
+
+bool sweepSphereBox(glm::vec3 start, glm::vec3 end, float sphereRadius, glm::vec3 boxCenter, glm::vec3 boxHalfSize, float& timeOfImpact)
+{
+    glm::vec3 boxMin = boxCenter - boxHalfSize;
+    glm::vec3 boxMax = boxCenter + boxHalfSize;
+    float r2 = sphereRadius * sphereRadius;
+
+    if (boxDistance2(start, boxMin, boxMax) < r2) {
+        timeOfImpact = 0.0f;
+        return true;
+    }
+
+    // slab test of the segment against the box grown by the radius
+    glm::vec3 delta = end - start;
+    float tEnter = 0.0f;
+    float tExit = 1.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        float lo = boxMin[axis] - sphereRadius;
+        float hi = boxMax[axis] + sphereRadius;
+        if (std::fabs(delta[axis]) < 1e-12f) {
+            if (start[axis] < lo || start[axis] > hi)
+                return false;
+            continue;
+        }
+        float inv = 1.0f / delta[axis];
+        float t0 = (lo - start[axis]) * inv;
+        float t1 = (hi - start[axis]) * inv;
+        if (t0 > t1) std::swap(t0, t1);
+        tEnter = std::max(tEnter, t0);
+        tExit = std::min(tExit, t1);
+        if (tEnter > tExit)
+            return false;
+    }
+
+    if (boxDistance2(start + delta * tEnter, boxMin, boxMax) < r2) {
+        timeOfImpact = tEnter;
+        return true;
+    }
+
+    // entered through a rounded edge or corner of the grown box. the distance to a convex box
+    // is convex along the segment, so find its minimum and then the first time it drops below r
+    float lo = tEnter, hi = tExit;
+    for (int i = 0; i < 32; i++) {
+        float m1 = lo + (hi - lo) / 3.0f;
+        float m2 = hi - (hi - lo) / 3.0f;
+        if (boxDistance2(start + delta * m1, boxMin, boxMax) < boxDistance2(start + delta * m2, boxMin, boxMax))
+            hi = m2;
+        else
+            lo = m1;
+    }
+    float tClosest = 0.5f * (lo + hi);
+    if (boxDistance2(start + delta * tClosest, boxMin, boxMax) >= r2)
+        return false;
+
+    lo = tEnter;
+    hi = tClosest;
+    for (int i = 0; i < 32; i++) {
+        float mid = 0.5f * (lo + hi);
+        if (boxDistance2(start + delta * mid, boxMin, boxMax) < r2)
+            hi = mid;
+        else
+            lo = mid;
+    }
+    timeOfImpact = hi;
+    return true;
+}
@@ -0,0 +1,101 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "flight_model.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+struct MeshCollider;
+
+// flight, bomb ballistics and hit detection. nothing in here touches GLFW or glad so the
+// same step runs inside the render loop and in the headless batch runner.
+
+// the world is cut into square tiles this wide (x and z); streaming loads it tile by tile and the
+// floating origin moves in whole tiles
+const float WORLD_TILE_SIZE = 2048.0f;
+
+// one tick worth of player intent, filled from the keyboard by processInput (or by a script)
+struct SimInput
+{
+    bool pitchDown = false;  // W
+    bool pitchUp = false;    // S
+    bool turnLeft = false;   // A
+    bool turnRight = false;  // D
+    bool speedUp = false;    // F
+    bool slowDown = false;   // G
+    bool dropBomb = false;   // SPACE
+    bool reloadBomb = false; // R
+};
+
+struct SimState
+{
+    // plane: position, flight frame, bank and airspeed, and the tunables of its type
+    FlightBody plane = { glm::vec3(60.0f, 400.0f, 8000.0f) };
+    FlightParams flight;
+
+    // bomb
+    glm::vec3 bombOffsetLocal = glm::vec3(0.0f, -0.5f, 1.8f);
+    glm::vec3 bombPosition = glm::vec3(0.0f, -0.5f, 1.8f);
+    glm::vec3 bombVelocity = glm::vec3(0.0f);
+    bool bombAttached = true;
+    bool bombReleased = false;
+    float gravity = -9.81f;
+
+    // hit detection
+    int hitCount = 0;
+    bool bombHit = false;
+    float bombHitRadius = 0.3f;
+    // the explosion shows for explosionDuration seconds after a hit
+    bool showExplosion = false;
+    glm::vec3 explosionPosition = glm::vec3(0.0f);
+    float explosionTimer = 0.0f;
+    float explosionDuration = 1.5f;
+
+    // floating origin: every position here is relative to the corner of this tile, so floats keep
+    // their precision however far the plane flies. once the plane is more than rebaseDistance from
+    // it the origin moves to the tile under the plane
+    int32_t originTileX = 0;
+    int32_t originTileZ = 0;
+    float rebaseDistance = 4.0f * WORLD_TILE_SIZE;
+
+    // target. the box is the broadphase; when shipMesh is set a hit must also touch the carrier's
+    // triangles, placed with shipColliderMatrix (relative to shipPosition, so rebasing never moves it)
+    glm::vec3 shipBoxHalfSize = glm::vec3(15.0f, 10.0f, 100.0f);
+    glm::vec3 shipPosition = glm::vec3(0.0f, -5.0f, 0.0f);
+    float shipScale = 60.0f;
+    const MeshCollider* shipMesh = nullptr;
+};
+
+// the plane's flight frame with its bank as a rotation matrix (pitch and roll are inverted to match the model)
+glm::mat4 planeRotationMatrix(const SimState& state);
+
+// model matrix of the carrier
+glm::mat4 shipModelMatrix(const SimState& state);
+// the same without the translation: the carrier collider is queried with positions relative to shipPosition
+glm::mat4 shipColliderMatrix(const SimState& state);
+
+// moves the origin by whole tiles: every position in the state shifts the other way
+void shiftOrigin(SimState& state, int32_t tilesX, int32_t tilesZ);
+
+// advances the plane, the bomb and the hit test by dt seconds; returns true on the tick the bomb hits the ship.
+// the bomb is swept over the whole step so large dt cannot tunnel through the ship. ends by rebasing
+// the origin when the plane is too far from it.
+bool stepSimulation(SimState& state, const SimInput& input, float dt);
+
+// where the bomb will come down: the falling bomb, or one released now when it is still on the
+// plane, stepped with the same Euler step and hit test as stepSimulation until it hits the ship or
+// reaches sea level (y = 0). fills points with the path (at most maxPoints, every few steps) and
+// returns how many; impact is where it stops and hitsShip whether that is on the ship
+std::size_t predictBombPath(const SimState& state, float dt, glm::vec3* points, std::size_t maxPoints, glm::vec3& impact, bool& hitsShip);
+
+bool checkSphereBoxCollision(glm::vec3 sphereCenter, float sphereRadius, glm::vec3 boxCenter, glm::vec3 boxHalfSize);
+
+// swept version for a sphere moving from start to end during one step: the segment is clipped
+// against the box grown by the radius and refined on its rounded edges and corners. on a hit,
+// timeOfImpact is the fraction (0..1) of the segment where the sphere first touches the box.
+bool sweepSphereBox(glm::vec3 start, glm::vec3 end, float sphereRadius, glm::vec3 boxCenter, glm::vec3 boxHalfSize, float& timeOfImpact);
+
+#endif
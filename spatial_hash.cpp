@@ -0,0 +1,333 @@
+#include "spatial_hash.h"
+
+#include <algorithm>
+#include <cmath>
+
+static uint64_t packCell(int32_t cellX, int32_t cellZ)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32) | static_cast<uint32_t>(cellZ);
+}
+
+static int32_t cellXOf(uint64_t key) { return static_cast<int32_t>(static_cast<uint32_t>(key >> 32)); }
+static int32_t cellZOf(uint64_t key) { return static_cast<int32_t>(static_cast<uint32_t>(key)); }
+
+static std::size_t slotOf(uint64_t key, std::size_t slotMask)
+{
+    uint64_t h = key * 0x9E3779B97F4A7C15ull;
+    return static_cast<std::size_t>(h ^ (h >> 29)) & slotMask;
+}
+
+static float distance2(glm::vec3 a, glm::vec3 b)
+{
+    glm::vec3 d = a - b;
+    return d.x * d.x + d.y * d.y + d.z * d.z;
+}
+
+SpatialHash::SpatialHash(float cellSize)
+    : side(cellSize), inverseSize(1.0f / cellSize)
+{
+}
+
+void SpatialHash::reserve(std::size_t points, std::size_t cells)
+{
+    positions.reserve(points);
+    masks.reserve(points);
+    keys.reserve(points);
+    slots.reserve(points);
+    next.reserve(points);
+    prev.reserve(points);
+    // at most half the slots are taken, and an in-place rehash fires once they are
+    std::size_t slotCount = 16;
+    while (slotCount < cells * 4)
+        slotCount *= 2;
+    if (slotCount > table.size())
+        rehash(slotCount);
+    spare.reserve(table.size());
+}
+
+void SpatialHash::clear()
+{
+    positions.clear();
+    masks.clear();
+    keys.clear();
+    slots.clear();
+    next.clear();
+    prev.clear();
+    std::fill(table.begin(), table.end(), Cell{ 0, -1, 0 });
+    usedSlots = liveCells = 0;
+    minCellX = minCellZ = 0;
+    maxCellX = maxCellZ = -1;
+    hashStats.points = hashStats.cells = hashStats.moved = 0;
+}
+
+uint64_t SpatialHash::keyOf(glm::vec3 position) const
+{
+    return packCell(static_cast<int32_t>(std::floor(position.x * inverseSize)), static_cast<int32_t>(std::floor(position.z * inverseSize)));
+}
+
+// table
+// ---------------------------------------------------------------------------------------------
+int64_t SpatialHash::find(uint64_t key) const
+{
+    if (table.empty())
+        return -1;
+    std::size_t slotMask = table.size() - 1;
+    for (std::size_t slot = slotOf(key, slotMask);; slot = (slot + 1) & slotMask)
+    {
+        if (!table[slot].used)
+            return -1;
+        if (table[slot].key == key)
+            return static_cast<int64_t>(slot);
+    }
+}
+
+// the table is rebuilt when half its slots are taken: at the same size when most of them are
+// cells that have since emptied (planes leave a trail of those), doubled otherwise
+std::size_t SpatialHash::insertCell(uint64_t key)
+{
+    if ((usedSlots + 1) * 2 > table.size())
+        rehash(table.empty() ? 16 : (liveCells + 1) * 4 <= table.size() ? table.size() : table.size() * 2);
+
+    std::size_t slotMask = table.size() - 1;
+    std::size_t slot = slotOf(key, slotMask);
+    while (table[slot].used)
+        slot = (slot + 1) & slotMask;
+    table[slot] = Cell{ key, -1, 1 };
+    usedSlots++;
+
+    int32_t cellX = cellXOf(key), cellZ = cellZOf(key);
+    if (maxCellX < minCellX)
+    {
+        minCellX = maxCellX = cellX;
+        minCellZ = maxCellZ = cellZ;
+    }
+    minCellX = std::min(minCellX, cellX);
+    maxCellX = std::max(maxCellX, cellX);
+    minCellZ = std::min(minCellZ, cellZ);
+    maxCellZ = std::max(maxCellZ, cellZ);
+    return slot;
+}
+
+void SpatialHash::rehash(std::size_t slotCount)
+{
+    hashStats.rehashes++;
+    spare.assign(slotCount, Cell{ 0, -1, 0 });
+    minCellX = minCellZ = 0;
+    maxCellX = maxCellZ = -1;
+    std::size_t slotMask = slotCount - 1;
+    for (const Cell& cell : table)
+    {
+        if (!cell.used || cell.head < 0)
+            continue;
+        std::size_t slot = slotOf(cell.key, slotMask);
+        while (spare[slot].used)
+            slot = (slot + 1) & slotMask;
+        spare[slot] = cell;
+        for (int32_t point = cell.head; point >= 0; point = next[point])
+            slots[point] = static_cast<uint32_t>(slot);
+
+        int32_t cellX = cellXOf(cell.key), cellZ = cellZOf(cell.key);
+        if (maxCellX < minCellX)
+        {
+            minCellX = maxCellX = cellX;
+            minCellZ = maxCellZ = cellZ;
+        }
+        minCellX = std::min(minCellX, cellX);
+        maxCellX = std::max(maxCellX, cellX);
+        minCellZ = std::min(minCellZ, cellZ);
+        maxCellZ = std::max(maxCellZ, cellZ);
+    }
+    table.swap(spare);
+    usedSlots = liveCells;
+}
+
+void SpatialHash::link(uint32_t point, uint64_t key)
+{
+    int64_t found = find(key);
+    std::size_t slot = found >= 0 ? static_cast<std::size_t>(found) : insertCell(key);
+    Cell& cell = table[slot];
+    if (cell.head < 0)
+        liveCells++;
+    next[point] = cell.head;
+    prev[point] = -1;
+    if (cell.head >= 0)
+        prev[cell.head] = static_cast<int32_t>(point);
+    cell.head = static_cast<int32_t>(point);
+    keys[point] = key;
+    slots[point] = static_cast<uint32_t>(slot);
+}
+
+void SpatialHash::unlink(uint32_t point)
+{
+    Cell& cell = table[slots[point]];
+    if (prev[point] >= 0)
+        next[prev[point]] = next[point];
+    else
+        cell.head = next[point];
+    if (next[point] >= 0)
+        prev[next[point]] = prev[point];
+    if (cell.head < 0)
+        liveCells--;
+}
+
+// update
+// ---------------------------------------------------------------------------------------------
+void SpatialHash::update(std::size_t count, const float* x, const float* y, const float* z, const uint32_t* newMasks)
+{
+    std::size_t moved = 0;
+    for (std::size_t i = positions.size(); i-- > count;)
+    {
+        if (masks[i])
+        {
+            unlink(static_cast<uint32_t>(i));
+            hashStats.points--;
+            moved++;
+        }
+    }
+    std::size_t previous = std::min(positions.size(), count);
+    positions.resize(count);
+    masks.resize(count, 0u);
+    keys.resize(count);
+    slots.resize(count);
+    next.resize(count, -1);
+    prev.resize(count, -1);
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        uint32_t point = static_cast<uint32_t>(i);
+        glm::vec3 position(x[i], y[i], z[i]);
+        positions[i] = position;
+        uint32_t oldMask = i < previous ? masks[i] : 0u;
+        masks[i] = newMasks[i];
+        if (!newMasks[i])
+        {
+            if (oldMask)
+            {
+                unlink(point);
+                hashStats.points--;
+                moved++;
+            }
+            continue;
+        }
+        uint64_t key = keyOf(position);
+        if (!oldMask)
+        {
+            link(point, key);
+            hashStats.points++;
+            moved++;
+        }
+        else if (key != keys[i])
+        {
+            unlink(point);
+            link(point, key);
+            moved++;
+        }
+    }
+    hashStats.moved = moved;
+    hashStats.cells = liveCells;
+}
+
+// queries
+// ---------------------------------------------------------------------------------------------
+template <typename Visit>
+void SpatialHash::visitCell(int32_t cellX, int32_t cellZ, Visit&& visit) const
+{
+    int64_t slot = find(packCell(cellX, cellZ));
+    if (slot < 0)
+        return;
+    for (int32_t point = table[static_cast<std::size_t>(slot)].head; point >= 0; point = next[point])
+        visit(static_cast<uint32_t>(point));
+}
+
+std::size_t SpatialHash::radius(glm::vec3 center, float radius, uint32_t mask, uint32_t* out, std::size_t maxOut) const
+{
+    if (liveCells == 0)
+        return 0;
+    int32_t x0 = std::max(minCellX, static_cast<int32_t>(std::floor((center.x - radius) * inverseSize)));
+    int32_t x1 = std::min(maxCellX, static_cast<int32_t>(std::floor((center.x + radius) * inverseSize)));
+    int32_t z0 = std::max(minCellZ, static_cast<int32_t>(std::floor((center.z - radius) * inverseSize)));
+    int32_t z1 = std::min(maxCellZ, static_cast<int32_t>(std::floor((center.z + radius) * inverseSize)));
+    const float radius2 = radius * radius;
+    std::size_t found = 0;
+    for (int32_t cellZ = z0; cellZ <= z1; cellZ++)
+    {
+        for (int32_t cellX = x0; cellX <= x1; cellX++)
+        {
+            visitCell(cellX, cellZ, [&](uint32_t point) {
+                if ((masks[point] & mask) && distance2(positions[point], center) <= radius2)
+                {
+                    if (found < maxOut)
+                        out[found] = point;
+                    found++;
+                }
+            });
+        }
+    }
+    return found;
+}
+
+std::size_t SpatialHash::nearest(glm::vec3 center, std::size_t k, float maxRadius, uint32_t mask, uint32_t skip, uint32_t* out, float* distances) const
+{
+    k = std::min(k, SPATIAL_HASH_MAX_K);
+    if (k == 0 || liveCells == 0)
+        return 0;
+
+    // the best so far, sorted nearest first
+    float best[SPATIAL_HASH_MAX_K];
+    uint32_t ids[SPATIAL_HASH_MAX_K];
+    std::size_t found = 0;
+    const float limit2 = maxRadius * maxRadius;
+    auto consider = [&](uint32_t point) {
+        if (point == skip || !(masks[point] & mask))
+            return;
+        float d2 = distance2(positions[point], center);
+        if (d2 > limit2 || (found == k && d2 >= best[k - 1]))
+            return;
+        std::size_t at = found < k ? found++ : k - 1;
+        while (at > 0 && best[at - 1] > d2)
+        {
+            best[at] = best[at - 1];
+            ids[at] = ids[at - 1];
+            at--;
+        }
+        best[at] = d2;
+        ids[at] = point;
+    };
+
+    const int32_t centerX = static_cast<int32_t>(std::floor(center.x * inverseSize));
+    const int32_t centerZ = static_cast<int32_t>(std::floor(center.z * inverseSize));
+    for (int32_t ring = 0;; ring++)
+    {
+        int32_t x0 = centerX - ring, x1 = centerX + ring;
+        int32_t z0 = centerZ - ring, z1 = centerZ + ring;
+        if (x0 < minCellX && x1 > maxCellX && z0 < minCellZ && z1 > maxCellZ)
+            break;
+        for (int32_t cellZ = std::max(z0, minCellZ); cellZ <= std::min(z1, maxCellZ); cellZ++)
+        {
+            if (cellZ == z0 || cellZ == z1)
+            {
+                for (int32_t cellX = std::max(x0, minCellX); cellX <= std::min(x1, maxCellX); cellX++)
+                    visitCell(cellX, cellZ, consider);
+            }
+            else
+            {
+                if (x0 >= minCellX)
+                    visitCell(x0, cellZ, consider);
+                if (x1 <= maxCellX && ring > 0)
+                    visitCell(x1, cellZ, consider);
+            }
+        }
+        // everything outside this ring is at least this far away across the plane
+        float reach = ring * side;
+        if (reach >= maxRadius || (found == k && best[k - 1] <= reach * reach))
+            break;
+    }
+
+    for (std::size_t i = 0; i < found; i++)
+    {
+        out[i] = ids[i];
+        if (distances)
+            distances[i] = best[i];
+    }
+    return found;
+}
@@ -0,0 +1,87 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// the most neighbours one nearest() query returns
+const std::size_t SPATIAL_HASH_MAX_K = 64;
+
+struct SpatialHashStats
+{
+    std::size_t points = 0;   // points in at least one group
+    std::size_t cells = 0;    // occupied cells
+    std::size_t moved = 0;    // points the last update() moved to another cell, added or removed
+    uint64_t rehashes = 0;    // table rebuilds, in place or grown
+};
+
+// neighbour queries over many moving points. the xz plane is cut into square cells; every occupied
+// cell is one slot of an open-addressed table heading a doubly linked list of its points. update()
+// takes all positions at once and relinks only the points that changed cell, so a tick in which
+// most points move less than a cell costs a compare per point. points are dense ids 0..count-1 and
+// belong to query groups through a bit mask; mask 0 takes a point out. the queries are const and
+// may run on any number of threads at once, just not while update() runs.
+class SpatialHash
+{
+public:
+    explicit SpatialHash(float cellSize = 250.0f);
+
+    // sizes everything for this many points and occupied cells, so later updates do not allocate
+    void reserve(std::size_t points, std::size_t cells);
+    // point i is at (x[i], y[i], z[i]) in groups masks[i]; points from count on are removed
+    void update(std::size_t count, const float* x, const float* y, const float* z, const uint32_t* masks);
+    void clear();
+
+    // points of any group in mask within radius of center (3D distance), unordered. at most maxOut
+    // are written; the return value counts all of them
+    std::size_t radius(glm::vec3 center, float radius, uint32_t mask, uint32_t* out, std::size_t maxOut) const;
+    // the k (at most SPATIAL_HASH_MAX_K) nearest points of any group in mask within maxRadius,
+    // nearest first, leaving out the point skip (the asker, or ~0u). squared distances go to
+    // distances when it is not null. cells are searched in rings around the centre and the search
+    // stops as soon as no unvisited cell can hold anything nearer than the k-th found
+    std::size_t nearest(glm::vec3 center, std::size_t k, float maxRadius, uint32_t mask, uint32_t skip, uint32_t* out, float* distances) const;
+
+    glm::vec3 position(uint32_t point) const { return positions[point]; }
+    uint32_t mask(uint32_t point) const { return masks[point]; }
+    std::size_t size() const { return positions.size(); }
+    float cellSize() const { return side; }
+    const SpatialHashStats& stats() const { return hashStats; }
+
+private:
+    struct Cell
+    {
+        uint64_t key;
+        int32_t head; // first point, -1 once the cell has emptied
+        int32_t used; // 0 for a slot never taken; emptied cells keep their slot until the next rehash
+    };
+
+    float side;
+    float inverseSize;
+    std::vector<Cell> table; // power of two
+    std::vector<Cell> spare; // the other table of an in-place rehash
+    std::size_t usedSlots = 0;
+    std::size_t liveCells = 0;
+    // bounds of the cells ever occupied since the last rehash, so an empty ring can end a search
+    int32_t minCellX = 0, maxCellX = -1, minCellZ = 0, maxCellZ = -1;
+
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> masks;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> slots; // the table slot of the point's cell
+    std::vector<int32_t> next, prev;
+    SpatialHashStats hashStats;
+
+    uint64_t keyOf(glm::vec3 position) const;
+    int64_t find(uint64_t key) const;
+    std::size_t insertCell(uint64_t key);
+    void link(uint32_t point, uint64_t key);
+    void unlink(uint32_t point);
+    void rehash(std::size_t slotCount);
+    template <typename Visit>
+    void visitCell(int32_t cellX, int32_t cellZ, Visit&& visit) const;
+};
+
+#endif
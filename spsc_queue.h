@@ -0,0 +1,45 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// lock-free ring for exactly one producer thread and one consumer thread. Capacity must be a power
+// of two; one slot is never used so full and empty can be told apart. head and tail sit on their
+// own cache lines so the two threads do not keep stealing each other's line.
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    // producer: false when the queue is full, the item is not added
+    bool push(const T& item)
+    {
+        std::size_t tail = tailIndex.load(std::memory_order_relaxed);
+        std::size_t next = (tail + 1) & (Capacity - 1);
+        if (next == headIndex.load(std::memory_order_acquire))
+            return false;
+        items[tail] = item;
+        tailIndex.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // consumer: false when there is nothing to take
+    bool pop(T& item)
+    {
+        std::size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire))
+            return false;
+        item = items[head];
+        headIndex.store((head + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<std::size_t> headIndex{ 0 };
+    alignas(64) std::atomic<std::size_t> tailIndex{ 0 };
+    alignas(64) T items[Capacity];
+};
+
+#endif
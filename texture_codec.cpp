@@ -0,0 +1,632 @@
+#include "texture_codec.h"
+#include "model_cache.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+static const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+static const uint32_t FOURCC_DXT1 = 0x31545844;
+static const uint32_t TEXTURE_CACHE_MARKER = 0x58544244; // "DBTX" in the reserved words
+static const uint32_t TEXTURE_CACHE_VERSION = 1;
+
+// DDS_HEADER flags and caps
+static const uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+static const uint32_t DDPF_ALPHAPIXELS = 0x1, DDPF_FOURCC = 0x4;
+static const uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+
+// the 124 byte DDS_HEADER as dwords
+enum DdsWord
+{
+    DDS_SIZE = 0,
+    DDS_FLAGS = 1,
+    DDS_HEIGHT = 2,
+    DDS_WIDTH = 3,
+    DDS_LINEAR_SIZE = 4,
+    DDS_MIP_COUNT = 6,
+    DDS_RESERVED = 7, // 11 words: marker, version, source size (2), source time (2)
+    DDS_PF_SIZE = 18,
+    DDS_PF_FLAGS = 19,
+    DDS_PF_FOURCC = 20,
+    DDS_CAPS = 26,
+    DDS_WORDS = 31
+};
+
+int CompressedTexture::levelWidth(int level) const
+{
+    return std::max(1, width >> level);
+}
+
+int CompressedTexture::levelHeight(int level) const
+{
+    return std::max(1, height >> level);
+}
+
+std::size_t CompressedTexture::levelSize(int level) const
+{
+    return bc1LevelSize(levelWidth(level), levelHeight(level));
+}
+
+// mips
+// ---------------------------------------------------------------------------------------------
+RgbaImage expandToRgba(const uint8_t* pixels, int width, int height, int channels)
+{
+    RgbaImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(std::size_t(width) * height * 4);
+    for (std::size_t i = 0; i < std::size_t(width) * height; i++)
+    {
+        const uint8_t* in = pixels + i * channels;
+        uint8_t* out = &image.pixels[i * 4];
+        if (channels <= 2)
+        {
+            out[0] = out[1] = out[2] = in[0];
+            out[3] = channels == 2 ? in[1] : 255;
+        }
+        else
+        {
+            out[0] = in[0];
+            out[1] = in[1];
+            out[2] = in[2];
+            out[3] = channels == 4 ? in[3] : 255;
+        }
+    }
+    return image;
+}
+
+RgbaImage downsample(const RgbaImage& image)
+{
+    RgbaImage next;
+    next.width = std::max(1, image.width / 2);
+    next.height = std::max(1, image.height / 2);
+    next.pixels.resize(std::size_t(next.width) * next.height * 4);
+    for (int y = 0; y < next.height; y++)
+    {
+        int y0 = std::min(2 * y, image.height - 1), y1 = std::min(2 * y + 1, image.height - 1);
+        for (int x = 0; x < next.width; x++)
+        {
+            int x0 = std::min(2 * x, image.width - 1), x1 = std::min(2 * x + 1, image.width - 1);
+            const uint8_t* a = &image.pixels[(std::size_t(y0) * image.width + x0) * 4];
+            const uint8_t* b = &image.pixels[(std::size_t(y0) * image.width + x1) * 4];
+            const uint8_t* c = &image.pixels[(std::size_t(y1) * image.width + x0) * 4];
+            const uint8_t* d = &image.pixels[(std::size_t(y1) * image.width + x1) * 4];
+            uint8_t* out = &next.pixels[(std::size_t(y) * next.width + x) * 4];
+            for (int channel = 0; channel < 4; channel++)
+                out[channel] = static_cast<uint8_t>((a[channel] + b[channel] + c[channel] + d[channel] + 2) / 4);
+        }
+    }
+    return next;
+}
+
+std::vector<RgbaImage> buildMipChain(const RgbaImage& image)
+{
+    std::vector<RgbaImage> levels;
+    levels.push_back(image);
+    while (levels.back().width > 1 || levels.back().height > 1)
+        levels.push_back(downsample(levels.back()));
+    return levels;
+}
+
+// bc1
+// ---------------------------------------------------------------------------------------------
+std::size_t bc1LevelSize(int width, int height)
+{
+    return std::size_t((width + 3) / 4) * std::size_t((height + 3) / 4) * 8;
+}
+
+static uint16_t packRgb565(const float color[3])
+{
+    int r = static_cast<int>(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    int g = static_cast<int>(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+    int b = static_cast<int>(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackRgb565(uint16_t packed, uint8_t color[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+    color[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+    color[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+}
+
+// the four colours a block can pick from; c0 > c1 selects the opaque 4 colour mode
+static void bc1Palette(uint16_t c0, uint16_t c1, uint8_t palette[4][4])
+{
+    unpackRgb565(c0, palette[0]);
+    unpackRgb565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = 255;
+    for (int channel = 0; channel < 3; channel++)
+    {
+        int a = palette[0][channel], b = palette[1][channel];
+        if (c0 > c1)
+        {
+            palette[2][channel] = static_cast<uint8_t>((2 * a + b) / 3);
+            palette[3][channel] = static_cast<uint8_t>((a + 2 * b) / 3);
+        }
+        else
+        {
+            palette[2][channel] = static_cast<uint8_t>((a + b) / 2);
+            palette[3][channel] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = c0 > c1 ? 255 : 0;
+}
+
+static int colorDistance(const uint8_t* a, const uint8_t* b)
+{
+    int dr = a[0] - b[0], dg = a[1] - b[1], db = a[2] - b[2];
+    return dr * dr + dg * dg + db * db;
+}
+
+// picks the nearest palette entry for every pixel; returns the summed squared error
+static int chooseIndices(const uint8_t rgba[64], uint16_t c0, uint16_t c1, uint32_t& indices)
+{
+    uint8_t palette[4][4];
+    bc1Palette(c0, c1, palette);
+    int colors = c0 > c1 ? 4 : 3;
+    int error = 0;
+    indices = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        const uint8_t* pixel = rgba + i * 4;
+        int best = 3;
+        if (pixel[3] >= 128 || colors == 4)
+        {
+            int bestDistance = colorDistance(pixel, palette[0]);
+            best = 0;
+            for (int p = 1; p < colors; p++)
+            {
+                int distance = colorDistance(pixel, palette[p]);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            error += bestDistance;
+        }
+        indices |= uint32_t(best) << (2 * i);
+    }
+    return error;
+}
+
+// orders the endpoints for the wanted mode: c0 > c1 for 4 colours, c0 <= c1 for 3 colours + transparent
+static void orderEndpoints(uint16_t& c0, uint16_t& c1, bool transparent)
+{
+    if (transparent ? c0 > c1 : c0 < c1)
+        std::swap(c0, c1);
+}
+
+void encodeBc1Block(const uint8_t rgba[64], uint8_t block[8])
+{
+    bool transparent = false;
+    int opaqueCount = 0;
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++)
+    {
+        if (rgba[i * 4 + 3] < 128)
+        {
+            transparent = true;
+            continue;
+        }
+        for (int channel = 0; channel < 3; channel++)
+            mean[channel] += rgba[i * 4 + channel];
+        opaqueCount++;
+    }
+
+    uint16_t c0 = 0, c1 = 0;
+    if (opaqueCount > 0)
+    {
+        for (int channel = 0; channel < 3; channel++)
+            mean[channel] /= opaqueCount;
+
+        // principal axis of the colours by power iteration on their covariance
+        float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++)
+        {
+            if (rgba[i * 4 + 3] < 128)
+                continue;
+            float r = rgba[i * 4] - mean[0], g = rgba[i * 4 + 1] - mean[1], b = rgba[i * 4 + 2] - mean[2];
+            covariance[0] += r * r;
+            covariance[1] += r * g;
+            covariance[2] += r * b;
+            covariance[3] += g * g;
+            covariance[4] += g * b;
+            covariance[5] += b * b;
+        }
+        // start from the covariance row of the channel that varies most, (1, 1, 1) misses anti-correlated channels
+        float axis[3] = { covariance[0], covariance[1], covariance[2] };
+        if (covariance[3] > covariance[0] && covariance[3] >= covariance[5])
+        {
+            axis[0] = covariance[1];
+            axis[1] = covariance[3];
+            axis[2] = covariance[4];
+        }
+        else if (covariance[5] > covariance[0] && covariance[5] > covariance[3])
+        {
+            axis[0] = covariance[2];
+            axis[1] = covariance[4];
+            axis[2] = covariance[5];
+        }
+        if (axis[0] == 0.0f && axis[1] == 0.0f && axis[2] == 0.0f)
+            axis[0] = axis[1] = axis[2] = 1.0f; // flat block, any axis will do
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+            float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+            float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+            float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+            if (length < 1e-6f)
+                break;
+            axis[0] = x / length;
+            axis[1] = y / length;
+            axis[2] = z / length;
+        }
+        float axisLength2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+        // the extremes of the projections onto the axis become the endpoints
+        float tMin = 0.0f, tMax = 0.0f;
+        for (int i = 0; i < 16; i++)
+        {
+            if (rgba[i * 4 + 3] < 128)
+                continue;
+            float t = ((rgba[i * 4] - mean[0]) * axis[0] + (rgba[i * 4 + 1] - mean[1]) * axis[1] + (rgba[i * 4 + 2] - mean[2]) * axis[2]) / axisLength2;
+            tMin = std::min(tMin, t);
+            tMax = std::max(tMax, t);
+        }
+        float high[3], low[3];
+        for (int channel = 0; channel < 3; channel++)
+        {
+            high[channel] = mean[channel] + axis[channel] * tMax;
+            low[channel] = mean[channel] + axis[channel] * tMin;
+        }
+        c0 = packRgb565(high);
+        c1 = packRgb565(low);
+    }
+    orderEndpoints(c0, c1, transparent);
+
+    uint32_t indices;
+    int error = chooseIndices(rgba, c0, c1, indices);
+
+    // one least squares pass: refit both endpoints to the colours with the chosen weights
+    if (!transparent && c0 != c1 && error > 0)
+    {
+        static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++)
+        {
+            float w = weights[(indices >> (2 * i)) & 3];
+            aa += w * w;
+            ab += w * (1.0f - w);
+            bb += (1.0f - w) * (1.0f - w);
+            for (int channel = 0; channel < 3; channel++)
+            {
+                ax[channel] += w * rgba[i * 4 + channel];
+                bx[channel] += (1.0f - w) * rgba[i * 4 + channel];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) > 1e-6f)
+        {
+            float high[3], low[3];
+            for (int channel = 0; channel < 3; channel++)
+            {
+                high[channel] = (ax[channel] * bb - bx[channel] * ab) / determinant;
+                low[channel] = (bx[channel] * aa - ax[channel] * ab) / determinant;
+            }
+            uint16_t r0 = packRgb565(high), r1 = packRgb565(low);
+            orderEndpoints(r0, r1, false);
+            uint32_t refinedIndices;
+            int refinedError = chooseIndices(rgba, r0, r1, refinedIndices);
+            if (refinedError < error)
+            {
+                c0 = r0;
+                c1 = r1;
+                indices = refinedIndices;
+            }
+        }
+    }
+
+    block[0] = static_cast<uint8_t>(c0 & 0xff);
+    block[1] = static_cast<uint8_t>(c0 >> 8);
+    block[2] = static_cast<uint8_t>(c1 & 0xff);
+    block[3] = static_cast<uint8_t>(c1 >> 8);
+    for (int i = 0; i < 4; i++)
+        block[4 + i] = static_cast<uint8_t>(indices >> (8 * i));
+}
+
+void decodeBc1Block(const uint8_t block[8], uint8_t rgba[64])
+{
+    uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    uint8_t palette[4][4];
+    bc1Palette(c0, c1, palette);
+    for (int i = 0; i < 16; i++)
+    {
+        int index = (block[4 + i / 4] >> (2 * (i % 4))) & 3;
+        std::memcpy(rgba + i * 4, palette[index], 4);
+    }
+}
+
+std::vector<uint8_t> compressBc1(const RgbaImage& image)
+{
+    std::vector<uint8_t> blocks(bc1LevelSize(image.width, image.height));
+    int blocksWide = (image.width + 3) / 4, blocksHigh = (image.height + 3) / 4;
+    uint8_t pixels[64];
+    for (int by = 0; by < blocksHigh; by++)
+    {
+        for (int bx = 0; bx < blocksWide; bx++)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                int x = std::min(bx * 4 + i % 4, image.width - 1);
+                int y = std::min(by * 4 + i / 4, image.height - 1);
+                std::memcpy(pixels + i * 4, &image.pixels[(std::size_t(y) * image.width + x) * 4], 4);
+            }
+            encodeBc1Block(pixels, &blocks[(std::size_t(by) * blocksWide + bx) * 8]);
+        }
+    }
+    return blocks;
+}
+
+RgbaImage decompressBc1(const uint8_t* blocks, int width, int height)
+{
+    RgbaImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(std::size_t(width) * height * 4);
+    int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+    uint8_t pixels[64];
+    for (int by = 0; by < blocksHigh; by++)
+    {
+        for (int bx = 0; bx < blocksWide; bx++)
+        {
+            decodeBc1Block(blocks + (std::size_t(by) * blocksWide + bx) * 8, pixels);
+            for (int i = 0; i < 16; i++)
+            {
+                int x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                if (x < width && y < height)
+                    std::memcpy(&image.pixels[(std::size_t(y) * width + x) * 4], pixels + i * 4, 4);
+            }
+        }
+    }
+    return image;
+}
+
+CompressedTexture compressTexture(const RgbaImage& image)
+{
+    CompressedTexture texture;
+    texture.width = image.width;
+    texture.height = image.height;
+    for (const RgbaImage& level : buildMipChain(image))
+    {
+        for (std::size_t i = 3; i < level.pixels.size(); i += 4)
+            texture.hasAlpha = texture.hasAlpha || level.pixels[i] < 128;
+        texture.levelOffsets.push_back(texture.blocks.size());
+        std::vector<uint8_t> blocks = compressBc1(level);
+        texture.blocks.insert(texture.blocks.end(), blocks.begin(), blocks.end());
+    }
+    return texture;
+}
+
+// dds file
+// ---------------------------------------------------------------------------------------------
+std::string textureCachePath(const std::string& sourcePath)
+{
+    return sourcePath + ".dds";
+}
+
+bool writeDds(const std::string& path, const std::string& sourcePath, const CompressedTexture& texture)
+{
+    uint32_t header[DDS_WORDS];
+    std::memset(header, 0, sizeof(header));
+    header[DDS_SIZE] = sizeof(header);
+    header[DDS_FLAGS] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header[DDS_HEIGHT] = static_cast<uint32_t>(texture.height);
+    header[DDS_WIDTH] = static_cast<uint32_t>(texture.width);
+    header[DDS_LINEAR_SIZE] = static_cast<uint32_t>(texture.levelSize(0));
+    header[DDS_MIP_COUNT] = static_cast<uint32_t>(texture.levelCount());
+    header[DDS_PF_SIZE] = 32;
+    header[DDS_PF_FLAGS] = DDPF_FOURCC | (texture.hasAlpha ? DDPF_ALPHAPIXELS : 0);
+    header[DDS_PF_FOURCC] = FOURCC_DXT1;
+    header[DDS_CAPS] = DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+
+    header[DDS_RESERVED] = TEXTURE_CACHE_MARKER;
+    header[DDS_RESERVED + 1] = TEXTURE_CACHE_VERSION;
+    if (!sourcePath.empty())
+    {
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        if (!sourceStamp(sourcePath, sourceSize, sourceTime))
+            return false;
+        std::memcpy(&header[DDS_RESERVED + 2], &sourceSize, 8);
+        std::memcpy(&header[DDS_RESERVED + 4], &sourceTime, 8);
+    }
+
+    // same temporary file and rename as the model cache
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out.write(reinterpret_cast<const char*>(&DDS_MAGIC), 4);
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(texture.blocks.data()), static_cast<std::streamsize>(texture.blocks.size()));
+        if (!out)
+            return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    return !error;
+}
+
+bool readDds(const std::string& path, const std::string& sourcePath, CompressedTexture& texture)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    uint32_t magic;
+    uint32_t header[DDS_WORDS];
+    if (file.size() < 4 + sizeof(header))
+        return false;
+    std::memcpy(&magic, file.data(), 4);
+    std::memcpy(header, file.data() + 4, sizeof(header));
+    if (magic != DDS_MAGIC || header[DDS_SIZE] != sizeof(header) || !(header[DDS_PF_FLAGS] & DDPF_FOURCC) || header[DDS_PF_FOURCC] != FOURCC_DXT1)
+        return false;
+    if (header[DDS_WIDTH] == 0 || header[DDS_HEIGHT] == 0 || header[DDS_WIDTH] > 16384 || header[DDS_HEIGHT] > 16384)
+        return false;
+
+    // one we baked: reject it when the source changed since (a source that is not shipped is fine)
+    if (header[DDS_RESERVED] == TEXTURE_CACHE_MARKER)
+    {
+        if (header[DDS_RESERVED + 1] != TEXTURE_CACHE_VERSION)
+            return false;
+        uint64_t bakedSize, sourceSize;
+        int64_t bakedTime, sourceTime;
+        std::memcpy(&bakedSize, &header[DDS_RESERVED + 2], 8);
+        std::memcpy(&bakedTime, &header[DDS_RESERVED + 4], 8);
+        if (!sourcePath.empty() && sourceStamp(sourcePath, sourceSize, sourceTime) && (sourceSize != bakedSize || sourceTime != bakedTime))
+            return false;
+    }
+
+    texture.width = static_cast<int>(header[DDS_WIDTH]);
+    texture.height = static_cast<int>(header[DDS_HEIGHT]);
+    texture.hasAlpha = (header[DDS_PF_FLAGS] & DDPF_ALPHAPIXELS) != 0;
+    int levels = (header[DDS_FLAGS] & DDSD_MIPMAPCOUNT) && header[DDS_MIP_COUNT] > 0 ? static_cast<int>(header[DDS_MIP_COUNT]) : 1;
+    texture.levelOffsets.clear();
+    std::size_t size = 0;
+    for (int level = 0; level < levels && level < 32; level++)
+    {
+        texture.levelOffsets.push_back(size);
+        size += texture.levelSize(level);
+    }
+    if (file.size() < 4 + sizeof(header) + size)
+        return false;
+    texture.blocks.assign(file.begin() + 4 + sizeof(header), file.begin() + 4 + sizeof(header) + size);
+    return true;
+}
+
+bool bakeTexture(const std::string& sourcePath)
+{
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, 0);
+    if (!pixels)
+    {
+        std::cout << "Texture failed to load at path: " << sourcePath << std::endl;
+        return false;
+    }
+    CompressedTexture texture = compressTexture(expandToRgba(pixels, width, height, channels));
+    stbi_image_free(pixels);
+
+    std::string cachePath = textureCachePath(sourcePath);
+    if (!writeDds(cachePath, sourcePath, texture))
+    {
+        std::cout << "Failed to write texture cache: " << cachePath << std::endl;
+        return false;
+    }
+    std::cout << "Baked " << sourcePath << " (" << width << "x" << height << ", " << texture.levelCount() << " levels, "
+              << std::size_t(width) * height * channels / 1024 << " KB -> " << texture.blocks.size() / 1024 << " KB) -> " << cachePath << std::endl;
+    return true;
+}
+
+// png
+// ---------------------------------------------------------------------------------------------
+static uint32_t crc32(const uint8_t* bytes, std::size_t size, uint32_t crc = 0)
+{
+    static uint32_t table[256];
+    static bool built = false;
+    if (!built)
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        built = true;
+    }
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; i++)
+        crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void putBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.insert(out.end(), { uint8_t(value >> 24), uint8_t(value >> 16), uint8_t(value >> 8), uint8_t(value) });
+}
+
+static void putChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+{
+    putBigEndian(out, static_cast<uint32_t>(data.size()));
+    std::size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putBigEndian(out, crc32(out.data() + start, out.size() - start));
+}
+
+bool writePng(const std::string& path, const RgbaImage& image)
+{
+    if (image.width <= 0 || image.height <= 0)
+        return false;
+
+    // scanlines with filter type 0 in front of each
+    std::size_t rowBytes = std::size_t(image.width) * 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowBytes + 1) * image.height);
+    for (int y = 0; y < image.height; y++)
+    {
+        raw.push_back(0);
+        const uint8_t* row = &image.pixels[y * rowBytes];
+        raw.insert(raw.end(), row, row + rowBytes);
+    }
+
+    // zlib stream of stored blocks (at most 65535 bytes each) and its adler32
+    std::vector<uint8_t> zlib = { 0x78, 0x01 };
+    uint32_t a = 1, b = 0;
+    for (std::size_t offset = 0; offset < raw.size() || offset == 0; )
+    {
+        std::size_t length = std::min<std::size_t>(raw.size() - offset, 65535);
+        bool last = offset + length == raw.size();
+        uint16_t len = static_cast<uint16_t>(length), nlen = static_cast<uint16_t>(~len);
+        zlib.insert(zlib.end(), { uint8_t(last ? 1 : 0), uint8_t(len), uint8_t(len >> 8), uint8_t(nlen), uint8_t(nlen >> 8) });
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+        for (std::size_t i = offset; i < offset + length; i++)
+        {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        offset += length;
+        if (last)
+            break;
+    }
+    putBigEndian(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    putBigEndian(header, static_cast<uint32_t>(image.width));
+    putBigEndian(header, static_cast<uint32_t>(image.height));
+    header.insert(header.end(), { 8, 6, 0, 0, 0 }); // 8 bit, RGBA, deflate, adaptive filters, no interlace
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    std::vector<uint8_t> file(signature, signature + 8);
+    putChunk(file, "IHDR", header);
+    putChunk(file, "IDAT", zlib);
+    putChunk(file, "IEND", {});
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+    return static_cast<bool>(out);
+}
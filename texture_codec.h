@@ -0,0 +1,66 @@
+#ifndef TEXTURE_CODEC_H
+#define TEXTURE_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// offline texture pipeline: box filtered mip chains, BC1 (DXT1) block compression and the DDS
+// container the game uploads with glCompressedTexImage2D. CPU only, nothing in here needs GL.
+
+// 8 bit RGBA, rows top to bottom
+struct RgbaImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// a BC1 texture with its whole mip chain, largest level first, in one buffer
+struct CompressedTexture
+{
+    int width = 0;
+    int height = 0;
+    bool hasAlpha = false; // some blocks use the punch-through (1 bit) alpha mode
+    std::vector<std::size_t> levelOffsets;
+    std::vector<uint8_t> blocks;
+
+    int levelCount() const { return static_cast<int>(levelOffsets.size()); }
+    int levelWidth(int level) const;
+    int levelHeight(int level) const;
+    std::size_t levelSize(int level) const;
+    const uint8_t* levelData(int level) const { return blocks.data() + levelOffsets[level]; }
+};
+
+// 1..4 channel 8 bit pixels as stb_image returns them, widened to RGBA
+RgbaImage expandToRgba(const uint8_t* pixels, int width, int height, int channels);
+// next level down with a 2x2 box filter; odd sizes drop the last row/column like glGenerateMipmap does
+RgbaImage downsample(const RgbaImage& image);
+// the image followed by every smaller level down to 1x1
+std::vector<RgbaImage> buildMipChain(const RgbaImage& image);
+
+std::size_t bc1LevelSize(int width, int height);
+// 4x4 RGBA pixels, row major -> 8 bytes. blocks with a pixel under half alpha use the 3 colour + transparent mode
+void encodeBc1Block(const uint8_t rgba[64], uint8_t block[8]);
+void decodeBc1Block(const uint8_t block[8], uint8_t rgba[64]);
+// whole level; edge blocks of sizes that are not a multiple of 4 repeat the last row/column
+std::vector<uint8_t> compressBc1(const RgbaImage& image);
+RgbaImage decompressBc1(const uint8_t* blocks, int width, int height);
+
+CompressedTexture compressTexture(const RgbaImage& image);
+
+// compressed copy next to the source: right.jpg -> right.jpg.dds
+std::string textureCachePath(const std::string& sourcePath);
+// the source size/mtime is kept in the header's reserved words so stale files are rejected like model caches
+bool writeDds(const std::string& path, const std::string& sourcePath, const CompressedTexture& texture);
+// DXT1 files only; an empty sourcePath skips the staleness check
+bool readDds(const std::string& path, const std::string& sourcePath, CompressedTexture& texture);
+
+// 8 bit RGBA PNG with uncompressed (stored) deflate blocks: big files, but byte exact and no zlib
+bool writePng(const std::string& path, const RgbaImage& image);
+
+// the offline bake step: decode, build mips, compress and write textureCachePath(sourcePath)
+bool bakeTexture(const std::string& sourcePath);
+
+#endif
@@ -0,0 +1,135 @@
+#include "transform_graph.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+
+int TransformGraph::add(int parent, const glm::mat4& local)
+{
+    int node = static_cast<int>(parents.size());
+    if (parent >= node)
+        parent = NO_PARENT;
+    parents.push_back(parent);
+    locals.push_back(local);
+    worlds.push_back(local);
+    dirty.push_back(1);
+    anyDirty = true;
+    return node;
+}
+
+void TransformGraph::setLocal(int node, const glm::mat4& local)
+{
+    if (locals[node] == local)
+        return;
+    locals[node] = local;
+    dirty[node] = 1;
+    anyDirty = true;
+}
+
+void TransformGraph::setTranslation(int node, glm::vec3 translation)
+{
+    glm::mat4 local = locals[node];
+    local[3] = glm::vec4(translation, 1.0f);
+    setLocal(node, local);
+}
+
+void TransformGraph::setParent(int node, int parent, const glm::mat4& local)
+{
+    // keeping parents below their children is what lets update() run front to back
+    if (parent >= node)
+        parent = NO_PARENT;
+    parents[node] = parent;
+    locals[node] = local;
+    dirty[node] = 1;
+    anyDirty = true;
+}
+
+std::size_t TransformGraph::update()
+{
+    if (!anyDirty)
+        return 0;
+    std::size_t recomputed = 0;
+    for (std::size_t node = 0; node < parents.size(); node++)
+    {
+        int parent = parents[node];
+        if (parent != NO_PARENT && dirty[parent])
+            dirty[node] = 1;
+        if (!dirty[node])
+            continue;
+        worlds[node] = parent != NO_PARENT ? worlds[parent] * locals[node] : locals[node];
+        recomputed++;
+    }
+    std::fill(dirty.begin(), dirty.end(), 0);
+    anyDirty = false;
+    return recomputed;
+}
+
+AircraftRig addAircraftRig(TransformGraph& graph, const SimState& state, float planeScale, float bombScale)
+{
+    AircraftRig rig;
+    rig.plane = graph.add(TransformGraph::NO_PARENT);
+    // the model faces +z and its pitch and roll are the flight frame's inverted, which a half turn
+    // about y gives: T * R(yaw, -pitch, -roll) * Ry(180) == T * Ry(180 + yaw) * Rx(pitch) * Rz(roll)
+    glm::mat4 planeModel = glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    rig.planeModel = graph.add(rig.plane, glm::scale(planeModel, glm::vec3(planeScale)));
+    rig.cockpit = graph.add(rig.plane);
+    rig.hardpoint = graph.add(rig.plane, glm::translate(glm::mat4(1.0f), state.bombOffsetLocal));
+    rig.bomb = graph.add(rig.hardpoint);
+    glm::mat4 bombModel = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    rig.bombModel = graph.add(rig.bomb, glm::scale(bombModel, glm::vec3(bombScale)));
+    rig.bombHitbox = graph.add(rig.bomb, glm::scale(glm::mat4(1.0f), glm::vec3(state.bombHitRadius)));
+    updateAircraftRig(graph, rig, state);
+    return rig;
+}
+
+void updateAircraftRig(TransformGraph& graph, const AircraftRig& rig, const SimState& state)
+{
+    glm::mat4 plane = planeRotationMatrix(state);
+    plane[3] = glm::vec4(state.plane.position, 1.0f);
+    graph.setLocal(rig.plane, plane);
+
+    bool onHardpoint = graph.parent(rig.bomb) == rig.hardpoint;
+    if (state.bombAttached && !onHardpoint)
+    {
+        graph.setParent(rig.bomb, rig.hardpoint, glm::mat4(1.0f));
+    }
+    else if (!state.bombAttached && onHardpoint)
+    {
+        // released: keep the attitude it left the plane with
+        glm::mat4 released = plane;
+        released[3] = glm::vec4(state.bombPosition, 1.0f);
+        graph.setParent(rig.bomb, TransformGraph::NO_PARENT, released);
+    }
+    else if (!state.bombAttached)
+    {
+        graph.setTranslation(rig.bomb, state.bombPosition);
+    }
+}
+
+void setCockpitView(TransformGraph& graph, AircraftRig& rig, glm::vec3 offset, float yawOffset, float pitchOffset)
+{
+    if (offset == rig.viewOffset && yawOffset == rig.viewYaw && pitchOffset == rig.viewPitch)
+        return;
+    rig.viewOffset = offset;
+    rig.viewYaw = yawOffset;
+    rig.viewPitch = pitchOffset;
+    glm::mat4 view = glm::translate(glm::mat4(1.0f), offset);
+    view = glm::rotate(view, glm::radians(yawOffset), glm::vec3(0.0f, 1.0f, 0.0f));
+    view = glm::rotate(view, glm::radians(pitchOffset), glm::vec3(1.0f, 0.0f, 0.0f));
+    graph.setLocal(rig.cockpit, view);
+}
+
+ShipRig addShipRig(TransformGraph& graph, const SimState& state)
+{
+    ShipRig rig;
+    rig.ship = graph.add(TransformGraph::NO_PARENT, glm::translate(glm::mat4(1.0f), state.shipPosition));
+    glm::mat4 shipModel = glm::scale(glm::mat4(1.0f), glm::vec3(state.shipScale));
+    rig.shipModel = graph.add(rig.ship, glm::rotate(shipModel, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+    rig.shipHitbox = graph.add(rig.ship, glm::scale(glm::mat4(1.0f), state.shipBoxHalfSize * 2.0f));
+    return rig;
+}
+
+void updateShipRig(TransformGraph& graph, const ShipRig& rig, const SimState& state)
+{
+    graph.setTranslation(rig.ship, state.shipPosition);
+}
@@ -0,0 +1,79 @@
+#ifndef TRANSFORM_GRAPH_H
+#define TRANSFORM_GRAPH_H
+
+#include "simulation.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// parent/child transforms in flat arrays. a node's parent always has a lower index, so update() is
+// one pass in index order: a node is recomputed only when its own local matrix or an ancestor
+// changed since the last update, everything else keeps last frame's world matrix.
+class TransformGraph
+{
+public:
+    static const int NO_PARENT = -1;
+
+    int add(int parent, const glm::mat4& local = glm::mat4(1.0f));
+    // setting the matrix a node already has does not mark it dirty
+    void setLocal(int node, const glm::mat4& local);
+    void setTranslation(int node, glm::vec3 translation);
+    // moves node under parent (which must be added before it) or makes it a root with NO_PARENT
+    void setParent(int node, int parent, const glm::mat4& local);
+
+    int parent(int node) const { return parents[node]; }
+    const glm::mat4& local(int node) const { return locals[node]; }
+    // as of the last update()
+    const glm::mat4& world(int node) const { return worlds[node]; }
+    std::size_t size() const { return parents.size(); }
+
+    // returns how many world matrices were recomputed
+    std::size_t update();
+
+private:
+    std::vector<int> parents;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<uint8_t> dirty;
+    bool anyDirty = false;
+};
+
+// the nodes of one aircraft. plane is the flight frame (position and yaw/pitch/roll) the others
+// hang off: the cockpit camera with its mouse look, the bomb hardpoint, and the bomb, which sits on
+// the hardpoint until it is released and then falls as a root node keeping its release attitude.
+struct AircraftRig
+{
+    int plane;
+    int planeModel;
+    int cockpit;
+    int hardpoint;
+    int bomb;
+    int bombModel;
+    int bombHitbox;
+    // what the cockpit node was last set to, so an unchanged view costs no trig
+    glm::vec3 viewOffset = glm::vec3(0.0f);
+    float viewYaw = 0.0f;
+    float viewPitch = 0.0f;
+};
+
+AircraftRig addAircraftRig(TransformGraph& graph, const SimState& state, float planeScale, float bombScale);
+// copies the plane and bomb state into the rig's local matrices; call before graph.update()
+void updateAircraftRig(TransformGraph& graph, const AircraftRig& rig, const SimState& state);
+void setCockpitView(TransformGraph& graph, AircraftRig& rig, glm::vec3 offset, float yawOffset, float pitchOffset);
+
+// the carrier: model and hit box under one placement node. the ship only moves when the floating
+// origin does, so between rebases none of these are recomputed
+struct ShipRig
+{
+    int ship;
+    int shipModel;
+    int shipHitbox;
+};
+
+ShipRig addShipRig(TransformGraph& graph, const SimState& state);
+void updateShipRig(TransformGraph& graph, const ShipRig& rig, const SimState& state);
+
+#endif
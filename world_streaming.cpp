@@ -0,0 +1,304 @@
+#include "world_streaming.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+static double clockMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int32_t floorDiv(float value, float size)
+{
+    return static_cast<int32_t>(std::floor(value / size));
+}
+
+TileCoord tileAt(int32_t originTileX, int32_t originTileZ, glm::vec3 local)
+{
+    TileCoord tile;
+    tile.x = originTileX + floorDiv(local.x, WORLD_TILE_SIZE);
+    tile.z = originTileZ + floorDiv(local.z, WORLD_TILE_SIZE);
+    return tile;
+}
+
+int32_t tileDistance(TileCoord a, TileCoord b)
+{
+    return std::max(std::abs(a.x - b.x), std::abs(a.z - b.z));
+}
+
+glm::vec3 tileOffset(TileCoord tile, int32_t originTileX, int32_t originTileZ)
+{
+    return glm::vec3((tile.x - originTileX) * WORLD_TILE_SIZE, 0.0f, (tile.z - originTileZ) * WORLD_TILE_SIZE);
+}
+
+// ocean surface
+// ---------------------------------------------------------------------------------------------
+// a few long swells at different angles. the phase is taken in double from the absolute position,
+// so a tile a million kilometres out looks as smooth as the first one
+struct Swell
+{
+    double dirX, dirZ; // unit direction
+    double waveNumber; // 2 pi / wavelength
+    float amplitude;
+};
+
+static const Swell swells[] = {
+    { 0.8, 0.6, 6.283185307179586 / 310.0, 1.2f },
+    { -0.3, 0.953939, 6.283185307179586 / 170.0, 0.8f },
+    { 0.99, -0.141067, 6.283185307179586 / 93.0, 0.6f },
+    { -0.6, -0.8, 6.283185307179586 / 47.0, 0.4f },
+};
+
+// height and its slope along x and z
+static float oceanSample(TileCoord tile, float localX, float localZ, float& slopeX, float& slopeZ)
+{
+    double x = static_cast<double>(tile.x) * WORLD_TILE_SIZE + localX;
+    double z = static_cast<double>(tile.z) * WORLD_TILE_SIZE + localZ;
+    float height = 0.0f;
+    slopeX = slopeZ = 0.0f;
+    for (const Swell& swell : swells)
+    {
+        double phase = std::fmod((swell.dirX * x + swell.dirZ * z) * swell.waveNumber, 6.283185307179586);
+        height += swell.amplitude * static_cast<float>(std::sin(phase));
+        float slope = swell.amplitude * static_cast<float>(swell.waveNumber * std::cos(phase));
+        slopeX += slope * static_cast<float>(swell.dirX);
+        slopeZ += slope * static_cast<float>(swell.dirZ);
+    }
+    return height;
+}
+
+float oceanHeight(TileCoord tile, float localX, float localZ)
+{
+    float slopeX, slopeZ;
+    return oceanSample(tile, localX, localZ, slopeX, slopeZ);
+}
+
+static uint32_t hashTile(TileCoord coord)
+{
+    uint32_t h = static_cast<uint32_t>(coord.x) * 0x9E3779B1u ^ static_cast<uint32_t>(coord.z) * 0x85EBCA77u;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    h *= 0x297A2D39u;
+    h ^= h >> 15;
+    return h;
+}
+
+std::unique_ptr<WorldTile> generateTile(TileCoord coord)
+{
+    std::unique_ptr<WorldTile> tile(new WorldTile());
+    tile->coord = coord;
+
+    const int n = WORLD_TILE_VERTICES;
+    const float spacing = WORLD_TILE_SIZE / static_cast<float>(n - 1);
+    tile->vertices.resize(static_cast<std::size_t>(n) * n * 6);
+    float* out = tile->vertices.data();
+    for (int row = 0; row < n; row++)
+    {
+        for (int column = 0; column < n; column++)
+        {
+            float x = column * spacing;
+            float z = row * spacing;
+            float slopeX, slopeZ;
+            float y = oceanSample(coord, x, z, slopeX, slopeZ);
+            glm::vec3 normal = glm::normalize(glm::vec3(-slopeX, 1.0f, -slopeZ));
+            *out++ = x;
+            *out++ = y;
+            *out++ = z;
+            *out++ = normal.x;
+            *out++ = normal.y;
+            *out++ = normal.z;
+        }
+    }
+
+    // about one tile in four has a task group of two to four ships in line astern. the carrier the
+    // sim aims at sits on the corner the four tiles around the origin share, so they are left to it
+    uint32_t seed = hashTile(coord);
+    bool besideCarrier = coord.x >= -1 && coord.x <= 0 && coord.z >= -1 && coord.z <= 0;
+    if (!besideCarrier && (seed & 3u) == 0)
+    {
+        auto next = [&seed]() {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<float>(seed >> 8) / 16777216.0f;
+        };
+        int ships = 2 + static_cast<int>(next() * 3.0f);
+        float heading = next() * 6.2831853f;
+        glm::vec2 along(std::sin(heading), std::cos(heading));
+        glm::vec2 center(400.0f + next() * (WORLD_TILE_SIZE - 800.0f), 400.0f + next() * (WORLD_TILE_SIZE - 800.0f));
+        for (int i = 0; i < ships; i++)
+        {
+            StreamedShip ship;
+            ship.offset = center + along * ((i - 0.5f * (ships - 1)) * 260.0f);
+            ship.heading = heading;
+            tile->ships.push_back(ship);
+        }
+    }
+    return tile;
+}
+
+// streamer
+// ---------------------------------------------------------------------------------------------
+WorldStreamer::WorldStreamer(JobSystem& jobs, const StreamingSettings& settings)
+    : jobs(jobs), config(settings)
+{
+    config.unloadRadius = std::max(config.unloadRadius, config.loadRadius);
+    std::size_t side = static_cast<std::size_t>(2 * config.loadRadius + 1);
+    config.maxResident = std::max(config.maxResident, side * side);
+    config.maxInFlight = std::max<std::size_t>(config.maxInFlight, 1);
+    // sized once, so moving around the world never allocates on the render thread
+    tiles.reserve(config.maxResident + config.maxInFlight);
+    pending.reserve(config.maxInFlight);
+}
+
+WorldStreamer::~WorldStreamer()
+{
+    jobs.wait(generating);
+}
+
+bool WorldStreamer::isResident(TileCoord coord) const
+{
+    for (const std::unique_ptr<WorldTile>& tile : tiles)
+        if (tile->coord == coord)
+            return true;
+    return false;
+}
+
+bool WorldStreamer::isPending(TileCoord coord) const
+{
+    for (const PendingTile& tile : pending)
+        if (tile.coord == coord)
+            return true;
+    return false;
+}
+
+void WorldStreamer::unload(std::size_t index, const std::function<void(WorldTile&)>& onUnload)
+{
+    if (onUnload)
+        onUnload(*tiles[index]);
+    tiles[index] = std::move(tiles.back());
+    tiles.pop_back();
+    streamingStats.unloaded++;
+}
+
+void WorldStreamer::refreshStats()
+{
+    streamingStats.resident = tiles.size();
+    streamingStats.loading = pending.size();
+    streamingStats.peakResident = std::max(streamingStats.peakResident, tiles.size());
+    streamingStats.residentBytes = tiles.size() * WorldTile::meshBytes();
+}
+
+void WorldStreamer::update(TileCoord playerTile, const std::function<void(WorldTile&)>& onUnload)
+{
+    PROFILE_SCOPE("world streaming");
+    player = playerTile;
+
+    // out of range: resident tiles go, tiles still generating are forgotten and dropped when they arrive
+    for (std::size_t i = tiles.size(); i-- > 0;)
+        if (tileDistance(tiles[i]->coord, player) > config.unloadRadius)
+            unload(i, onUnload);
+    for (std::size_t i = pending.size(); i-- > 0;)
+    {
+        if (tileDistance(pending[i].coord, player) > config.unloadRadius)
+        {
+            pending[i] = pending.back();
+            pending.pop_back();
+        }
+    }
+
+    // missing tiles in range, ring by ring outwards so the tile under the plane comes first
+    for (int32_t ring = 0; ring <= config.loadRadius && pending.size() < config.maxInFlight; ring++)
+    {
+        for (int32_t dz = -ring; dz <= ring && pending.size() < config.maxInFlight; dz++)
+        {
+            for (int32_t dx = -ring; dx <= ring && pending.size() < config.maxInFlight; dx++)
+            {
+                if (std::max(std::abs(dx), std::abs(dz)) != ring)
+                    continue;
+                TileCoord coord;
+                coord.x = player.x + dx;
+                coord.z = player.z + dz;
+                if (isResident(coord) || isPending(coord))
+                    continue;
+                PendingTile request;
+                request.coord = coord;
+                request.requestTime = clockMs();
+                pending.push_back(request);
+                streamingStats.requested++;
+                jobs.submit([this, coord] {
+                    std::unique_ptr<WorldTile> tile = generateTile(coord);
+                    std::lock_guard<std::mutex> guard(finishedLock);
+                    finished.push_back(std::move(tile));
+                }, &generating);
+            }
+        }
+    }
+
+    // over the cap (only possible between the load and unload radius): farthest first
+    while (tiles.size() > config.maxResident)
+    {
+        std::size_t farthest = 0;
+        for (std::size_t i = 1; i < tiles.size(); i++)
+            if (tileDistance(tiles[i]->coord, player) > tileDistance(tiles[farthest]->coord, player))
+                farthest = i;
+        unload(farthest, onUnload);
+    }
+    refreshStats();
+}
+
+std::size_t WorldStreamer::collect(std::size_t maxTiles, const std::function<void(WorldTile&)>& onLoaded)
+{
+    PROFILE_SCOPE("world streaming");
+    std::size_t collected = 0;
+    while (collected < maxTiles)
+    {
+        std::unique_ptr<WorldTile> tile;
+        {
+            std::lock_guard<std::mutex> guard(finishedLock);
+            if (finished.empty())
+                break;
+            tile = std::move(finished.back());
+            finished.pop_back();
+        }
+
+        std::size_t request = pending.size();
+        for (std::size_t i = 0; i < pending.size(); i++)
+            if (pending[i].coord == tile->coord)
+                request = i;
+        if (request == pending.size())
+        {
+            streamingStats.cancelled++;
+            continue;
+        }
+        tile->loadMs = clockMs() - pending[request].requestTime;
+        pending[request] = pending.back();
+        pending.pop_back();
+
+        if (onLoaded)
+            onLoaded(*tile);
+        streamingStats.loaded++;
+        streamingStats.lastLoadMs = tile->loadMs;
+        streamingStats.maxLoadMs = std::max(streamingStats.maxLoadMs, tile->loadMs);
+        streamingStats.totalLoadMs += tile->loadMs;
+        tiles.push_back(std::move(tile));
+        collected++;
+    }
+    refreshStats();
+    return collected;
+}
+
+void WorldStreamer::clear(const std::function<void(WorldTile&)>& onUnload)
+{
+    waitForLoads();
+    {
+        std::lock_guard<std::mutex> guard(finishedLock);
+        finished.clear();
+    }
+    pending.clear();
+    while (!tiles.empty())
+        unload(tiles.size() - 1, onUnload);
+    refreshStats();
+}
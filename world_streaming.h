@@ -0,0 +1,147 @@
+#ifndef WORLD_STREAMING_H
+#define WORLD_STREAMING_H
+
+#include "job_system.h"
+#include "simulation.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// the open ocean around the player, cut into WORLD_TILE_SIZE tiles that are generated on the job
+// system as the plane approaches and dropped once it is far enough away. tiles are addressed by
+// integer coordinates so nothing here loses precision however long the flight; positions inside a
+// tile are relative to its corner. nothing in here needs GL.
+
+// vertices along one side of a tile's ocean grid
+const int WORLD_TILE_VERTICES = 65;
+// the swell never leaves +-this around sea level
+const float OCEAN_SWELL_HEIGHT = 3.0f;
+
+struct TileCoord
+{
+    int32_t x = 0;
+    int32_t z = 0;
+    bool operator==(const TileCoord& other) const { return x == other.x && z == other.z; }
+    bool operator!=(const TileCoord& other) const { return !(*this == other); }
+};
+
+// the tile a position relative to the origin tile lies in
+TileCoord tileAt(int32_t originTileX, int32_t originTileZ, glm::vec3 local);
+// tiles between a and b along the longer axis
+int32_t tileDistance(TileCoord a, TileCoord b);
+// where a tile's corner is, seen from the origin tile; exact while the two are within 2^13 tiles
+glm::vec3 tileOffset(TileCoord tile, int32_t originTileX, int32_t originTileZ);
+
+// a ship of a streamed task group: where in its tile and which way it faces (radians about y)
+struct StreamedShip
+{
+    glm::vec2 offset;
+    float heading;
+};
+
+struct WorldTile
+{
+    TileCoord coord;
+    // WORLD_TILE_VERTICES^2 vertices of position then normal, positions relative to the tile corner.
+    // freed once the renderer has uploaded them
+    std::vector<float> vertices;
+    std::vector<StreamedShip> ships;
+    // owned by the OceanRenderer
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+    // request to resident, measured by the streamer
+    double loadMs = 0.0;
+
+    static std::size_t meshBytes() { return WORLD_TILE_VERTICES * WORLD_TILE_VERTICES * 6 * sizeof(float); }
+};
+
+// ocean height at a world position given as tile plus offset inside it; the same everywhere a
+// tile edge is shared, so neighbours meet without seams
+float oceanHeight(TileCoord tile, float localX, float localZ);
+// builds a tile's mesh and ship group; deterministic per coordinate
+std::unique_ptr<WorldTile> generateTile(TileCoord coord);
+
+struct StreamingSettings
+{
+    // tiles within this many of the player's are loaded, tiles beyond unloadRadius dropped; the gap
+    // keeps a plane flying along a tile edge from loading and dropping the same row over and over
+    int32_t loadRadius = 2;
+    int32_t unloadRadius = 3;
+    // hard cap on resident tiles, the farthest go first; never below the load square
+    std::size_t maxResident = 40;
+    // tiles generating at once
+    std::size_t maxInFlight = 4;
+};
+
+struct StreamingStats
+{
+    uint64_t requested = 0;
+    uint64_t loaded = 0;
+    uint64_t unloaded = 0;
+    uint64_t cancelled = 0; // out of range again before they finished loading
+    std::size_t resident = 0;
+    std::size_t loading = 0;
+    std::size_t peakResident = 0;
+    std::size_t residentBytes = 0;
+    double lastLoadMs = 0.0;
+    double maxLoadMs = 0.0;
+    double totalLoadMs = 0.0;
+};
+
+class WorldStreamer
+{
+public:
+    WorldStreamer(JobSystem& jobs, const StreamingSettings& settings = StreamingSettings());
+    // waits for the tiles still generating
+    ~WorldStreamer();
+    WorldStreamer(const WorldStreamer&) = delete;
+    WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+    // once per frame: drops tiles that are too far (onUnload runs first, to free their GL objects)
+    // and requests the missing tiles around the player, nearest first
+    void update(TileCoord playerTile, const std::function<void(WorldTile&)>& onUnload = nullptr);
+    // makes up to maxTiles finished tiles resident, onLoaded running on each first (to upload it);
+    // returns how many
+    std::size_t collect(std::size_t maxTiles, const std::function<void(WorldTile&)>& onLoaded = nullptr);
+    // blocks until every requested tile has finished generating, for runs that must draw the same
+    // tiles every time
+    void waitForLoads() { jobs.wait(generating); }
+    // whether any requested tile is still generating
+    bool loading() const { return !generating.done(); }
+    // drops every tile, e.g. before the GL context goes away
+    void clear(const std::function<void(WorldTile&)>& onUnload = nullptr);
+
+    const std::vector<std::unique_ptr<WorldTile>>& resident() const { return tiles; }
+    const StreamingStats& stats() const { return streamingStats; }
+    const StreamingSettings& settings() const { return config; }
+
+private:
+    struct PendingTile
+    {
+        TileCoord coord;
+        double requestTime;
+    };
+
+    JobSystem& jobs;
+    StreamingSettings config;
+    StreamingStats streamingStats;
+    TileCoord player;
+    std::vector<std::unique_ptr<WorldTile>> tiles;
+    std::vector<PendingTile> pending;
+    JobCounter generating;
+    std::mutex finishedLock;
+    std::vector<std::unique_ptr<WorldTile>> finished;
+
+    bool isResident(TileCoord coord) const;
+    bool isPending(TileCoord coord) const;
+    void unload(std::size_t index, const std::function<void(WorldTile&)>& onUnload);
+    void refreshStats();
+};
+
+#endif